@@ -0,0 +1,36 @@
+find_path(BROTLI_INCLUDE_DIR brotli/encode.h
+	HINTS
+	$ENV{BROTLI_DIR}
+	PATH_SUFFIXES include
+	PATHS
+	/usr/local
+	/usr
+)
+
+find_library(BROTLI_ENC_LIBRARY
+	NAMES brotlienc
+	HINTS
+	$ENV{BROTLI_DIR}
+)
+
+find_library(BROTLI_DEC_LIBRARY
+	NAMES brotlidec
+	HINTS
+	$ENV{BROTLI_DIR}
+)
+
+find_library(BROTLI_COMMON_LIBRARY
+	NAMES brotlicommon
+	HINTS
+	$ENV{BROTLI_DIR}
+)
+
+if(BROTLI_ENC_LIBRARY AND BROTLI_DEC_LIBRARY AND BROTLI_COMMON_LIBRARY AND BROTLI_INCLUDE_DIR)
+	set(BROTLI_LIBRARIES
+		${BROTLI_ENC_LIBRARY}
+		${BROTLI_DEC_LIBRARY}
+		${BROTLI_COMMON_LIBRARY}
+	)
+	message(STATUS "Found Brotli: ${BROTLI_LIBRARIES}")
+	set(BROTLI_FOUND TRUE)
+endif()
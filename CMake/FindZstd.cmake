@@ -0,0 +1,19 @@
+find_path(ZSTD_INCLUDE_DIR zstd.h
+	HINTS
+	$ENV{ZSTD_DIR}
+	PATH_SUFFIXES include/zstd include
+	PATHS
+	/usr/local
+	/usr
+)
+
+find_library(ZSTD_LIBRARY
+	NAMES zstd
+	HINTS
+	$ENV{ZSTD_DIR}
+)
+
+if(ZSTD_LIBRARY AND ZSTD_INCLUDE_DIR)
+	message(STATUS "Found zstd: ${ZSTD_LIBRARY}")
+	set(ZSTD_FOUND TRUE)
+endif()
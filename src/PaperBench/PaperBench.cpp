@@ -0,0 +1,416 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "PaperCommon/Compression/LZMA.h"
+#include "PaperCommon/QR/Coding.h"
+#include "PaperCommon/QR/Encoder.h"
+#include "PaperCommon/Util/IO.h"
+#include "PaperCommon/Util/Memstream.h"
+#include "PaperCommon/Util/Parallel.h"
+
+namespace
+{
+/**
+ * \brief This constant defines the input sizes to benchmark, in bytes.
+ */
+const std::size_t INPUT_SIZES[] = {1024, 16384, 262144, 1048576};
+
+/**
+ * \brief This constant defines roughly how many input bytes each benchmark
+ * should process in total, to keep the run time of each size comparable.
+ */
+constexpr std::size_t BYTES_PER_BENCHMARK = 8 * 1048576;
+
+/**
+ * \brief This constant defines the minimum number of times each compression
+ * benchmark is run, however large its input.
+ */
+constexpr std::size_t MIN_COMPRESS_ITERATIONS = 4;
+
+/**
+ * \brief This constant defines how many small inputs the batch benchmark
+ * compresses, mimicking an export of many small files.
+ */
+constexpr std::size_t BATCH_COUNT = 2000;
+
+/**
+ * \brief This constant defines the QR code versions to benchmark encoding.
+ */
+const int QR_VERSIONS[] = {10, 25, 40};
+
+/**
+ * \brief This constant defines how many full QR codes each parallel encoding
+ * benchmark produces.
+ */
+constexpr std::size_t PARALLEL_QR_COUNT = 200;
+
+/**
+ * This function generates some moderately compressible text-like data of
+ * the given size. The output is deterministic, so results are comparable
+ * between runs.
+ *
+ * \param size The number of bytes to generate.
+ * \return The generated data.
+ */
+std::vector<uint8_t> generateInput(std::size_t size)
+{
+	static const char *WORDS[] = {"paper ", "data ",  "code ", "the ",
+	                              "qr ",    "store ", "load ", "of ",
+	                              "using ", "an ",    "and\n", "bits "};
+
+	std::vector<uint8_t> data;
+	data.reserve(size);
+
+	uint32_t state = 1;
+	while(data.size() < size)
+	{
+		state = state * 1103515245 + 12345;
+		for(const char *c = WORDS[(state >> 16) % 12];
+		    (*c != '\0') && (data.size() < size); ++c)
+		{
+			data.push_back(static_cast<uint8_t>(*c));
+		}
+	}
+
+	return data;
+}
+
+/**
+ * This function runs the given function the given number of times, and
+ * returns the average time each run took, in microseconds. The function is
+ * run once beforehand, untimed, to warm up caches and the allocator.
+ *
+ * \param iterations The number of times to run the function.
+ * \param fn The function to benchmark.
+ * \return The average run time, in microseconds.
+ */
+double timeRuns(std::size_t iterations, const std::function<void()> &fn)
+{
+	fn();
+
+	auto start = std::chrono::steady_clock::now();
+	for(std::size_t i = 0; i < iterations; ++i)
+		fn();
+	auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::micro>(end - start).count() /
+	       static_cast<double>(iterations);
+}
+
+/**
+ * This function compresses the given data through the stdio path, using a
+ * memory-backed FILE for both the input and the output.
+ *
+ * \param dst The shared pointer to store the result inside.
+ * \param src The buffer containing the data to compress.
+ * \param srcSize The length of the input buffer.
+ * \param options The compression options to use.
+ * \return The size of the result buffer.
+ */
+std::size_t stdioCompress(std::shared_ptr<uint8_t> &dst, const uint8_t *src,
+                          std::size_t srcSize,
+                          const paper::compression::LZMAOptions &options)
+{
+	paper::util::Memstream dstStream;
+	std::shared_ptr<FILE> srcFile(
+	        paper::util::io::openMemory(src, srcSize));
+	paper::compression::lzmaCompress(dstStream.getFile(), srcFile.get(),
+	                                 options);
+	dst.reset(dstStream.detach(), free);
+	return dstStream.getSize();
+}
+
+/**
+ * This function decompresses the given data through the stdio path, using a
+ * memory-backed FILE for both the input and the output.
+ *
+ * \param dst The shared pointer to store the result inside.
+ * \param src The buffer containing the data to decompress.
+ * \param srcSize The length of the input buffer.
+ * \return The size of the result buffer.
+ */
+std::size_t stdioDecompress(std::shared_ptr<uint8_t> &dst, const uint8_t *src,
+                            std::size_t srcSize)
+{
+	paper::util::Memstream dstStream;
+	std::shared_ptr<FILE> srcFile(
+	        paper::util::io::openMemory(src, srcSize));
+	paper::compression::lzmaDecompress(dstStream.getFile(), srcFile.get());
+	dst.reset(dstStream.detach(), free);
+	return dstStream.getSize();
+}
+
+/**
+ * This function benchmarks the single-shot in-memory LZMA path against the
+ * stdio path for one input size and format, printing one row of results.
+ *
+ * \param size The input size to benchmark.
+ * \param format The LZMA container format to benchmark.
+ */
+void benchmark(std::size_t size, paper::compression::LZMAFormat format)
+{
+	using namespace paper::compression;
+
+	LZMAOptions options;
+	options.threads = 1;
+	options.level = 6;
+	options.format = format;
+
+	std::vector<uint8_t> input(generateInput(size));
+	// Compressing the largest inputs is dominated by the encoder itself,
+	// so a single run would mostly measure noise between the two paths.
+	std::size_t iterations = std::max<std::size_t>(
+	        MIN_COMPRESS_ITERATIONS, BYTES_PER_BENCHMARK / 8 / size);
+
+	std::shared_ptr<uint8_t> compressed;
+	std::size_t compressedSize = 0;
+	double fastCompress = timeRuns(iterations, [&]()
+	                               {
+		compressedSize = lzmaCompress(compressed, input.data(),
+		                              input.size(), options);
+	});
+
+	std::shared_ptr<uint8_t> stdioCompressed;
+	double slowCompress = timeRuns(iterations, [&]()
+	                               {
+		stdioCompress(stdioCompressed, input.data(), input.size(),
+		              options);
+	});
+
+	iterations = std::max<std::size_t>(1, BYTES_PER_BENCHMARK / size);
+
+	std::vector<uint8_t> output(size);
+	double fastDecompress = timeRuns(iterations, [&]()
+	                                 {
+		if(lzmaDecompress(output.data(), output.size(),
+		                  compressed.get(), compressedSize) != size)
+		{
+			throw std::runtime_error("Decompressed size mismatch.");
+		}
+	});
+
+	std::shared_ptr<uint8_t> decompressed;
+	double slowDecompress = timeRuns(iterations, [&]()
+	                                 {
+		if(stdioDecompress(decompressed, compressed.get(),
+		                   compressedSize) != size)
+		{
+			throw std::runtime_error("Decompressed size mismatch.");
+		}
+	});
+
+	std::cout << std::setw(4) << (format == LZMAFormat::XZ ? "xz" : "raw")
+	          << std::setw(10) << size << std::setw(10) << compressedSize
+	          << std::setw(14) << slowCompress << std::setw(14)
+	          << fastCompress << std::setw(14) << slowDecompress
+	          << std::setw(14) << fastDecompress << "\n";
+}
+
+/**
+ * This function benchmarks compressing many small inputs one at a time,
+ * comparing the free lzmaCompress function (which builds a fresh encoder
+ * for every call) against a reused LZMAContext.
+ *
+ * \param format The LZMA container format to benchmark.
+ * \param level The compression preset level to use.
+ */
+void benchmarkBatch(paper::compression::LZMAFormat format, uint32_t level)
+{
+	using namespace paper::compression;
+
+	LZMAOptions options;
+	options.threads = 1;
+	options.level = level;
+	options.format = format;
+	options.filter = Filter(FilterType::None);
+
+	// Inputs between 256 bytes and 4 KiB, with varying sizes so the
+	// allocator can't trivially hand back the same block every time.
+	std::vector<std::vector<uint8_t>> inputs;
+	std::size_t totalSize = 0;
+	for(std::size_t i = 0; i < BATCH_COUNT; ++i)
+	{
+		inputs.push_back(generateInput(256 + (i * 2654435761u) % 3840));
+		totalSize += inputs.back().size();
+	}
+
+	std::shared_ptr<uint8_t> compressed;
+	double freeTime = timeRuns(1, [&]()
+	                           {
+		for(const std::vector<uint8_t> &input : inputs)
+		{
+			lzmaCompress(compressed, input.data(), input.size(),
+			             options);
+		}
+	});
+
+	LZMAContext context;
+	double contextTime = timeRuns(1, [&]()
+	                              {
+		for(const std::vector<uint8_t> &input : inputs)
+		{
+			context.compress(compressed, input.data(), input.size(),
+			                 options);
+		}
+	});
+
+	std::cout << std::setw(4) << (format == LZMAFormat::XZ ? "xz" : "raw")
+	          << std::setw(6) << level << std::setw(10) << BATCH_COUNT
+	          << std::setw(12) << totalSize << std::setw(14)
+	          << freeTime / 1000.0 << std::setw(14) << contextTime / 1000.0
+	          << std::setw(14) << context.getReservedMemory() / 1024
+	          << "\n";
+}
+
+/**
+ * This function benchmarks encoding a full QR code of the given version,
+ * printing one row of results.
+ *
+ * \param version The QR code version to benchmark.
+ */
+void benchmarkQR(int version)
+{
+	using namespace paper::qr;
+
+	std::size_t size = getCapacity(version, QRCode::ErrorCorrection::Low);
+	std::vector<uint8_t> input(generateInput(size));
+
+	std::size_t width = 0;
+	double encode = timeRuns(100, [&]()
+	                         {
+		width = encodeSymbol(input.data(), input.size(), version,
+		                     QRCode::ErrorCorrection::Low)
+		                .getWidth();
+	});
+
+	std::cout << std::setw(8) << version << std::setw(10) << size
+	          << std::setw(10) << width << std::setw(14) << encode
+	          << "\n";
+}
+
+/**
+ * This function benchmarks encoding a multi-code export with the given number
+ * of worker threads, printing one row of results.
+ *
+ * \param workers The number of worker threads to use.
+ * \param baseline The single-threaded time to compare against, or 0.
+ * \return The time taken, in milliseconds.
+ */
+double benchmarkParallelQR(std::size_t workers, double baseline)
+{
+	std::vector<uint8_t> input(generateInput(
+	        PARALLEL_QR_COUNT * paper::qr::getMaximumCapacity()));
+
+	std::size_t codes = 0;
+	double encode = timeRuns(3, [&]()
+	                         {
+		codes = paper::qr::encode(input.data(), input.size(), workers)
+		                .size();
+	}) / 1000.0;
+
+	std::cout << std::setw(8) << workers << std::setw(10) << codes
+	          << std::setw(14) << encode << std::setw(10)
+	          << (baseline > 0.0 ? baseline / encode : 1.0) << "\n";
+	return encode;
+}
+}
+
+int main(int, char **)
+{
+	try
+	{
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << "LZMA batches of small inputs (total "
+		          << "milliseconds):\n\n";
+		std::cout << std::setw(4) << "fmt" << std::setw(6) << "level"
+		          << std::setw(10) << "inputs" << std::setw(12)
+		          << "bytes" << std::setw(14) << "free fn"
+		          << std::setw(14) << "context" << std::setw(14)
+		          << "arena KiB"
+		          << "\n";
+
+		for(paper::compression::LZMAFormat format :
+		    {paper::compression::LZMAFormat::XZ,
+		     paper::compression::LZMAFormat::Raw})
+		{
+			for(uint32_t level : {0u, 6u})
+				benchmarkBatch(format, level);
+		}
+
+		std::cout << "\nLZMA in-memory codec paths (average "
+		          << "microseconds per call):\n\n";
+		std::cout << std::setw(4) << "fmt" << std::setw(10) << "input"
+		          << std::setw(10) << "output" << std::setw(14)
+		          << "stdio comp" << std::setw(14) << "direct comp"
+		          << std::setw(14) << "stdio decomp" << std::setw(14)
+		          << "direct decomp"
+		          << "\n";
+
+		for(paper::compression::LZMAFormat format :
+		    {paper::compression::LZMAFormat::XZ,
+		     paper::compression::LZMAFormat::Raw})
+		{
+			for(std::size_t size : INPUT_SIZES)
+				benchmark(size, format);
+		}
+
+		std::cout << "\nQR code encoding (average microseconds per "
+		          << "symbol):\n\n";
+		std::cout << std::setw(8) << "version" << std::setw(10)
+		          << "bytes" << std::setw(10) << "width"
+		          << std::setw(14) << "encode"
+		          << "\n";
+
+		for(int version : QR_VERSIONS)
+			benchmarkQR(version);
+
+		std::cout << "\nParallel QR code encoding (total "
+		          << "milliseconds):\n\n";
+		std::cout << std::setw(8) << "workers" << std::setw(10)
+		          << "codes" << std::setw(14) << "encode"
+		          << std::setw(10) << "speedup"
+		          << "\n";
+
+		double baseline = benchmarkParallelQR(1, 0.0);
+		std::size_t cores = paper::util::getOnlineCores();
+		for(std::size_t workers = 2; workers < cores; workers *= 2)
+			benchmarkParallelQR(workers, baseline);
+		if(cores > 1)
+			benchmarkParallelQR(cores, baseline);
+	}
+	catch(std::exception &e)
+	{
+		std::cerr << "Exception: " << e.what() << "\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -18,9 +18,14 @@
 
 #include "PaperCLI.h"
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <iomanip>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <set>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -32,8 +37,15 @@
 #include <QTimer>
 
 #include "PaperCommon/Functionality.h"
+#include "PaperCommon/Compression/Codec.h"
+#include "PaperCommon/Compression/Dictionary.h"
+#include "PaperCommon/Compression/Filters.h"
+#include "PaperCommon/Compression/LZMA.h"
 #include "PaperCommon/QR/QRCode.h"
+#include "PaperCommon/Symbol/Symbol.h"
 #include "PaperCommon/Util/FS.h"
+#include "PaperCommon/Util/IO.h"
+#include "PaperCommon/Util/Parallel.h"
 
 namespace
 {
@@ -43,29 +55,633 @@ void printGlobalHelp()
 
 	std::cout << "Commands:\n";
 	std::cout << "\texport - Create a QR code containing data.\n";
+	std::cout << "\timport - Restore data from scanned QR codes.\n";
+	std::cout << "\ttrain-dict - Build a compression dictionary.\n";
+	std::cout << "\tverify - Check exported SVGs restore a file.\n";
+}
+
+/**
+ * The options the export command accepts.
+ */
+const std::set<std::string> EXPORT_OPTIONS = {
+        "codec",      "no-probe",     "group-size",    "frame",
+        "parity",     "stripe",       "color",         "verify",
+        "threads",    "qr-threads",   "symbology",     "max-version",
+        "ec-level",   "max-codes",    "block-size",    "level",
+        "extreme",    "memory-limit", "lzma-raw",      "no-checksum",
+        "dictionary", "filter",       "zstd-level",    "zstd-long",
+        "brotli-quality"};
+
+/**
+ * The options getDecodeOptions understands, which the import and verify
+ * commands accept.
+ */
+const std::set<std::string> DECODE_OPTIONS = {
+        "color", "threads", "memory-limit", "output-limit", "dictionary"};
+
+/**
+ * The options the train-dict command accepts.
+ */
+const std::set<std::string> TRAIN_DICT_OPTIONS = {"size"};
+
+/**
+ * This function parses the given "--name value" and "--flag" style options
+ * into a map from option name (without leading dashes) to value. Flags which
+ * have no value are mapped to an empty string. If an option isn't one of the
+ * given accepted options (e.g. because of a typo), an exception is thrown,
+ * rather than silently ignoring it.
+ *
+ * \param argit The first argument to parse.
+ * \param argend The end of the argument list.
+ * \param accepted The names of the options the command accepts.
+ * \return The parsed options.
+ */
+std::map<std::string, std::string>
+parseOptions(QStringList::const_iterator argit,
+             QStringList::const_iterator argend,
+             const std::set<std::string> &accepted)
+{
+	std::map<std::string, std::string> options;
+
+	while(argit != argend)
+	{
+		QString name = *(argit++);
+		if(!name.startsWith("--"))
+		{
+			throw std::runtime_error("Unexpected argument: " +
+			                         name.toStdString());
+		}
+
+		std::string option = name.toStdString().substr(2);
+		if(accepted.count(option) == 0)
+		{
+			throw std::runtime_error("Unknown option: " +
+			                         name.toStdString());
+		}
+
+		std::string value;
+		if((argit != argend) && !(*argit).startsWith("--"))
+			value = (*(argit++)).toStdString();
+
+		options[option] = value;
+	}
+
+	return options;
+}
+
+/**
+ * This function returns the unsigned integer value of the given option, or
+ * the given default value if the option wasn't specified. If the option's
+ * value isn't a valid unsigned integer, an exception is thrown instead.
+ *
+ * \param options The parsed options to search.
+ * \param name The name of the option to retrieve.
+ * \param def The value to return if the option wasn't specified.
+ * \return The option's value.
+ */
+uint64_t getUnsignedOption(const std::map<std::string, std::string> &options,
+                           const std::string &name, uint64_t def)
+{
+	auto it = options.find(name);
+	if(it == options.end())
+		return def;
+
+	bool ok = false;
+	uint64_t value = QString::fromStdString(it->second).toULongLong(&ok);
+	if(!ok)
+		throw std::runtime_error("Invalid value for --" + name + ".");
+
+	return value;
+}
+
+/**
+ * This function returns the string value of the given option, or the given
+ * default value if the option wasn't specified.
+ *
+ * \param options The parsed options to search.
+ * \param name The name of the option to retrieve.
+ * \param def The value to return if the option wasn't specified.
+ * \return The option's value.
+ */
+std::string getStringOption(const std::map<std::string, std::string> &options,
+                            const std::string &name, const std::string &def)
+{
+	auto it = options.find(name);
+	return it == options.end() ? def : it->second;
+}
+
+/**
+ * This function builds the encoding options described by the given parsed
+ * command-line options.
+ *
+ * \param options The parsed options to apply.
+ * \return The resulting encoding options.
+ */
+paper::EncodeOptions
+getEncodeOptions(const std::map<std::string, std::string> &options)
+{
+	paper::EncodeOptions encodeOptions;
+	paper::compression::CompressionOptions &compression =
+	        encodeOptions.compression;
+
+	encodeOptions.codec =
+	        getStringOption(options, "codec", encodeOptions.codec);
+	encodeOptions.probe = options.count("no-probe") == 0;
+	encodeOptions.groupSize = getUnsignedOption(options, "group-size",
+	                                            encodeOptions.groupSize);
+	encodeOptions.frame = options.count("frame") > 0;
+	encodeOptions.erasure.dataChunks =
+	        static_cast<std::size_t>(getUnsignedOption(
+	                options, "stripe", encodeOptions.erasure.dataChunks));
+	encodeOptions.erasure.parityChunks =
+	        static_cast<std::size_t>(getUnsignedOption(
+	                options, "parity", encodeOptions.erasure.parityChunks));
+
+	compression.lzma.threads = static_cast<uint32_t>(getUnsignedOption(
+	        options, "threads", compression.lzma.threads));
+	encodeOptions.qrThreads = static_cast<std::size_t>(getUnsignedOption(
+	        options, "qr-threads", encodeOptions.qrThreads));
+	encodeOptions.layout.symbology = paper::symbol::parseSymbology(
+	        getStringOption(options, "symbology", "qr"));
+	encodeOptions.layout.maximumVersion = static_cast<int>(
+	        getUnsignedOption(options, "max-version", 40));
+	encodeOptions.layout.errorCorrection = paper::qr::parseErrorCorrection(
+	        getStringOption(options, "ec-level", "L"));
+	encodeOptions.layout.maximumCodes = static_cast<std::size_t>(
+	        getUnsignedOption(options, "max-codes", 0));
+	compression.lzma.blockSize = getUnsignedOption(
+	        options, "block-size", compression.lzma.blockSize);
+	compression.lzma.level = static_cast<uint32_t>(
+	        getUnsignedOption(options, "level", compression.lzma.level));
+	compression.lzma.extreme = options.count("extreme") > 0;
+	compression.lzma.memoryLimit = getUnsignedOption(
+	        options, "memory-limit", compression.lzma.memoryLimit);
+	if(options.count("lzma-raw") > 0)
+		compression.lzma.format = paper::compression::LZMAFormat::Raw;
+	compression.lzma.checksum = options.count("no-checksum") == 0;
+	compression.lzma.filter = paper::compression::parseFilter(
+	        getStringOption(options, "filter", "auto"));
+
+	std::string dictionary = getStringOption(options, "dictionary", "");
+	if(!dictionary.empty())
+	{
+		compression.lzma.format = paper::compression::LZMAFormat::Raw;
+		compression.lzma.dictionary =
+		        paper::compression::Dictionary::load(dictionary);
+	}
+
+	compression.zstd.level = static_cast<int>(getUnsignedOption(
+	        options, "zstd-level",
+	        static_cast<uint64_t>(compression.zstd.level)));
+	compression.zstd.longRange = options.count("zstd-long") > 0;
+
+	compression.brotli.quality = static_cast<uint32_t>(getUnsignedOption(
+	        options, "brotli-quality", compression.brotli.quality));
+
+	if((compression.lzma.threads < 1) || (encodeOptions.qrThreads < 1))
+		throw std::runtime_error("At least one thread is required.");
+
+	return encodeOptions;
+}
+
+/**
+ * This function builds the options which control decoding from the given
+ * parsed command line options.
+ *
+ * \param options The parsed command line options.
+ * \return The decoding options.
+ */
+paper::DecodeOptions
+getDecodeOptions(const std::map<std::string, std::string> &options)
+{
+	paper::DecodeOptions decodeOptions;
+	decodeOptions.color = options.count("color") > 0;
+	decodeOptions.threads = static_cast<std::size_t>(getUnsignedOption(
+	        options, "threads", decodeOptions.threads));
+	decodeOptions.compression.lzmaDecoder.memoryLimit = getUnsignedOption(
+	        options, "memory-limit",
+	        decodeOptions.compression.lzmaDecoder.memoryLimit);
+	decodeOptions.compression.lzmaDecoder.outputLimit = getUnsignedOption(
+	        options, "output-limit",
+	        decodeOptions.compression.lzmaDecoder.outputLimit);
+
+	std::string dictionary = getStringOption(options, "dictionary", "");
+	if(!dictionary.empty())
+	{
+		std::shared_ptr<paper::compression::DictionaryStore> store(
+		        new paper::compression::DictionaryStore());
+		store->load(dictionary);
+		decodeOptions.compression.lzmaDecoder.dictionaries = store;
+	}
+
+	if(decodeOptions.threads < 1)
+		throw std::runtime_error("At least one thread is required.");
+
+	return decodeOptions;
 }
 
 void exportCommand(std::size_t argc, QStringList::const_iterator argit,
-                   QStringList::const_iterator)
+                   QStringList::const_iterator argend)
 {
 	if(argc < 1)
 	{
-		std::cout << "Usage: PaperCLI export [file]\n\n";
+		std::cout << "Usage: PaperCLI export [file] [options]\n\n";
 
 		std::cout << "Options:\n";
 		std::cout << "\t[file] - The path to the file to "
 		          << "encode.\n";
+		std::cout << "\t--codec [name] - The compression codec: "
+		          << "store, lzma, zstd, brotli or auto (default: "
+		          << "lzma).\n";
+		std::cout << "\t--no-probe - Compress the input even if it "
+		          << "appears incompressible.\n";
+		std::cout << "\t--group-size [bytes] - Compress the input in "
+		          << "independent groups of this size.\n";
+		std::cout << "\t--frame - Number and checksum each QR code, "
+		          << "so they can be scanned in any order.\n";
+		std::cout << "\t--parity [n] - Add this many parity QR codes "
+		          << "to each stripe, so any n codes can be lost "
+		          << "(implies --frame).\n";
+		std::cout << "\t--stripe [n] - The number of data QR codes in "
+		          << "each parity stripe (default: 10).\n";
+		std::cout << "\t--color - Overlay three QR codes per image, "
+		          << "in cyan, magenta and yellow.\n";
+		std::cout << "\t--verify - Decode the QR codes in memory "
+		          << "while they are rendered, and check that they "
+		          << "restore the file.\n";
+		std::cout << "\t--threads [n] - The number of compression "
+		          << "threads (default: online cores).\n";
+		std::cout << "\t--qr-threads [n] - The number of QR code "
+		          << "encoding threads (default: online cores).\n";
+		std::cout << "\t--symbology [qr|datamatrix|auto] - The kind "
+		          << "of code to store data in; auto picks whichever "
+		          << "needs the least paper (default: qr).\n";
+		std::cout << "\t--max-version [1-40] - The largest QR code "
+		          << "version to use (default: 40).\n";
+		std::cout << "\t--ec-level [L|M|Q|H] - The QR code error "
+		          << "correction level (default: L).\n";
+		std::cout << "\t--max-codes [n] - The maximum number of QR "
+		          << "codes to use (default: unlimited).\n";
+		std::cout << "\t--block-size [bytes] - The uncompressed size "
+		          << "of each threaded compression block.\n";
+		std::cout << "\t--level [0-9] - The compression level "
+		          << "(default: 9).\n";
+		std::cout << "\t--extreme - Use the slower \"extreme\" "
+		          << "variant of the compression level.\n";
+		std::cout << "\t--memory-limit [bytes] - The maximum amount "
+		          << "of memory the compressor may use (default: a "
+		          << "quarter of physical memory, 0 for no limit).\n";
+		std::cout << "\t--lzma-raw - Write compact raw LZMA2 data "
+		          << "instead of the .xz format.\n";
+		std::cout << "\t--no-checksum - Omit the raw LZMA2 "
+		          << "checksum.\n";
+		std::cout << "\t--dictionary [path] - Compress with the given "
+		          << "preset dictionary (implies --lzma-raw).\n";
+		std::cout << "\t--filter [name] - The filter to apply before "
+		          << "LZMA2: auto, none, x86, powerpc, arm, armthumb, "
+		          << "sparc, arm64 or delta:[1-256] (default: auto).\n";
+		std::cout << "\t--zstd-level [1-22] - The zstd compression "
+		          << "level (default: 19).\n";
+		std::cout << "\t--zstd-long - Enable zstd's long distance "
+		          << "matching mode.\n";
+		std::cout << "\t--brotli-quality [0-11] - The Brotli "
+		          << "quality level (default: 11).\n";
 
 		return;
 	}
 
 	QString path = *(argit++);
+	std::map<std::string, std::string> options(
+	        parseOptions(argit, argend, EXPORT_OPTIONS));
+	paper::EncodeOptions encodeOptions(getEncodeOptions(options));
+	bool color = options.count("color") > 0;
+	bool verify = options.count("verify") > 0;
+
+	if((encodeOptions.codec == "lzma") || (encodeOptions.codec == "auto"))
+	{
+		std::cout << "Encoder memory usage: "
+		          << paper::compression::lzmaEncoderMemoryUsage(
+		                     encodeOptions.compression.lzma,
+		                     paper::util::io::filesize(
+		                             path.toStdString()))
+		          << " bytes.\n";
+	}
+
+	paper::EncodeReport report;
+	std::vector<paper::symbol::Symbol> codes(
+	        paper::encode(path.toStdString(), encodeOptions, &report));
+
+	if(report.probed)
+	{
+		std::cout << "Compressibility probe: " << report.probe.entropy
+		          << " bits/byte entropy";
+		if(report.probe.trialRatio > 0.0)
+		{
+			std::cout << ", trial compression ratio "
+			          << report.probe.trialRatio;
+		}
+		std::cout << " over " << report.probe.sampledSize
+		          << " sampled bytes; "
+		          << (report.probe.compressible
+		                      ? "compressing.\n"
+		                      : "storing uncompressed.\n");
+	}
+
+	std::cout << "Compressed " << report.inputSize << " bytes to "
+	          << report.payloadSize << " bytes using " << report.codec
+	          << ", in " << codes.size() << " code(s).\n";
+
+	const paper::symbol::Symbol *largest = &codes.front();
+	for(const paper::symbol::Symbol &code : codes)
+	{
+		if(code.getWidth() * code.getHeight() >
+		   largest->getWidth() * largest->getHeight())
+		{
+			largest = &code;
+		}
+	}
+	std::cout << "The largest code is a "
+	          << paper::symbol::getSymbologyName(largest->getSymbology())
+	          << ", version " << largest->getVersion() << ", "
+	          << largest->getWidth() << "x" << largest->getHeight()
+	          << " modules.\n";
+
+	if(report.exportId != 0)
+	{
+		std::cout << "Each code is framed with export ID "
+		          << report.exportId << ".\n";
+	}
+
+	if(report.groupCount > 0)
+	{
+		std::cout << "The data was split into " << report.groupCount
+		          << " independently compressed group(s).\n";
+	}
+
+	if(color)
+	{
+		std::cout << "Overlaying three codes per colour image.\n";
+	}
+
+	std::string file(path.toStdString());
+	std::string directory(paper::util::fs::dirname(file));
+	std::string name(paper::util::fs::filename(file));
+	if(!verify)
+	{
+		paper::renderSVGs(directory, name, codes, color);
+		return;
+	}
+
+	// Decode the codes as they'd be scanned, to check nothing went wrong
+	// while encoding them. This is independent of rendering, so the two
+	// are done at the same time.
+	paper::DecodeOptions decodeOptions;
+	decodeOptions.threads = encodeOptions.qrThreads;
+	if(encodeOptions.compression.lzma.dictionary)
+	{
+		std::shared_ptr<paper::compression::DictionaryStore> store(
+		        new paper::compression::DictionaryStore());
+		store->add(encodeOptions.compression.lzma.dictionary);
+		decodeOptions.compression.lzmaDecoder.dictionaries = store;
+	}
+
+	paper::VerifyReport verifyReport;
+	bool matches = false;
+	paper::util::parallelFor(
+	        2, 2, [&](std::size_t task)
+	        {
+		        if(task == 0)
+		        {
+			        paper::renderSVGs(directory, name, codes,
+			                          color);
+		        }
+		        else
+		        {
+			        matches = paper::verify(file, codes,
+			                                decodeOptions,
+			                                &verifyReport);
+		        }
+		});
+
+	if(!matches)
+	{
+		throw std::runtime_error("The codes don't restore " + file +
+		                         "!");
+	}
+
+	std::cout << "Verified that the codes restore "
+	          << verifyReport.inputSize << " bytes (CRC32C " << std::hex
+	          << std::setw(8) << std::setfill('0')
+	          << verifyReport.inputChecksum << std::dec << ").\n";
+}
+
+void importCommand(std::size_t argc, QStringList::const_iterator argit,
+                   QStringList::const_iterator argend)
+{
+	if(argc < 2)
+	{
+		std::cout << "Usage: PaperCLI import [output] [images...] "
+		          << "[options]\n\n";
+
+		std::cout << "Options:\n";
+		std::cout << "\t[output] - The path to write the restored "
+		          << "file to.\n";
+		std::cout << "\t[images...] - The scanned images, as PNG, "
+		          << "PBM, PGM or PPM files, or directories of them "
+		          << "(read in name order). Unless the codes are "
+		          << "framed, they must be given in order.\n";
+		std::cout << "\t--color - Each image overlays three QR codes, "
+		          << "in cyan, magenta and yellow.\n";
+		std::cout << "\t--threads [n] - The number of scanning "
+		          << "threads (default: online cores).\n";
+		std::cout << "\t--memory-limit [bytes] - The maximum amount "
+		          << "of memory the decompressor may use (default: a "
+		          << "quarter of physical memory, 0 for no limit).\n";
+		std::cout << "\t--output-limit [bytes] - The largest size "
+		          << "LZMA data may decompress to (default: 0, for no "
+		          << "limit).\n";
+		std::cout << "\t--dictionary [path] - The preset dictionary "
+		          << "the data was compressed with, if any.\n";
+
+		return;
+	}
+
+	QString output = *(argit++);
+
+	std::vector<std::string> images;
+	for(; (argit != argend) && !(*argit).startsWith("--"); ++argit)
+	{
+		std::string image = (*argit).toStdString();
+		if(!paper::util::fs::isDirectory(image))
+		{
+			images.push_back(image);
+			continue;
+		}
+
+		std::vector<std::string> found(paper::findImages(image));
+		images.insert(images.end(), found.begin(), found.end());
+	}
+
+	paper::DecodeOptions decodeOptions(getDecodeOptions(
+	        parseOptions(argit, argend, DECODE_OPTIONS)));
+
+	paper::DecodeReport report;
+	paper::decode(images, output.toStdString(), decodeOptions, &report);
+
+	for(const std::string &unreadable : report.unreadable)
+		std::cout << "Skipped unreadable image " << unreadable << "\n";
+
+	std::cout << "Read " << report.codeCount << " code(s) from "
+	          << images.size() << " image(s).\n";
+
+	if(report.exportId != 0)
+	{
+		std::cout << "The codes were framed with export ID "
+		          << report.exportId << ".\n";
+	}
+
+	if(report.duplicateCount > 0)
+	{
+		std::cout << "Dropped " << report.duplicateCount
+		          << " duplicate code(s).\n";
+	}
+
+	if(report.groupCount > 0)
+	{
+		std::cout << "The data was restored from " << report.groupCount
+		          << " independently compressed group(s).\n";
+	}
+
+	for(const paper::format::GroupGap &gap : report.missingGroups)
+	{
+		std::cout << "Lost block group(s) " << gap.first << " to "
+		          << gap.last - 1 << ": ";
+		if(gap.end == UINT64_MAX)
+		{
+			std::cout << "the data from byte " << gap.begin
+			          << " on is missing.\n";
+		}
+		else
+		{
+			std::cout << "bytes " << gap.begin << " to " << gap.end
+			          << " are zeros.\n";
+		}
+	}
+
+	std::cout << "Restored " << report.outputSize << " bytes to "
+	          << output.toStdString() << ".\n";
+}
+
+void trainDictCommand(std::size_t argc, QStringList::const_iterator argit,
+                      QStringList::const_iterator argend)
+{
+	if(argc < 2)
+	{
+		std::cout << "Usage: PaperCLI train-dict [output] [samples...] "
+		          << "[options]\n\n";
+
+		std::cout << "Options:\n";
+		std::cout << "\t[output] - The path to write the dictionary "
+		          << "to.\n";
+		std::cout << "\t[samples...] - The sample files to train "
+		          << "with.\n";
+		std::cout << "\t--size [bytes] - The maximum dictionary size "
+		          << "(default: 32768).\n";
+
+		return;
+	}
+
+	QString output = *(argit++);
+
+	std::vector<std::vector<uint8_t>> samples;
+	for(; (argit != argend) && !(*argit).startsWith("--"); ++argit)
+	{
+		std::shared_ptr<uint8_t> data;
+		std::size_t size =
+		        paper::util::io::loadFile(data, (*argit).toStdString());
+		samples.push_back(
+		        std::vector<uint8_t>(data.get(), data.get() + size));
+	}
+
+	std::size_t size = static_cast<std::size_t>(getUnsignedOption(
+	        parseOptions(argit, argend, TRAIN_DICT_OPTIONS), "size",
+	        32768));
+
+	std::shared_ptr<paper::compression::Dictionary> dictionary(
+	        paper::compression::trainDictionary(samples, size));
+	dictionary->save(output.toStdString());
+
+	std::cout << "Wrote a " << dictionary->getSize() << " byte dictionary "
+	          << "with ID " << std::hex << std::setw(8) << std::setfill('0')
+	          << dictionary->getId() << std::dec << ".\n";
+}
+
+void verifyCommand(std::size_t argc, QStringList::const_iterator argit,
+                   QStringList::const_iterator argend)
+{
+	if(argc < 1)
+	{
+		std::cout << "Usage: PaperCLI verify [file] [svgs...] "
+		          << "[options]\n\n";
+
+		std::cout << "Options:\n";
+		std::cout << "\t[file] - The file which was exported.\n";
+		std::cout << "\t[svgs...] - The SVG images export wrote, in "
+		          << "order (default: those next to the file).\n";
+		std::cout << "\t--color - Each image overlays three QR codes, "
+		          << "in cyan, magenta and yellow.\n";
+		std::cout << "\t--threads [n] - The number of decoding "
+		          << "threads (default: online cores).\n";
+		std::cout << "\t--memory-limit [bytes] - The maximum amount "
+		          << "of memory the decompressor may use (default: a "
+		          << "quarter of physical memory, 0 for no limit).\n";
+		std::cout << "\t--output-limit [bytes] - The largest size "
+		          << "LZMA data may decompress to (default: 0, for no "
+		          << "limit).\n";
+		std::cout << "\t--dictionary [path] - The preset dictionary "
+		          << "the data was compressed with, if any.\n";
+
+		return;
+	}
+
+	std::string path = (*(argit++)).toStdString();
+
+	std::vector<std::string> svgs;
+	for(; (argit != argend) && !(*argit).startsWith("--"); ++argit)
+		svgs.push_back((*argit).toStdString());
+
+	paper::DecodeOptions decodeOptions(getDecodeOptions(
+	        parseOptions(argit, argend, DECODE_OPTIONS)));
+
+	if(svgs.empty())
+	{
+		svgs = paper::findSVGs(paper::util::fs::dirname(path),
+		                       paper::util::fs::filename(path));
+	}
+	if(svgs.empty())
+		throw std::runtime_error("No SVG images found for " + path);
+
+	paper::VerifyReport report;
+	bool matches = paper::verify(path, svgs, decodeOptions, &report);
 
-	std::vector<std::shared_ptr<paper::qr::QRCode>> codes(
-	        paper::encode(path.toStdString()));
+	for(const std::string &unreadable : report.decode.unreadable)
+		std::cout << "Skipped unreadable image " << unreadable << "\n";
 
-	paper::renderSVGs(paper::util::fs::dirname(path.toStdString()),
-	                  paper::util::fs::filename(path.toStdString()), codes);
+	std::cout << "Read " << report.decode.codeCount << " code(s) from "
+	          << svgs.size() << " image(s).\n";
+
+	std::cout << "Source: " << report.inputSize << " bytes, CRC32C "
+	          << std::hex << std::setw(8) << std::setfill('0')
+	          << report.inputChecksum << std::dec << ".\n";
+	std::cout << "Restored: " << report.decode.outputSize
+	          << " bytes, CRC32C " << std::hex << std::setw(8)
+	          << std::setfill('0') << report.outputChecksum << std::dec
+	          << ".\n";
+
+	if(!matches)
+		throw std::runtime_error("The images don't match " + path);
+
+	std::cout << "Verified " << path << ".\n";
 }
 }
 
@@ -94,6 +710,21 @@ void PaperCLI::run()
 			exportCommand(static_cast<size_t>(args.length() - 2),
 			              args.cbegin() + 2, args.cend());
 		}
+		else if(args.at(1) == "import")
+		{
+			importCommand(static_cast<size_t>(args.length() - 2),
+			              args.cbegin() + 2, args.cend());
+		}
+		else if(args.at(1) == "train-dict")
+		{
+			trainDictCommand(static_cast<size_t>(args.length() - 2),
+			                 args.cbegin() + 2, args.cend());
+		}
+		else if(args.at(1) == "verify")
+		{
+			verifyCommand(static_cast<size_t>(args.length() - 2),
+			              args.cbegin() + 2, args.cend());
+		}
 		else
 		{
 			printGlobalHelp();
@@ -0,0 +1,182 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Brotli.h"
+
+#include <brotli/decode.h>
+#include <brotli/encode.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "PaperCommon/Util/Memory.h"
+
+namespace
+{
+constexpr std::size_t BUFFER_SIZE = 65536;
+
+/**
+ * This function reads as much data as possible from the given file into the
+ * given buffer, throwing an exception if reading fails.
+ *
+ * \param buf The buffer to read data into.
+ * \param src The file to read data from.
+ * \return The number of bytes read, which is less than BUFFER_SIZE only at
+ * EOF.
+ */
+std::size_t readInput(uint8_t *buf, FILE *src)
+{
+	std::size_t read = fread(buf, sizeof(uint8_t), BUFFER_SIZE, src);
+	if(ferror(src) != 0)
+		throw std::runtime_error(strerror(errno));
+	return read;
+}
+
+/**
+ * This function writes the used portion of the given output buffer to the
+ * given file, and then resets the buffer so it can be filled again.
+ *
+ * \param dst The file to write data to.
+ * \param outbuf The start of the output buffer.
+ * \param nextOut The next output position, which is reset to outbuf.
+ * \param availOut The available output space, which is reset as well.
+ */
+void writeOutput(FILE *dst, uint8_t *outbuf, uint8_t *&nextOut,
+                 std::size_t &availOut)
+{
+	std::size_t size = BUFFER_SIZE - availOut;
+	if(fwrite(outbuf, sizeof(uint8_t), size, dst) != size)
+		throw std::runtime_error(strerror(errno));
+
+	nextOut = outbuf;
+	availOut = BUFFER_SIZE;
+}
+}
+
+namespace paper
+{
+namespace compression
+{
+BrotliOptions::BrotliOptions()
+        : quality(BROTLI_MAX_QUALITY), window(BROTLI_MAX_WINDOW_BITS)
+{
+}
+
+void brotliCompress(FILE *dst, FILE *src, const BrotliOptions &options)
+{
+	std::shared_ptr<BrotliEncoderState> state(
+	        BrotliEncoderCreateInstance(nullptr, nullptr, nullptr),
+	        BrotliEncoderDestroyInstance);
+	if(!state)
+		throw std::runtime_error("Creating Brotli encoder failed.");
+
+	if(!BrotliEncoderSetParameter(state.get(), BROTLI_PARAM_QUALITY,
+	                              options.quality) ||
+	   !BrotliEncoderSetParameter(state.get(), BROTLI_PARAM_LGWIN,
+	                              options.window))
+	{
+		throw std::runtime_error("Invalid Brotli compression options.");
+	}
+
+	auto inbuf(util::makeSharedArray<uint8_t>(BUFFER_SIZE));
+	auto outbuf(util::makeSharedArray<uint8_t>(BUFFER_SIZE));
+
+	const uint8_t *nextIn = inbuf.get();
+	std::size_t availIn = 0;
+	uint8_t *nextOut = outbuf.get();
+	std::size_t availOut = BUFFER_SIZE;
+	bool eof = false;
+
+	while(!BrotliEncoderIsFinished(state.get()))
+	{
+		if((availIn == 0) && !eof)
+		{
+			availIn = readInput(inbuf.get(), src);
+			nextIn = inbuf.get();
+			eof = availIn < BUFFER_SIZE;
+		}
+
+		BrotliEncoderOperation op = eof ? BROTLI_OPERATION_FINISH
+		                                : BROTLI_OPERATION_PROCESS;
+		if(!BrotliEncoderCompressStream(state.get(), op, &availIn,
+		                                &nextIn, &availOut, &nextOut,
+		                                nullptr))
+		{
+			throw std::runtime_error("Brotli compression failed.");
+		}
+
+		if((availOut == 0) || BrotliEncoderIsFinished(state.get()))
+			writeOutput(dst, outbuf.get(), nextOut, availOut);
+	}
+}
+
+void brotliDecompress(FILE *dst, FILE *src)
+{
+	std::shared_ptr<BrotliDecoderState> state(
+	        BrotliDecoderCreateInstance(nullptr, nullptr, nullptr),
+	        BrotliDecoderDestroyInstance);
+	if(!state)
+		throw std::runtime_error("Creating Brotli decoder failed.");
+
+	auto inbuf(util::makeSharedArray<uint8_t>(BUFFER_SIZE));
+	auto outbuf(util::makeSharedArray<uint8_t>(BUFFER_SIZE));
+
+	const uint8_t *nextIn = inbuf.get();
+	std::size_t availIn = 0;
+	uint8_t *nextOut = outbuf.get();
+	std::size_t availOut = BUFFER_SIZE;
+
+	BrotliDecoderResult result = BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT;
+	while(result != BROTLI_DECODER_RESULT_SUCCESS)
+	{
+		if(result == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT)
+		{
+			availIn = readInput(inbuf.get(), src);
+			nextIn = inbuf.get();
+
+			if(availIn == 0)
+			{
+				throw std::runtime_error(
+				        "Brotli input data is truncated.");
+			}
+		}
+
+		result = BrotliDecoderDecompressStream(state.get(), &availIn,
+		                                       &nextIn, &availOut,
+		                                       &nextOut, nullptr);
+
+		if(result == BROTLI_DECODER_RESULT_ERROR)
+		{
+			throw std::runtime_error(
+			        std::string("Brotli error: ") +
+			        BrotliDecoderErrorString(
+			                BrotliDecoderGetErrorCode(state.get())));
+		}
+
+		writeOutput(dst, outbuf.get(), nextOut, availOut);
+	}
+
+	if((availIn != 0) || (readInput(inbuf.get(), src) != 0))
+		throw std::runtime_error("Brotli input data error.");
+}
+}
+}
@@ -0,0 +1,75 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_COMPRESSION_BROTLI_H
+#define PAPER_COMPRESSION_BROTLI_H
+
+#include <cstdint>
+#include <cstdio>
+
+namespace paper
+{
+namespace compression
+{
+/**
+ * \brief This structure holds the tunable parameters for Brotli compression.
+ */
+struct BrotliOptions
+{
+	/**
+	 * The Brotli quality level, from 0 to 11. The default is 11, which
+	 * produces the smallest output.
+	 */
+	uint32_t quality;
+
+	/**
+	 * The base-2 logarithm of the sliding window size, from 10 to 24. The
+	 * default is 24, the largest standard window.
+	 */
+	uint32_t window;
+
+	/**
+	 * This constructor initializes all options to their default values.
+	 */
+	BrotliOptions();
+};
+
+/**
+ * This function compresses all of the data read from the given source file
+ * with Brotli, writing the compressed result to the given destination file.
+ *
+ * \param dst The file to write the compressed data to.
+ * \param src The file to read the data to compress from.
+ * \param options The compression options to use.
+ */
+void brotliCompress(FILE *dst, FILE *src,
+                    const BrotliOptions &options = BrotliOptions());
+
+/**
+ * This function decompresses all of the Brotli data read from the given
+ * source file, writing the decompressed result to the given destination file.
+ *
+ * \param dst The file to write the decompressed data to.
+ * \param src The file to read the data to decompress from.
+ */
+void brotliDecompress(FILE *dst, FILE *src);
+}
+}
+
+#endif
@@ -0,0 +1,330 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Codec.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "PaperCommon/Util/IO.h"
+#include "PaperCommon/Util/Memstream.h"
+
+namespace
+{
+/**
+ * \brief The first byte of the .xz format's magic bytes, which payloads
+ * written before codec identifiers were introduced start with.
+ */
+constexpr int XZ_MAGIC = 0xFD;
+
+/**
+ * \brief This codec stores data as-is, for inputs which don't compress.
+ */
+class StoreCodec : public paper::compression::Codec
+{
+public:
+	virtual paper::compression::CodecId getId() const
+	{
+		return paper::compression::CodecId::Store;
+	}
+
+	virtual std::string getName() const
+	{
+		return "store";
+	}
+
+	virtual void compress(FILE *dst, FILE *src) const
+	{
+		paper::util::io::copyFile(dst, src);
+	}
+
+	virtual void decompress(FILE *dst, FILE *src) const
+	{
+		paper::util::io::copyFile(dst, src);
+	}
+};
+
+/**
+ * \brief This codec compresses data into the .xz format using liblzma.
+ */
+class LZMACodec : public paper::compression::Codec
+{
+public:
+	LZMACodec(const paper::compression::LZMAOptions &o,
+	          const paper::compression::LZMADecoderOptions &d)
+	        : options(o), decoderOptions(d)
+	{
+	}
+
+	virtual paper::compression::CodecId getId() const
+	{
+		return paper::compression::CodecId::LZMA;
+	}
+
+	virtual std::string getName() const
+	{
+		return "lzma";
+	}
+
+	virtual bool isSelfDescribing() const
+	{
+		return options.format == paper::compression::LZMAFormat::XZ;
+	}
+
+	virtual void compress(FILE *dst, FILE *src) const
+	{
+		paper::compression::lzmaCompress(dst, src, options);
+	}
+
+	virtual void decompress(FILE *dst, FILE *src) const
+	{
+		paper::compression::lzmaDecompress(dst, src, decoderOptions);
+	}
+
+private:
+	paper::compression::LZMAOptions options;
+	paper::compression::LZMADecoderOptions decoderOptions;
+};
+
+/**
+ * \brief This codec compresses data with zstd.
+ */
+class ZstdCodec : public paper::compression::Codec
+{
+public:
+	ZstdCodec(const paper::compression::ZstdOptions &o) : options(o)
+	{
+	}
+
+	virtual paper::compression::CodecId getId() const
+	{
+		return paper::compression::CodecId::Zstd;
+	}
+
+	virtual std::string getName() const
+	{
+		return "zstd";
+	}
+
+	virtual void compress(FILE *dst, FILE *src) const
+	{
+		paper::compression::zstdCompress(dst, src, options);
+	}
+
+	virtual void decompress(FILE *dst, FILE *src) const
+	{
+		paper::compression::zstdDecompress(dst, src);
+	}
+
+private:
+	paper::compression::ZstdOptions options;
+};
+
+/**
+ * \brief This codec compresses data with Brotli.
+ */
+class BrotliCodec : public paper::compression::Codec
+{
+public:
+	BrotliCodec(const paper::compression::BrotliOptions &o) : options(o)
+	{
+	}
+
+	virtual paper::compression::CodecId getId() const
+	{
+		return paper::compression::CodecId::Brotli;
+	}
+
+	virtual std::string getName() const
+	{
+		return "brotli";
+	}
+
+	virtual void compress(FILE *dst, FILE *src) const
+	{
+		paper::compression::brotliCompress(dst, src, options);
+	}
+
+	virtual void decompress(FILE *dst, FILE *src) const
+	{
+		paper::compression::brotliDecompress(dst, src);
+	}
+
+private:
+	paper::compression::BrotliOptions options;
+};
+
+/**
+ * This function runs the given codec operation on the given buffer, placing
+ * the result in the given shared pointer.
+ *
+ * \param compress Whether to compress (true) or decompress (false).
+ * \param codec The codec to use.
+ * \param dst The shared pointer to store the result inside.
+ * \param src The buffer containing the data to process.
+ * \param srcSize The length of the input buffer.
+ * \return The size of the result buffer.
+ */
+std::size_t codeBuffer(bool compress, const paper::compression::Codec &codec,
+                       std::shared_ptr<uint8_t> &dst, const uint8_t *src,
+                       std::size_t srcSize)
+{
+	paper::util::Memstream dstStream;
+	std::shared_ptr<FILE> srcFile(paper::util::io::openMemory(src, srcSize));
+
+	if(compress)
+		codec.compress(dstStream.getFile(), srcFile.get());
+	else
+		codec.decompress(dstStream.getFile(), srcFile.get());
+
+	dst.reset(dstStream.detach(), free);
+	return dstStream.getSize();
+}
+}
+
+namespace paper
+{
+namespace compression
+{
+CompressionOptions::CompressionOptions()
+        : lzma(), lzmaDecoder(), zstd(), brotli()
+{
+}
+
+Codec::Codec()
+{
+}
+
+Codec::~Codec()
+{
+}
+
+bool Codec::isSelfDescribing() const
+{
+	return false;
+}
+
+std::size_t Codec::compressBuffer(std::shared_ptr<uint8_t> &dst,
+                                  const uint8_t *src,
+                                  std::size_t srcSize) const
+{
+	return codeBuffer(true, *this, dst, src, srcSize);
+}
+
+std::size_t Codec::decompressBuffer(std::shared_ptr<uint8_t> &dst,
+                                    const uint8_t *src,
+                                    std::size_t srcSize) const
+{
+	return codeBuffer(false, *this, dst, src, srcSize);
+}
+
+std::vector<CodecId> getCodecIds()
+{
+	return {CodecId::Store, CodecId::LZMA, CodecId::Zstd, CodecId::Brotli};
+}
+
+std::shared_ptr<Codec> createCodec(CodecId id,
+                                   const CompressionOptions &options)
+{
+	switch(id)
+	{
+	case CodecId::Store:
+		return std::shared_ptr<Codec>(new StoreCodec());
+	case CodecId::LZMA:
+		return std::shared_ptr<Codec>(
+		        new LZMACodec(options.lzma, options.lzmaDecoder));
+	case CodecId::Zstd:
+		return std::shared_ptr<Codec>(new ZstdCodec(options.zstd));
+	case CodecId::Brotli:
+		return std::shared_ptr<Codec>(new BrotliCodec(options.brotli));
+	default:
+		throw std::runtime_error("Unknown compression codec.");
+	}
+}
+
+std::shared_ptr<Codec> createCodec(const std::string &name,
+                                   const CompressionOptions &options)
+{
+	for(CodecId id : getCodecIds())
+	{
+		std::shared_ptr<Codec> codec(createCodec(id, options));
+		if(codec->getName() == name)
+			return codec;
+	}
+
+	throw std::runtime_error("Unknown compression codec: " + name);
+}
+
+void compressPayload(FILE *dst, FILE *src, const Codec &codec)
+{
+	if(!codec.isSelfDescribing() &&
+	   (fputc(static_cast<int>(codec.getId()), dst) == EOF))
+	{
+		throw std::runtime_error(strerror(errno));
+	}
+
+	codec.compress(dst, src);
+}
+
+void decompressPayload(FILE *dst, FILE *src,
+                       const CompressionOptions &options)
+{
+	int id = fgetc(src);
+	if(id == EOF)
+		throw std::runtime_error("Payload is empty.");
+
+	// Plain .xz payloads have no identifier; the magic bytes are left in
+	// place for the LZMA decoder.
+	if(id == XZ_MAGIC)
+	{
+		if(ungetc(id, src) == EOF)
+			throw std::runtime_error("Reading payload failed.");
+		createCodec(CodecId::LZMA, options)->decompress(dst, src);
+		return;
+	}
+
+	std::vector<CodecId> ids(getCodecIds());
+	auto it = std::find(ids.begin(), ids.end(), static_cast<CodecId>(id));
+	if(it == ids.end())
+	{
+		throw std::runtime_error("Unknown payload codec identifier: " +
+		                         std::to_string(id) + ".");
+	}
+
+	createCodec(*it, options)->decompress(dst, src);
+}
+
+std::size_t decompressPayload(std::shared_ptr<uint8_t> &dst,
+                              const uint8_t *src, std::size_t srcSize,
+                              const CompressionOptions &options)
+{
+	paper::util::Memstream dstStream;
+	std::shared_ptr<FILE> srcFile(paper::util::io::openMemory(src, srcSize));
+
+	decompressPayload(dstStream.getFile(), srcFile.get(), options);
+
+	dst.reset(dstStream.detach(), free);
+	return dstStream.getSize();
+}
+}
+}
@@ -0,0 +1,223 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_COMPRESSION_CODEC_H
+#define PAPER_COMPRESSION_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PaperCommon/Compression/Brotli.h"
+#include "PaperCommon/Compression/LZMA.h"
+#include "PaperCommon/Compression/Zstd.h"
+
+namespace paper
+{
+namespace compression
+{
+/**
+ * \brief This enumeration defines the one-byte identifiers which are written
+ * at the start of each payload to denote the codec which produced it.
+ *
+ * These values are part of the payload format, so existing values must never
+ * be changed or reused.
+ */
+enum class CodecId : uint8_t
+{
+	Store = 0,
+	LZMA = 1,
+	Zstd = 2,
+	Brotli = 3
+};
+
+/**
+ * \brief This structure holds the options for each of the supported codecs.
+ */
+struct CompressionOptions
+{
+	LZMAOptions lzma;
+	LZMADecoderOptions lzmaDecoder;
+	ZstdOptions zstd;
+	BrotliOptions brotli;
+
+	/**
+	 * This constructor initializes all options to their default values.
+	 */
+	CompressionOptions();
+};
+
+/**
+ * \brief This class defines the interface each compression codec implements.
+ *
+ * Codecs operate on FILE pointers, so data is streamed through them without
+ * being loaded into memory in its entirety. Buffer-based wrappers are provided
+ * for convenience.
+ */
+class Codec
+{
+public:
+	Codec();
+	virtual ~Codec();
+
+	/**
+	 * \return The identifier which denotes this codec in payloads.
+	 */
+	virtual CodecId getId() const = 0;
+
+	/**
+	 * \return This codec's human-readable name.
+	 */
+	virtual std::string getName() const = 0;
+
+	/**
+	 * This function returns whether this codec's output starts with magic
+	 * bytes of its own, which can't be mistaken for any codec identifier.
+	 * Payloads of such codecs are written without an identifier byte, so
+	 * they remain readable by other tools. By default, this is false.
+	 *
+	 * \return Whether this codec's output identifies itself.
+	 */
+	virtual bool isSelfDescribing() const;
+
+	/**
+	 * This function compresses all of the data read from the given source
+	 * file, writing the compressed result to the given destination file.
+	 *
+	 * \param dst The file to write the compressed data to.
+	 * \param src The file to read the data to compress from.
+	 */
+	virtual void compress(FILE *dst, FILE *src) const = 0;
+
+	/**
+	 * This function decompresses all of the data read from the given
+	 * source file, writing the result to the given destination file.
+	 *
+	 * \param dst The file to write the decompressed data to.
+	 * \param src The file to read the data to decompress from.
+	 */
+	virtual void decompress(FILE *dst, FILE *src) const = 0;
+
+	/**
+	 * This function compresses the given buffer, placing the result in the
+	 * given shared pointer and returning the size of the result.
+	 *
+	 * \param dst The shared pointer to store the result inside.
+	 * \param src The buffer containing the data to compress.
+	 * \param srcSize The length of the input buffer.
+	 * \return The size of the result buffer.
+	 */
+	std::size_t compressBuffer(std::shared_ptr<uint8_t> &dst,
+	                           const uint8_t *src, std::size_t srcSize) const;
+
+	/**
+	 * This function decompresses the given buffer, placing the result in
+	 * the given shared pointer and returning the size of the result.
+	 *
+	 * \param dst The shared pointer to store the result inside.
+	 * \param src The buffer containing the data to decompress.
+	 * \param srcSize The length of the input buffer.
+	 * \return The size of the result buffer.
+	 */
+	std::size_t decompressBuffer(std::shared_ptr<uint8_t> &dst,
+	                             const uint8_t *src,
+	                             std::size_t srcSize) const;
+
+private:
+	Codec(const Codec &);
+	Codec &operator=(const Codec &);
+};
+
+/**
+ * This function returns the identifiers of all of the supported codecs.
+ *
+ * \return All supported codec identifiers.
+ */
+std::vector<CodecId> getCodecIds();
+
+/**
+ * This function creates the codec with the given identifier, configured with
+ * the given options. If the identifier is unknown, an exception is thrown.
+ *
+ * \param id The identifier of the codec to create.
+ * \param options The options to configure the codec with.
+ * \return The new codec.
+ */
+std::shared_ptr<Codec> createCodec(CodecId id,
+                                   const CompressionOptions &options);
+
+/**
+ * This function creates the codec with the given name (e.g. "lzma"),
+ * configured with the given options. If the name is unknown, an exception is
+ * thrown.
+ *
+ * \param name The name of the codec to create.
+ * \param options The options to configure the codec with.
+ * \return The new codec.
+ */
+std::shared_ptr<Codec> createCodec(const std::string &name,
+                                   const CompressionOptions &options);
+
+/**
+ * This function compresses all of the data read from the given source file
+ * using the given codec, writing a payload consisting of the codec's one-byte
+ * identifier followed by the compressed data to the given destination file.
+ * If the codec is self-describing (i.e., it writes the .xz format), the
+ * identifier is omitted, so the payload is a plain .xz file, as it was before
+ * codecs were introduced.
+ *
+ * \param dst The file to write the payload to.
+ * \param src The file to read the data to compress from.
+ * \param codec The codec to compress with.
+ */
+void compressPayload(FILE *dst, FILE *src, const Codec &codec);
+
+/**
+ * This function decompresses a payload written by compressPayload, using the
+ * codec denoted by its leading identifier byte. A payload starting with the
+ * .xz magic bytes instead is decompressed as .xz. If the identifier is
+ * unknown, an exception is thrown.
+ *
+ * \param dst The file to write the decompressed data to.
+ * \param src The file to read the payload from.
+ * \param options The options to configure the payload's codec with.
+ */
+void decompressPayload(FILE *dst, FILE *src,
+                       const CompressionOptions &options);
+
+/**
+ * This function decompresses a payload written by compressPayload, placing
+ * the result in the given shared pointer and returning its size.
+ *
+ * \param dst The shared pointer to store the result inside.
+ * \param src The buffer containing the payload.
+ * \param srcSize The length of the payload.
+ * \param options The options to configure the payload's codec with.
+ * \return The size of the result buffer.
+ */
+std::size_t decompressPayload(std::shared_ptr<uint8_t> &dst,
+                              const uint8_t *src, std::size_t srcSize,
+                              const CompressionOptions &options);
+}
+}
+
+#endif
@@ -0,0 +1,306 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Dictionary.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include <lzma.h>
+
+#include "PaperCommon/Util/IO.h"
+
+namespace
+{
+// The length of the substrings the trainer counts.
+constexpr std::size_t DMER_SIZE = sizeof(uint64_t);
+
+// The length of each segment the trainer selects.
+constexpr std::size_t SEGMENT_SIZE = 256;
+
+/**
+ * \brief This structure tracks how many samples contain a given substring.
+ */
+struct DmerFrequency
+{
+	uint32_t frequency;
+	std::size_t lastSample;
+};
+
+/**
+ * \brief This structure holds a segment selected by the trainer.
+ */
+struct Segment
+{
+	std::size_t offset;
+	std::size_t size;
+	uint64_t score;
+};
+
+/**
+ * This function returns the substring of DMER_SIZE bytes starting at the given
+ * position, packed into an integer so it can be used as a hash map key.
+ *
+ * \param data The data to read the substring from.
+ * \return The packed substring.
+ */
+uint64_t getDmer(const uint8_t *data)
+{
+	uint64_t dmer;
+	memcpy(&dmer, data, sizeof(uint64_t));
+	return dmer;
+}
+
+/**
+ * This function finds the best segment within the given range of the corpus,
+ * using a sliding window over the substrings each candidate contains.
+ *
+ * \param corpus The concatenated samples.
+ * \param valid Whether or not a substring starts at each corpus position.
+ * \param frequencies The number of samples containing each substring.
+ * \param begin The first corpus position to consider.
+ * \param end The end of the range of corpus positions to consider.
+ * \param segmentSize The size of the segment to select.
+ * \return The best segment in the given range.
+ */
+Segment findBestSegment(
+        const std::vector<uint8_t> &corpus, const std::vector<bool> &valid,
+        const std::unordered_map<uint64_t, DmerFrequency> &frequencies,
+        std::size_t begin, std::size_t end, std::size_t segmentSize)
+{
+	Segment best = {begin, segmentSize, 0};
+	std::unordered_map<uint64_t, uint32_t> active;
+	uint64_t score = 0;
+
+	auto add = [&](std::size_t position)
+	{
+		if(!valid[position])
+			return;
+
+		uint64_t dmer = getDmer(&corpus[position]);
+		if(active[dmer]++ == 0)
+			score += frequencies.at(dmer).frequency;
+	};
+
+	auto remove = [&](std::size_t position)
+	{
+		if(!valid[position])
+			return;
+
+		uint64_t dmer = getDmer(&corpus[position]);
+		if(--active[dmer] == 0)
+			score -= frequencies.at(dmer).frequency;
+	};
+
+	std::size_t window = segmentSize - DMER_SIZE + 1;
+	for(std::size_t position = begin; position + segmentSize <= end;
+	    ++position)
+	{
+		if(position == begin)
+		{
+			for(std::size_t i = 0; i < window; ++i)
+				add(position + i);
+		}
+		else
+		{
+			remove(position - 1);
+			add(position + window - 1);
+		}
+
+		if(score > best.score)
+		{
+			best.offset = position;
+			best.score = score;
+		}
+	}
+
+	return best;
+}
+}
+
+namespace paper
+{
+namespace compression
+{
+Dictionary::Dictionary(const std::vector<uint8_t> &d)
+        : data(d), id(lzma_crc32(d.data(), d.size(), 0))
+{
+}
+
+std::shared_ptr<Dictionary> Dictionary::load(const std::string &path)
+{
+	std::shared_ptr<uint8_t> buffer;
+	std::size_t size = util::io::loadFile(buffer, path);
+
+	return std::make_shared<Dictionary>(
+	        std::vector<uint8_t>(buffer.get(), buffer.get() + size));
+}
+
+void Dictionary::save(const std::string &path) const
+{
+	util::io::writeFile(path, reinterpret_cast<const char *>(data.data()),
+	                    data.size());
+}
+
+uint32_t Dictionary::getId() const
+{
+	return id;
+}
+
+const uint8_t *Dictionary::getData() const
+{
+	return data.data();
+}
+
+std::size_t Dictionary::getSize() const
+{
+	return data.size();
+}
+
+DictionaryStore::DictionaryStore() : dictionaries()
+{
+}
+
+void DictionaryStore::add(const std::shared_ptr<const Dictionary> &dictionary)
+{
+	dictionaries[dictionary->getId()] = dictionary;
+}
+
+uint32_t DictionaryStore::load(const std::string &path)
+{
+	std::shared_ptr<const Dictionary> dictionary(Dictionary::load(path));
+	add(dictionary);
+	return dictionary->getId();
+}
+
+std::shared_ptr<const Dictionary> DictionaryStore::get(uint32_t id) const
+{
+	auto it = dictionaries.find(id);
+	if(it == dictionaries.end())
+	{
+		throw std::runtime_error(
+		        "The required compression dictionary is unavailable.");
+	}
+
+	return it->second;
+}
+
+std::shared_ptr<Dictionary>
+trainDictionary(const std::vector<std::vector<uint8_t>> &samples,
+                std::size_t size)
+{
+	if(size == 0)
+		throw std::runtime_error("Dictionary size must be nonzero.");
+
+	// Concatenate the samples, noting where substrings may start.
+
+	std::vector<uint8_t> corpus;
+	std::vector<bool> valid;
+	std::unordered_map<uint64_t, DmerFrequency> frequencies;
+
+	for(std::size_t s = 0; s < samples.size(); ++s)
+	{
+		const std::vector<uint8_t> &sample = samples[s];
+		std::size_t start = corpus.size();
+		corpus.insert(corpus.end(), sample.begin(), sample.end());
+		valid.resize(corpus.size(), false);
+
+		for(std::size_t i = 0; i + DMER_SIZE <= sample.size(); ++i)
+		{
+			valid[start + i] = true;
+
+			// Count each substring at most once per sample.
+			DmerFrequency &f = frequencies[getDmer(&sample[i])];
+			if(f.lastSample != s + 1)
+			{
+				++f.frequency;
+				f.lastSample = s + 1;
+			}
+		}
+	}
+
+	std::size_t segmentSize = std::min(SEGMENT_SIZE, size);
+	if((segmentSize < DMER_SIZE) || (corpus.size() < segmentSize))
+		throw std::runtime_error("Not enough sample data to train with.");
+
+	// Select the best segment from each epoch.
+
+	std::size_t segmentCount = (size + segmentSize - 1) / segmentSize;
+	std::size_t epochSize =
+	        std::max(corpus.size() / segmentCount, segmentSize);
+
+	std::vector<Segment> segments;
+	for(std::size_t begin = 0; begin + segmentSize <= corpus.size();
+	    begin += epochSize)
+	{
+		std::size_t end = std::min(begin + epochSize, corpus.size());
+		Segment segment = findBestSegment(corpus, valid, frequencies,
+		                                  begin, end, segmentSize);
+		if(segment.score == 0)
+			continue;
+
+		segments.push_back(segment);
+
+		// Don't reward the selected substrings again.
+		for(std::size_t i = 0; i + DMER_SIZE <= segment.size; ++i)
+		{
+			if(valid[segment.offset + i])
+			{
+				frequencies[getDmer(&corpus[segment.offset + i])]
+				        .frequency = 0;
+			}
+		}
+	}
+
+	if(segments.empty())
+	{
+		throw std::runtime_error(
+		        "The samples have no content in common to train with.");
+	}
+
+	// Place the best segments last, trimming the worst to fit.
+
+	std::stable_sort(segments.begin(), segments.end(),
+	                 [](const Segment &a, const Segment &b)
+	                 {
+		return a.score < b.score;
+	});
+
+	std::vector<uint8_t> data;
+	for(const Segment &segment : segments)
+	{
+		data.insert(data.end(), corpus.begin() + static_cast<std::ptrdiff_t>(
+		                                                 segment.offset),
+		            corpus.begin() + static_cast<std::ptrdiff_t>(
+		                                     segment.offset + segment.size));
+	}
+
+	if(data.size() > size)
+	{
+		data.erase(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(
+		                                                data.size() - size));
+	}
+
+	return std::make_shared<Dictionary>(data);
+}
+}
+}
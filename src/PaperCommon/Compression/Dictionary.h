@@ -0,0 +1,150 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_COMPRESSION_DICTIONARY_H
+#define PAPER_COMPRESSION_DICTIONARY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace paper
+{
+namespace compression
+{
+/**
+ * \brief This class holds an immutable LZMA preset dictionary.
+ *
+ * A preset dictionary primes the compressor's window with data which is
+ * likely to appear in the input, so small inputs can refer back to it instead
+ * of starting from an empty window. The exact same dictionary must be
+ * available when decompressing, so each dictionary is identified by the CRC32
+ * of its contents, which is recorded in the compressed payload.
+ */
+class Dictionary
+{
+public:
+	/**
+	 * This constructor creates a new dictionary with the given contents.
+	 *
+	 * \param d The dictionary's contents.
+	 */
+	Dictionary(const std::vector<uint8_t> &d);
+
+	/**
+	 * This function loads the dictionary stored in the file at the given
+	 * path. If the file can't be read, an exception is thrown instead.
+	 *
+	 * \param path The path to the dictionary file.
+	 * \return The loaded dictionary.
+	 */
+	static std::shared_ptr<Dictionary> load(const std::string &path);
+
+	/**
+	 * This function writes this dictionary's contents to the given path.
+	 *
+	 * \param path The path to write the dictionary to.
+	 */
+	void save(const std::string &path) const;
+
+	/**
+	 * \return The identifier which denotes this dictionary in payloads.
+	 */
+	uint32_t getId() const;
+
+	/**
+	 * \return A pointer to this dictionary's contents.
+	 */
+	const uint8_t *getData() const;
+
+	/**
+	 * \return The size of this dictionary's contents, in bytes.
+	 */
+	std::size_t getSize() const;
+
+private:
+	std::vector<uint8_t> data;
+	uint32_t id;
+};
+
+/**
+ * \brief This class maps dictionary identifiers to dictionaries, so payloads
+ * compressed with a preset dictionary can be decompressed.
+ */
+class DictionaryStore
+{
+public:
+	DictionaryStore();
+
+	/**
+	 * This function adds the given dictionary to this store. If a
+	 * dictionary with the same identifier was already present, it is
+	 * replaced.
+	 *
+	 * \param dictionary The dictionary to add.
+	 */
+	void add(const std::shared_ptr<const Dictionary> &dictionary);
+
+	/**
+	 * This function loads the dictionary stored in the file at the given
+	 * path, and adds it to this store.
+	 *
+	 * \param path The path to the dictionary file.
+	 * \return The identifier of the loaded dictionary.
+	 */
+	uint32_t load(const std::string &path);
+
+	/**
+	 * This function returns the dictionary with the given identifier. If
+	 * this store doesn't contain it, an exception is thrown instead.
+	 *
+	 * \param id The identifier of the dictionary to retrieve.
+	 * \return The dictionary with the given identifier.
+	 */
+	std::shared_ptr<const Dictionary> get(uint32_t id) const;
+
+private:
+	std::map<uint32_t, std::shared_ptr<const Dictionary>> dictionaries;
+};
+
+/**
+ * This function builds a preset dictionary of (at most) the given size from
+ * the given sample inputs.
+ *
+ * This is a simplified version of the COVER algorithm: the samples are split
+ * into as many equally sized epochs as the dictionary has segments, and from
+ * each epoch the segment whose distinct substrings occur in the most samples
+ * is selected. Substrings are only counted once, so later segments favour
+ * content which hasn't been covered yet. The best segments are placed at the
+ * end of the dictionary, where they are cheapest for LZMA to refer to.
+ *
+ * \param samples The sample inputs to train with.
+ * \param size The maximum size of the dictionary, in bytes.
+ * \return The new dictionary.
+ */
+std::shared_ptr<Dictionary>
+trainDictionary(const std::vector<std::vector<uint8_t>> &samples,
+                std::size_t size);
+}
+}
+
+#endif
@@ -0,0 +1,314 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Filters.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "PaperCommon/Compression/Probe.h"
+
+namespace
+{
+// The number of bytes at the start of the input which are inspected.
+constexpr std::size_t SAMPLE_SIZE = 65536;
+
+// Inputs smaller than this never get the delta filter, since there isn't
+// enough data to tell whether it would help.
+constexpr std::size_t MIN_DELTA_SAMPLE_SIZE = 1024;
+
+// The delta filter is chosen if it reduces the entropy to this fraction.
+constexpr double DELTA_ENTROPY_RATIO = 0.75;
+
+// The delta distances which are tried; i.e., common sample sizes and strides.
+const uint32_t DELTA_DISTANCES[] = {1, 2, 3, 4, 6, 8, 12, 16};
+
+// The names of each filter type, in FilterType order.
+const char *FILTER_NAMES[] = {"none",     "x86",   "powerpc", "arm",
+                              "armthumb", "sparc", "arm64",   "delta"};
+
+/**
+ * This function reads an unsigned integer of the given size from the given
+ * buffer.
+ *
+ * \param data The buffer to read from.
+ * \param bytes The size of the integer, in bytes.
+ * \param bigEndian Whether the integer is stored most significant byte first.
+ * \return The integer which was read.
+ */
+uint32_t readInteger(const uint8_t *data, std::size_t bytes, bool bigEndian)
+{
+	uint32_t value = 0;
+	for(std::size_t i = 0; i < bytes; ++i)
+	{
+		std::size_t shift = 8 * (bigEndian ? bytes - 1 - i : i);
+		value |= static_cast<uint32_t>(data[i]) << shift;
+	}
+	return value;
+}
+
+/**
+ * This function identifies the architecture of an ELF executable.
+ *
+ * \param data The start of the input.
+ * \param size The size of the given data, in bytes.
+ * \return The BCJ filter to use, or FilterType::None.
+ */
+paper::compression::FilterType detectELF(const uint8_t *data,
+                                         std::size_t size)
+{
+	using paper::compression::FilterType;
+
+	if((size < 20) || (memcmp(data, "\177ELF", 4) != 0))
+		return FilterType::None;
+
+	bool bigEndian = data[5] == 2;
+	switch(readInteger(data + 18, 2, bigEndian))
+	{
+	case 3:  // EM_386
+	case 62: // EM_X86_64
+		return FilterType::X86;
+	case 20: // EM_PPC
+	case 21: // EM_PPC64
+		return bigEndian ? FilterType::PowerPC : FilterType::None;
+	case 2:  // EM_SPARC
+	case 18: // EM_SPARC32PLUS
+	case 43: // EM_SPARCV9
+		return FilterType::SPARC;
+	case 40: // EM_ARM
+		return bigEndian ? FilterType::None : FilterType::ARM;
+	case 183: // EM_AARCH64
+		return FilterType::ARM64;
+	default:
+		return FilterType::None;
+	}
+}
+
+/**
+ * This function identifies the architecture of a PE (Windows) executable.
+ *
+ * \param data The start of the input.
+ * \param size The size of the given data, in bytes.
+ * \return The BCJ filter to use, or FilterType::None.
+ */
+paper::compression::FilterType detectPE(const uint8_t *data, std::size_t size)
+{
+	using paper::compression::FilterType;
+
+	if((size < 0x40) || (data[0] != 'M') || (data[1] != 'Z'))
+		return FilterType::None;
+
+	std::size_t offset = readInteger(data + 0x3C, 4, false);
+	if((offset > size - 6) || (memcmp(data + offset, "PE\0\0", 4) != 0))
+		return FilterType::None;
+
+	switch(readInteger(data + offset + 4, 2, false))
+	{
+	case 0x014C: // IMAGE_FILE_MACHINE_I386
+	case 0x8664: // IMAGE_FILE_MACHINE_AMD64
+		return FilterType::X86;
+	case 0x01C0: // IMAGE_FILE_MACHINE_ARM
+		return FilterType::ARM;
+	case 0x01C2: // IMAGE_FILE_MACHINE_THUMB
+	case 0x01C4: // IMAGE_FILE_MACHINE_ARMNT
+		return FilterType::ARMThumb;
+	case 0xAA64: // IMAGE_FILE_MACHINE_ARM64
+		return FilterType::ARM64;
+	default:
+		return FilterType::None;
+	}
+}
+
+/**
+ * This function identifies the architecture of a (thin) Mach-O executable.
+ *
+ * \param data The start of the input.
+ * \param size The size of the given data, in bytes.
+ * \return The BCJ filter to use, or FilterType::None.
+ */
+paper::compression::FilterType detectMachO(const uint8_t *data,
+                                           std::size_t size)
+{
+	using paper::compression::FilterType;
+
+	if(size < 8)
+		return FilterType::None;
+
+	uint32_t magic = readInteger(data, 4, true);
+	bool bigEndian;
+	if((magic == 0xFEEDFACE) || (magic == 0xFEEDFACF))
+		bigEndian = true;
+	else if((magic == 0xCEFAEDFE) || (magic == 0xCFFAEDFE))
+		bigEndian = false;
+	else
+		return FilterType::None;
+
+	switch(readInteger(data + 4, 4, bigEndian))
+	{
+	case 0x00000007: // CPU_TYPE_X86
+	case 0x01000007: // CPU_TYPE_X86_64
+		return FilterType::X86;
+	case 0x00000012: // CPU_TYPE_POWERPC
+		return bigEndian ? FilterType::PowerPC : FilterType::None;
+	case 0x0000000C: // CPU_TYPE_ARM
+		return FilterType::ARM;
+	case 0x0100000C: // CPU_TYPE_ARM64
+		return FilterType::ARM64;
+	default:
+		return FilterType::None;
+	}
+}
+
+/**
+ * This function finds the delta distance which minimizes the entropy of the
+ * given data, if any distance reduces it enough to be worthwhile.
+ *
+ * \param data The start of the input.
+ * \param size The size of the given data, in bytes.
+ * \return The best delta distance, or 0 if the delta filter shouldn't be used.
+ */
+uint32_t detectDelta(const uint8_t *data, std::size_t size)
+{
+	if(size < MIN_DELTA_SAMPLE_SIZE)
+		return 0;
+
+	double best = paper::compression::getEntropy(data, size) *
+	              DELTA_ENTROPY_RATIO;
+	uint32_t bestDistance = 0;
+
+	std::vector<uint8_t> residuals(size);
+	for(uint32_t distance : DELTA_DISTANCES)
+	{
+		for(std::size_t i = 0; i < distance; ++i)
+			residuals[i] = data[i];
+		for(std::size_t i = distance; i < size; ++i)
+			residuals[i] = static_cast<uint8_t>(data[i] -
+			                                    data[i - distance]);
+
+		double entropy =
+		        paper::compression::getEntropy(residuals.data(), size);
+		if(entropy < best)
+		{
+			best = entropy;
+			bestDistance = distance;
+		}
+	}
+
+	return bestDistance;
+}
+}
+
+namespace paper
+{
+namespace compression
+{
+Filter::Filter(FilterType t, uint32_t d) : type(t), distance(d)
+{
+}
+
+Filter detectFilter(const uint8_t *data, std::size_t size)
+{
+	size = std::min(size, SAMPLE_SIZE);
+
+	for(auto detect : {detectELF, detectPE, detectMachO})
+	{
+		FilterType type = detect(data, size);
+		if(type != FilterType::None)
+			return Filter(type);
+	}
+
+	uint32_t distance = detectDelta(data, size);
+	if(distance > 0)
+		return Filter(FilterType::Delta, distance);
+
+	return Filter(FilterType::None);
+}
+
+Filter detectFilter(FILE *src)
+{
+	long start = ftell(src);
+	if(start < 0)
+		return Filter(FilterType::None);
+
+	std::vector<uint8_t> sample(SAMPLE_SIZE);
+	std::size_t size =
+	        fread(sample.data(), sizeof(uint8_t), sample.size(), src);
+	if(ferror(src) || (fseek(src, start, SEEK_SET) != 0))
+		throw std::runtime_error(strerror(errno));
+
+	return detectFilter(sample.data(), size);
+}
+
+Filter parseFilter(const std::string &name)
+{
+	if(name == "auto")
+		return Filter(FilterType::Auto);
+
+	std::string base = name.substr(0, name.find(':'));
+	for(uint8_t i = 0; i <= static_cast<uint8_t>(FilterType::Delta); ++i)
+	{
+		if(base != FILTER_NAMES[i])
+			continue;
+
+		Filter filter(static_cast<FilterType>(i));
+		if(filter.type != FilterType::Delta)
+		{
+			if(base != name)
+				break;
+			return filter;
+		}
+
+		char *end = nullptr;
+		std::string distance =
+		        base == name ? "1" : name.substr(base.size() + 1);
+		unsigned long value = strtoul(distance.c_str(), &end, 10);
+		if((*end != '\0') || distance.empty() || (value < 1) ||
+		   (value > 256))
+		{
+			break;
+		}
+
+		filter.distance = static_cast<uint32_t>(value);
+		return filter;
+	}
+
+	throw std::runtime_error("Invalid filter: " + name);
+}
+
+std::string getFilterName(const Filter &filter)
+{
+	if(filter.type == FilterType::Auto)
+		return "auto";
+
+	std::size_t index = static_cast<std::size_t>(filter.type);
+	if(index >= sizeof(FILTER_NAMES) / sizeof(FILTER_NAMES[0]))
+		throw std::runtime_error("Invalid filter type.");
+
+	std::string name(FILTER_NAMES[index]);
+	if(filter.type == FilterType::Delta)
+		name += ":" + std::to_string(filter.distance);
+	return name;
+}
+}
+}
@@ -0,0 +1,127 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_COMPRESSION_FILTERS_H
+#define PAPER_COMPRESSION_FILTERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace paper
+{
+namespace compression
+{
+/**
+ * \brief This enumeration defines the filters which can be applied to data
+ * before it is compressed with LZMA2.
+ *
+ * The branch/call/jump (BCJ) filters convert relative branch targets in
+ * machine code into absolute addresses, so repeated calls to the same
+ * function produce repeated byte sequences. The delta filter replaces each
+ * byte with its difference from the byte a fixed distance before it, which
+ * suits fixed-stride numeric data like audio or sensor samples.
+ *
+ * These values are stored in raw LZMA2 payloads, so they must not change.
+ */
+enum class FilterType : uint8_t
+{
+	None = 0,
+	X86 = 1,
+	PowerPC = 2,
+	ARM = 3,
+	ARMThumb = 4,
+	SPARC = 5,
+	ARM64 = 6,
+	Delta = 7,
+
+	/**
+	 * Choose a filter automatically, based upon the content of the input
+	 * (see detectFilter).
+	 */
+	Auto = 0xFF
+};
+
+/**
+ * \brief This structure describes a filter to apply before LZMA2.
+ */
+struct Filter
+{
+	/**
+	 * The type of filter to apply.
+	 */
+	FilterType type;
+
+	/**
+	 * For the delta filter, the distance between the bytes to subtract,
+	 * from 1 to 256. This is unused by the other filters.
+	 */
+	uint32_t distance;
+
+	/**
+	 * This constructor creates a new filter description.
+	 *
+	 * \param t The type of filter to apply.
+	 * \param d The delta filter's distance, if applicable.
+	 */
+	Filter(FilterType t = FilterType::Auto, uint32_t d = 0);
+};
+
+/**
+ * This function guesses which filter best suits the given data. Executables
+ * are recognized by their ELF, PE or Mach-O headers, and get the BCJ filter
+ * for their architecture. Otherwise, if subtracting bytes at some small fixed
+ * distance greatly reduces the data's entropy, the delta filter is chosen.
+ *
+ * \param data The data to inspect. Only its start is examined.
+ * \param size The size of the data, in bytes.
+ * \return The filter to use, which is never FilterType::Auto.
+ */
+Filter detectFilter(const uint8_t *data, std::size_t size);
+
+/**
+ * This function guesses which filter best suits the remaining data in the
+ * given file (see detectFilter(const uint8_t *, std::size_t)). Only the
+ * start of the data is read, and the file's position is restored before this
+ * function returns. If the file isn't seekable, FilterType::None is returned.
+ *
+ * \param src The file to inspect.
+ * \return The filter to use, which is never FilterType::Auto.
+ */
+Filter detectFilter(FILE *src);
+
+/**
+ * This function parses a filter name, as returned by getFilterName. If the
+ * name isn't valid, an exception is thrown instead.
+ *
+ * \param name The name to parse, e.g. "x86" or "delta:4".
+ * \return The filter described by the name.
+ */
+Filter parseFilter(const std::string &name);
+
+/**
+ * \param filter The filter to describe.
+ * \return A short human-readable name for the given filter.
+ */
+std::string getFilterName(const Filter &filter);
+}
+}
+
+#endif
@@ -20,19 +20,69 @@
 
 #include <lzma.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <climits>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "PaperCommon/Util/Arena.h"
+#include "PaperCommon/Util/IO.h"
 #include "PaperCommon/Util/Memory.h"
 #include "PaperCommon/Util/Memstream.h"
+#include "PaperCommon/Util/Parallel.h"
 
 namespace
 {
 constexpr uint64_t BUFFER_SIZE = 8192;
 
+// This mirrors liblzma's internal LZMA_THREADS_MAX, which isn't public.
+constexpr uint32_t MAX_THREADS = 16384;
+
+// The default memory limit is a quarter of physical memory, as for xz's
+// multithreaded mode, but never less than one level 9 thread needs.
+constexpr uint64_t MIN_DEFAULT_MEMORY_LIMIT = 1ULL << 30;
+
+// LZMA can't compress by more than this ratio (liblzma's best is a little
+// under 7000:1), so a larger declared size must be corrupt or hostile.
+constexpr uint64_t MAX_COMPRESSION_RATIO = 8192;
+
+// A declared decompressed size is only preallocated up to this size. Larger
+// outputs are streamed, so memory grows only as real data is produced.
+constexpr uint64_t MAX_PREALLOCATED_SIZE = 1ULL << 28;
+
+// This denotes an input whose size isn't known in advance.
+constexpr uint64_t UNKNOWN_SIZE = UINT64_MAX;
+
+// This is the first byte of the .xz format's magic bytes.
+constexpr int XZ_MAGIC = 0xFD;
+
+// These are the fields of the first byte of a raw LZMA2 payload.
+constexpr uint8_t RAW_PROPS_MASK = 0x3F;
+constexpr uint8_t RAW_FLAG_CHECKSUM = 0x40;
+constexpr uint8_t RAW_FLAG_DICTIONARY = 0x80;
+
+// LZMA2 properties never exceed 40, so this value of the properties field
+// instead denotes a header which describes a filter before the properties.
+constexpr uint8_t RAW_PROPS_FILTERED = 0x3F;
+
+// The maximum size of a raw LZMA2 header: flags, filter type and distance,
+// properties, dictionary ID, and size.
+constexpr std::size_t MAX_RAW_HEADER_SIZE =
+        1 + 3 + 4 + paper::util::io::MAX_VARINT_SIZE;
+
+// The size of the checksum which may trail raw LZMA2 data.
+constexpr std::size_t RAW_TRAILER_SIZE = 2;
+
 /**
  * This is a small utility function which converts an LZMA return code
  * to a human-readable string.
@@ -73,6 +123,77 @@ std::string lzma_error_string(lzma_ret code)
 	}
 }
 
+/**
+ * \brief This structure tracks how much data an LZMA coder has processed.
+ */
+struct CoderStats
+{
+	uint64_t inputSize;
+	uint64_t outputSize;
+	uint32_t inputCrc;
+	uint32_t outputCrc;
+	bool computeCrcs;
+	uint64_t outputLimit;
+
+	CoderStats(bool crcs, uint64_t limit = 0)
+	        : inputSize(0),
+	          outputSize(0),
+	          inputCrc(0),
+	          outputCrc(0),
+	          computeCrcs(crcs),
+	          outputLimit(limit)
+	{
+	}
+};
+
+/**
+ * This function returns a sink which writes all of the data it is given to
+ * the given file.
+ *
+ * \param dst The file to write data to.
+ * \return A sink which writes to the given file.
+ */
+paper::compression::LZMASink fileSink(FILE *dst)
+{
+	return [dst](const uint8_t *data, std::size_t size)
+	{
+		if(fwrite(data, sizeof(uint8_t), size, dst) != size)
+			throw std::runtime_error(strerror(errno));
+	};
+}
+
+/**
+ * \brief This structure holds an LZMA stream, along with the buffers used to
+ * feed it from and drain it to stdio.
+ *
+ * Reinitializing a stream which has been used before lets liblzma reuse its
+ * existing allocations wherever the new coder's needs allow, so a Coder may
+ * be kept across many operations (see LZMAContext). The stream is only ended
+ * when the Coder is destroyed.
+ */
+struct Coder
+{
+	lzma_stream stream;
+	std::shared_ptr<uint8_t> inbuf;
+	std::shared_ptr<uint8_t> outbuf;
+
+	Coder(const lzma_allocator *allocator = nullptr)
+	        : stream(), inbuf(), outbuf()
+	{
+		stream = LZMA_STREAM_INIT;
+		stream.allocator = allocator;
+	}
+
+	~Coder()
+	{
+		lzma_end(&stream);
+	}
+
+private:
+	Coder(const Coder &);
+	Coder &operator=(const Coder &);
+};
+
 /**
  * This is a simple utility function to fill the given input buffer
  * with data from the given file, for use with the given LZMA stream.
@@ -84,9 +205,10 @@ std::string lzma_error_string(lzma_ret code)
  * \param stream The LZMA stream that will use the new input buffer.
  * \param action The next action LZMA should take.
  * \param src The source file to read data from.
+ * \param stats The statistics to update with the data which was read.
  */
 void fillInputBuffer(const std::shared_ptr<uint8_t> &inbuf, lzma_stream &stream,
-                     lzma_action &action, FILE *src)
+                     lzma_action &action, FILE *src, CoderStats &stats)
 {
 	if(stream.avail_in == 0 && (feof(src) == 0))
 	{
@@ -101,6 +223,9 @@ void fillInputBuffer(const std::shared_ptr<uint8_t> &inbuf, lzma_stream &stream,
 
 			left -= read;
 
+			if(ferror(src) != 0)
+				throw std::runtime_error(strerror(errno));
+
 			if(read == 0)
 			{
 				action = LZMA_FINISH;
@@ -109,22 +234,45 @@ void fillInputBuffer(const std::shared_ptr<uint8_t> &inbuf, lzma_stream &stream,
 		}
 
 		stream.avail_in = BUFFER_SIZE - left;
+
+		stats.inputSize += stream.avail_in;
+		if(stats.computeCrcs)
+		{
+			stats.inputCrc = lzma_crc32(inbuf.get(), stream.avail_in,
+			                            stats.inputCrc);
+		}
 	}
 }
 
 /**
- * This is a very basic utility function which writes the contents of
- * the given output buffer to the given destination file.
+ * This is a very basic utility function which passes the contents of
+ * the given output buffer to the given sink. If this would exceed the
+ * output limit, an exception is thrown instead.
  *
- * \param dst The destination file to write the data to.
+ * \param sink The sink to pass the data to.
  * \param stream The LZMA stream which produced this output.
  * \param outbuf The output buffer containing the data to write.
+ * \param stats The statistics to update with the data which was written.
  */
-void writeOutputBuffer(FILE *dst, lzma_stream &stream,
-                       const std::shared_ptr<uint8_t> &outbuf)
+void writeOutputBuffer(const paper::compression::LZMASink &sink,
+                       lzma_stream &stream,
+                       const std::shared_ptr<uint8_t> &outbuf,
+                       CoderStats &stats)
 {
-	fwrite(outbuf.get(), BUFFER_SIZE - stream.avail_out, sizeof(uint8_t),
-	       dst);
+	std::size_t size = BUFFER_SIZE - stream.avail_out;
+	if((stats.outputLimit > 0) &&
+	   (stats.outputSize + size > stats.outputLimit))
+	{
+		throw std::runtime_error(
+		        "Decompressed data exceeds the output size limit.");
+	}
+
+	sink(outbuf.get(), size);
+
+	stats.outputSize += size;
+	if(stats.computeCrcs)
+		stats.outputCrc = lzma_crc32(outbuf.get(), size, stats.outputCrc);
+
 	stream.next_out = outbuf.get();
 	stream.avail_out = BUFFER_SIZE;
 }
@@ -134,16 +282,17 @@ void writeOutputBuffer(FILE *dst, lzma_stream &stream,
  * possibly writing any remaining output, throwing an exception (in
  * case of an error), or simply stopping the coding operation.
  *
- * \param dst The destination file to write output to, if applicable.
+ * \param sink The sink to pass output to, if applicable.
  * \param stream The LZMA stream producing output.
  * \param outbuf The output buffer potentially containing data to write.
- * \param src The source file input is being read from.
  * \param ret The LZMA reurn code being handled.
+ * \param stats The statistics to update with any data written.
  * \return True if coding should continue, or false otherwise.
  */
-bool handleReturnCode(FILE *dst, lzma_stream &stream,
-                      const std::shared_ptr<uint8_t> &outbuf, FILE *src,
-                      lzma_ret ret)
+bool handleReturnCode(const paper::compression::LZMASink &sink,
+                      lzma_stream &stream,
+                      const std::shared_ptr<uint8_t> &outbuf, lzma_ret ret,
+                      CoderStats &stats)
 {
 	if(ret != LZMA_OK)
 	{
@@ -155,25 +304,20 @@ bool handleReturnCode(FILE *dst, lzma_stream &stream,
 
 		if(ret != LZMA_NO_CHECK && ret != LZMA_UNSUPPORTED_CHECK)
 		{
-			writeOutputBuffer(dst, stream, outbuf);
+			writeOutputBuffer(sink, stream, outbuf, stats);
 		}
 
 		// Stop if we reached the end of the stream.
 
 		if(ret == LZMA_STREAM_END)
-		{
-			if((stream.avail_in == 0) && (feof(src) != 0))
-			{
-				return false;
-			}
+			return false;
 
-			/*
-			 * Since we've hit LZMA_STREAM_END, but
-			 * there is available input and/or we
-			 * haven't hit EOF, there is a problem.
-			 */
+		// Report how much memory the decoder would have needed.
 
-			throw std::runtime_error("LZMA input data error.");
+		if(ret == LZMA_MEMLIMIT_ERROR)
+		{
+			throw paper::compression::MemoryLimitError(
+			        lzma_memusage(&stream));
 		}
 
 		// Looks like some other problem occurred.
@@ -185,107 +329,1500 @@ bool handleReturnCode(FILE *dst, lzma_stream &stream,
 }
 
 /**
- * This is a fairly low level implementation of LZMA {en,de}coding
- * using basic FILE pointers. This can be used to implement a
- * higher-level LZMA API.
+ * This function runs the given (already initialized) LZMA coder until it
+ * reaches the end of its stream, reading input from the given source file and
+ * passing output to the given sink.
  *
- * \param compress Whether or not we should be in compress mode.
- * \param dst The file to write output data to.
+ * Any input the coder didn't consume is returned in the given leftover
+ * buffer, so trailing data can be inspected by the caller.
+ *
+ * \param coder The coder whose initialized stream should be run.
+ * \param sink The sink to pass output data to.
  * \param src The file to read input data from.
+ * \param stats The statistics to update as data is processed.
+ * \param leftover The buffer to store unconsumed input in.
  */
-void lzmaRaw(bool compress, FILE *dst, FILE *src)
+void runCoder(Coder &coder, const paper::compression::LZMASink &sink,
+              FILE *src, CoderStats &stats, std::vector<uint8_t> &leftover)
 {
-	lzma_stream stream = LZMA_STREAM_INIT;
-	lzma_filter filters[2];
 	lzma_action action = LZMA_RUN;
-	lzma_check check = LZMA_CHECK_CRC32;
-	lzma_ret ret;
+	lzma_stream &stream = coder.stream;
 
-	lzma_options_lzma options;
-	lzma_lzma_preset(&options, LZMA_PRESET_EXTREME);
-
-	filters[0].id = LZMA_FILTER_LZMA2;
-	filters[0].options = &options;
-	filters[1].id = LZMA_VLI_UNKNOWN;
+	if(!coder.inbuf)
+	{
+		coder.inbuf = paper::util::makeSharedArray<uint8_t>(BUFFER_SIZE);
+		memset(coder.inbuf.get(), 0, sizeof(uint8_t) * BUFFER_SIZE);
+	}
 
-	if(compress)
+	if(!coder.outbuf)
 	{
-		ret = lzma_stream_encoder(&stream, filters, check);
+		coder.outbuf = paper::util::makeSharedArray<uint8_t>(BUFFER_SIZE);
+		memset(coder.outbuf.get(), 0, sizeof(uint8_t) * BUFFER_SIZE);
 	}
-	else
+
+	stream.next_in = nullptr;
+	stream.avail_in = 0;
+	stream.next_out = coder.outbuf.get();
+	stream.avail_out = BUFFER_SIZE;
+
+	while(true)
 	{
-		ret = lzma_stream_decoder(&stream, UINT64_MAX,
-		                          LZMA_TELL_UNSUPPORTED_CHECK |
-		                                  LZMA_CONCATENATED);
+		fillInputBuffer(coder.inbuf, stream, action, src, stats);
+
+		// Let liblzma do the actual work.
+		lzma_ret ret = lzma_code(&stream, action);
+
+		// Write the output if the output buffer is full.
+		if(stream.avail_out == 0)
+			writeOutputBuffer(sink, stream, coder.outbuf, stats);
+
+		// Handle the return code, continuing if appropriate.
+		if(!handleReturnCode(sink, stream, coder.outbuf, ret, stats))
+			break;
 	}
 
+	leftover.assign(stream.next_in, stream.next_in + stream.avail_in);
+}
+
+/**
+ * This function runs the given (already initialized) LZMA coder over the
+ * given input buffer in its entirety, writing its output to the given output
+ * buffer, until it finishes or can make no further progress.
+ *
+ * \param coder The coder whose initialized stream should be run.
+ * \param dst The buffer to write output data to.
+ * \param dstSize The size of the output buffer.
+ * \param src The buffer to read input data from.
+ * \param srcSize The size of the input buffer.
+ * \return The last return code from liblzma.
+ */
+lzma_ret runBufferCoder(Coder &coder, uint8_t *dst, std::size_t dstSize,
+                        const uint8_t *src, std::size_t srcSize)
+{
+	lzma_stream &stream = coder.stream;
+	stream.next_in = src;
+	stream.avail_in = srcSize;
+	stream.next_out = dst;
+	stream.avail_out = dstSize;
+
+	lzma_ret ret;
+	do
+	{
+		ret = lzma_code(&stream, LZMA_FINISH);
+	} while(ret == LZMA_OK);
+
+	return ret;
+}
+
+/**
+ * This function verifies that the given source file has been consumed in its
+ * entirety. Since we've hit LZMA_STREAM_END, any remaining input indicates a
+ * problem.
+ *
+ * \param leftover The input the coder didn't consume.
+ * \param src The source file input was read from.
+ */
+void checkEndOfInput(const std::vector<uint8_t> &leftover, FILE *src)
+{
+	if(!leftover.empty() || (fgetc(src) != EOF))
+		throw std::runtime_error("LZMA input data error.");
+}
+
+/**
+ * This function throws an exception if the given return code from a liblzma
+ * initialization function indicates an error.
+ *
+ * \param ret The return code to check.
+ */
+void checkInit(lzma_ret ret)
+{
 	if(ret != LZMA_OK)
 	{
 		throw std::runtime_error(std::string("LZMA error: ") +
 		                         lzma_error_string(ret));
 	}
+}
 
-	auto inbuf(paper::util::makeSharedArray<uint8_t>(BUFFER_SIZE));
-	memset(inbuf.get(), 0, sizeof(uint8_t) * BUFFER_SIZE);
+/**
+ * This function returns liblzma's identifier for the given filter type.
+ *
+ * \param type The filter type to look up. This must not be None or Auto.
+ * \return The liblzma filter ID.
+ */
+lzma_vli getFilterId(paper::compression::FilterType type)
+{
+	switch(type)
+	{
+	case paper::compression::FilterType::X86:
+		return LZMA_FILTER_X86;
+	case paper::compression::FilterType::PowerPC:
+		return LZMA_FILTER_POWERPC;
+	case paper::compression::FilterType::ARM:
+		return LZMA_FILTER_ARM;
+	case paper::compression::FilterType::ARMThumb:
+		return LZMA_FILTER_ARMTHUMB;
+	case paper::compression::FilterType::SPARC:
+		return LZMA_FILTER_SPARC;
+#ifdef LZMA_FILTER_ARM64
+	case paper::compression::FilterType::ARM64:
+		return LZMA_FILTER_ARM64;
+#endif
+	case paper::compression::FilterType::Delta:
+		return LZMA_FILTER_DELTA;
+	default:
+		throw std::runtime_error("Unsupported LZMA filter.");
+	}
+}
 
-	auto outbuf(paper::util::makeSharedArray<uint8_t>(BUFFER_SIZE));
-	memset(outbuf.get(), 0, sizeof(uint8_t) * BUFFER_SIZE);
+/**
+ * This function fills in the given filter chain: the given filter (if any),
+ * followed by LZMA2 with the given options, followed by the terminator. The
+ * chain must have room for three entries.
+ *
+ * \param filters The filter chain to fill in.
+ * \param filter The filter to apply before LZMA2.
+ * \param delta Storage for the delta filter's options.
+ * \param lzma The LZMA2 options, which may be filled in later.
+ * \return The index of LZMA2 within the chain.
+ */
+std::size_t buildFilterChain(lzma_filter *filters,
+                             const paper::compression::Filter &filter,
+                             lzma_options_delta &delta, void *lzma)
+{
+	std::size_t index = 0;
 
-	stream.next_out = outbuf.get();
-	stream.avail_out = BUFFER_SIZE;
+	if((filter.type != paper::compression::FilterType::None) &&
+	   (filter.type != paper::compression::FilterType::Auto))
+	{
+		filters[index].id = getFilterId(filter.type);
+		filters[index].options = nullptr;
 
-	while(true)
+		if(filter.type == paper::compression::FilterType::Delta)
+		{
+			if((filter.distance < LZMA_DELTA_DIST_MIN) ||
+			   (filter.distance > LZMA_DELTA_DIST_MAX))
+			{
+				throw std::runtime_error(
+				        "Invalid delta filter distance.");
+			}
+
+			memset(&delta, 0, sizeof(lzma_options_delta));
+			delta.type = LZMA_DELTA_TYPE_BYTE;
+			delta.dist = filter.distance;
+			filters[index].options = &delta;
+		}
+
+		++index;
+	}
+
+	filters[index].id = LZMA_FILTER_LZMA2;
+	filters[index].options = lzma;
+	filters[index + 1].id = LZMA_VLI_UNKNOWN;
+	filters[index + 1].options = nullptr;
+	return index;
+}
+
+/**
+ * This function returns the filter to actually use, given the one detected
+ * automatically. Filters which this build of liblzma can't encode are
+ * skipped, rather than failing.
+ *
+ * \param opts The compression options in use.
+ * \param detect A function which detects the best filter for the input.
+ * \return The filter to use.
+ */
+paper::compression::Filter
+resolveFilter(const paper::compression::LZMAOptions &opts,
+              const std::function<paper::compression::Filter()> &detect)
+{
+	if(opts.filter.type != paper::compression::FilterType::Auto)
+		return opts.filter;
+
+	paper::compression::Filter filter(detect());
+
+#ifndef LZMA_FILTER_ARM64
+	if(filter.type == paper::compression::FilterType::ARM64)
+		filter.type = paper::compression::FilterType::None;
+#endif
+
+	if((filter.type != paper::compression::FilterType::None) &&
+	   !lzma_filter_encoder_is_supported(getFilterId(filter.type)))
 	{
-		fillInputBuffer(inbuf, stream, action, src);
+		filter.type = paper::compression::FilterType::None;
+	}
 
-		// Let liblzma do the actual work.
-		ret = lzma_code(&stream, action);
+	return filter;
+}
 
-		// Write the output if the output buffer is full.
-		if(stream.avail_out == 0)
-			writeOutputBuffer(dst, stream, outbuf);
+/**
+ * \brief This structure holds a fully configured LZMA encoder setup.
+ *
+ * The filter chain points at the filter options stored alongside it, and the
+ * threaded encoder options point at the filter chain, so instances of this
+ * structure must not be copied once configured.
+ */
+struct EncoderConfig
+{
+	lzma_options_lzma lzma;
+	lzma_options_delta delta;
+	lzma_filter filters[3];
+	std::size_t lzma2Index;
+	paper::compression::FilterType filterType;
+	uint32_t filterDistance;
+	lzma_mt mt;
+	bool threaded;
+	bool raw;
+};
 
-		// Handle the return code, continuing if appropriate.
-		if(!handleReturnCode(dst, stream, outbuf, src, ret))
-			break;
+/**
+ * This function returns the number of bytes the encoder described by the
+ * given configuration will use, according to liblzma.
+ *
+ * \param config The encoder configuration to inspect.
+ * \return The encoder's memory usage, in bytes.
+ */
+uint64_t getEncoderMemoryUsage(const EncoderConfig &config)
+{
+	uint64_t usage = config.threaded
+	                         ? lzma_stream_encoder_mt_memusage(&config.mt)
+	                         : lzma_raw_encoder_memusage(config.filters);
+
+	if(usage == UINT64_MAX)
+		throw std::runtime_error("Invalid LZMA encoder options.");
+
+	return usage;
+}
+
+/**
+ * This function fills in the given encoder configuration according to the
+ * given compression options. The dictionary size is reduced to the size of
+ * the input (if known), since a dictionary larger than the input only costs
+ * memory without improving the compression ratio. If the options specify a
+ * memory limit, the number of threads is reduced until the encoder fits.
+ *
+ * \param config The encoder configuration to fill in.
+ * \param opts The compression options to use.
+ * \param inputSize The size of the input, or UNKNOWN_SIZE.
+ * \param filter The filter to apply before LZMA2 (see resolveFilter).
+ */
+void configureEncoder(EncoderConfig &config,
+                      const paper::compression::LZMAOptions &opts,
+                      uint64_t inputSize,
+                      const paper::compression::Filter &filter)
+{
+	if(opts.level > 9)
+		throw std::runtime_error("Invalid LZMA compression level.");
+
+	uint32_t preset = opts.level;
+	if(opts.extreme)
+		preset |= LZMA_PRESET_EXTREME;
+
+	memset(&config, 0, sizeof(EncoderConfig));
+
+	if(lzma_lzma_preset(&config.lzma, preset))
+		throw std::runtime_error("Unsupported LZMA compression preset.");
+
+	// The raw LZMA2 format has no blocks, so it is always single-threaded.
+	config.raw = opts.format == paper::compression::LZMAFormat::Raw;
+
+	uint64_t presetSize = 0;
+	if(opts.dictionary)
+	{
+		if(!config.raw)
+		{
+			throw std::runtime_error("Preset dictionaries require the "
+			                         "raw LZMA2 format.");
+		}
+
+		presetSize = opts.dictionary->getSize();
+		config.lzma.preset_dict = opts.dictionary->getData();
+		config.lzma.preset_dict_size =
+		        static_cast<uint32_t>(std::min(presetSize,
+		                                       static_cast<uint64_t>(
+		                                               UINT32_MAX)));
+	}
+
+	if(inputSize != UNKNOWN_SIZE)
+	{
+		// Leave room in the window for the preset dictionary, if any. The
+		// size is rounded up to a power of two, so that jobs of similar
+		// sizes share the same match finder geometry, letting a reused
+		// encoder keep its allocations instead of rebuilding them.
+		uint64_t dictSize = LZMA_DICT_SIZE_MIN;
+		while(dictSize < inputSize + presetSize)
+			dictSize <<= 1;
+		config.lzma.dict_size = static_cast<uint32_t>(std::min(
+		        dictSize, static_cast<uint64_t>(config.lzma.dict_size)));
+	}
+
+	config.lzma2Index = buildFilterChain(config.filters, filter,
+	                                     config.delta, &config.lzma);
+	config.filterType = config.lzma2Index == 0
+	                            ? paper::compression::FilterType::None
+	                            : filter.type;
+	config.filterDistance = filter.distance;
+
+	config.threaded = !config.raw && (opts.threads > 1);
+	config.mt.threads = std::min(opts.threads, MAX_THREADS);
+	config.mt.block_size = opts.blockSize;
+	config.mt.filters = config.filters;
+	config.mt.check = LZMA_CHECK_CRC32;
+
+	if(opts.memoryLimit == 0)
+		return;
+
+	while(config.threaded &&
+	      (getEncoderMemoryUsage(config) > opts.memoryLimit))
+	{
+		--config.mt.threads;
+		config.threaded = config.mt.threads > 1;
+	}
+
+	if(getEncoderMemoryUsage(config) > opts.memoryLimit)
+	{
+		throw std::runtime_error(
+		        "LZMA encoder memory usage exceeds the memory limit.");
 	}
 }
 
 /**
- * This function performs an LZMA {en,de}coding operation using
- * high-level memory streams and so on. This is a basic utility which
- * can be used to implement either LZMA compression or decompression.
+ * This function returns the number of bytes remaining in the given file, if
+ * it is a regular file or some other seekable stream (e.g. a memory stream).
+ * For anything else (pipes, sockets, etc.), UNKNOWN_SIZE is returned.
  *
- * \param compress Whether or not we should be in compress mode.
- * \param dst The shared pointer to store the result inside.
- * \param src The buffer containing the data to {en,de}code.
- * \param srcSize The length of the input buffer.
- * \return The size of the result buffer.
+ * \param file The file to inspect.
+ * \return The size of the given file, or UNKNOWN_SIZE.
  */
-std::size_t lzma(bool compress, std::shared_ptr<uint8_t> &dst,
-                 const uint8_t *src, std::size_t srcSize)
+uint64_t getInputSize(FILE *file)
 {
-	paper::util::Memstream dstStream;
-	FILE *srcFile = fmemopen(const_cast<uint8_t *>(src),
-	                         sizeof(uint8_t) * srcSize, "r");
+	int fd = fileno(file);
+	if(fd >= 0)
+	{
+		struct stat s;
+		if((fstat(fd, &s) != 0) || !S_ISREG(s.st_mode))
+			return UNKNOWN_SIZE;
+	}
 
-	lzmaRaw(compress, dstStream.getFile(), srcFile);
+	// Account for anything which has already been read from the file.
+	long offset = ftell(file);
+	if(offset < 0)
+		return UNKNOWN_SIZE;
 
-	dst.reset(dstStream.getBuffer());
-	return dstStream.getSize();
+	if(fseek(file, 0, SEEK_END) != 0)
+		return UNKNOWN_SIZE;
+
+	long end = ftell(file);
+	if(fseek(file, offset, SEEK_SET) != 0)
+		throw std::runtime_error(strerror(errno));
+
+	if(end < offset)
+		return UNKNOWN_SIZE;
+
+	return static_cast<uint64_t>(end - offset);
+}
+
+/**
+ * This function initializes the given coder's stream as an .xz encoder,
+ * using either the single- or multi-threaded encoder.
+ *
+ * \param coder The coder to initialize.
+ * \param config The encoder configuration to use.
+ */
+void initXZEncoder(Coder &coder, const EncoderConfig &config)
+{
+	if(config.threaded)
+		checkInit(lzma_stream_encoder_mt(&coder.stream, &config.mt));
+	else
+		checkInit(lzma_stream_encoder(&coder.stream, config.filters,
+		                              config.mt.check));
 }
+
+/**
+ * This function compresses the given source file into the .xz container
+ * format, using either the single- or multi-threaded encoder.
+ *
+ * \param coder The coder to use.
+ * \param dst The file to write output data to.
+ * \param src The file to read input data from.
+ * \param config The encoder configuration to use.
+ */
+void encodeXZ(Coder &coder, FILE *dst, FILE *src, const EncoderConfig &config)
+{
+	initXZEncoder(coder, config);
+
+	CoderStats stats(false);
+	std::vector<uint8_t> leftover;
+	runCoder(coder, fileSink(dst), src, stats, leftover);
+	checkEndOfInput(leftover, src);
 }
 
-std::size_t paper::compression::lzmaCompress(std::shared_ptr<uint8_t> &dst,
-                                             const uint8_t *src,
-                                             std::size_t srcSize)
+/**
+ * This function decompresses .xz data from the given source file.
+ *
+ * \param coder The coder to use.
+ * \param sink The sink to pass output data to.
+ * \param src The file to read input data from.
+ * \param opts The decompression options to use.
+ */
+void decodeXZ(Coder &coder, const paper::compression::LZMASink &sink,
+              FILE *src, const paper::compression::LZMADecoderOptions &opts)
 {
-	return lzma(true, dst, src, srcSize);
+	checkInit(lzma_stream_decoder(
+	        &coder.stream,
+	        opts.memoryLimit == 0 ? UINT64_MAX : opts.memoryLimit,
+	        LZMA_TELL_UNSUPPORTED_CHECK | LZMA_CONCATENATED));
+
+	CoderStats stats(false, opts.outputLimit);
+	std::vector<uint8_t> leftover;
+	runCoder(coder, sink, src, stats, leftover);
+	checkEndOfInput(leftover, src);
 }
 
-std::size_t paper::compression::lzmaDecompress(std::shared_ptr<uint8_t> &dst,
-                                               const uint8_t *src,
-                                               std::size_t srcSize)
+/**
+ * This function encodes the given number of bytes of the given value into the
+ * given buffer, least significant byte first.
+ *
+ * \param dst The buffer to encode the value into.
+ * \param value The value to encode.
+ * \param bytes The number of bytes to encode.
+ */
+void writeLittleEndian(uint8_t *dst, uint32_t value, std::size_t bytes)
+{
+	for(std::size_t i = 0; i < bytes; ++i)
+		dst[i] = static_cast<uint8_t>((value >> (8 * i)) & 0xFF);
+}
+
+/**
+ * This function decodes the given number of bytes from the given buffer as a
+ * value stored least significant byte first.
+ *
+ * \param data The buffer containing the value.
+ * \param bytes The number of bytes to decode.
+ * \return The decoded value.
+ */
+uint32_t readLittleEndian(const uint8_t *data, std::size_t bytes)
+{
+	uint32_t value = 0;
+	for(std::size_t i = 0; i < bytes; ++i)
+		value |= static_cast<uint32_t>(data[i]) << (8 * i);
+	return value;
+}
+
+/**
+ * \brief This structure holds the fields of a raw LZMA2 header.
+ */
+struct RawHeader
+{
+	uint8_t props;
+	paper::compression::FilterType filterType;
+	uint32_t filterDistance;
+	bool checksum;
+	bool hasDictionary;
+	uint32_t dictionaryId;
+	uint64_t size;
+};
+
+/**
+ * This function encodes the raw LZMA2 header for the given encoder
+ * configuration into the given buffer, which must have room for at least
+ * MAX_RAW_HEADER_SIZE bytes.
+ *
+ * Paper's compact raw LZMA2 format consists of:
+ *
+ *     - One byte, whose low six bits hold the LZMA2 filter properties (the
+ *       encoded dictionary size), whose RAW_FLAG_CHECKSUM bit denotes
+ *       whether or not a checksum trails the compressed data, and whose
+ *       RAW_FLAG_DICTIONARY bit denotes whether or not a preset dictionary
+ *       was used.
+ *     - If the properties field holds RAW_PROPS_FILTERED, a filter was
+ *       applied before LZMA2. This is followed by one byte holding the
+ *       FilterType, then for the delta filter one byte holding the distance
+ *       minus one, and then one byte holding the LZMA2 properties.
+ *     - If a preset dictionary was used, its 32-bit identifier, least
+ *       significant byte first.
+ *     - The uncompressed size, as an LEB128 variable-length integer.
+ *     - The raw LZMA2 data, which is self-terminating.
+ *     - Optionally, the low 16 bits of the uncompressed data's CRC32, least
+ *       significant byte first. This trails the data, so it can be computed
+ *       while streaming.
+ *
+ * Compared to .xz, this omits the stream header and footer, the block
+ * headers, and the index, saving dozens of bytes on small payloads.
+ *
+ * \param dst The buffer to encode the header into.
+ * \param config The encoder configuration to use.
+ * \param opts The compression options the configuration was built from.
+ * \param inputSize The size of the input, which must be known in advance.
+ * \return The size of the header, in bytes.
+ */
+std::size_t writeRawHeader(uint8_t *dst, const EncoderConfig &config,
+                           const paper::compression::LZMAOptions &opts,
+                           uint64_t inputSize)
+{
+	if(inputSize == UNKNOWN_SIZE)
+	{
+		throw std::runtime_error(
+		        "Raw LZMA2 compression requires a known input size.");
+	}
+
+	uint8_t props = 0;
+	checkInit(lzma_properties_encode(&config.filters[config.lzma2Index],
+	                                 &props));
+
+	bool filtered =
+	        config.filterType != paper::compression::FilterType::None;
+
+	std::size_t size = 0;
+	dst[size] = filtered ? RAW_PROPS_FILTERED : props;
+	if(opts.checksum)
+		dst[size] |= RAW_FLAG_CHECKSUM;
+	if(opts.dictionary)
+		dst[size] |= RAW_FLAG_DICTIONARY;
+	++size;
+
+	if(filtered)
+	{
+		dst[size++] = static_cast<uint8_t>(config.filterType);
+		if(config.filterType == paper::compression::FilterType::Delta)
+		{
+			dst[size++] =
+			        static_cast<uint8_t>(config.filterDistance - 1);
+		}
+		dst[size++] = props;
+	}
+
+	if(opts.dictionary)
+	{
+		writeLittleEndian(dst + size, opts.dictionary->getId(), 4);
+		size += 4;
+	}
+
+	return size + paper::util::io::encodeVarint(dst + size, inputSize);
+}
+
+/**
+ * This function parses the raw LZMA2 header at the start of the given
+ * buffer. If the header is malformed, an exception is thrown instead.
+ *
+ * \param header The header to fill in.
+ * \param data The buffer to parse.
+ * \param size The size of the buffer, in bytes.
+ * \return The size of the header, or 0 if the buffer ends early.
+ */
+std::size_t parseRawHeader(RawHeader &header, const uint8_t *data,
+                           std::size_t size)
+{
+	using paper::compression::FilterType;
+
+	if(size == 0)
+		return 0;
+
+	header.props = static_cast<uint8_t>(data[0] & RAW_PROPS_MASK);
+	header.filterType = FilterType::None;
+	header.filterDistance = 0;
+	header.checksum = (data[0] & RAW_FLAG_CHECKSUM) != 0;
+	header.hasDictionary = (data[0] & RAW_FLAG_DICTIONARY) != 0;
+	header.dictionaryId = 0;
+
+	std::size_t offset = 1;
+	if(header.props == RAW_PROPS_FILTERED)
+	{
+		if(size < offset + 2)
+			return 0;
+
+		header.filterType = static_cast<FilterType>(data[offset++]);
+		if((header.filterType == FilterType::None) ||
+		   (header.filterType > FilterType::Delta))
+		{
+			throw std::runtime_error("Invalid raw LZMA2 header.");
+		}
+
+		if(header.filterType == FilterType::Delta)
+		{
+			if(size < offset + 2)
+				return 0;
+
+			header.filterDistance =
+			        static_cast<uint32_t>(data[offset++]) + 1;
+		}
+
+		header.props = data[offset++];
+	}
+
+	if(header.hasDictionary)
+	{
+		if(size < offset + 4)
+			return 0;
+
+		header.dictionaryId = readLittleEndian(data + offset, 4);
+		offset += 4;
+	}
+
+	std::size_t varintSize = paper::util::io::decodeVarint(
+	        header.size, data + offset, size - offset);
+	return varintSize == 0 ? 0 : offset + varintSize;
+}
+
+/**
+ * This function reads a raw LZMA2 header from the given file, one byte at a
+ * time so no data past the header is consumed.
+ *
+ * \param src The file to read the header from.
+ * \return The header which was read.
+ */
+RawHeader readRawHeader(FILE *src)
+{
+	RawHeader header;
+	uint8_t buffer[MAX_RAW_HEADER_SIZE];
+
+	for(std::size_t size = 1; size <= MAX_RAW_HEADER_SIZE; ++size)
+	{
+		int byte = fgetc(src);
+		if(byte == EOF)
+			break;
+
+		buffer[size - 1] = static_cast<uint8_t>(byte);
+		if(parseRawHeader(header, buffer, size) != 0)
+			return header;
+	}
+
+	throw std::runtime_error("Raw LZMA2 header is truncated.");
+}
+
+/**
+ * \brief This structure holds a fully configured raw LZMA2 decoder setup.
+ *
+ * The filter chain points at the filter options and the preset dictionary
+ * held alongside it, so instances must not be copied.
+ */
+struct RawDecoderConfig
+{
+	RawDecoderConfig() : delta(), filters(), options(), dictionary()
+	{
+	}
+
+	lzma_options_delta delta;
+	lzma_filter filters[3];
+	std::shared_ptr<void> options;
+	std::shared_ptr<const paper::compression::Dictionary> dictionary;
+};
+
+/**
+ * This function fills in the given raw LZMA2 decoder configuration according
+ * to the given header, enforcing the given options' limits.
+ *
+ * \param config The decoder configuration to fill in.
+ * \param header The header of the data to decode.
+ * \param opts The decompression options to use.
+ */
+void configureRawDecoder(RawDecoderConfig &config, const RawHeader &header,
+                         const paper::compression::LZMADecoderOptions &opts)
+{
+	if((opts.outputLimit > 0) && (header.size > opts.outputLimit))
+	{
+		throw std::runtime_error(
+		        "Decompressed data exceeds the output size limit.");
+	}
+
+	if(header.hasDictionary)
+	{
+		if(!opts.dictionaries)
+		{
+			throw std::runtime_error("The required compression "
+			                         "dictionary is unavailable.");
+		}
+
+		config.dictionary = opts.dictionaries->get(header.dictionaryId);
+	}
+
+	lzma_filter &lzma2 = config.filters[buildFilterChain(
+	        config.filters,
+	        paper::compression::Filter(header.filterType,
+	                                   header.filterDistance),
+	        config.delta, nullptr)];
+
+	checkInit(lzma_properties_decode(&lzma2, nullptr, &header.props, 1));
+	config.options.reset(lzma2.options, free);
+
+	if(config.dictionary)
+	{
+		lzma_options_lzma *lzmaOptions =
+		        static_cast<lzma_options_lzma *>(lzma2.options);
+		lzmaOptions->preset_dict = config.dictionary->getData();
+		lzmaOptions->preset_dict_size =
+		        static_cast<uint32_t>(config.dictionary->getSize());
+	}
+
+	// The raw decoder has no memory limit of its own, so check it here.
+	uint64_t usage = lzma_raw_decoder_memusage(config.filters);
+	if(usage == UINT64_MAX)
+		throw std::runtime_error("Invalid raw LZMA2 header.");
+	if((opts.memoryLimit > 0) && (usage > opts.memoryLimit))
+		throw paper::compression::MemoryLimitError(usage);
+}
+
+/**
+ * This function verifies the trailing checksum of some raw LZMA2 data.
+ *
+ * \param header The header of the data.
+ * \param trailer The trailer which followed the compressed data.
+ * \param crc The CRC32 of the decompressed data.
+ */
+void checkRawTrailer(const RawHeader &header, const uint8_t *trailer,
+                     uint32_t crc)
+{
+	if(header.checksum && (readLittleEndian(trailer, 2) != (crc & 0xFFFF)))
+		throw std::runtime_error("Raw LZMA2 checksum mismatch.");
+}
+
+/**
+ * This function compresses the given source file into Paper's compact raw
+ * LZMA2 format (see writeRawHeader).
+ *
+ * \param coder The coder to use.
+ * \param dst The file to write output data to.
+ * \param src The file to read input data from.
+ * \param config The encoder configuration to use.
+ * \param opts The compression options the configuration was built from.
+ * \param inputSize The size of the input, which must be known in advance.
+ */
+void encodeRawLZMA2(Coder &coder, FILE *dst, FILE *src,
+                    const EncoderConfig &config,
+                    const paper::compression::LZMAOptions &opts,
+                    uint64_t inputSize)
+{
+	uint8_t header[MAX_RAW_HEADER_SIZE];
+	std::size_t headerSize = writeRawHeader(header, config, opts, inputSize);
+	if(fwrite(header, sizeof(uint8_t), headerSize, dst) != headerSize)
+		throw std::runtime_error(strerror(errno));
+
+	checkInit(lzma_raw_encoder(&coder.stream, config.filters));
+
+	CoderStats stats(opts.checksum);
+	std::vector<uint8_t> leftover;
+	runCoder(coder, fileSink(dst), src, stats, leftover);
+	checkEndOfInput(leftover, src);
+
+	if(stats.inputSize != inputSize)
+		throw std::runtime_error("Input size changed while compressing.");
+
+	if(opts.checksum)
+	{
+		uint8_t trailer[RAW_TRAILER_SIZE];
+		writeLittleEndian(trailer, stats.inputCrc & 0xFFFF,
+		                  RAW_TRAILER_SIZE);
+		if(fwrite(trailer, sizeof(uint8_t), RAW_TRAILER_SIZE, dst) !=
+		   RAW_TRAILER_SIZE)
+		{
+			throw std::runtime_error(strerror(errno));
+		}
+	}
+}
+
+/**
+ * This function decompresses data written by encodeRawLZMA2 from the given
+ * source file, verifying the uncompressed size and (if present) checksum.
+ *
+ * \param coder The coder to use.
+ * \param sink The sink to pass output data to.
+ * \param src The file to read input data from.
+ * \param opts The decompression options to use.
+ */
+void decodeRawLZMA2(Coder &coder, const paper::compression::LZMASink &sink,
+                    FILE *src,
+                    const paper::compression::LZMADecoderOptions &opts)
+{
+	RawHeader header(readRawHeader(src));
+	RawDecoderConfig config;
+	configureRawDecoder(config, header, opts);
+
+	checkInit(lzma_raw_decoder(&coder.stream, config.filters));
+
+	CoderStats stats(header.checksum, header.size);
+	std::vector<uint8_t> leftover;
+	runCoder(coder, sink, src, stats, leftover);
+
+	if(stats.outputSize != header.size)
+		throw std::runtime_error("Raw LZMA2 data has the wrong size.");
+
+	// Read the trailing checksum, which may already be in our buffer.
+
+	std::size_t trailerSize = header.checksum ? RAW_TRAILER_SIZE : 0;
+	std::size_t remaining = trailerSize - std::min(trailerSize,
+	                                               leftover.size());
+	leftover.resize(leftover.size() + remaining);
+	if(fread(leftover.data() + leftover.size() - remaining,
+	         sizeof(uint8_t), remaining, src) != remaining)
+	{
+		throw std::runtime_error("Raw LZMA2 checksum is truncated.");
+	}
+
+	if((leftover.size() != trailerSize) || (fgetc(src) != EOF))
+		throw std::runtime_error("LZMA input data error.");
+
+	checkRawTrailer(header, leftover.data(), stats.outputCrc);
+}
+
+/**
+ * This function decompresses LZMA data from the given source file, passing
+ * the output to the given sink. The format is detected automatically: .xz
+ * data always starts with XZ_MAGIC, whose first byte is never a valid raw
+ * LZMA2 header.
+ *
+ * \param coder The coder to use.
+ * \param sink The sink to pass output data to.
+ * \param src The file to read input data from.
+ * \param opts The decompression options to use.
+ */
+void lzmaDecode(Coder &coder, const paper::compression::LZMASink &sink,
+                FILE *src, const paper::compression::LZMADecoderOptions &opts)
+{
+	int first = fgetc(src);
+	if((first != EOF) && (ungetc(first, src) == EOF))
+		throw std::runtime_error(strerror(errno));
+
+	if(first == XZ_MAGIC)
+		decodeXZ(coder, sink, src, opts);
+	else
+		decodeRawLZMA2(coder, sink, src, opts);
+}
+
+/**
+ * This function compresses the given buffer in a single shot, directly into
+ * the given output buffer.
+ *
+ * Rather than liblzma's own single-call buffer functions (which set up and
+ * tear down a complete coder every time, and which are considerably slower
+ * for small inputs in the .xz case), this runs the given coder's stream over
+ * the whole buffers at once, so the coder's allocations can be reused.
+ *
+ * \param coder The coder to use.
+ * \param dst The buffer to compress into.
+ * \param capacity The size of the output buffer.
+ * \param src The buffer containing the data to compress.
+ * \param srcSize The length of the input buffer.
+ * \param config The encoder configuration to use.
+ * \param opts The compression options the configuration was built from.
+ * \return The size of the compressed data.
+ */
+std::size_t encodeInto(Coder &coder, uint8_t *dst, std::size_t capacity,
+                       const uint8_t *src, std::size_t srcSize,
+                       const EncoderConfig &config,
+                       const paper::compression::LZMAOptions &opts)
+{
+	std::size_t size = 0;
+
+	if(config.raw)
+	{
+		size = writeRawHeader(dst, config, opts, srcSize);
+		checkInit(lzma_raw_encoder(&coder.stream, config.filters));
+		capacity -= size + RAW_TRAILER_SIZE;
+		dst += size;
+	}
+	else
+	{
+		initXZEncoder(coder, config);
+	}
+
+	lzma_ret ret = runBufferCoder(coder, dst, capacity, src, srcSize);
+	if(ret != LZMA_STREAM_END)
+		throw std::runtime_error(lzma_error_string(ret));
+
+	size += static_cast<std::size_t>(coder.stream.total_out);
+
+	if(config.raw && opts.checksum)
+	{
+		writeLittleEndian(coder.stream.next_out,
+		                  lzma_crc32(src, srcSize, 0), RAW_TRAILER_SIZE);
+		size += RAW_TRAILER_SIZE;
+	}
+
+	return size;
+}
+
+/**
+ * This function returns the largest size the given input can compress to with
+ * the given encoder configuration. liblzma's stream bound only allows for a
+ * single block, but the multithreaded encoder splits the input into blocks,
+ * each of which adds its own header, padding, check and index record.
+ *
+ * \param config The encoder configuration to use.
+ * \param srcSize The size of the input, in bytes.
+ * \return The largest possible output size, in bytes.
+ */
+std::size_t getOutputBound(const EncoderConfig &config, std::size_t srcSize)
+{
+	// liblzma picks a block size of at least 1 MiB by default. Assuming
+	// the smallest one over-counts the blocks, which is safe.
+	uint64_t blockSize = config.mt.block_size;
+	if(blockSize == 0)
+		blockSize = 1 << 20;
+
+	uint64_t blocks = 1;
+	if(config.threaded && (srcSize > blockSize))
+		blocks = (srcSize + blockSize - 1) / blockSize;
+	else
+		blockSize = srcSize;
+
+	std::size_t base = lzma_stream_buffer_bound(0);
+	uint64_t perBlock = lzma_block_buffer_bound(blockSize);
+	if((base == 0) || (perBlock == 0))
+		throw std::runtime_error("Input is too large to compress.");
+
+	// Besides the block itself, its index record holds two integers.
+	perBlock += 2 * LZMA_VLI_BYTES_MAX;
+	uint64_t limit = SIZE_MAX - base - MAX_RAW_HEADER_SIZE -
+	                 RAW_TRAILER_SIZE;
+	if(blocks > limit / perBlock)
+		throw std::runtime_error("Input is too large to compress.");
+
+	return base + static_cast<std::size_t>(blocks * perBlock);
+}
+
+/**
+ * This function compresses the given buffer in a single shot, directly into
+ * an output buffer preallocated using a worst-case bound, avoiding
+ * the stdio copies and reallocations of the streaming path.
+ *
+ * \param coder The coder to use.
+ * \param dst The shared pointer to store the result inside.
+ * \param src The buffer containing the data to compress.
+ * \param srcSize The length of the input buffer.
+ * \param opts The compression options to use.
+ * \return The size of the result buffer.
+ */
+std::size_t encodeBuffer(Coder &coder, std::shared_ptr<uint8_t> &dst,
+                         const uint8_t *src, std::size_t srcSize,
+                         const paper::compression::LZMAOptions &opts)
+{
+	auto detect = [src, srcSize]()
+	{
+		return paper::compression::detectFilter(src, srcSize);
+	};
+
+	EncoderConfig config;
+	configureEncoder(config, opts, srcSize, resolveFilter(opts, detect));
+
+	std::size_t capacity = getOutputBound(config, srcSize) +
+	                       MAX_RAW_HEADER_SIZE + RAW_TRAILER_SIZE;
+	uint8_t *out = static_cast<uint8_t *>(malloc(capacity));
+	if(out == nullptr)
+		throw std::runtime_error(strerror(errno));
+
+	std::size_t size;
+	try
+	{
+		size = encodeInto(coder, out, capacity, src, srcSize, config,
+		                  opts);
+	}
+	catch(...)
+	{
+		free(out);
+		throw;
+	}
+
+	// Give back the unused part of the worst-case allocation.
+	uint8_t *shrunk = static_cast<uint8_t *>(realloc(out, size + 1));
+	if(shrunk != nullptr)
+		out = shrunk;
+
+	dst.reset(out, free);
+	return size;
+}
+
+/**
+ * This function returns the decompressed size of the given LZMA data, if it
+ * can be determined without decompressing it. Raw LZMA2 data records its
+ * size in its header. For .xz data, the size is read from the stream's index,
+ * provided the buffer contains exactly one stream.
+ *
+ * \param src The buffer containing the compressed data.
+ * \param srcSize The length of the input buffer.
+ * \return The decompressed size, or UNKNOWN_SIZE.
+ */
+uint64_t getDecompressedSize(const uint8_t *src, std::size_t srcSize)
+{
+	if((srcSize > 0) && (src[0] != XZ_MAGIC))
+	{
+		RawHeader header;
+		return parseRawHeader(header, src, srcSize) == 0 ? UNKNOWN_SIZE
+		                                                 : header.size;
+	}
+
+	if(srcSize < 2 * LZMA_STREAM_HEADER_SIZE)
+		return UNKNOWN_SIZE;
+
+	const uint8_t *footer = src + srcSize - LZMA_STREAM_HEADER_SIZE;
+	lzma_stream_flags flags;
+	if((lzma_stream_footer_decode(&flags, footer) != LZMA_OK) ||
+	   (flags.backward_size > srcSize - 2 * LZMA_STREAM_HEADER_SIZE))
+	{
+		return UNKNOWN_SIZE;
+	}
+
+	lzma_index *index = nullptr;
+	uint64_t memlimit = UINT64_MAX;
+	std::size_t position = srcSize - LZMA_STREAM_HEADER_SIZE -
+	                       static_cast<std::size_t>(flags.backward_size);
+	if(lzma_index_buffer_decode(&index, &memlimit, nullptr, src, &position,
+	                            srcSize - LZMA_STREAM_HEADER_SIZE) !=
+	   LZMA_OK)
+	{
+		return UNKNOWN_SIZE;
+	}
+
+	uint64_t size = UNKNOWN_SIZE;
+	if(lzma_index_stream_size(index) == srcSize)
+		size = lzma_index_uncompressed_size(index);
+
+	lzma_index_end(index, nullptr);
+	return size;
+}
+
+/**
+ * This function decompresses the given buffer in a single shot, directly into
+ * the given output buffer.
+ *
+ * \param coder The coder to use.
+ * \param dst The buffer to decompress into.
+ * \param dstSize The size of the output buffer.
+ * \param src The buffer containing the data to decompress.
+ * \param srcSize The length of the input buffer.
+ * \param opts The decompression options to use.
+ * \return The size of the decompressed data.
+ */
+std::size_t decodeBuffer(Coder &coder, uint8_t *dst, std::size_t dstSize,
+                         const uint8_t *src, std::size_t srcSize,
+                         const paper::compression::LZMADecoderOptions &opts)
+{
+	lzma_stream &stream = coder.stream;
+
+	if((srcSize > 0) && (src[0] == XZ_MAGIC))
+	{
+		checkInit(lzma_stream_decoder(
+		        &stream,
+		        opts.memoryLimit == 0 ? UINT64_MAX : opts.memoryLimit,
+		        LZMA_CONCATENATED));
+
+		std::size_t outLimit = dstSize;
+		if(opts.outputLimit > 0)
+		{
+			outLimit = static_cast<std::size_t>(std::min(
+			        static_cast<uint64_t>(dstSize), opts.outputLimit));
+		}
+
+		lzma_ret ret = runBufferCoder(coder, dst, outLimit, src, srcSize);
+
+		if(ret == LZMA_MEMLIMIT_ERROR)
+		{
+			throw paper::compression::MemoryLimitError(
+			        lzma_memusage(&stream));
+		}
+		if((ret == LZMA_BUF_ERROR) && (stream.avail_out == 0))
+			throw std::runtime_error("Decompressed data is too large.");
+		if(ret == LZMA_BUF_ERROR)
+			throw std::runtime_error("LZMA input data error.");
+		if(ret != LZMA_STREAM_END)
+			throw std::runtime_error(lzma_error_string(ret));
+
+		return static_cast<std::size_t>(stream.total_out);
+	}
+
+	RawHeader header;
+	std::size_t headerSize = parseRawHeader(header, src, srcSize);
+	if(headerSize == 0)
+		throw std::runtime_error("Raw LZMA2 header is truncated.");
+
+	RawDecoderConfig config;
+	configureRawDecoder(config, header, opts);
+
+	std::size_t trailerSize = header.checksum ? RAW_TRAILER_SIZE : 0;
+	if((header.size > dstSize) || (srcSize - headerSize < trailerSize))
+		throw std::runtime_error("Raw LZMA2 data has the wrong size.");
+
+	checkInit(lzma_raw_decoder(&stream, config.filters));
+	lzma_ret ret = runBufferCoder(
+	        coder, dst, static_cast<std::size_t>(header.size),
+	        src + headerSize, srcSize - headerSize - trailerSize);
+
+	if((ret != LZMA_STREAM_END) || (stream.total_out != header.size) ||
+	   (stream.avail_in != 0))
+	{
+		throw std::runtime_error("LZMA input data error.");
+	}
+
+	checkRawTrailer(header, stream.next_in,
+	                lzma_crc32(dst, static_cast<std::size_t>(header.size),
+	                           0));
+	return static_cast<std::size_t>(header.size);
+}
+
+/**
+ * This is a fairly low level implementation of LZMA {en,de}coding
+ * using basic FILE pointers. This can be used to implement a
+ * higher-level LZMA API.
+ *
+ * \param coder The coder to use.
+ * \param compress Whether or not we should be in compress mode.
+ * \param dst The file to write output data to.
+ * \param src The file to read input data from.
+ * \param opts The compression options to use, if compressing.
+ * \param decoderOpts The decompression options to use, if decompressing.
+ * \param inputSize The size of the input, or UNKNOWN_SIZE.
+ */
+void lzmaRaw(Coder &coder, bool compress, FILE *dst, FILE *src,
+             const paper::compression::LZMAOptions &opts,
+             const paper::compression::LZMADecoderOptions &decoderOpts,
+             uint64_t inputSize)
+{
+	if(compress)
+	{
+		// Only seekable inputs can be inspected before compressing them.
+		auto detect = [src, inputSize]()
+		{
+			if(inputSize == UNKNOWN_SIZE)
+			{
+				return paper::compression::Filter(
+				        paper::compression::FilterType::None);
+			}
+
+			return paper::compression::detectFilter(src);
+		};
+
+		EncoderConfig config;
+		configureEncoder(config, opts, inputSize,
+		                 resolveFilter(opts, detect));
+
+		if(config.raw)
+			encodeRawLZMA2(coder, dst, src, config, opts, inputSize);
+		else
+			encodeXZ(coder, dst, src, config);
+
+		return;
+	}
+
+	lzmaDecode(coder, fileSink(dst), src, decoderOpts);
+}
+
+/**
+ * This function runs an LZMA {en,de}coding operation between the two given
+ * file descriptors. Each descriptor is duplicated and wrapped in a FILE, so
+ * the caller's descriptors are left open.
+ *
+ * \param compress Whether or not we should be in compress mode.
+ * \param dst The file descriptor to write output data to.
+ * \param src The file descriptor to read input data from.
+ * \param opts The compression options to use, if compressing.
+ * \param decoderOpts The decompression options to use, if decompressing.
+ */
+void lzmaFd(bool compress, int dst, int src,
+            const paper::compression::LZMAOptions &opts,
+            const paper::compression::LZMADecoderOptions &decoderOpts)
+{
+	auto open = [](int fd, const char *mode) -> std::shared_ptr<FILE>
+	{
+		int dupFd = dup(fd);
+		if(dupFd < 0)
+			throw std::runtime_error(strerror(errno));
+
+		FILE *file = fdopen(dupFd, mode);
+		if(file == nullptr)
+		{
+			close(dupFd);
+			throw std::runtime_error(strerror(errno));
+		}
+
+		return std::shared_ptr<FILE>(file, fclose);
+	};
+
+	std::shared_ptr<FILE> srcFile(open(src, "rb"));
+	std::shared_ptr<FILE> dstFile(open(dst, "wb"));
+
+	Coder coder;
+	lzmaRaw(coder, compress, dstFile.get(), srcFile.get(), opts,
+	        decoderOpts,
+	        compress ? getInputSize(srcFile.get()) : UNKNOWN_SIZE);
+
+	if(fflush(dstFile.get()) != 0)
+		throw std::runtime_error(strerror(errno));
+}
+
+/**
+ * This function performs an LZMA {en,de}coding operation using
+ * high-level memory streams and so on. This is a basic utility which
+ * can be used to implement either LZMA compression or decompression.
+ *
+ * \param coder The coder to use.
+ * \param compress Whether or not we should be in compress mode.
+ * \param dst The shared pointer to store the result inside.
+ * \param src The buffer containing the data to {en,de}code.
+ * \param srcSize The length of the input buffer.
+ * \param opts The compression options to use, if compressing.
+ * \param decoderOpts The decompression options to use, if decompressing.
+ * \return The size of the result buffer.
+ */
+std::size_t lzma(Coder &coder, bool compress, std::shared_ptr<uint8_t> &dst,
+                 const uint8_t *src, std::size_t srcSize,
+                 const paper::compression::LZMAOptions &opts,
+                 const paper::compression::LZMADecoderOptions &decoderOpts)
+{
+	paper::util::Memstream dstStream;
+	std::shared_ptr<FILE> srcFile(paper::util::io::openMemory(src, srcSize));
+
+	lzmaRaw(coder, compress, dstStream.getFile(), srcFile.get(), opts,
+	        decoderOpts, srcSize);
+
+	dst.reset(dstStream.detach(), free);
+	return dstStream.getSize();
+}
+
+/**
+ * This function decompresses the given buffer into a newly allocated buffer.
+ * If the decompressed size is known in advance, the buffer is allocated with
+ * exactly that size and filled in a single shot; otherwise, this falls back
+ * to streaming into a memory stream. The size comes from the (untrusted)
+ * input, so it is only preallocated if it is plausible for the input's size,
+ * and not too large (see MAX_PREALLOCATED_SIZE).
+ *
+ * \param coder The coder to use.
+ * \param dst The shared pointer to store the result inside.
+ * \param src The buffer containing the data to decompress.
+ * \param srcSize The length of the input buffer.
+ * \param opts The decompression options to use.
+ * \return The size of the result buffer.
+ */
+std::size_t decompressBuffer(Coder &coder, std::shared_ptr<uint8_t> &dst,
+                             const uint8_t *src, std::size_t srcSize,
+                             const paper::compression::LZMADecoderOptions &opts)
+{
+	uint64_t trustedSize = MAX_PREALLOCATED_SIZE;
+	if(srcSize < MAX_PREALLOCATED_SIZE / MAX_COMPRESSION_RATIO)
+		trustedSize = srcSize * MAX_COMPRESSION_RATIO;
+
+	uint64_t size = getDecompressedSize(src, srcSize);
+	if((size == UNKNOWN_SIZE) || (size > trustedSize) ||
+	   ((opts.outputLimit > 0) && (size > opts.outputLimit)))
+	{
+		// Fall back to streaming, which enforces the limits as it goes.
+		return lzma(coder, false, dst, src, srcSize,
+		            paper::compression::LZMAOptions(), opts);
+	}
+
+	uint8_t *out = static_cast<uint8_t *>(
+	        malloc(static_cast<std::size_t>(size) + 1));
+	if(out == nullptr)
+		throw std::runtime_error(strerror(errno));
+	std::shared_ptr<uint8_t> buffer(out, free);
+
+	std::size_t outSize = decodeBuffer(
+	        coder, out, static_cast<std::size_t>(size), src, srcSize, opts);
+	dst = buffer;
+	return outSize;
+}
+
+/**
+ * This function allocates memory for liblzma from the arena given as its
+ * opaque pointer.
+ *
+ * \param opaque The arena to allocate from.
+ * \param nmemb The number of elements to allocate.
+ * \param size The size of each element.
+ * \return The allocated memory, or nullptr on failure.
+ */
+void *arenaAlloc(void *opaque, std::size_t nmemb, std::size_t size)
+{
+	if((size != 0) && (nmemb > SIZE_MAX / size))
+		return nullptr;
+
+	return static_cast<paper::util::Arena *>(opaque)->allocate(nmemb *
+	                                                           size);
+}
+
+/**
+ * This function returns memory allocated by arenaAlloc to its arena.
+ *
+ * \param opaque The arena the memory was allocated from.
+ * \param ptr The memory to release.
+ */
+void arenaFree(void *opaque, void *ptr)
+{
+	static_cast<paper::util::Arena *>(opaque)->release(ptr);
+}
+}
+
+/**
+ * \brief This structure holds the state an LZMAContext keeps between jobs.
+ *
+ * The coder is declared last, so it is ended before the arena its stream
+ * allocated from is destroyed.
+ */
+struct paper::compression::LZMAContext::State
+{
+	paper::util::Arena arena;
+	lzma_allocator allocator;
+	Coder coder;
+
+	State() : arena(), allocator(), coder(&allocator)
+	{
+		allocator.alloc = arenaAlloc;
+		allocator.free = arenaFree;
+		allocator.opaque = &arena;
+	}
+
+private:
+	State(const State &);
+	State &operator=(const State &);
+};
+
+paper::compression::LZMAOptions::LZMAOptions()
+        : level(9),
+          extreme(false),
+          threads(static_cast<uint32_t>(util::getOnlineCores())),
+          blockSize(0),
+          memoryLimit(std::max(lzma_physmem() / 4,
+                               MIN_DEFAULT_MEMORY_LIMIT)),
+          format(LZMAFormat::XZ),
+          checksum(true),
+          dictionary(),
+          filter()
+{
+}
+
+paper::compression::LZMADecoderOptions::LZMADecoderOptions()
+        : dictionaries(),
+          memoryLimit(std::max(lzma_physmem() / 4, MIN_DEFAULT_MEMORY_LIMIT)),
+          outputLimit(0)
+{
+}
+
+paper::compression::MemoryLimitError::MemoryLimitError(uint64_t required)
+        : std::runtime_error("LZMA decoder needs " + std::to_string(required) +
+                             " bytes of memory, exceeding the memory limit."),
+          requiredLimit(required)
+{
+}
+
+uint64_t paper::compression::MemoryLimitError::getRequiredLimit() const
+{
+	return requiredLimit;
+}
+
+std::size_t paper::compression::lzmaCompress(std::shared_ptr<uint8_t> &dst,
+                                             const uint8_t *src,
+                                             std::size_t srcSize,
+                                             const LZMAOptions &options)
+{
+	Coder coder;
+	return encodeBuffer(coder, dst, src, srcSize, options);
+}
+
+std::size_t paper::compression::lzmaDecompress(std::shared_ptr<uint8_t> &dst,
+                                               const uint8_t *src,
+                                               std::size_t srcSize,
+                                               const LZMADecoderOptions &options)
+{
+	Coder coder;
+	return decompressBuffer(coder, dst, src, srcSize, options);
+}
+
+uint64_t paper::compression::lzmaDecompressedSize(const uint8_t *src,
+                                                  std::size_t srcSize)
+{
+	return getDecompressedSize(src, srcSize);
+}
+
+std::size_t paper::compression::lzmaDecompress(uint8_t *dst,
+                                               std::size_t dstSize,
+                                               const uint8_t *src,
+                                               std::size_t srcSize,
+                                               const LZMADecoderOptions &options)
+{
+	Coder coder;
+	return decodeBuffer(coder, dst, dstSize, src, srcSize, options);
+}
+
+uint64_t
+paper::compression::lzmaEncoderMemoryUsage(const LZMAOptions &options,
+                                           uint64_t inputSize)
+{
+	EncoderConfig config;
+	configureEncoder(config, options,
+	                 inputSize == 0 ? UNKNOWN_SIZE : inputSize,
+	                 options.filter);
+	return getEncoderMemoryUsage(config);
+}
+
+void paper::compression::lzmaCompress(FILE *dst, FILE *src,
+                                      const LZMAOptions &options)
+{
+	Coder coder;
+	lzmaRaw(coder, true, dst, src, options, LZMADecoderOptions(),
+	        getInputSize(src));
+}
+
+void paper::compression::lzmaDecompress(FILE *dst, FILE *src,
+                                        const LZMADecoderOptions &options)
+{
+	Coder coder;
+	lzmaRaw(coder, false, dst, src, LZMAOptions(), options, UNKNOWN_SIZE);
+}
+
+void paper::compression::lzmaDecompress(const LZMASink &sink, FILE *src,
+                                        const LZMADecoderOptions &options)
+{
+	Coder coder;
+	lzmaDecode(coder, sink, src, options);
+}
+
+void paper::compression::lzmaCompress(int dst, int src,
+                                      const LZMAOptions &options)
+{
+	lzmaFd(true, dst, src, options, LZMADecoderOptions());
+}
+
+void paper::compression::lzmaDecompress(int dst, int src,
+                                        const LZMADecoderOptions &options)
+{
+	lzmaFd(false, dst, src, LZMAOptions(), options);
+}
+
+paper::compression::LZMAContext::LZMAContext() : state(new State())
+{
+}
+
+paper::compression::LZMAContext::~LZMAContext()
+{
+}
+
+std::size_t paper::compression::LZMAContext::compress(
+        std::shared_ptr<uint8_t> &dst, const uint8_t *src, std::size_t srcSize,
+        const LZMAOptions &options)
+{
+	return encodeBuffer(state->coder, dst, src, srcSize, options);
+}
+
+void paper::compression::LZMAContext::compress(FILE *dst, FILE *src,
+                                               const LZMAOptions &options)
+{
+	lzmaRaw(state->coder, true, dst, src, options, LZMADecoderOptions(),
+	        getInputSize(src));
+}
+
+std::size_t paper::compression::LZMAContext::decompress(
+        std::shared_ptr<uint8_t> &dst, const uint8_t *src, std::size_t srcSize,
+        const LZMADecoderOptions &options)
+{
+	return decompressBuffer(state->coder, dst, src, srcSize, options);
+}
+
+void paper::compression::LZMAContext::decompress(
+        FILE *dst, FILE *src, const LZMADecoderOptions &options)
+{
+	lzmaRaw(state->coder, false, dst, src, LZMAOptions(), options,
+	        UNKNOWN_SIZE);
+}
+
+std::size_t paper::compression::LZMAContext::getReservedMemory() const
 {
-	return lzma(false, dst, src, srcSize);
+	return state->arena.getReservedSize();
 }
@@ -21,35 +21,416 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <functional>
 #include <memory>
+#include <stdexcept>
+
+#include "PaperCommon/Compression/Dictionary.h"
+#include "PaperCommon/Compression/Filters.h"
 
 namespace paper
 {
 namespace compression
 {
+/**
+ * \brief This enumeration defines the container formats LZMA data can be
+ * written in.
+ */
+enum class LZMAFormat
+{
+	/**
+	 * The standard .xz format, which can be decompressed by other tools,
+	 * and which supports multithreaded compression.
+	 */
+	XZ,
+
+	/**
+	 * A compact raw LZMA2 format, with a minimal header (the LZMA2
+	 * properties and the uncompressed size) and an optional 16-bit
+	 * checksum. This saves dozens of bytes compared to .xz, which matters
+	 * most for small payloads. It requires an input of known size, and it
+	 * is always single-threaded.
+	 */
+	Raw
+};
+
+/**
+ * \brief This structure holds the tunable parameters for LZMA compression.
+ */
+struct LZMAOptions
+{
+	/**
+	 * The compression preset level, from 0 (fastest) to 9 (smallest
+	 * output). The default is 9, since every byte saved reduces the amount
+	 * of QR codes to print.
+	 */
+	uint32_t level;
+
+	/**
+	 * Whether or not to use the "extreme" variant of the preset level,
+	 * which is slower but may produce slightly smaller output.
+	 */
+	bool extreme;
+
+	/**
+	 * The number of encoder threads to use. A value of 1 selects liblzma's
+	 * single-threaded encoder. By default, this is the number of online
+	 * processor cores.
+	 */
+	uint32_t threads;
+
+	/**
+	 * The uncompressed size of each independently compressed block when
+	 * using the multithreaded encoder. Zero lets liblzma choose a size
+	 * based upon the dictionary size.
+	 */
+	uint64_t blockSize;
+
+	/**
+	 * The maximum amount of memory the encoder may use, in bytes. If the
+	 * encoder would exceed this, the thread count is reduced until it fits,
+	 * or an exception is thrown if even one thread is too many. Zero means
+	 * there is no limit. The default is a quarter of physical memory (but
+	 * at least 1 GiB, enough for one thread at level 9), since each
+	 * thread at high levels needs hundreds of megabytes.
+	 */
+	uint64_t memoryLimit;
+
+	/**
+	 * The container format to write. Decompression detects the format
+	 * automatically.
+	 */
+	LZMAFormat format;
+
+	/**
+	 * Whether or not to include a checksum of the uncompressed data in
+	 * raw LZMA2 payloads. (.xz payloads always include a CRC32.)
+	 */
+	bool checksum;
+
+	/**
+	 * An optional preset dictionary to prime the encoder with. This is
+	 * only supported by the raw LZMA2 format, which records the
+	 * dictionary's identifier so the decoder can find it.
+	 */
+	std::shared_ptr<const Dictionary> dictionary;
+
+	/**
+	 * The filter to apply to the input before LZMA2, e.g. to make machine
+	 * code or numeric samples more compressible. By default, the filter is
+	 * chosen based upon the start of the input, if it is seekable. Both
+	 * formats record the filter, so the decoder reverses it automatically.
+	 */
+	Filter filter;
+
+	/**
+	 * This constructor initializes all options to their default values.
+	 */
+	LZMAOptions();
+};
+
+/**
+ * \brief This structure holds the parameters for LZMA decompression.
+ */
+struct LZMADecoderOptions
+{
+	/**
+	 * The preset dictionaries which compressed payloads may refer to. If
+	 * a payload needs a dictionary which isn't available, decompression
+	 * fails.
+	 */
+	std::shared_ptr<const DictionaryStore> dictionaries;
+
+	/**
+	 * The maximum amount of memory the decoder may use, in bytes. If a
+	 * payload needs more (e.g., because it was compressed with a huge
+	 * dictionary, or because it is corrupt), a MemoryLimitError is thrown.
+	 * Zero means there is no limit. The default is the same as the
+	 * encoder's (see LZMAOptions::memoryLimit), which any payload written
+	 * with a preset level fits within.
+	 */
+	uint64_t memoryLimit;
+
+	/**
+	 * The maximum number of bytes decompression may produce. If a payload
+	 * would decompress to more than this, an exception is thrown. Zero
+	 * means there is no limit.
+	 */
+	uint64_t outputLimit;
+
+	/**
+	 * This constructor initializes all options to their default values.
+	 */
+	LZMADecoderOptions();
+};
+
+/**
+ * \brief This exception is thrown when decompression would exceed the
+ * decoder's memory limit.
+ */
+class MemoryLimitError : public std::runtime_error
+{
+public:
+	/**
+	 * This constructor creates a new exception for a decoder which needs
+	 * the given amount of memory.
+	 *
+	 * \param required The memory limit needed to decompress, in bytes.
+	 */
+	MemoryLimitError(uint64_t required);
+
+	/**
+	 * \return The memory limit needed to decompress, in bytes.
+	 */
+	uint64_t getRequiredLimit() const;
+
+private:
+	uint64_t requiredLimit;
+};
+
+/**
+ * \brief This type is a function which consumes decompressed data, one chunk
+ * at a time.
+ */
+typedef std::function<void(const uint8_t *, std::size_t)> LZMASink;
+
+/**
+ * This function returns the amount of memory, in bytes, the LZMA encoder will
+ * use when compressing an input of the given size with the given options. The
+ * dictionary size (and therefore memory usage) is reduced for small inputs,
+ * and the thread count is reduced to honor any memory limit.
+ *
+ * \param options The compression options to inspect.
+ * \param inputSize The size of the input, or 0 if it isn't known.
+ * \return The encoder's memory usage, in bytes.
+ */
+uint64_t lzmaEncoderMemoryUsage(const LZMAOptions &options,
+                                uint64_t inputSize);
+
 /**
  * This function compresses the given data, placing the result in the given
- * shared pointer and returning the size of the compressed result.
+ * shared pointer and returning the size of the compressed result. The data is
+ * compressed in a single shot, into a buffer sized using liblzma's worst-case
+ * bound.
  *
  * \param dst The shared pointer to store the result inside.
  * \param src The buffer containing the data to compress.
  * \param srcSize The length of the input buffer.
+ * \param options The compression options to use.
  * \return The size of the result buffer.
  */
 std::size_t lzmaCompress(std::shared_ptr<uint8_t> &dst, const uint8_t *src,
-                         std::size_t srcSize);
+                         std::size_t srcSize,
+                         const LZMAOptions &options = LZMAOptions());
 
 /**
  * This function decompresses the given data, placing the result in the given
- * shared pointer and returning the size of the decompressed result.
+ * shared pointer and returning the size of the decompressed result. If the
+ * decompressed size is known in advance (see lzmaDecompressedSize), the data
+ * is decompressed in a single shot into an exactly sized buffer.
  *
  * \param dst The shared pointer to store the result inside.
  * \param src The bufer containing the data to decompress.
  * \param srcSize The length of the input buffer.
+ * \param options The decompression options to use.
  * \return The size of the result buffer.
  */
-std::size_t lzmaDecompress(std::shared_ptr<uint8_t> &dst, const uint8_t *src,
-                           std::size_t srcSize);
+std::size_t
+lzmaDecompress(std::shared_ptr<uint8_t> &dst, const uint8_t *src,
+               std::size_t srcSize,
+               const LZMADecoderOptions &options = LZMADecoderOptions());
+
+/**
+ * This function returns the decompressed size of the given compressed data,
+ * if it can be determined without decompressing it. This is the case for raw
+ * LZMA2 data, and for .xz data consisting of exactly one stream.
+ *
+ * \param src The buffer containing the compressed data.
+ * \param srcSize The length of the input buffer.
+ * \return The decompressed size, or UINT64_MAX if it is unknown.
+ */
+uint64_t lzmaDecompressedSize(const uint8_t *src, std::size_t srcSize);
+
+/**
+ * This function decompresses the given data in a single shot, directly into
+ * the given caller-provided buffer. If the buffer is too small to hold the
+ * decompressed data, an exception is thrown.
+ *
+ * \param dst The buffer to decompress into.
+ * \param dstSize The size of the output buffer.
+ * \param src The buffer containing the data to decompress.
+ * \param srcSize The length of the input buffer.
+ * \param options The decompression options to use.
+ * \return The size of the decompressed data.
+ */
+std::size_t
+lzmaDecompress(uint8_t *dst, std::size_t dstSize, const uint8_t *src,
+               std::size_t srcSize,
+               const LZMADecoderOptions &options = LZMADecoderOptions());
+
+/**
+ * This function compresses all of the data read from the given source file,
+ * writing the compressed result to the given destination file. Data is
+ * processed in small fixed-size blocks, so memory usage does not depend on
+ * the size of the input.
+ *
+ * \param dst The file to write the compressed data to.
+ * \param src The file to read the data to compress from.
+ * \param options The compression options to use.
+ */
+void lzmaCompress(FILE *dst, FILE *src,
+                  const LZMAOptions &options = LZMAOptions());
+
+/**
+ * This function decompresses all of the data read from the given source file,
+ * writing the decompressed result to the given destination file. Like the
+ * compression equivalent, memory usage does not depend on the size of the
+ * input or output.
+ *
+ * \param dst The file to write the decompressed data to.
+ * \param src The file to read the data to decompress from.
+ * \param options The decompression options to use.
+ */
+void lzmaDecompress(FILE *dst, FILE *src,
+                    const LZMADecoderOptions &options = LZMADecoderOptions());
+
+/**
+ * This function decompresses all of the data read from the given source file,
+ * passing the decompressed result to the given sink in chunks as it is
+ * produced. The sink may throw an exception to abort decompression. Memory
+ * usage is bounded by the decoder's memory limit, regardless of the size of
+ * the output.
+ *
+ * \param sink The function to pass the decompressed data to.
+ * \param src The file to read the data to decompress from.
+ * \param options The decompression options to use.
+ */
+void lzmaDecompress(const LZMASink &sink, FILE *src,
+                    const LZMADecoderOptions &options = LZMADecoderOptions());
+
+/**
+ * This is a convenience wrapper around the FILE-based lzmaCompress, which
+ * operates on raw file descriptors instead. The given descriptors are not
+ * closed, but the destination is flushed before this function returns.
+ *
+ * \param dst The file descriptor to write the compressed data to.
+ * \param src The file descriptor to read the data to compress from.
+ * \param options The compression options to use.
+ */
+void lzmaCompress(int dst, int src, const LZMAOptions &options = LZMAOptions());
+
+/**
+ * This is a convenience wrapper around the FILE-based lzmaDecompress, which
+ * operates on raw file descriptors instead. The given descriptors are not
+ * closed, but the destination is flushed before this function returns.
+ *
+ * \param dst The file descriptor to write the decompressed data to.
+ * \param src The file descriptor to read the data to decompress from.
+ * \param options The decompression options to use.
+ */
+void lzmaDecompress(int dst, int src,
+                    const LZMADecoderOptions &options = LZMADecoderOptions());
+
+/**
+ * \brief This class holds LZMA coder state which is reused between jobs.
+ *
+ * Each of the free lzmaCompress and lzmaDecompress functions sets up a new
+ * coder, and tears it down again when it is done. When many small inputs are
+ * processed, that allocation and initialization work can take longer than
+ * the compression itself. A context instead keeps its coder alive between
+ * jobs, so liblzma can reinitialize it in place, and it serves all of the
+ * coder's allocations from a private arena, so blocks released by one job
+ * are recycled by the next.
+ *
+ * This pays off for fast presets (e.g., level 0) on small inputs, where
+ * setting up the coder dominates. At higher levels, or on larger inputs,
+ * the coder's own work dominates, and the C library's allocator already
+ * recycles freed blocks between jobs, so a context performs about the same
+ * as the free functions (within run-to-run noise), while holding on to all of
+ * the memory it has used.
+ *
+ * The output is identical to that of the free functions. Memory held by the
+ * arena is only released when the context is destroyed. A context must not
+ * be used by more than one thread at a time.
+ */
+class LZMAContext
+{
+public:
+	/**
+	 * This constructor creates a new, empty context.
+	 */
+	LZMAContext();
+
+	/**
+	 * This destructor releases all of the memory this context holds.
+	 */
+	~LZMAContext();
+
+	/**
+	 * This function compresses the given data, like the buffer-based
+	 * lzmaCompress function.
+	 *
+	 * \param dst The shared pointer to store the result inside.
+	 * \param src The buffer containing the data to compress.
+	 * \param srcSize The length of the input buffer.
+	 * \param options The compression options to use.
+	 * \return The size of the result buffer.
+	 */
+	std::size_t compress(std::shared_ptr<uint8_t> &dst, const uint8_t *src,
+	                     std::size_t srcSize,
+	                     const LZMAOptions &options = LZMAOptions());
+
+	/**
+	 * This function compresses the data read from the given source file,
+	 * like the FILE-based lzmaCompress function.
+	 *
+	 * \param dst The file to write the compressed data to.
+	 * \param src The file to read the data to compress from.
+	 * \param options The compression options to use.
+	 */
+	void compress(FILE *dst, FILE *src,
+	              const LZMAOptions &options = LZMAOptions());
+
+	/**
+	 * This function decompresses the given data, like the buffer-based
+	 * lzmaDecompress function.
+	 *
+	 * \param dst The shared pointer to store the result inside.
+	 * \param src The buffer containing the data to decompress.
+	 * \param srcSize The length of the input buffer.
+	 * \param options The decompression options to use.
+	 * \return The size of the result buffer.
+	 */
+	std::size_t
+	decompress(std::shared_ptr<uint8_t> &dst, const uint8_t *src,
+	           std::size_t srcSize,
+	           const LZMADecoderOptions &options = LZMADecoderOptions());
+
+	/**
+	 * This function decompresses the data read from the given source
+	 * file, like the FILE-based lzmaDecompress function.
+	 *
+	 * \param dst The file to write the decompressed data to.
+	 * \param src The file to read the data to decompress from.
+	 * \param options The decompression options to use.
+	 */
+	void decompress(FILE *dst, FILE *src,
+	                const LZMADecoderOptions &options = LZMADecoderOptions());
+
+	/**
+	 * \return The total amount of memory this context's arena has
+	 * obtained from the system, in bytes.
+	 */
+	std::size_t getReservedMemory() const;
+
+private:
+	struct State;
+	std::shared_ptr<State> state;
+
+	LZMAContext(const LZMAContext &);
+	LZMAContext &operator=(const LZMAContext &);
+};
 }
 }
 
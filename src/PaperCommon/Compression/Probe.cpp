@@ -0,0 +1,233 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Probe.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "PaperCommon/Compression/LZMA.h"
+
+namespace
+{
+// The number of windows to sample from the input.
+constexpr std::size_t WINDOW_COUNT = 4;
+
+// The size of each sampled window, in bytes.
+constexpr std::size_t WINDOW_SIZE = 16384;
+
+// Inputs whose sampled entropy is below this are always compressible.
+constexpr double ENTROPY_THRESHOLD = 7.5;
+
+// Inputs whose trial compression ratio is at least this are stored as-is.
+constexpr double RATIO_THRESHOLD = 0.98;
+
+/**
+ * This function compresses each of the given windows independently with a
+ * fast LZMA preset, and returns the overall compression ratio.
+ *
+ * \param data The concatenated windows.
+ * \param windowSizes The size of each window, in bytes.
+ * \return The ratio of compressed to uncompressed size.
+ */
+double getTrialRatio(const uint8_t *data,
+                     const std::vector<std::size_t> &windowSizes)
+{
+	paper::compression::LZMAOptions options;
+	options.level = 1;
+	options.threads = 1;
+	options.format = paper::compression::LZMAFormat::Raw;
+	options.checksum = false;
+	options.filter = paper::compression::FilterType::None;
+
+	std::size_t input = 0;
+	std::size_t output = 0;
+	for(std::size_t size : windowSizes)
+	{
+		std::shared_ptr<uint8_t> compressed;
+		output += paper::compression::lzmaCompress(
+		        compressed, data + input, size, options);
+		input += size;
+	}
+
+	return input == 0 ? 1.0 : static_cast<double>(output) /
+	                                  static_cast<double>(input);
+}
+
+/**
+ * This function probes the given sampled windows of some input.
+ *
+ * \param data The concatenated windows.
+ * \param windowSizes The size of each window, in bytes.
+ * \return The result of the probe.
+ */
+paper::compression::ProbeResult
+probeWindows(const uint8_t *data, const std::vector<std::size_t> &windowSizes)
+{
+	paper::compression::ProbeResult result;
+	for(std::size_t size : windowSizes)
+		result.sampledSize += size;
+
+	result.entropy = paper::compression::getEntropy(
+	        data, static_cast<std::size_t>(result.sampledSize));
+	if(result.entropy < ENTROPY_THRESHOLD)
+		return result;
+
+	result.trialRatio = getTrialRatio(data, windowSizes);
+	result.compressible = result.trialRatio < RATIO_THRESHOLD;
+	return result;
+}
+
+/**
+ * This function returns the offset of each sampled window within an input of
+ * the given size. Small inputs are sampled in their entirety, as one window.
+ *
+ * \param size The size of the input.
+ * \param windowSizes The size of each window, filled in by this function.
+ * \return The offset of each window.
+ */
+std::vector<uint64_t> getWindows(uint64_t size,
+                                 std::vector<std::size_t> &windowSizes)
+{
+	std::vector<uint64_t> offsets;
+	windowSizes.clear();
+
+	if(size <= WINDOW_COUNT * WINDOW_SIZE)
+	{
+		offsets.push_back(0);
+		windowSizes.push_back(static_cast<std::size_t>(size));
+		return offsets;
+	}
+
+	uint64_t stride = (size - WINDOW_SIZE) / (WINDOW_COUNT - 1);
+	for(std::size_t i = 0; i < WINDOW_COUNT; ++i)
+	{
+		offsets.push_back(stride * i);
+		windowSizes.push_back(WINDOW_SIZE);
+	}
+
+	return offsets;
+}
+}
+
+namespace paper
+{
+namespace compression
+{
+double getEntropy(const uint8_t *data, std::size_t size)
+{
+	if(size == 0)
+		return 0.0;
+
+	// The histogram is split across four independent sets of counters, so
+	// consecutive bytes with the same value don't serialize on a single
+	// counter's load-increment-store chain.
+
+	uint32_t counts[4][256];
+	memset(counts, 0, sizeof(counts));
+
+	std::size_t i = 0;
+	for(; i + 4 <= size; i += 4)
+	{
+		++counts[0][data[i]];
+		++counts[1][data[i + 1]];
+		++counts[2][data[i + 2]];
+		++counts[3][data[i + 3]];
+	}
+
+	for(; i < size; ++i)
+		++counts[0][data[i]];
+
+	double entropy = 0.0;
+	for(std::size_t b = 0; b < 256; ++b)
+	{
+		uint32_t count = counts[0][b] + counts[1][b] + counts[2][b] +
+		                 counts[3][b];
+		if(count == 0)
+			continue;
+
+		double p = static_cast<double>(count) / static_cast<double>(size);
+		entropy -= p * std::log2(p);
+	}
+
+	return entropy;
+}
+
+ProbeResult::ProbeResult()
+        : sampledSize(0), entropy(0.0), trialRatio(0.0), compressible(true)
+{
+}
+
+ProbeResult probeCompressibility(const uint8_t *data, std::size_t size)
+{
+	std::vector<std::size_t> windowSizes;
+	std::vector<uint64_t> offsets(getWindows(size, windowSizes));
+
+	std::vector<uint8_t> samples;
+	for(std::size_t i = 0; i < offsets.size(); ++i)
+	{
+		const uint8_t *window = data + offsets[i];
+		samples.insert(samples.end(), window, window + windowSizes[i]);
+	}
+
+	return probeWindows(samples.data(), windowSizes);
+}
+
+ProbeResult probeCompressibility(FILE *src)
+{
+	// Sampling a pipe would consume the input, so it isn't probed.
+	long start = ftell(src);
+	if((start < 0) || (fseek(src, 0, SEEK_END) != 0))
+		return ProbeResult();
+
+	long end = ftell(src);
+	if(end < start)
+		throw std::runtime_error(strerror(errno));
+
+	std::vector<std::size_t> windowSizes;
+	std::vector<uint64_t> offsets(
+	        getWindows(static_cast<uint64_t>(end - start), windowSizes));
+
+	std::vector<uint8_t> samples;
+	for(std::size_t i = 0; i < offsets.size(); ++i)
+	{
+		std::size_t offset = samples.size();
+		samples.resize(offset + windowSizes[i]);
+
+		if((fseek(src, start + static_cast<long>(offsets[i]),
+		          SEEK_SET) != 0) ||
+		   (fread(samples.data() + offset, sizeof(uint8_t),
+		          windowSizes[i], src) != windowSizes[i]))
+		{
+			throw std::runtime_error("Reading the input failed.");
+		}
+	}
+
+	if(fseek(src, start, SEEK_SET) != 0)
+		throw std::runtime_error(strerror(errno));
+
+	return probeWindows(samples.data(), windowSizes);
+}
+}
+}
@@ -0,0 +1,105 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_COMPRESSION_PROBE_H
+#define PAPER_COMPRESSION_PROBE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+namespace paper
+{
+namespace compression
+{
+/**
+ * \brief This structure describes the result of a compressibility probe.
+ */
+struct ProbeResult
+{
+	/**
+	 * The number of bytes which were sampled.
+	 */
+	uint64_t sampledSize;
+
+	/**
+	 * The Shannon entropy of the sampled bytes, in bits per byte (from 0
+	 * to 8).
+	 */
+	double entropy;
+
+	/**
+	 * The ratio of compressed to uncompressed size from a trial
+	 * compression of the sampled bytes, or 0 if the entropy was low enough
+	 * that no trial was needed.
+	 */
+	double trialRatio;
+
+	/**
+	 * Whether or not the input appears to be worth compressing.
+	 */
+	bool compressible;
+
+	/**
+	 * This constructor initializes an empty result.
+	 */
+	ProbeResult();
+};
+
+/**
+ * This function computes the Shannon entropy of the given data, in bits per
+ * byte (from 0 to 8).
+ *
+ * \param data The data to inspect.
+ * \param size The size of the data, in bytes.
+ * \return The data's entropy.
+ */
+double getEntropy(const uint8_t *data, std::size_t size);
+
+/**
+ * This function cheaply estimates whether or not the data in the given buffer
+ * is worth compressing. See probeCompressibility(FILE *) for details.
+ *
+ * \param data The data to probe.
+ * \param size The size of the data, in bytes.
+ * \return The result of the probe.
+ */
+ProbeResult probeCompressibility(const uint8_t *data, std::size_t size);
+
+/**
+ * This function cheaply estimates whether or not the remaining data in the
+ * given file is worth compressing, so already-compressed or encrypted input
+ * can skip the compressor entirely.
+ *
+ * Only a few evenly spaced windows of the input are read. First, a byte
+ * histogram of the windows is computed; if their entropy is clearly below 8
+ * bits per byte, the input is compressible. Otherwise, the windows are
+ * compressed with a fast LZMA preset, since high byte entropy alone doesn't
+ * rule out long repeated sequences. The file's position is restored before
+ * this function returns. If the file isn't seekable (e.g., it is a pipe),
+ * nothing is sampled, and the input is assumed to be compressible.
+ *
+ * \param src The file to probe.
+ * \return The result of the probe.
+ */
+ProbeResult probeCompressibility(FILE *src);
+}
+}
+
+#endif
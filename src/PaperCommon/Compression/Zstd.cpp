@@ -0,0 +1,193 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Zstd.h"
+
+#include <zstd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "PaperCommon/Util/Memory.h"
+
+namespace
+{
+/**
+ * This is the window size (as a power of two) used in long distance matching
+ * mode. This matches zstd's own "--long" default, which every zstd decoder
+ * accepts without any special configuration.
+ */
+constexpr int LONG_RANGE_WINDOW_LOG = 27;
+
+/**
+ * This function checks the given zstd return code, throwing an exception if
+ * it denotes an error.
+ *
+ * \param ret The zstd return code to check.
+ * \return The given return code, if it isn't an error.
+ */
+std::size_t checkZstd(std::size_t ret)
+{
+	if(ZSTD_isError(ret))
+	{
+		throw std::runtime_error(std::string("zstd error: ") +
+		                         ZSTD_getErrorName(ret));
+	}
+
+	return ret;
+}
+
+/**
+ * This function reads as much data as possible from the given file into the
+ * given buffer, throwing an exception if reading fails.
+ *
+ * \param buf The buffer to read data into.
+ * \param size The size of the given buffer.
+ * \param src The file to read data from.
+ * \return The number of bytes read, which is less than size only at EOF.
+ */
+std::size_t readInput(uint8_t *buf, std::size_t size, FILE *src)
+{
+	std::size_t read = fread(buf, sizeof(uint8_t), size, src);
+	if(ferror(src) != 0)
+		throw std::runtime_error(strerror(errno));
+	return read;
+}
+
+/**
+ * This function writes the contents of the given zstd output buffer to the
+ * given file, and then resets the buffer so it can be filled again.
+ *
+ * \param dst The file to write data to.
+ * \param output The zstd output buffer to write.
+ */
+void writeOutput(FILE *dst, ZSTD_outBuffer &output)
+{
+	if(fwrite(output.dst, sizeof(uint8_t), output.pos, dst) != output.pos)
+		throw std::runtime_error(strerror(errno));
+	output.pos = 0;
+}
+}
+
+namespace paper
+{
+namespace compression
+{
+ZstdOptions::ZstdOptions() : level(19), longRange(false)
+{
+}
+
+void zstdCompress(FILE *dst, FILE *src, const ZstdOptions &options)
+{
+	std::shared_ptr<ZSTD_CCtx> ctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+	if(!ctx)
+		throw std::runtime_error("Creating zstd context failed.");
+
+	checkZstd(ZSTD_CCtx_setParameter(ctx.get(), ZSTD_c_compressionLevel,
+	                                 options.level));
+	if(options.longRange)
+	{
+		checkZstd(ZSTD_CCtx_setParameter(
+		        ctx.get(), ZSTD_c_enableLongDistanceMatching, 1));
+		checkZstd(ZSTD_CCtx_setParameter(ctx.get(), ZSTD_c_windowLog,
+		                                 LONG_RANGE_WINDOW_LOG));
+	}
+
+	const std::size_t inSize = ZSTD_CStreamInSize();
+	const std::size_t outSize = ZSTD_CStreamOutSize();
+	auto inbuf(util::makeSharedArray<uint8_t>(inSize));
+	auto outbuf(util::makeSharedArray<uint8_t>(outSize));
+
+	ZSTD_outBuffer output = {outbuf.get(), outSize, 0};
+
+	bool finished = false;
+	while(!finished)
+	{
+		std::size_t read = readInput(inbuf.get(), inSize, src);
+		ZSTD_EndDirective mode =
+		        read < inSize ? ZSTD_e_end : ZSTD_e_continue;
+		ZSTD_inBuffer input = {inbuf.get(), read, 0};
+
+		/*
+		 * Keep compressing until all of this input has been consumed
+		 * or, if this was the last input, until the frame is complete.
+		 */
+
+		while(true)
+		{
+			std::size_t remaining = checkZstd(ZSTD_compressStream2(
+			        ctx.get(), &output, &input, mode));
+			writeOutput(dst, output);
+
+			if(mode == ZSTD_e_end ? (remaining == 0)
+			                      : (input.pos == input.size))
+			{
+				break;
+			}
+		}
+
+		finished = mode == ZSTD_e_end;
+	}
+}
+
+void zstdDecompress(FILE *dst, FILE *src)
+{
+	std::shared_ptr<ZSTD_DCtx> ctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+	if(!ctx)
+		throw std::runtime_error("Creating zstd context failed.");
+
+	const std::size_t inSize = ZSTD_DStreamInSize();
+	const std::size_t outSize = ZSTD_DStreamOutSize();
+	auto inbuf(util::makeSharedArray<uint8_t>(inSize));
+	auto outbuf(util::makeSharedArray<uint8_t>(outSize));
+
+	ZSTD_outBuffer output = {outbuf.get(), outSize, 0};
+	std::size_t last = 0;
+
+	while(std::size_t read = readInput(inbuf.get(), inSize, src))
+	{
+		ZSTD_inBuffer input = {inbuf.get(), read, 0};
+		while(input.pos < input.size)
+		{
+			last = checkZstd(
+			        ZSTD_decompressStream(ctx.get(), &output, &input));
+			writeOutput(dst, output);
+		}
+	}
+
+	// Flush any output zstd is still holding on to.
+
+	while(last != 0)
+	{
+		ZSTD_inBuffer input = {nullptr, 0, 0};
+		last = checkZstd(ZSTD_decompressStream(ctx.get(), &output, &input));
+		if(output.pos == 0)
+			break;
+		writeOutput(dst, output);
+	}
+
+	if(last != 0)
+		throw std::runtime_error("zstd input data is truncated.");
+}
+}
+}
@@ -0,0 +1,74 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_COMPRESSION_ZSTD_H
+#define PAPER_COMPRESSION_ZSTD_H
+
+#include <cstdio>
+
+namespace paper
+{
+namespace compression
+{
+/**
+ * \brief This structure holds the tunable parameters for zstd compression.
+ */
+struct ZstdOptions
+{
+	/**
+	 * The zstd compression level, from 1 to 22. The default is 19, which
+	 * is the highest level which doesn't need zstd's "ultra" window sizes.
+	 */
+	int level;
+
+	/**
+	 * Whether or not to enable zstd's long distance matching mode, which
+	 * uses a 128 MiB window to find repetitions far apart in large inputs.
+	 */
+	bool longRange;
+
+	/**
+	 * This constructor initializes all options to their default values.
+	 */
+	ZstdOptions();
+};
+
+/**
+ * This function compresses all of the data read from the given source file
+ * with zstd, writing the compressed result to the given destination file.
+ *
+ * \param dst The file to write the compressed data to.
+ * \param src The file to read the data to compress from.
+ * \param options The compression options to use.
+ */
+void zstdCompress(FILE *dst, FILE *src,
+                  const ZstdOptions &options = ZstdOptions());
+
+/**
+ * This function decompresses all of the zstd data read from the given source
+ * file, writing the decompressed result to the given destination file.
+ *
+ * \param dst The file to write the decompressed data to.
+ * \param src The file to read the data to decompress from.
+ */
+void zstdDecompress(FILE *dst, FILE *src);
+}
+}
+
+#endif
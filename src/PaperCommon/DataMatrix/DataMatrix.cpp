@@ -0,0 +1,708 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "DataMatrix.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "PaperCommon/DataMatrix/ReedSolomon.h"
+
+namespace
+{
+/**
+ * \brief This structure describes the layout of one ECC200 symbol size.
+ */
+struct SymbolSize
+{
+	std::size_t rows;
+	std::size_t columns;
+
+	// The size of each data region, not counting its finder and alignment
+	// patterns. Larger symbols are tiled with several regions.
+	std::size_t regionRows;
+	std::size_t regionColumns;
+
+	std::size_t dataCodewords;
+	std::size_t parityCodewords;
+
+	// The number of interleaved Reed-Solomon blocks.
+	std::size_t blocks;
+};
+
+/**
+ * \brief This table describes each symbol size, indexed by version - 1. The
+ * square and rectangular sizes are merged in order of increasing area.
+ */
+const SymbolSize SYMBOL_SIZES[paper::datamatrix::VERSION_COUNT] = {
+        {10, 10, 8, 8, 3, 5, 1},
+        {12, 12, 10, 10, 5, 7, 1},
+        {8, 18, 6, 16, 5, 7, 1},
+        {14, 14, 12, 12, 8, 10, 1},
+        {16, 16, 14, 14, 12, 12, 1},
+        {8, 32, 6, 14, 10, 11, 1},
+        {12, 26, 10, 24, 16, 14, 1},
+        {18, 18, 16, 16, 18, 14, 1},
+        {20, 20, 18, 18, 22, 18, 1},
+        {12, 36, 10, 16, 22, 18, 1},
+        {22, 22, 20, 20, 30, 20, 1},
+        {16, 36, 14, 16, 32, 24, 1},
+        {24, 24, 22, 22, 36, 24, 1},
+        {26, 26, 24, 24, 44, 28, 1},
+        {16, 48, 14, 22, 49, 28, 1},
+        {32, 32, 14, 14, 62, 36, 1},
+        {36, 36, 16, 16, 86, 42, 1},
+        {40, 40, 18, 18, 114, 48, 1},
+        {44, 44, 20, 20, 144, 56, 1},
+        {48, 48, 22, 22, 174, 68, 1},
+        {52, 52, 24, 24, 204, 84, 2},
+        {64, 64, 14, 14, 280, 112, 2},
+        {72, 72, 16, 16, 368, 144, 4},
+        {80, 80, 18, 18, 456, 192, 4},
+        {88, 88, 20, 20, 576, 224, 4},
+        {96, 96, 22, 22, 696, 272, 4},
+        {104, 104, 24, 24, 816, 336, 6},
+        {120, 120, 18, 18, 1050, 408, 6},
+        {132, 132, 20, 20, 1304, 496, 8},
+        {144, 144, 22, 22, 1558, 620, 10}};
+
+const uint8_t BASE256_LATCH = 231;
+const uint8_t PAD = 129;
+
+/**
+ * This function returns the layout of the given symbol version, or throws an
+ * exception if the version is invalid.
+ *
+ * \param version The symbol version.
+ * \return The symbol's layout.
+ */
+const SymbolSize &getSymbolSize(int version)
+{
+	if((version < 1) || (version > paper::datamatrix::VERSION_COUNT))
+		throw std::runtime_error("Invalid Data Matrix version.");
+	return SYMBOL_SIZES[version - 1];
+}
+
+/**
+ * This function applies (or, with a negative sign, removes) the "255-state"
+ * randomization Base 256 mode applies to each codeword.
+ *
+ * \param value The codeword to (de)randomize.
+ * \param position The codeword's one-based position in the symbol.
+ * \param sign 1 to randomize, or -1 to derandomize.
+ * \return The resulting codeword.
+ */
+uint8_t randomize255(unsigned int value, std::size_t position, int sign)
+{
+	int pseudoRandom = static_cast<int>((149 * position) % 255) + 1;
+	int result = static_cast<int>(value) + sign * pseudoRandom;
+	return static_cast<uint8_t>((result + 256) % 256);
+}
+
+/**
+ * This function applies the "253-state" randomization used for each pad
+ * codeword but the first.
+ *
+ * \param position The pad codeword's one-based position in the symbol.
+ * \return The randomized pad codeword.
+ */
+uint8_t randomizePad(std::size_t position)
+{
+	std::size_t result = PAD + ((149 * position) % 253) + 1;
+	return static_cast<uint8_t>(result <= 254 ? result : result - 254);
+}
+
+/**
+ * This function encodes the given data as Base 256 mode data codewords,
+ * padded out to the given count.
+ *
+ * \param data The data to encode.
+ * \param size The size of the data.
+ * \param count The number of data codewords the symbol holds.
+ * \return The data codewords.
+ */
+std::vector<uint8_t> getDataCodewords(const uint8_t *data, std::size_t size,
+                                      std::size_t count)
+{
+	std::vector<uint8_t> codewords;
+	codewords.reserve(count);
+
+	// A zero length would mean "to the end of the symbol", so empty data
+	// is just padding instead.
+	auto push = [&codewords](unsigned int value)
+	{
+		std::size_t position = codewords.size() + 1;
+		codewords.push_back(randomize255(value, position, 1));
+	};
+	if(size > 0)
+	{
+		codewords.push_back(BASE256_LATCH);
+		if(size < 250)
+		{
+			push(static_cast<unsigned int>(size));
+		}
+		else
+		{
+			push(static_cast<unsigned int>(size / 250 + 249));
+			push(static_cast<unsigned int>(size % 250));
+		}
+		for(std::size_t i = 0; i < size; ++i)
+			push(data[i]);
+	}
+
+	if(codewords.size() < count)
+		codewords.push_back(PAD);
+	while(codewords.size() < count)
+		codewords.push_back(randomizePad(codewords.size() + 1));
+
+	return codewords;
+}
+
+/**
+ * This function computes the parity codewords for each interleaved block of
+ * the given data codewords. If check is set, the parity already present after
+ * the data is compared instead, and an exception is thrown if it differs.
+ *
+ * \param codewords The data codewords, followed by room for the parity.
+ * \param size The symbol's layout.
+ * \param check Whether to check the parity rather than write it.
+ */
+void applyParity(std::vector<uint8_t> &codewords, const SymbolSize &size,
+                 bool check)
+{
+	std::size_t degree = size.parityCodewords / size.blocks;
+	std::vector<uint8_t> block;
+	std::vector<uint8_t> parity(degree);
+
+	// Codeword i belongs to block (i % blocks), for both data and parity.
+	for(std::size_t b = 0; b < size.blocks; ++b)
+	{
+		block.clear();
+		for(std::size_t i = b; i < size.dataCodewords; i += size.blocks)
+			block.push_back(codewords[i]);
+
+		paper::datamatrix::computeParity(block.data(), block.size(),
+		                                 parity.data(), degree);
+
+		for(std::size_t j = 0; j < degree; ++j)
+		{
+			uint8_t &out = codewords[size.dataCodewords +
+			                         j * size.blocks + b];
+			if(check && (out != parity[j]))
+			{
+				throw std::runtime_error("Data Matrix error "
+				                         "correction mismatch.");
+			}
+			out = parity[j];
+		}
+	}
+}
+
+/**
+ * \brief This class computes where each bit of each codeword is placed in a
+ * symbol's data regions, following the ECC200 placement algorithm.
+ *
+ * Positions are in the "mapping matrix": every data region of the symbol
+ * packed together without the patterns between them.
+ */
+class Placement
+{
+public:
+	/**
+	 * This value marks a module with no codeword bit, which is fixed dark.
+	 */
+	static constexpr int DARK = -2;
+
+	/**
+	 * This value marks a module with no codeword bit, which is fixed
+	 * light.
+	 */
+	static constexpr int LIGHT = -3;
+
+	/**
+	 * This constructor computes the placement for a mapping matrix of the
+	 * given size.
+	 *
+	 * \param r The number of rows in the mapping matrix.
+	 * \param c The number of columns in the mapping matrix.
+	 */
+	Placement(std::size_t r, std::size_t c);
+
+	/**
+	 * This function returns which codeword bit is placed in the given
+	 * module: codeword * 8 + bit, where bit 0 is the most significant
+	 * bit, or DARK or LIGHT for the fixed modules.
+	 *
+	 * \param row The row of the module.
+	 * \param column The column of the module.
+	 * \return The bit placed in the module.
+	 */
+	int get(std::size_t row, std::size_t column) const
+	{
+		return cells[row * static_cast<std::size_t>(columns) + column];
+	}
+
+private:
+	int rows;
+	int columns;
+	std::vector<int> cells;
+
+	// The sweeps never step more than this far above or left of the matrix.
+	static constexpr std::size_t MARGIN = 4;
+
+	void visit(std::size_t row, std::size_t column, int &codeword);
+	bool isFree(int row, int column) const;
+	void module(int row, int column, int codeword, int bit);
+	void utah(int row, int column, int codeword);
+	void corner1(int codeword);
+	void corner2(int codeword);
+	void corner3(int codeword);
+	void corner4(int codeword);
+};
+
+constexpr int Placement::DARK;
+constexpr int Placement::LIGHT;
+constexpr std::size_t Placement::MARGIN;
+
+Placement::Placement(std::size_t r, std::size_t c)
+        : rows(static_cast<int>(r)),
+          columns(static_cast<int>(c)),
+          cells(r * c, -1)
+{
+	// Codewords are placed in diagonal sweeps of "utah" shaped modules,
+	// alternating up-right and down-left, with four special shapes for
+	// codewords which wrap around the corners. The sweeps step a little
+	// past the matrix's edges, so positions are tracked offset by MARGIN,
+	// which keeps them unsigned.
+	const std::size_t bottom = MARGIN + r;
+	const std::size_t right = MARGIN + c;
+	int codeword = 0;
+	std::size_t row = MARGIN + 4;
+	std::size_t column = MARGIN;
+	do
+	{
+		if((row == bottom) && (column == MARGIN))
+			corner1(codeword++);
+		if((row == bottom - 2) && (column == MARGIN) && (c % 4 != 0))
+			corner2(codeword++);
+		if((row == bottom - 2) && (column == MARGIN) && (c % 8 == 4))
+			corner3(codeword++);
+		if((row == bottom + 4) && (column == MARGIN + 2) && (c % 8 == 0))
+			corner4(codeword++);
+
+		do
+		{
+			visit(row, column, codeword);
+			row -= 2;
+			column += 2;
+		} while((row >= MARGIN) && (column < right));
+		row += 1;
+		column += 3;
+
+		do
+		{
+			visit(row, column, codeword);
+			row += 2;
+			column -= 2;
+		} while((row < bottom) && (column >= MARGIN));
+		row += 3;
+		column += 1;
+	} while((row < bottom) || (column < right));
+
+	// Some sizes leave the bottom right 2x2 modules unused, in which case
+	// they are filled with a fixed checkerboard.
+	if(isFree(rows - 1, columns - 1))
+	{
+		std::size_t last = cells.size() - 1;
+		std::size_t stride = static_cast<std::size_t>(columns);
+		cells[last] = DARK;
+		cells[last - 1] = LIGHT;
+		cells[last - stride] = LIGHT;
+		cells[last - stride - 1] = DARK;
+	}
+}
+
+void Placement::visit(std::size_t row, std::size_t column, int &codeword)
+{
+	if((row < MARGIN) || (column < MARGIN))
+		return;
+
+	int r = static_cast<int>(row - MARGIN);
+	int c = static_cast<int>(column - MARGIN);
+	if((r < rows) && (c < columns) && isFree(r, c))
+		utah(r, c, codeword++);
+}
+
+bool Placement::isFree(int row, int column) const
+{
+	return cells[static_cast<std::size_t>(row * columns + column)] == -1;
+}
+
+void Placement::module(int row, int column, int codeword, int bit)
+{
+	if(row < 0)
+	{
+		row += rows;
+		column += 4 - ((rows + 4) % 8);
+	}
+	if(column < 0)
+	{
+		column += columns;
+		row += 4 - ((columns + 4) % 8);
+	}
+	cells[static_cast<std::size_t>(row * columns + column)] =
+	        codeword * 8 + bit;
+}
+
+void Placement::utah(int row, int column, int codeword)
+{
+	module(row - 2, column - 2, codeword, 0);
+	module(row - 2, column - 1, codeword, 1);
+	module(row - 1, column - 2, codeword, 2);
+	module(row - 1, column - 1, codeword, 3);
+	module(row - 1, column, codeword, 4);
+	module(row, column - 2, codeword, 5);
+	module(row, column - 1, codeword, 6);
+	module(row, column, codeword, 7);
+}
+
+void Placement::corner1(int codeword)
+{
+	module(rows - 1, 0, codeword, 0);
+	module(rows - 1, 1, codeword, 1);
+	module(rows - 1, 2, codeword, 2);
+	module(0, columns - 2, codeword, 3);
+	module(0, columns - 1, codeword, 4);
+	module(1, columns - 1, codeword, 5);
+	module(2, columns - 1, codeword, 6);
+	module(3, columns - 1, codeword, 7);
+}
+
+void Placement::corner2(int codeword)
+{
+	module(rows - 3, 0, codeword, 0);
+	module(rows - 2, 0, codeword, 1);
+	module(rows - 1, 0, codeword, 2);
+	module(0, columns - 4, codeword, 3);
+	module(0, columns - 3, codeword, 4);
+	module(0, columns - 2, codeword, 5);
+	module(0, columns - 1, codeword, 6);
+	module(1, columns - 1, codeword, 7);
+}
+
+void Placement::corner3(int codeword)
+{
+	module(rows - 3, 0, codeword, 0);
+	module(rows - 2, 0, codeword, 1);
+	module(rows - 1, 0, codeword, 2);
+	module(0, columns - 2, codeword, 3);
+	module(0, columns - 1, codeword, 4);
+	module(1, columns - 1, codeword, 5);
+	module(2, columns - 1, codeword, 6);
+	module(3, columns - 1, codeword, 7);
+}
+
+void Placement::corner4(int codeword)
+{
+	module(rows - 1, 0, codeword, 0);
+	module(rows - 1, columns - 1, codeword, 1);
+	module(0, columns - 3, codeword, 2);
+	module(0, columns - 2, codeword, 3);
+	module(0, columns - 1, codeword, 4);
+	module(1, columns - 3, codeword, 5);
+	module(1, columns - 2, codeword, 6);
+	module(1, columns - 1, codeword, 7);
+}
+
+/**
+ * This function returns the position in the symbol of a row or column of the
+ * mapping matrix, skipping over the patterns around each data region.
+ *
+ * \param i The row or column in the mapping matrix.
+ * \param regionSize The height or width of each data region.
+ * \return The row or column in the symbol.
+ */
+std::size_t getSymbolOffset(std::size_t i, std::size_t regionSize)
+{
+	return (i / regionSize) * (regionSize + 2) + 1 + (i % regionSize);
+}
+
+/**
+ * This function calls the given function once for each module of the given
+ * symbol's data regions, with its position in the symbol and the codeword bit
+ * placed there (see Placement::get).
+ *
+ * \param size The symbol's layout.
+ * \param fn The function to call for each module.
+ */
+template <typename F> void forEachDataModule(const SymbolSize &size, F fn)
+{
+	std::size_t rows = size.rows / (size.regionRows + 2) * size.regionRows;
+	std::size_t columns =
+	        size.columns / (size.regionColumns + 2) * size.regionColumns;
+	Placement placement(rows, columns);
+
+	for(std::size_t r = 0; r < rows; ++r)
+	{
+		std::size_t y = getSymbolOffset(r, size.regionRows);
+		for(std::size_t c = 0; c < columns; ++c)
+		{
+			fn(getSymbolOffset(c, size.regionColumns), y,
+			   placement.get(r, c));
+		}
+	}
+}
+
+/**
+ * This function returns whether the given modules have the right finder and
+ * alignment patterns for the given symbol layout: each data region has solid
+ * dark lines on its left and bottom, and alternating "clock tracks" on its
+ * top and right. If draw is set, the patterns are drawn instead.
+ *
+ * \param modules The symbol's modules.
+ * \param size The symbol's layout.
+ * \param draw Whether to draw the patterns rather than check them.
+ * \return Whether the patterns are (now) present.
+ */
+bool applyPatterns(paper::qr::ModuleMatrix &modules, const SymbolSize &size,
+                   bool draw)
+{
+	std::size_t h = size.regionRows + 2;
+	std::size_t w = size.regionColumns + 2;
+
+	bool valid = true;
+	auto apply = [&modules, draw, &valid](std::size_t x, std::size_t y,
+	                                      bool dark)
+	{
+		if(draw)
+			modules.set(x, y, dark);
+		else
+			valid = valid && (modules.get(x, y) == dark);
+	};
+
+	for(std::size_t y0 = 0; y0 < size.rows; y0 += h)
+	{
+		for(std::size_t x0 = 0; x0 < size.columns; x0 += w)
+		{
+			for(std::size_t y = 0; y < h; ++y)
+			{
+				apply(x0, y0 + y, true);
+				apply(x0 + w - 1, y0 + y, (y % 2) == 1);
+			}
+			for(std::size_t x = 1; x + 1 < w; ++x)
+			{
+				apply(x0 + x, y0, (x % 2) == 0);
+				apply(x0 + x, y0 + h - 1, true);
+			}
+		}
+	}
+
+	return valid;
+}
+
+/**
+ * This function encodes the given data into a Data Matrix symbol of the
+ * given version.
+ *
+ * \param data The data to encode.
+ * \param size The size of the data.
+ * \param version The symbol version, which must be able to hold the data.
+ * \return The symbol's modules.
+ */
+paper::qr::ModuleMatrix encodeSymbol(const uint8_t *data, std::size_t size,
+                                     int version)
+{
+	const SymbolSize &layout = getSymbolSize(version);
+
+	std::vector<uint8_t> codewords(
+	        getDataCodewords(data, size, layout.dataCodewords));
+	codewords.resize(layout.dataCodewords + layout.parityCodewords);
+	applyParity(codewords, layout, false);
+
+	paper::qr::ModuleMatrix modules(layout.columns, layout.rows);
+	applyPatterns(modules, layout, true);
+	forEachDataModule(
+	        layout, [&modules, &codewords](std::size_t x, std::size_t y,
+	                                       int bit)
+	        {
+		        bool dark = bit == Placement::DARK;
+		        if(bit >= 0)
+		        {
+			        std::size_t i = static_cast<std::size_t>(bit);
+			        dark = (codewords[i / 8] >> (7 - i % 8)) & 1;
+		        }
+		        modules.set(x, y, dark);
+		});
+
+	return modules;
+}
+}
+
+namespace paper
+{
+namespace datamatrix
+{
+DataMatrix::DataMatrix(const uint8_t *data, std::size_t offset,
+                       std::size_t size)
+        : version(getMinimumVersion(size)),
+          modules(encodeSymbol(data + offset, size, version))
+{
+}
+
+DataMatrix::DataMatrix(DataMatrix &&o)
+        : version(o.version), modules(std::move(o.modules))
+{
+	o.version = 0;
+	o.modules = qr::ModuleMatrix();
+}
+
+DataMatrix::~DataMatrix()
+{
+}
+
+DataMatrix &DataMatrix::operator=(DataMatrix &&o)
+{
+	if(this != &o)
+	{
+		version = o.version;
+		modules = std::move(o.modules);
+		o.version = 0;
+		o.modules = qr::ModuleMatrix();
+	}
+	return *this;
+}
+
+int DataMatrix::getVersion() const
+{
+	return version;
+}
+
+std::size_t DataMatrix::getWidth() const
+{
+	return modules.getWidth();
+}
+
+std::size_t DataMatrix::getHeight() const
+{
+	return modules.getHeight();
+}
+
+const qr::ModuleMatrix &DataMatrix::getModules() const
+{
+	return modules;
+}
+
+std::size_t getWidth(int version)
+{
+	return getSymbolSize(version).columns;
+}
+
+std::size_t getHeight(int version)
+{
+	return getSymbolSize(version).rows;
+}
+
+std::size_t getCapacity(int version)
+{
+	// Base 256 mode needs a latch codeword, and then a one byte length
+	// below 250 bytes or a two byte length from then on.
+	std::size_t codewords = getSymbolSize(version).dataCodewords;
+	std::size_t capacity = codewords - 2;
+	if(capacity >= 250)
+		capacity = std::max<std::size_t>(249, codewords - 3);
+	return capacity;
+}
+
+std::size_t getMaximumCapacity()
+{
+	return getCapacity(VERSION_COUNT);
+}
+
+int getMinimumVersion(std::size_t bytes)
+{
+	for(int i = 1; i <= VERSION_COUNT; ++i)
+	{
+		if(getCapacity(i) >= bytes)
+			return i;
+	}
+
+	throw std::runtime_error("Too much data for one Data Matrix symbol.");
+}
+
+std::vector<uint8_t> decode(const qr::ModuleMatrix &modules)
+{
+	int version = 0;
+	for(int i = 1; i <= VERSION_COUNT; ++i)
+	{
+		if((getWidth(i) == modules.getWidth()) &&
+		   (getHeight(i) == modules.getHeight()))
+		{
+			version = i;
+		}
+	}
+
+	qr::ModuleMatrix copy(modules);
+	const SymbolSize &layout = getSymbolSize(version);
+	if(!applyPatterns(copy, layout, false))
+		throw std::runtime_error("Invalid Data Matrix patterns.");
+
+	std::vector<uint8_t> codewords(layout.dataCodewords +
+	                               layout.parityCodewords);
+	forEachDataModule(
+	        layout, [&modules, &codewords](std::size_t x, std::size_t y,
+	                                       int bit)
+	        {
+		        if((bit >= 0) && modules.get(x, y))
+		        {
+			        std::size_t i = static_cast<std::size_t>(bit);
+			        codewords[i / 8] |= 0x80 >> (i % 8);
+		        }
+		});
+	applyParity(codewords, layout, true);
+
+	if(codewords[0] == PAD)
+		return std::vector<uint8_t>();
+	if(codewords[0] != BASE256_LATCH)
+		throw std::runtime_error("Unsupported Data Matrix encodation.");
+
+	std::size_t position = 1;
+	auto next = [&codewords, &position, &layout]() -> std::size_t
+	{
+		if(position >= layout.dataCodewords)
+			throw std::runtime_error("Truncated Data Matrix data.");
+		std::size_t value = randomize255(codewords[position],
+		                                 position + 1, -1);
+		++position;
+		return value;
+	};
+
+	std::size_t size = next();
+	if(size == 0)
+		size = layout.dataCodewords - position;
+	else if(size >= 250)
+		size = (size - 249) * 250 + next();
+
+	std::vector<uint8_t> data(size);
+	for(uint8_t &byte : data)
+		byte = static_cast<uint8_t>(next());
+	return data;
+}
+}
+}
@@ -0,0 +1,175 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_DATA_MATRIX_DATA_MATRIX_H
+#define PAPER_DATA_MATRIX_DATA_MATRIX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PaperCommon/QR/ModuleMatrix.h"
+
+namespace paper
+{
+namespace datamatrix
+{
+/**
+ * \brief The number of ECC200 symbol sizes. We number the sizes (or
+ * "versions") from 1, in order of increasing area, so a larger version never
+ * needs less paper than a smaller one.
+ */
+constexpr int VERSION_COUNT = 30;
+
+/**
+ * \brief This class denotes a single ECC200 Data Matrix symbol.
+ *
+ * Data is always stored in Base 256 mode, which costs a fixed two or three
+ * codewords per symbol, since our payloads are compressed binary data which
+ * none of the other encodation modes could shrink.
+ */
+class DataMatrix
+{
+public:
+	/**
+	 * This constructor creates a new Data Matrix symbol which contains the
+	 * given data. The symbol's size will be the smallest (by area) which
+	 * can store the given data.
+	 *
+	 * If too much data is given, then an exception will be thrown
+	 * indicating that object creation has failed.
+	 *
+	 * \param data The data to encode.
+	 * \param offset The offset in the given buffer to read data from.
+	 * \param size The size of the data to encode.
+	 */
+	DataMatrix(const uint8_t *data, std::size_t offset, std::size_t size);
+
+	/**
+	 * This constructor takes over the given symbol's modules, leaving it
+	 * empty.
+	 *
+	 * \param o The symbol to move from.
+	 */
+	DataMatrix(DataMatrix &&o);
+
+	/**
+	 * This is our object's default destructor, which frees all of this
+	 * object's internal resources.
+	 */
+	~DataMatrix();
+
+	/**
+	 * This operator takes over the given symbol's modules, leaving it
+	 * empty.
+	 *
+	 * \param o The symbol to move from.
+	 * \return A reference to this symbol.
+	 */
+	DataMatrix &operator=(DataMatrix &&o);
+
+	/**
+	 * \return This symbol's version (see VERSION_COUNT).
+	 */
+	int getVersion() const;
+
+	/**
+	 * \return The width of this symbol, in modules.
+	 */
+	std::size_t getWidth() const;
+
+	/**
+	 * \return The height of this symbol, in modules.
+	 */
+	std::size_t getHeight() const;
+
+	/**
+	 * This function returns this symbol's modules, including its finder
+	 * and alignment patterns, with dark modules set.
+	 *
+	 * \return This symbol's modules.
+	 */
+	const qr::ModuleMatrix &getModules() const;
+
+private:
+	int version;
+	qr::ModuleMatrix modules;
+
+	DataMatrix(const DataMatrix &);
+	DataMatrix &operator=(const DataMatrix &);
+};
+
+/**
+ * This function returns the width of Data Matrix symbols of the given version.
+ *
+ * \param version The symbol version.
+ * \return The symbol's width, in modules.
+ */
+std::size_t getWidth(int version);
+
+/**
+ * This function returns the height of Data Matrix symbols of the given
+ * version. This is less than the width for rectangular symbols.
+ *
+ * \param version The symbol version.
+ * \return The symbol's height, in modules.
+ */
+std::size_t getHeight(int version);
+
+/**
+ * This function returns the maximum number of bytes a Data Matrix symbol of
+ * the given version can store.
+ *
+ * \param version The symbol version.
+ * \return The number of bytes the symbol can store.
+ */
+std::size_t getCapacity(int version);
+
+/**
+ * This function returns the absolute maximum amount of data a single Data
+ * Matrix symbol can store.
+ *
+ * \return The maximum amount of data one symbol can store.
+ */
+std::size_t getMaximumCapacity();
+
+/**
+ * This function returns the smallest Data Matrix version which can store the
+ * given amount of bytes. If the given amount of bytes is larger than the
+ * maximum possible capacity, an exception will be thrown.
+ *
+ * \param bytes The amount of bytes you want to store.
+ * \return The minimum version for the given number of bytes.
+ */
+int getMinimumVersion(std::size_t bytes);
+
+/**
+ * This function reads the data back out of the given Data Matrix symbol's
+ * modules, as written by the DataMatrix class. The error correction codewords
+ * are only used to detect damage: if they don't match, or the modules aren't
+ * a valid symbol, an exception is thrown.
+ *
+ * \param modules The symbol's modules.
+ * \return The data stored in the symbol.
+ */
+std::vector<uint8_t> decode(const qr::ModuleMatrix &modules);
+}
+}
+
+#endif
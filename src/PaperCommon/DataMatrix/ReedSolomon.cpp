@@ -0,0 +1,127 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ReedSolomon.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+/**
+ * \brief This structure holds the GF(2^8) logarithm tables for the Data
+ * Matrix field, and the generator polynomial for each supported number of
+ * parity codewords.
+ */
+struct Tables
+{
+	// Powers of alpha, repeated so the sum of two logarithms can be used
+	// as an index without reducing it.
+	uint8_t exp[510];
+
+	// Discrete logarithms; log[0] is unused.
+	uint8_t log[256];
+
+	/**
+	 * For each degree, the generator polynomial's coefficients from the
+	 * highest power down to x^0, excluding the leading (monic) 1.
+	 */
+	uint8_t generators[paper::datamatrix::MAX_PARITY_SIZE + 1]
+	                  [paper::datamatrix::MAX_PARITY_SIZE];
+
+	Tables();
+
+	/**
+	 * \param a The first factor.
+	 * \param b The second factor.
+	 * \return The product of the two factors.
+	 */
+	uint8_t multiply(uint8_t a, uint8_t b) const
+	{
+		if((a == 0) || (b == 0))
+			return 0;
+		return exp[log[a] + log[b]];
+	}
+};
+
+Tables::Tables() : exp(), log(), generators()
+{
+	unsigned int x = 1;
+	for(std::size_t i = 0; i < 255; ++i)
+	{
+		exp[i] = static_cast<uint8_t>(x);
+		exp[i + 255] = static_cast<uint8_t>(x);
+		log[x] = static_cast<uint8_t>(i);
+
+		x <<= 1;
+		if(x & 0x100)
+			x ^= 0x12D;
+	}
+
+	for(std::size_t degree = 1;
+	    degree <= paper::datamatrix::MAX_PARITY_SIZE; ++degree)
+	{
+		// Multiply the factors (x - alpha^i), for i in [1, degree],
+		// together one at a time.
+		uint8_t *g = generators[degree];
+		g[degree - 1] = 1;
+
+		for(std::size_t i = 1; i <= degree; ++i)
+		{
+			uint8_t root = exp[i];
+			for(std::size_t j = 0; j < degree; ++j)
+			{
+				g[j] = multiply(g[j], root);
+				if(j + 1 < degree)
+					g[j] ^= g[j + 1];
+			}
+		}
+	}
+}
+}
+
+namespace paper
+{
+namespace datamatrix
+{
+void computeParity(const uint8_t *data, std::size_t size, uint8_t *parity,
+                   std::size_t degree)
+{
+	static const Tables tables;
+
+	if((degree == 0) || (degree > MAX_PARITY_SIZE))
+		throw std::runtime_error("Unsupported Reed-Solomon degree.");
+
+	// This is the same long division qr::computeParity does, just over a
+	// different field. Data Matrix blocks are small enough that a scalar
+	// loop is plenty.
+	const uint8_t *generator = tables.generators[degree];
+	uint8_t remainder[MAX_PARITY_SIZE + 1] = {0};
+	for(std::size_t i = 0; i < size; ++i)
+	{
+		uint8_t factor = data[i] ^ remainder[0];
+		memmove(remainder, remainder + 1, degree);
+		for(std::size_t j = 0; j < degree; ++j)
+			remainder[j] ^= tables.multiply(generator[j], factor);
+	}
+
+	memcpy(parity, remainder, degree);
+}
+}
+}
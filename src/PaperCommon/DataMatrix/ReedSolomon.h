@@ -0,0 +1,53 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_DATA_MATRIX_REED_SOLOMON_H
+#define PAPER_DATA_MATRIX_REED_SOLOMON_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace paper
+{
+namespace datamatrix
+{
+/**
+ * \brief This constant defines the largest number of error correction
+ * codewords any Data Matrix block uses.
+ */
+constexpr std::size_t MAX_PARITY_SIZE = 68;
+
+/**
+ * This function computes the Reed-Solomon error correction codewords for the
+ * given block of data codewords, as ECC200 Data Matrix symbols define them.
+ * Unlike QR codes, these use the field generated by the primitive polynomial
+ * x^8 + x^5 + x^3 + x^2 + 1 (0x12D), and a generator polynomial whose roots
+ * are alpha^1 .. alpha^degree.
+ *
+ * \param data The data codewords.
+ * \param size The number of data codewords.
+ * \param parity The buffer to write the degree parity codewords to.
+ * \param degree The number of parity codewords, at most MAX_PARITY_SIZE.
+ */
+void computeParity(const uint8_t *data, std::size_t size, uint8_t *parity,
+                   std::size_t degree);
+}
+}
+
+#endif
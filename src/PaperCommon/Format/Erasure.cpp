@@ -0,0 +1,480 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Erasure.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+#include "PaperCommon/Util/GF256.h"
+#include "PaperCommon/Util/IO.h"
+
+namespace
+{
+/**
+ * The first byte of every erasure coded chunk, so they can be told apart from
+ * plain ones. The first chunk of a plain payload starts with a codec
+ * identifier or a block group header instead, which is never this value.
+ */
+constexpr uint8_t ERASURE_MAGIC = 0xEC;
+
+/**
+ * \brief This structure describes how some data is laid out in chunks.
+ */
+struct Layout
+{
+	std::size_t size;
+	std::size_t chunkSize;
+	std::size_t dataChunks;
+	std::size_t parityChunks;
+
+	// The total number of data chunks, and the number of stripes.
+	std::size_t dataCount;
+	std::size_t stripeCount;
+};
+
+/**
+ * This function divides the given nonzero numerator by the given denominator,
+ * rounding up.
+ *
+ * \param n The numerator.
+ * \param d The denominator.
+ * \return The rounded up quotient.
+ */
+std::size_t divideRoundingUp(std::size_t n, std::size_t d)
+{
+	return 1 + ((n - 1) / d);
+}
+
+/**
+ * This function converts the given index into an iterator offset.
+ *
+ * \param index The index to convert.
+ * \return The equivalent iterator offset.
+ */
+std::ptrdiff_t getOffset(std::size_t index)
+{
+	return static_cast<std::ptrdiff_t>(index);
+}
+
+/**
+ * This function returns the layout of the given data, validating the given
+ * parameters.
+ *
+ * \param size The size of the data.
+ * \param chunkSize The number of data bytes in each chunk.
+ * \param dataChunks The number of data chunks in each stripe.
+ * \param parityChunks The number of parity chunks in each stripe.
+ * \return The resulting layout.
+ */
+Layout getLayout(std::size_t size, std::size_t chunkSize,
+                 std::size_t dataChunks, std::size_t parityChunks)
+{
+	if((chunkSize == 0) || (dataChunks == 0))
+	{
+		throw std::runtime_error(
+		        "Erasure code chunks must be nonempty.");
+	}
+
+	// Each chunk of a stripe needs its own element of GF(2^8).
+	if(dataChunks + parityChunks > 256)
+	{
+		throw std::runtime_error("Erasure code stripes can't have more "
+		                         "than 256 chunks.");
+	}
+
+	Layout layout;
+	layout.size = size;
+	layout.chunkSize = chunkSize;
+	layout.dataChunks = dataChunks;
+	layout.parityChunks = parityChunks;
+	layout.dataCount = size == 0 ? 1 : divideRoundingUp(size, chunkSize);
+	layout.stripeCount = divideRoundingUp(layout.dataCount, dataChunks);
+	return layout;
+}
+
+/**
+ * This function returns the number of data bytes in the given data chunk.
+ *
+ * \param layout The layout of the data.
+ * \param index The index of the data chunk.
+ * \return The size of the data chunk.
+ */
+std::size_t getDataSize(const Layout &layout, std::size_t index)
+{
+	std::size_t offset = index * layout.chunkSize;
+	return std::min(layout.size - offset, layout.chunkSize);
+}
+
+/**
+ * This function returns the header which starts every chunk. Besides the
+ * magic byte, it records the whole layout, including the number of data and
+ * parity chunks in each stripe, so the decoder needn't be told any of it.
+ *
+ * \param layout The layout of the data.
+ * \return The encoded header.
+ */
+std::vector<uint8_t> getHeader(const Layout &layout)
+{
+	std::vector<uint8_t> header(1, ERASURE_MAGIC);
+	for(std::size_t value : {layout.size, layout.chunkSize,
+	                         layout.dataChunks, layout.parityChunks})
+	{
+		uint8_t encoded[paper::util::io::MAX_VARINT_SIZE];
+		header.insert(header.end(), encoded,
+		              encoded + paper::util::io::encodeVarint(encoded,
+		                                                      value));
+	}
+
+	return header;
+}
+
+/**
+ * This function parses the header at the start of the given chunk.
+ *
+ * \param layout The layout to fill in.
+ * \param chunk The chunk to parse.
+ * \return The size of the header, in bytes.
+ */
+std::size_t readHeader(Layout &layout, const std::vector<uint8_t> &chunk)
+{
+	if(!paper::format::isErasure(chunk.data(), chunk.size()))
+		throw std::runtime_error("Data is not erasure coded.");
+
+	uint64_t values[4];
+	std::size_t position = 1;
+	for(uint64_t &value : values)
+	{
+		std::size_t consumed = paper::util::io::decodeVarint(
+		        value, chunk.data() + position,
+		        chunk.size() - position);
+		if((consumed == 0) || (value > SIZE_MAX))
+		{
+			throw std::runtime_error(
+			        "Erasure code header is invalid.");
+		}
+		position += consumed;
+	}
+
+	layout = getLayout(static_cast<std::size_t>(values[0]),
+	                   static_cast<std::size_t>(values[1]),
+	                   static_cast<std::size_t>(values[2]),
+	                   static_cast<std::size_t>(values[3]));
+	return position;
+}
+
+/**
+ * This function returns the coefficient which the given data chunk is
+ * multiplied by in the given parity chunk. These form a Cauchy matrix,
+ * 1 / (x_j + y_i) with x_j = dataChunks + j and y_i = i, so every square
+ * submatrix is invertible, which is what lets any dataChunks chunks of a
+ * stripe restore it.
+ *
+ * \param layout The layout of the data.
+ * \param parity The index of the parity chunk within its stripe.
+ * \param data The index of the data chunk within its stripe.
+ * \return The coefficient.
+ */
+uint8_t getCoefficient(const Layout &layout, std::size_t parity,
+                       std::size_t data)
+{
+	return paper::util::gf256::inverse(
+	        static_cast<uint8_t>((layout.dataChunks + parity) ^ data));
+}
+
+/**
+ * This function inverts the given square matrix over GF(2^8) in place, using
+ * Gauss-Jordan elimination. The matrix must be invertible.
+ *
+ * \param matrix The matrix to invert, in row-major order.
+ * \param n The number of rows (and columns) in the matrix.
+ */
+void invert(std::vector<uint8_t> &matrix, std::size_t n)
+{
+	using namespace paper::util::gf256;
+
+	std::vector<uint8_t> inverse(n * n, 0);
+	for(std::size_t i = 0; i < n; ++i)
+		inverse[i * n + i] = 1;
+
+	for(std::size_t column = 0; column < n; ++column)
+	{
+		std::size_t pivot = column;
+		while(matrix[pivot * n + column] == 0)
+			++pivot;
+
+		std::swap_ranges(matrix.begin() + getOffset(pivot * n),
+		                 matrix.begin() + getOffset(pivot * n + n),
+		                 matrix.begin() + getOffset(column * n));
+		std::swap_ranges(inverse.begin() + getOffset(pivot * n),
+		                 inverse.begin() + getOffset(pivot * n + n),
+		                 inverse.begin() + getOffset(column * n));
+
+		uint8_t scale = paper::util::gf256::inverse(
+		        matrix[column * n + column]);
+		for(std::size_t c = 0; c < n; ++c)
+		{
+			matrix[column * n + c] =
+			        multiply(matrix[column * n + c], scale);
+			inverse[column * n + c] =
+			        multiply(inverse[column * n + c], scale);
+		}
+
+		for(std::size_t r = 0; r < n; ++r)
+		{
+			uint8_t factor = matrix[r * n + column];
+			if((r == column) || (factor == 0))
+				continue;
+
+			mulAdd(&matrix[r * n], &matrix[column * n], factor,
+			       n);
+			mulAdd(&inverse[r * n], &inverse[column * n], factor,
+			       n);
+		}
+	}
+
+	matrix.swap(inverse);
+}
+}
+
+namespace paper
+{
+namespace format
+{
+ErasureParameters::ErasureParameters() : dataChunks(10), parityChunks(0)
+{
+}
+
+std::size_t getErasureHeaderSize(std::size_t size, std::size_t chunkSize,
+                                 const ErasureParameters &parameters)
+{
+	return getHeader(getLayout(size, chunkSize, parameters.dataChunks,
+	                           parameters.parityChunks))
+	        .size();
+}
+
+std::size_t getErasureChunkCount(std::size_t size, std::size_t chunkSize,
+                                 const ErasureParameters &parameters)
+{
+	Layout layout(getLayout(size, chunkSize, parameters.dataChunks,
+	                        parameters.parityChunks));
+	return layout.dataCount + layout.stripeCount * layout.parityChunks;
+}
+
+std::vector<std::vector<uint8_t>>
+encodeErasure(const uint8_t *data, std::size_t size, std::size_t chunkSize,
+              const ErasureParameters &parameters)
+{
+	Layout layout(getLayout(size, chunkSize, parameters.dataChunks,
+	                        parameters.parityChunks));
+	std::vector<uint8_t> header(getHeader(layout));
+
+	std::vector<std::vector<uint8_t>> chunks;
+	for(std::size_t stripe = 0; stripe < layout.stripeCount; ++stripe)
+	{
+		std::size_t first = stripe * layout.dataChunks;
+		std::size_t count =
+		        std::min(layout.dataChunks, layout.dataCount - first);
+
+		for(std::size_t i = first; i < first + count; ++i)
+		{
+			const uint8_t *chunkData = data + i * chunkSize;
+			std::vector<uint8_t> chunk(header);
+			chunk.insert(chunk.end(), chunkData,
+			             chunkData + getDataSize(layout, i));
+			chunks.push_back(chunk);
+		}
+
+		// A short final data chunk is treated as if it were padded
+		// with zeros, which contribute nothing to the parity.
+		for(std::size_t p = 0; p < layout.parityChunks; ++p)
+		{
+			std::vector<uint8_t> chunk(header);
+			chunk.resize(header.size() + chunkSize, 0);
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				util::gf256::mulAdd(
+				        chunk.data() + header.size(),
+				        data + (first + i) * chunkSize,
+				        getCoefficient(layout, p, i),
+				        getDataSize(layout, first + i));
+			}
+			chunks.push_back(chunk);
+		}
+	}
+
+	return chunks;
+}
+
+bool isErasure(const uint8_t *data, std::size_t size)
+{
+	return (size > 0) && (data[0] == ERASURE_MAGIC);
+}
+
+std::vector<uint8_t>
+decodeErasure(const std::vector<std::vector<uint8_t>> &chunks,
+              const std::vector<uint64_t> &missing)
+{
+	std::vector<char> present(chunks.size(), 1);
+	for(uint64_t index : missing)
+	{
+		if(index < present.size())
+			present[static_cast<std::size_t>(index)] = 0;
+	}
+
+	auto firstPresent = std::find(present.begin(), present.end(), 1);
+	if(firstPresent == present.end())
+	{
+		throw std::runtime_error(
+		        "No erasure coded chunks are present.");
+	}
+
+	Layout layout;
+	std::size_t headerSize = readHeader(
+	        layout, chunks[static_cast<std::size_t>(
+	                        firstPresent - present.begin())]);
+	if(chunks.size() !=
+	   layout.dataCount + layout.stripeCount * layout.parityChunks)
+	{
+		throw std::runtime_error(
+		        "Wrong number of erasure coded chunks.");
+	}
+
+	std::vector<uint8_t> data(layout.size);
+	std::size_t stride = layout.dataChunks + layout.parityChunks;
+	for(std::size_t stripe = 0; stripe < layout.stripeCount; ++stripe)
+	{
+		std::size_t first = stripe * layout.dataChunks;
+		std::size_t count =
+		        std::min(layout.dataChunks, layout.dataCount - first);
+		std::size_t base = stripe * stride;
+
+		// Check each chunk's size, and copy the data we already have.
+
+		auto getBody = [&](std::size_t index,
+		                   std::size_t size) -> const uint8_t *
+		{
+			const std::vector<uint8_t> &chunk = chunks[index];
+			if(chunk.size() != headerSize + size)
+			{
+				throw std::runtime_error("Erasure coded chunk "
+				                         "has the wrong size.");
+			}
+			return chunk.data() + headerSize;
+		};
+
+		std::vector<std::size_t> erased;
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			std::size_t size = getDataSize(layout, first + i);
+			if(present[base + i] == 0)
+			{
+				erased.push_back(i);
+				continue;
+			}
+
+			std::size_t offset = (first + i) * layout.chunkSize;
+			const uint8_t *body = getBody(base + i, size);
+			std::copy(body, body + size,
+			          data.begin() + getOffset(offset));
+		}
+
+		if(erased.empty())
+			continue;
+
+		std::vector<std::size_t> parities;
+		for(std::size_t p = 0; (p < layout.parityChunks) &&
+		                       (parities.size() < erased.size());
+		    ++p)
+		{
+			if(present[base + count + p] != 0)
+				parities.push_back(p);
+		}
+
+		if(parities.size() < erased.size())
+		{
+			throw std::runtime_error("Too many chunks are "
+			                         "missing to restore the "
+			                         "data.");
+		}
+
+		// Subtract the data we have from each parity chunk, leaving
+		// just the contributions of the erased chunks.
+
+		std::size_t n = erased.size();
+		std::vector<std::vector<uint8_t>> syndromes;
+		for(std::size_t p : parities)
+		{
+			const uint8_t *body =
+			        getBody(base + count + p, layout.chunkSize);
+			std::vector<uint8_t> syndrome(body,
+			                              body + layout.chunkSize);
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				if(present[base + i] == 0)
+					continue;
+				std::size_t index = first + i;
+				util::gf256::mulAdd(
+				        syndrome.data(),
+				        data.data() + index * layout.chunkSize,
+				        getCoefficient(layout, p, i),
+				        getDataSize(layout, index));
+			}
+			syndromes.push_back(syndrome);
+		}
+
+		// Solve for the erased chunks.
+
+		std::vector<uint8_t> matrix(n * n);
+		for(std::size_t r = 0; r < n; ++r)
+		{
+			for(std::size_t c = 0; c < n; ++c)
+			{
+				matrix[r * n + c] = getCoefficient(
+				        layout, parities[r], erased[c]);
+			}
+		}
+		invert(matrix, n);
+
+		std::vector<uint8_t> restored(layout.chunkSize);
+		for(std::size_t c = 0; c < n; ++c)
+		{
+			std::fill(restored.begin(), restored.end(), 0);
+			for(std::size_t r = 0; r < n; ++r)
+			{
+				util::gf256::mulAdd(restored.data(),
+				                    syndromes[r].data(),
+				                    matrix[c * n + r],
+				                    layout.chunkSize);
+			}
+
+			std::size_t index = first + erased[c];
+			std::size_t size = getDataSize(layout, index);
+			std::size_t offset = index * layout.chunkSize;
+			std::copy(restored.begin(),
+			          restored.begin() + getOffset(size),
+			          data.begin() + getOffset(offset));
+		}
+	}
+
+	return data;
+}
+}
+}
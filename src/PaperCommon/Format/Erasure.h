@@ -0,0 +1,125 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_FORMAT_ERASURE_H
+#define PAPER_FORMAT_ERASURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace paper
+{
+namespace format
+{
+/**
+ * \brief This structure holds the parameters of our cross-code erasure code.
+ *
+ * The data chunks are divided into stripes of (up to) dataChunks chunks, and
+ * each stripe is followed by parityChunks parity chunks, computed with a
+ * systematic Reed-Solomon (Cauchy) code over GF(2^8). Any dataChunks of a
+ * stripe's chunks are enough to restore the whole stripe, so up to
+ * parityChunks lost or unreadable QR codes per stripe can be tolerated.
+ */
+struct ErasureParameters
+{
+	/**
+	 * The number of data chunks in each stripe.
+	 */
+	std::size_t dataChunks;
+
+	/**
+	 * The number of parity chunks added to each stripe. If this is zero,
+	 * erasure coding is disabled.
+	 */
+	std::size_t parityChunks;
+
+	/**
+	 * This constructor initializes parameters with erasure coding
+	 * disabled, and a default stripe size.
+	 */
+	ErasureParameters();
+};
+
+/**
+ * This function returns the largest erasure header size of any chunk with the
+ * given parameters. Each chunk holds a header followed by (up to) chunkSize
+ * bytes.
+ *
+ * \param size The size of the data being encoded.
+ * \param chunkSize The number of data bytes in each chunk.
+ * \param parameters The erasure code parameters.
+ * \return The largest header size, in bytes.
+ */
+std::size_t getErasureHeaderSize(std::size_t size, std::size_t chunkSize,
+                                 const ErasureParameters &parameters);
+
+/**
+ * This function returns the total number of chunks encodeErasure() produces.
+ *
+ * \param size The size of the data being encoded.
+ * \param chunkSize The number of data bytes in each chunk.
+ * \param parameters The erasure code parameters.
+ * \return The number of data and parity chunks.
+ */
+std::size_t getErasureChunkCount(std::size_t size, std::size_t chunkSize,
+                                 const ErasureParameters &parameters);
+
+/**
+ * This function splits the given data into chunks of the given size, and adds
+ * parity chunks to each stripe. Every chunk starts with a small header which
+ * describes the layout, including the number of data and parity chunks in
+ * each stripe, so any intact chunk is enough to decode it (see isErasure).
+ *
+ * \param data The data to encode.
+ * \param size The size of the data, in bytes.
+ * \param chunkSize The number of data bytes in each chunk.
+ * \param parameters The erasure code parameters.
+ * \return The data and parity chunks, in stripe order.
+ */
+std::vector<std::vector<uint8_t>>
+encodeErasure(const uint8_t *data, std::size_t size, std::size_t chunkSize,
+              const ErasureParameters &parameters);
+
+/**
+ * This function returns whether or not the given data (e.g., the chunk of a
+ * single frame) is an erasure coded chunk, as produced by encodeErasure().
+ *
+ * \param data The data to inspect.
+ * \param size The size of the data, in bytes.
+ * \return Whether or not the data is an erasure coded chunk.
+ */
+bool isErasure(const uint8_t *data, std::size_t size);
+
+/**
+ * This function restores the original data from the given chunks, as
+ * produced by encodeErasure(), some of which may be missing. If any stripe
+ * has lost more chunks than it has parity chunks, an exception is thrown.
+ *
+ * \param chunks Every chunk, in order. Missing chunks' contents are ignored.
+ * \param missing The indices of the missing chunks, in order.
+ * \return The restored data.
+ */
+std::vector<uint8_t>
+decodeErasure(const std::vector<std::vector<uint8_t>> &chunks,
+              const std::vector<uint64_t> &missing);
+}
+}
+
+#endif
@@ -0,0 +1,358 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Framing.h"
+
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+#include "PaperCommon/Util/CRC32C.h"
+#include "PaperCommon/Util/IO.h"
+#include "PaperCommon/Util/Parallel.h"
+
+namespace
+{
+/**
+ * The first byte of every frame. Plain payloads start with a codec identifier
+ * and block groups with their own magic byte, neither of which is ever this
+ * value.
+ */
+constexpr uint8_t FRAME_MAGIC = 0xF5;
+
+/**
+ * The size of the fixed-width export identifier and checksum fields.
+ */
+constexpr std::size_t FIELD_SIZE = 4;
+
+/**
+ * The most codes an erasure coded stripe can hold (see format::encodeErasure).
+ */
+constexpr uint64_t MAX_STRIPE_SIZE = 256;
+
+/**
+ * This function appends the given 32-bit value to the given buffer, least
+ * significant byte first.
+ *
+ * \param dst The buffer to append to.
+ * \param value The value to append.
+ */
+void appendUint32(std::vector<uint8_t> &dst, uint32_t value)
+{
+	for(std::size_t i = 0; i < FIELD_SIZE; ++i)
+		dst.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+/**
+ * This function reads a 32-bit value, least significant byte first.
+ *
+ * \param src The buffer to read from, which must hold at least 4 bytes.
+ * \return The value which was read.
+ */
+uint32_t readUint32(const uint8_t *src)
+{
+	uint32_t value = 0;
+	for(std::size_t i = 0; i < FIELD_SIZE; ++i)
+		value |= static_cast<uint32_t>(src[i]) << (8 * i);
+	return value;
+}
+
+/**
+ * This function appends the given value to the given buffer as a varint.
+ *
+ * \param dst The buffer to append to.
+ * \param value The value to append.
+ */
+void appendVarint(std::vector<uint8_t> &dst, uint64_t value)
+{
+	uint8_t encoded[paper::util::io::MAX_VARINT_SIZE];
+	std::size_t size = paper::util::io::encodeVarint(encoded, value);
+	dst.insert(dst.end(), encoded, encoded + size);
+}
+
+/**
+ * This function decodes a varint from the given position in a frame,
+ * advancing the position past it.
+ *
+ * \param data The frame.
+ * \param size The size of the frame.
+ * \param position The position to decode from.
+ * \return The decoded value.
+ */
+uint64_t readVarint(const uint8_t *data, std::size_t size,
+                    std::size_t &position)
+{
+	uint64_t value;
+	std::size_t consumed = paper::util::io::decodeVarint(
+	        value, data + position, size - position);
+	if(consumed == 0)
+		throw std::runtime_error("Frame header is truncated.");
+
+	position += consumed;
+	return value;
+}
+}
+
+namespace paper
+{
+namespace format
+{
+FrameHeader::FrameHeader() : exportId(0), sequence(0), total(0), crc(0)
+{
+}
+
+Frame::Frame() : header(), chunk()
+{
+}
+
+Reassembler::Reassembler(uint64_t m)
+        : maximumTotal(m),
+          exportId(0),
+          total(0),
+          chunks(),
+          present(),
+          presentCount(0),
+          contiguousCount(0)
+{
+}
+
+FrameStatus Reassembler::add(const uint8_t *data, std::size_t size)
+{
+	Frame frame;
+	try
+	{
+		frame = readFrame(data, size);
+	}
+	catch(...)
+	{
+		return FrameStatus::Damaged;
+	}
+
+	return store(frame);
+}
+
+std::vector<FrameStatus>
+Reassembler::addAll(const std::vector<std::vector<uint8_t>> &frames,
+                    std::size_t workers)
+{
+	std::vector<Frame> decoded(frames.size());
+	std::vector<char> intact(frames.size(), 0);
+
+	util::parallelFor(frames.size(), workers, [&](std::size_t i)
+	                  {
+		try
+		{
+			decoded[i] =
+			        readFrame(frames[i].data(), frames[i].size());
+			intact[i] = 1;
+		}
+		catch(...)
+		{
+		}
+	});
+
+	std::vector<FrameStatus> statuses;
+	for(std::size_t i = 0; i < frames.size(); ++i)
+	{
+		statuses.push_back(intact[i] != 0 ? store(decoded[i])
+		                                  : FrameStatus::Damaged);
+	}
+
+	return statuses;
+}
+
+uint32_t Reassembler::getExportId() const
+{
+	return exportId;
+}
+
+uint64_t Reassembler::getTotal() const
+{
+	return total;
+}
+
+bool Reassembler::isComplete() const
+{
+	return (total > 0) && (presentCount == total);
+}
+
+uint64_t Reassembler::getContiguousCount() const
+{
+	return contiguousCount;
+}
+
+std::vector<uint64_t> Reassembler::getMissing() const
+{
+	if(total == 0)
+		throw std::runtime_error("No intact frames have been added.");
+
+	std::vector<uint64_t> missing;
+	for(std::size_t i = 0; i < present.size(); ++i)
+	{
+		if(present[i] == 0)
+			missing.push_back(i);
+	}
+
+	return missing;
+}
+
+const std::vector<std::vector<uint8_t>> &Reassembler::getChunks() const
+{
+	if(!isComplete())
+		throw std::runtime_error("Some frames are missing.");
+
+	return chunks;
+}
+
+const std::vector<std::vector<uint8_t>> &
+Reassembler::getReceivedChunks() const
+{
+	return chunks;
+}
+
+std::vector<uint8_t> Reassembler::assemble() const
+{
+	std::vector<uint8_t> data;
+	for(const std::vector<uint8_t> &chunk : getChunks())
+		data.insert(data.end(), chunk.begin(), chunk.end());
+	return data;
+}
+
+FrameStatus Reassembler::store(Frame &frame)
+{
+	const FrameHeader &header = frame.header;
+	if(header.total > maximumTotal)
+		return FrameStatus::Damaged;
+
+	if(total == 0)
+	{
+		exportId = header.exportId;
+		total = header.total;
+		chunks.resize(static_cast<std::size_t>(total));
+		present.resize(static_cast<std::size_t>(total), 0);
+	}
+	else if((header.exportId != exportId) || (header.total != total))
+	{
+		return FrameStatus::Foreign;
+	}
+
+	std::size_t sequence = static_cast<std::size_t>(header.sequence);
+	if(present[sequence] != 0)
+		return FrameStatus::Duplicate;
+
+	chunks[sequence] = std::move(frame.chunk);
+	present[sequence] = 1;
+	++presentCount;
+	while((contiguousCount < total) &&
+	      (present[static_cast<std::size_t>(contiguousCount)] != 0))
+	{
+		++contiguousCount;
+	}
+	return FrameStatus::Accepted;
+}
+
+std::size_t getFrameHeaderSize(uint64_t total)
+{
+	uint8_t encoded[util::io::MAX_VARINT_SIZE];
+	std::size_t sequenceSize =
+	        util::io::encodeVarint(encoded, total > 0 ? total - 1 : 0);
+	std::size_t totalSize = util::io::encodeVarint(encoded, total);
+	return 1 + FIELD_SIZE + sequenceSize + totalSize + FIELD_SIZE;
+}
+
+uint64_t getMaximumFrameTotal(uint64_t codeCount)
+{
+	return codeCount > UINT64_MAX / MAX_STRIPE_SIZE
+	               ? UINT64_MAX
+	               : codeCount * MAX_STRIPE_SIZE;
+}
+
+uint32_t generateExportId()
+{
+	std::random_device device;
+	uint32_t id = 0;
+	while(id == 0)
+		id = static_cast<uint32_t>(device());
+	return id;
+}
+
+std::vector<std::vector<uint8_t>>
+writeFrames(const std::vector<std::vector<uint8_t>> &chunks,
+            uint32_t exportId)
+{
+	std::vector<std::vector<uint8_t>> frames;
+	for(std::size_t i = 0; i < chunks.size(); ++i)
+	{
+		std::vector<uint8_t> frame;
+		frame.reserve(getFrameHeaderSize(chunks.size()) +
+		              chunks[i].size());
+
+		frame.push_back(FRAME_MAGIC);
+		appendUint32(frame, exportId);
+		appendVarint(frame, i);
+		appendVarint(frame, chunks.size());
+
+		uint32_t crc = util::crc32c(frame.data(), frame.size());
+		crc = util::crc32c(chunks[i].data(), chunks[i].size(), crc);
+		appendUint32(frame, crc);
+
+		frame.insert(frame.end(), chunks[i].begin(), chunks[i].end());
+		frames.push_back(std::move(frame));
+	}
+
+	return frames;
+}
+
+bool isFrame(const uint8_t *data, std::size_t size)
+{
+	return (size > 0) && (data[0] == FRAME_MAGIC);
+}
+
+Frame readFrame(const uint8_t *data, std::size_t size)
+{
+	if(!isFrame(data, size))
+		throw std::runtime_error("Data is not a frame.");
+	if(size < 1 + FIELD_SIZE)
+		throw std::runtime_error("Frame header is truncated.");
+
+	Frame frame;
+	FrameHeader &header = frame.header;
+	std::size_t position = 1;
+
+	header.exportId = readUint32(data + position);
+	position += FIELD_SIZE;
+	header.sequence = readVarint(data, size, position);
+	header.total = readVarint(data, size, position);
+
+	if(size - position < FIELD_SIZE)
+		throw std::runtime_error("Frame header is truncated.");
+	header.crc = readUint32(data + position);
+
+	uint32_t crc = util::crc32c(data, position);
+	position += FIELD_SIZE;
+	crc = util::crc32c(data + position, size - position, crc);
+
+	if((crc != header.crc) || (header.sequence >= header.total))
+		throw std::runtime_error("Frame is damaged.");
+
+	frame.chunk.assign(data + position, data + size);
+	return frame;
+}
+}
+}
@@ -0,0 +1,286 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_FORMAT_FRAMING_H
+#define PAPER_FORMAT_FRAMING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace paper
+{
+namespace format
+{
+/**
+ * \brief This structure holds the header which starts each framed chunk.
+ *
+ * A frame wraps the chunk of data stored in one QR code, so that the chunk
+ * identifies itself: which export it belongs to, where it goes, and whether
+ * it is intact. Framed codes can be scanned in any order, each one can be
+ * verified on its own, and any missing pages can be named exactly.
+ */
+struct FrameHeader
+{
+	/**
+	 * An identifier shared by every frame of the same export, so frames
+	 * from different exports can't be mixed up.
+	 */
+	uint32_t exportId;
+
+	/**
+	 * The index of this frame, from 0 to total - 1.
+	 */
+	uint64_t sequence;
+
+	/**
+	 * The total number of frames in the export.
+	 */
+	uint64_t total;
+
+	/**
+	 * The CRC32C of the header fields before it, followed by the chunk.
+	 */
+	uint32_t crc;
+
+	/**
+	 * This constructor initializes an empty header.
+	 */
+	FrameHeader();
+};
+
+/**
+ * \brief This structure holds a decoded frame.
+ */
+struct Frame
+{
+	FrameHeader header;
+	std::vector<uint8_t> chunk;
+
+	Frame();
+};
+
+/**
+ * \brief This enumeration describes what happened to a frame given to a
+ * Reassembler.
+ */
+enum class FrameStatus
+{
+	/**
+	 * The frame was intact, and was stored.
+	 */
+	Accepted,
+
+	/**
+	 * The frame was intact, but this part was already stored.
+	 */
+	Duplicate,
+
+	/**
+	 * The frame belongs to a different export than earlier frames.
+	 */
+	Foreign,
+
+	/**
+	 * The data was not an intact frame, or declared an implausibly large
+	 * export.
+	 */
+	Damaged
+};
+
+/**
+ * \brief This class collects the frames of one export, in any order, and
+ * puts their chunks back together.
+ */
+class Reassembler
+{
+public:
+	/**
+	 * \param m The largest number of frames the export may plausibly be
+	 * made of (see getMaximumFrameTotal). A frame's checksum doesn't
+	 * protect against a forged total, so frames which declare a larger
+	 * one are treated as damaged, rather than being allocated for.
+	 */
+	explicit Reassembler(uint64_t m);
+
+	/**
+	 * This function verifies the given frame, and stores its chunk if it
+	 * belongs to this export. The first intact frame decides which export
+	 * is being reassembled.
+	 *
+	 * \param data The frame, e.g. the contents of a single QR code.
+	 * \param size The size of the frame, in bytes.
+	 * \return What happened to the frame.
+	 */
+	FrameStatus add(const uint8_t *data, std::size_t size);
+
+	/**
+	 * This function adds each of the given frames, as add() would, but
+	 * verifies them in parallel first.
+	 *
+	 * \param frames The frames to add, in any order.
+	 * \param workers The maximum number of threads to use.
+	 * \return What happened to each frame.
+	 */
+	std::vector<FrameStatus>
+	addAll(const std::vector<std::vector<uint8_t>> &frames,
+	       std::size_t workers);
+
+	/**
+	 * \return The identifier of the export being reassembled, or 0 if no
+	 * intact frame has been added yet.
+	 */
+	uint32_t getExportId() const;
+
+	/**
+	 * \return The total number of frames in the export, or 0 if no intact
+	 * frame has been added yet.
+	 */
+	uint64_t getTotal() const;
+
+	/**
+	 * \return Whether every frame of the export has been added.
+	 */
+	bool isComplete() const;
+
+	/**
+	 * This function returns the number of frames at the start of the
+	 * export which have all been added, so their chunks can be used
+	 * before the rest of the export arrives.
+	 *
+	 * \return The number of leading frames which are present.
+	 */
+	uint64_t getContiguousCount() const;
+
+	/**
+	 * This function returns the sequence numbers of the frames which
+	 * haven't been added yet. If no intact frame has been added at all,
+	 * the export's size is unknown, so an exception is thrown instead.
+	 *
+	 * \return The sequence numbers of the missing frames, in order.
+	 */
+	std::vector<uint64_t> getMissing() const;
+
+	/**
+	 * This function returns every frame's chunk, in order. If any frame is
+	 * missing, an exception is thrown instead.
+	 *
+	 * \return The chunks of every frame.
+	 */
+	const std::vector<std::vector<uint8_t>> &getChunks() const;
+
+	/**
+	 * This function returns every frame's chunk, in order, whether or not
+	 * the export is complete. The chunks of missing frames are empty (see
+	 * getMissing).
+	 *
+	 * \return The chunks of every frame received so far.
+	 */
+	const std::vector<std::vector<uint8_t>> &getReceivedChunks() const;
+
+	/**
+	 * This function returns every frame's chunk concatenated in order,
+	 * which is the original data. If any frame is missing, an exception is
+	 * thrown instead.
+	 *
+	 * \return The reassembled data.
+	 */
+	std::vector<uint8_t> assemble() const;
+
+private:
+	uint64_t maximumTotal;
+	uint32_t exportId;
+	uint64_t total;
+	std::vector<std::vector<uint8_t>> chunks;
+	std::vector<char> present;
+	uint64_t presentCount;
+	uint64_t contiguousCount;
+
+	/**
+	 * This function stores the given intact frame's chunk, if it belongs
+	 * to this export.
+	 *
+	 * \param frame The frame to store.
+	 * \return What happened to the frame.
+	 */
+	FrameStatus store(Frame &frame);
+};
+
+/**
+ * This function returns the largest header size of any frame in an export
+ * with the given number of frames.
+ *
+ * \param total The total number of frames in the export.
+ * \return The largest header size, in bytes.
+ */
+std::size_t getFrameHeaderSize(uint64_t total);
+
+/**
+ * This function returns the largest number of frames an export which the
+ * given number of codes were read from can plausibly be made of. With
+ * erasure coding, a stripe of up to 256 codes can be restored from any one
+ * of them, so a larger export couldn't be restored anyway.
+ *
+ * \param codeCount The number of codes which were read.
+ * \return The largest plausible number of frames.
+ */
+uint64_t getMaximumFrameTotal(uint64_t codeCount);
+
+/**
+ * This function returns a new, random export identifier.
+ *
+ * \return The new export identifier, which is never 0.
+ */
+uint32_t generateExportId();
+
+/**
+ * This function wraps each of the given chunks in a frame, numbering them in
+ * order.
+ *
+ * \param chunks The chunks to frame, in order.
+ * \param exportId The identifier of the export.
+ * \return The framed chunks.
+ */
+std::vector<std::vector<uint8_t>>
+writeFrames(const std::vector<std::vector<uint8_t>> &chunks,
+            uint32_t exportId);
+
+/**
+ * This function returns whether or not the given data (e.g., the contents of
+ * a single QR code) starts with a frame header.
+ *
+ * \param data The data to inspect.
+ * \param size The size of the data, in bytes.
+ * \return Whether or not the data is a frame.
+ */
+bool isFrame(const uint8_t *data, std::size_t size);
+
+/**
+ * This function decodes a single frame, verifying its checksum. If the frame
+ * is malformed or damaged, an exception is thrown instead.
+ *
+ * \param data The frame to decode.
+ * \param size The size of the frame, in bytes.
+ * \return The decoded frame.
+ */
+Frame readFrame(const uint8_t *data, std::size_t size);
+}
+}
+
+#endif
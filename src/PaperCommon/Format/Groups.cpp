@@ -0,0 +1,569 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Groups.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <lzma.h>
+
+#include "PaperCommon/Util/IO.h"
+#include "PaperCommon/Util/Memstream.h"
+#include "PaperCommon/Util/Parallel.h"
+
+namespace
+{
+/**
+ * The first byte of every block group. Plain payloads start with a codec
+ * identifier instead, which is never this value.
+ */
+constexpr uint8_t GROUP_MAGIC = 0xB7;
+
+/**
+ * This function reads the next block of (at most) the given size from the
+ * given file.
+ *
+ * \param src The file to read from.
+ * \param size The maximum size of the block.
+ * \return The block which was read, which is empty at the end of the file.
+ */
+std::vector<uint8_t> readBlock(FILE *src, uint64_t size)
+{
+	std::vector<uint8_t> block(static_cast<std::size_t>(size));
+	std::size_t read = fread(block.data(), sizeof(uint8_t), block.size(), src);
+	if(ferror(src) != 0)
+		throw std::runtime_error(strerror(errno));
+
+	block.resize(read);
+	return block;
+}
+
+/**
+ * This function compresses the given block with the given codec, producing a
+ * tagged payload (see compression::compressPayload).
+ *
+ * \param block The block to compress.
+ * \param codec The codec to compress with.
+ * \return The resulting payload.
+ */
+std::vector<uint8_t> compressBlock(const std::vector<uint8_t> &block,
+                                   const paper::compression::Codec &codec)
+{
+	std::shared_ptr<FILE> src(
+	        paper::util::io::openMemory(block.data(), block.size()));
+	paper::util::Memstream payload;
+	paper::compression::compressPayload(payload.getFile(), src.get(), codec);
+
+	std::shared_ptr<uint8_t> data(payload.detach(), free);
+	return std::vector<uint8_t>(data.get(), data.get() + payload.getSize());
+}
+
+/**
+ * This function encodes the given group header followed by the given payload.
+ *
+ * \param header The header to write.
+ * \param payload The compressed payload.
+ * \return The encoded group.
+ */
+std::vector<uint8_t> writeGroup(const paper::format::GroupHeader &header,
+                                const std::vector<uint8_t> &payload)
+{
+	paper::util::Memstream group;
+	FILE *file = group.getFile();
+
+	if(fputc(GROUP_MAGIC, file) == EOF)
+		throw std::runtime_error(strerror(errno));
+
+	paper::util::io::writeVarint(file, header.index);
+	paper::util::io::writeVarint(file, header.count);
+	paper::util::io::writeVarint(file, header.offset);
+	paper::util::io::writeVarint(file, header.size);
+
+	for(std::size_t i = 0; i < 4; ++i)
+	{
+		if(fputc(static_cast<int>((header.crc >> (8 * i)) & 0xFF), file) ==
+		   EOF)
+		{
+			throw std::runtime_error(strerror(errno));
+		}
+	}
+
+	paper::util::io::writeVarint(file, header.payloadSize);
+	group.write(payload.data(), payload.size());
+
+	std::shared_ptr<uint8_t> data(group.detach(), free);
+	return std::vector<uint8_t>(data.get(), data.get() + group.getSize());
+}
+
+/**
+ * \brief This structure describes which QR codes make up a group.
+ */
+struct GroupSpan
+{
+	std::size_t first;
+	std::size_t last;
+};
+
+/**
+ * This function returns whether or not the given QR code contents start a
+ * different group of the same input as the given header.
+ *
+ * \param code The QR code contents to inspect.
+ * \param header The header of the group currently being assembled.
+ * \return Whether or not the code starts a new group.
+ */
+bool startsNextGroup(const std::vector<uint8_t> &code,
+                     const paper::format::GroupHeader &header)
+{
+	if(!paper::format::isGroup(code.data(), code.size()))
+		return false;
+
+	try
+	{
+		paper::format::GroupHeader next;
+		paper::format::readGroupHeader(next, code.data(), code.size());
+		return (next.count == header.count) && (next.index > header.index);
+	}
+	catch(...)
+	{
+		return false;
+	}
+}
+
+/**
+ * This function assigns the given QR codes to groups. Codes which don't
+ * belong to any complete group are skipped.
+ *
+ * \param codes The contents of each QR code, in order.
+ * \return The codes which make up each complete group.
+ */
+std::vector<GroupSpan>
+findGroups(const std::vector<std::vector<uint8_t>> &codes)
+{
+	std::vector<GroupSpan> spans;
+
+	std::size_t i = 0;
+	while(i < codes.size())
+	{
+		paper::format::GroupHeader header;
+		std::size_t needed;
+
+		try
+		{
+			if(!paper::format::isGroup(codes[i].data(),
+			                           codes[i].size()))
+			{
+				++i;
+				continue;
+			}
+
+			needed = paper::format::readGroupHeader(
+			                 header, codes[i].data(), codes[i].size()) +
+			         header.payloadSize;
+		}
+		catch(...)
+		{
+			++i;
+			continue;
+		}
+
+		// Collect codes until the group is complete, stopping early
+		// if we run into the start of another group.
+
+		std::size_t size = codes[i].size();
+		std::size_t j = i + 1;
+		while((size < needed) && (j < codes.size()) &&
+		      !startsNextGroup(codes[j], header))
+		{
+			size += codes[j++].size();
+		}
+
+		if(size == needed)
+			spans.push_back({i, j});
+
+		i = j;
+	}
+
+	return spans;
+}
+}
+
+namespace paper
+{
+namespace format
+{
+GroupHeader::GroupHeader()
+        : index(0), count(0), offset(0), size(0), crc(0), payloadSize(0)
+{
+}
+
+Group::Group() : header(), codec(), data()
+{
+}
+
+DecodedGroup::DecodedGroup() : header(), data()
+{
+}
+
+GroupGap::GroupGap() : first(0), last(0), begin(0), end(0)
+{
+}
+
+std::vector<Group>
+encodeGroups(FILE *src, uint64_t groupSize,
+             const std::vector<std::shared_ptr<compression::Codec>> &codecs,
+             std::size_t workers)
+{
+	if(groupSize == 0)
+		throw std::runtime_error("Block group size must be nonzero.");
+
+	if(codecs.empty())
+		throw std::runtime_error("No compression codecs were given.");
+
+	// Split the input into blocks. An empty input still gets one group.
+
+	std::vector<std::vector<uint8_t>> blocks;
+	while(true)
+	{
+		std::vector<uint8_t> block(readBlock(src, groupSize));
+		if(block.empty() && !blocks.empty())
+			break;
+
+		blocks.push_back(block);
+		if(block.size() < groupSize)
+			break;
+	}
+
+	// Compress each block independently.
+
+	std::vector<Group> groups(blocks.size());
+	util::parallelFor(blocks.size(), workers, [&](std::size_t i)
+	                  {
+		const std::vector<uint8_t> &block = blocks[i];
+
+		std::vector<uint8_t> best;
+		for(const std::shared_ptr<compression::Codec> &codec : codecs)
+		{
+			std::vector<uint8_t> payload(compressBlock(block, *codec));
+			if(best.empty() || (payload.size() < best.size()))
+			{
+				best.swap(payload);
+				groups[i].codec = codec->getName();
+			}
+		}
+
+		GroupHeader &header = groups[i].header;
+		header.index = i;
+		header.count = blocks.size();
+		header.offset = i * groupSize;
+		header.size = block.size();
+		header.crc = lzma_crc32(block.data(), block.size(), 0);
+		header.payloadSize = best.size();
+
+		groups[i].data = writeGroup(header, best);
+	});
+
+	return groups;
+}
+
+bool isGroup(const uint8_t *data, std::size_t size)
+{
+	return (size > 0) && (data[0] == GROUP_MAGIC);
+}
+
+std::size_t readGroupHeader(GroupHeader &header, const uint8_t *data,
+                            std::size_t size)
+{
+	if(!isGroup(data, size))
+		throw std::runtime_error("Data is not a block group.");
+
+	std::shared_ptr<FILE> src(util::io::openMemory(data, size));
+	fgetc(src.get());
+
+	header.index = util::io::readVarint(src.get());
+	header.count = util::io::readVarint(src.get());
+	header.offset = util::io::readVarint(src.get());
+	header.size = util::io::readVarint(src.get());
+
+	uint8_t crc[4];
+	if(fread(crc, sizeof(uint8_t), 4, src.get()) != 4)
+		throw std::runtime_error("Block group header is truncated.");
+
+	header.crc = 0;
+	for(std::size_t i = 0; i < 4; ++i)
+		header.crc |= static_cast<uint32_t>(crc[i]) << (8 * i);
+
+	header.payloadSize = util::io::readVarint(src.get());
+
+	if(header.index >= header.count)
+		throw std::runtime_error("Block group header is invalid.");
+
+	return static_cast<std::size_t>(ftell(src.get()));
+}
+
+DecodedGroup decodeGroup(const uint8_t *data, std::size_t size,
+                         const compression::CompressionOptions &options)
+{
+	DecodedGroup group;
+	std::size_t headerSize = readGroupHeader(group.header, data, size);
+
+	if(size - headerSize != group.header.payloadSize)
+		throw std::runtime_error("Block group has the wrong size.");
+
+	std::shared_ptr<uint8_t> decompressed;
+	std::size_t decompressedSize = compression::decompressPayload(
+	        decompressed, data + headerSize, size - headerSize, options);
+
+	if((decompressedSize != group.header.size) ||
+	   (lzma_crc32(decompressed.get(), decompressedSize, 0) !=
+	    group.header.crc))
+	{
+		throw std::runtime_error("Block group is damaged.");
+	}
+
+	group.data.assign(decompressed.get(),
+	                  decompressed.get() + decompressedSize);
+	return group;
+}
+
+std::vector<DecodedGroup>
+decodeGroups(const std::vector<std::vector<uint8_t>> &codes,
+             const compression::CompressionOptions &options,
+             std::size_t workers)
+{
+	std::vector<GroupSpan> spans(findGroups(codes));
+	std::vector<DecodedGroup> decoded(spans.size());
+	std::vector<char> intact(spans.size(), 0);
+
+	util::parallelFor(spans.size(), workers, [&](std::size_t i)
+	                  {
+		std::vector<uint8_t> data;
+		for(std::size_t c = spans[i].first; c < spans[i].last; ++c)
+			data.insert(data.end(), codes[c].begin(), codes[c].end());
+
+		// Damaged groups are simply left out of the result.
+		try
+		{
+			decoded[i] = decodeGroup(data.data(), data.size(), options);
+			intact[i] = 1;
+		}
+		catch(...)
+		{
+		}
+	});
+
+	std::vector<DecodedGroup> groups;
+	for(std::size_t i = 0; i < decoded.size(); ++i)
+	{
+		if(intact[i] != 0)
+			groups.push_back(std::move(decoded[i]));
+	}
+
+	std::stable_sort(groups.begin(), groups.end(),
+	                 [](const DecodedGroup &a, const DecodedGroup &b)
+	                 {
+		return a.header.index < b.header.index;
+	});
+
+	// Drop any duplicates (e.g., from a page which was scanned twice).
+	groups.erase(std::unique(groups.begin(), groups.end(),
+	                         [](const DecodedGroup &a, const DecodedGroup &b)
+	                         {
+		             return a.header.index == b.header.index;
+		         }),
+	             groups.end());
+
+	return groups;
+}
+
+std::vector<uint64_t> getMissingGroups(const std::vector<DecodedGroup> &groups)
+{
+	if(groups.empty())
+		throw std::runtime_error("No block groups could be decoded.");
+
+	std::vector<uint64_t> missing;
+	auto it = groups.begin();
+	for(uint64_t index = 0; index < groups.front().header.count; ++index)
+	{
+		if((it != groups.end()) && (it->header.index == index))
+			++it;
+		else
+			missing.push_back(index);
+	}
+
+	return missing;
+}
+
+std::vector<GroupGap> getGroupGaps(const std::vector<DecodedGroup> &groups)
+{
+	std::vector<uint64_t> missing(getMissingGroups(groups));
+
+	std::vector<GroupGap> gaps;
+	for(uint64_t index : missing)
+	{
+		if(!gaps.empty() && (gaps.back().last == index))
+		{
+			++gaps.back().last;
+			continue;
+		}
+
+		GroupGap gap;
+		gap.first = index;
+		gap.last = index + 1;
+		gaps.push_back(gap);
+	}
+
+	// Each gap runs from the end of the group before it to the start of
+	// the group after it.
+
+	auto it = groups.begin();
+	for(GroupGap &gap : gaps)
+	{
+		while((it != groups.end()) && (it->header.index < gap.first))
+			++it;
+
+		if(it != groups.begin())
+		{
+			const GroupHeader &before = (it - 1)->header;
+			gap.begin = before.offset + before.size;
+		}
+		gap.end = it == groups.end() ? UINT64_MAX : it->header.offset;
+	}
+
+	return gaps;
+}
+
+uint64_t restoreIntactGroups(FILE *dst,
+                             const std::vector<DecodedGroup> &groups)
+{
+	if(groups.empty())
+		throw std::runtime_error("No block groups could be decoded.");
+
+	// Every group but the last holds the same amount of the input, so no
+	// gap can be larger than that many groups. A header claiming
+	// otherwise mustn't make us write an arbitrary amount of zeros.
+
+	uint64_t groupSize = 1;
+	for(const DecodedGroup &group : groups)
+		groupSize = std::max(groupSize, group.header.size);
+
+	const std::vector<uint8_t> zeros(
+	        static_cast<std::size_t>(std::min<uint64_t>(groupSize, 65536)),
+	        0);
+
+	uint64_t position = 0;
+	uint64_t index = 0;
+	for(const DecodedGroup &group : groups)
+	{
+		const GroupHeader &header = group.header;
+		if((header.offset < position) || (header.index < index))
+		{
+			throw std::runtime_error(
+			        "Block group offsets are inconsistent.");
+		}
+
+		uint64_t gap = header.offset - position;
+		uint64_t missing = header.index - index;
+		if((gap > 0) &&
+		   ((missing == 0) || ((gap - 1) / groupSize >= missing)))
+		{
+			throw std::runtime_error(
+			        "Block group offsets are inconsistent.");
+		}
+
+		while(gap > 0)
+		{
+			std::size_t size = static_cast<std::size_t>(
+			        std::min<uint64_t>(gap, zeros.size()));
+			if(fwrite(zeros.data(), sizeof(uint8_t), size, dst) !=
+			   size)
+			{
+				throw std::runtime_error(strerror(errno));
+			}
+			gap -= size;
+		}
+
+		if(fwrite(group.data.data(), sizeof(uint8_t), group.data.size(),
+		          dst) != group.data.size())
+		{
+			throw std::runtime_error(strerror(errno));
+		}
+
+		position = header.offset + header.size;
+		index = header.index + 1;
+	}
+
+	return position;
+}
+
+uint64_t restoreGroups(FILE *dst, const std::vector<DecodedGroup> &groups,
+                       uint64_t begin, uint64_t end)
+{
+	if(groups.empty())
+		throw std::runtime_error("No block groups could be decoded.");
+
+	// The total size is only known if we have the final group.
+
+	const GroupHeader &last = groups.back().header;
+	if(last.index == last.count - 1)
+		end = std::min(end, last.offset + last.size);
+	else if(end == UINT64_MAX)
+		throw std::runtime_error("The final block group is missing.");
+
+	uint64_t position = begin;
+	for(const DecodedGroup &group : groups)
+	{
+		if(position >= end)
+			break;
+
+		uint64_t groupEnd = group.header.offset + group.header.size;
+		if(groupEnd <= position)
+			continue;
+
+		if(group.header.offset > position)
+			break;
+
+		uint64_t writeEnd = std::min(groupEnd, end);
+		std::size_t offset =
+		        static_cast<std::size_t>(position - group.header.offset);
+		std::size_t size = static_cast<std::size_t>(writeEnd - position);
+		if(fwrite(group.data.data() + offset, sizeof(uint8_t), size, dst) !=
+		   size)
+		{
+			throw std::runtime_error(strerror(errno));
+		}
+
+		position = writeEnd;
+	}
+
+	if(position < end)
+	{
+		throw std::runtime_error("The block group containing offset " +
+		                         std::to_string(position) +
+		                         " is missing.");
+	}
+
+	return end - std::min(begin, end);
+}
+}
+}
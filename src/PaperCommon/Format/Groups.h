@@ -0,0 +1,262 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_FORMAT_GROUPS_H
+#define PAPER_FORMAT_GROUPS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PaperCommon/Compression/Codec.h"
+
+namespace paper
+{
+namespace format
+{
+/**
+ * \brief This structure holds the header which starts each block group.
+ *
+ * A block group is an independently compressed block of the input, which
+ * occupies one or more whole QR codes of its own. Since no group depends on
+ * any other, groups can be decompressed in parallel, a damaged code only
+ * loses the group it belongs to, and any byte range of the input can be
+ * restored from just the groups which cover it.
+ */
+struct GroupHeader
+{
+	/**
+	 * The index of this group, from 0 to count - 1.
+	 */
+	uint64_t index;
+
+	/**
+	 * The total number of groups the input was split into.
+	 */
+	uint64_t count;
+
+	/**
+	 * The offset of this group's data within the input, in bytes.
+	 */
+	uint64_t offset;
+
+	/**
+	 * The uncompressed size of this group's data, in bytes.
+	 */
+	uint64_t size;
+
+	/**
+	 * The CRC32 of this group's uncompressed data.
+	 */
+	uint32_t crc;
+
+	/**
+	 * The size of the compressed payload which follows the header.
+	 */
+	uint64_t payloadSize;
+
+	/**
+	 * This constructor initializes an empty header.
+	 */
+	GroupHeader();
+};
+
+/**
+ * \brief This structure holds an encoded block group.
+ */
+struct Group
+{
+	GroupHeader header;
+
+	/**
+	 * The name of the codec which compressed this group.
+	 */
+	std::string codec;
+
+	/**
+	 * The encoded group (its header followed by its payload), which should
+	 * be stored in its own QR codes.
+	 */
+	std::vector<uint8_t> data;
+
+	Group();
+};
+
+/**
+ * \brief This structure holds a decoded block group.
+ */
+struct DecodedGroup
+{
+	GroupHeader header;
+	std::vector<uint8_t> data;
+
+	DecodedGroup();
+};
+
+/**
+ * \brief This structure describes a run of consecutive block groups which
+ * couldn't be decoded, and the range of the input they held.
+ */
+struct GroupGap
+{
+	/**
+	 * The index of the first missing group.
+	 */
+	uint64_t first;
+
+	/**
+	 * The index just past the last missing group.
+	 */
+	uint64_t last;
+
+	/**
+	 * The offset of the first byte the missing groups held.
+	 */
+	uint64_t begin;
+
+	/**
+	 * The offset just past the last byte the missing groups held. If the
+	 * final group is missing, the input's size is unknown, so this is
+	 * UINT64_MAX.
+	 */
+	uint64_t end;
+
+	GroupGap();
+};
+
+/**
+ * This function splits all of the data read from the given source file into
+ * blocks of the given uncompressed size, and compresses each block into its
+ * own group. Blocks are compressed in parallel, and each block is compressed
+ * with every given codec, keeping whichever produces the smallest payload.
+ *
+ * \param src The file to read the data to encode from.
+ * \param groupSize The uncompressed size of each group, in bytes.
+ * \param codecs The candidate codecs to compress each block with.
+ * \param workers The maximum number of threads to use.
+ * \return The encoded groups, in order.
+ */
+std::vector<Group>
+encodeGroups(FILE *src, uint64_t groupSize,
+             const std::vector<std::shared_ptr<compression::Codec>> &codecs,
+             std::size_t workers);
+
+/**
+ * This function returns whether or not the given data (e.g., the contents of
+ * a single QR code) starts with a block group header.
+ *
+ * \param data The data to inspect.
+ * \param size The size of the data, in bytes.
+ * \return Whether or not the data starts a block group.
+ */
+bool isGroup(const uint8_t *data, std::size_t size);
+
+/**
+ * This function parses the block group header at the start of the given
+ * data. If the header is malformed, an exception is thrown instead.
+ *
+ * \param header The header to fill in.
+ * \param data The data to parse.
+ * \param size The size of the data, in bytes.
+ * \return The size of the header, in bytes.
+ */
+std::size_t readGroupHeader(GroupHeader &header, const uint8_t *data,
+                            std::size_t size);
+
+/**
+ * This function decompresses a single encoded block group, verifying its
+ * size and checksum. If the group is damaged, an exception is thrown.
+ *
+ * \param data The encoded group.
+ * \param size The size of the encoded group, in bytes.
+ * \param options The options to configure the group's codec with.
+ * \return The decoded group.
+ */
+DecodedGroup decodeGroup(const uint8_t *data, std::size_t size,
+                         const compression::CompressionOptions &options);
+
+/**
+ * This function decodes every intact group from the given sequence of QR
+ * code contents, in parallel. Codes are assigned to groups using each group's
+ * header, and groups which are incomplete or damaged are skipped, so the
+ * result may be missing some groups (see getMissingGroups).
+ *
+ * \param codes The contents of each QR code, in order.
+ * \param options The options to configure each group's codec with.
+ * \param workers The maximum number of threads to use.
+ * \return The intact groups, ordered by index.
+ */
+std::vector<DecodedGroup>
+decodeGroups(const std::vector<std::vector<uint8_t>> &codes,
+             const compression::CompressionOptions &options,
+             std::size_t workers);
+
+/**
+ * This function returns the indices of the groups which are missing from the
+ * given decoded groups.
+ *
+ * \param groups The decoded groups, ordered by index.
+ * \return The indices of the missing groups.
+ */
+std::vector<uint64_t> getMissingGroups(const std::vector<DecodedGroup> &groups);
+
+/**
+ * This function returns each run of groups which is missing from the given
+ * decoded groups (see getMissingGroups), along with the range of the input
+ * the run held.
+ *
+ * \param groups The decoded groups, ordered by index.
+ * \return The runs of missing groups, in order.
+ */
+std::vector<GroupGap> getGroupGaps(const std::vector<DecodedGroup> &groups);
+
+/**
+ * This function writes as much of the original input as can be restored from
+ * the given decoded groups to the given destination file. Unlike
+ * restoreGroups, missing groups aren't an error: the range each one held is
+ * filled with zeros, so the intact groups still end up in the right place.
+ * If the final group is missing, the output ends with the last intact group.
+ *
+ * \param dst The file to write the restored data to.
+ * \param groups The decoded groups, ordered by index.
+ * \return The number of bytes written.
+ */
+uint64_t restoreIntactGroups(FILE *dst,
+                             const std::vector<DecodedGroup> &groups);
+
+/**
+ * This function writes the given range of the original input, restored from
+ * the given decoded groups, to the given destination file. If any group
+ * needed to restore the range is missing, an exception is thrown.
+ *
+ * \param dst The file to write the restored data to.
+ * \param groups The decoded groups, ordered by index.
+ * \param begin The offset of the first byte to restore.
+ * \param end The offset just past the last byte to restore.
+ * \return The number of bytes written.
+ */
+uint64_t restoreGroups(FILE *dst, const std::vector<DecodedGroup> &groups,
+                       uint64_t begin = 0, uint64_t end = UINT64_MAX);
+}
+}
+
+#endif
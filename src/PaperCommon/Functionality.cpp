@@ -18,63 +18,1418 @@
 
 #include "Functionality.h"
 
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include <QDir>
 #include <QFileInfo>
+#include <QImage>
 #include <QString>
 
-#include "PaperCommon/Compression/LZMA.h"
+#include "PaperCommon/Compression/Codec.h"
+#include "PaperCommon/DataMatrix/DataMatrix.h"
+#include "PaperCommon/Format/Erasure.h"
+#include "PaperCommon/Format/Framing.h"
+#include "PaperCommon/Format/Groups.h"
 #include "PaperCommon/QR/Coding.h"
+#include "PaperCommon/QR/Decoder.h"
+#include "PaperCommon/QR/ModuleMatrix.h"
+#include "PaperCommon/Render/Color.h"
+#include "PaperCommon/Render/Image.h"
+#include "PaperCommon/Render/PNM.h"
 #include "PaperCommon/Render/SVG.h"
+#include "PaperCommon/Render/SVGReader.h"
+#include "PaperCommon/Scan/Scanner.h"
+#include "PaperCommon/Util/CRC32C.h"
 #include "PaperCommon/Util/FS.h"
 #include "PaperCommon/Util/IO.h"
+#include "PaperCommon/Util/Memstream.h"
+#include "PaperCommon/Util/Parallel.h"
+
+namespace
+{
+/**
+ * The number of bytes of the source file checksummed at a time by verify().
+ */
+constexpr std::size_t CHECKSUM_CHUNK_SIZE = 1 << 16;
+
+/**
+ * \brief This structure holds a compressed payload, as produced by a codec.
+ */
+struct Payload
+{
+	std::shared_ptr<uint8_t> data;
+	std::size_t size;
+	std::string codec;
+
+	Payload() : data(), size(0), codec()
+	{
+	}
+};
+
+/**
+ * This function compresses the contents of the given file with the given
+ * codec, producing a tagged payload (see compression::compressPayload). The
+ * input is streamed through the codec, so only the payload is kept in memory.
+ *
+ * \param path The path to the file to compress.
+ * \param codec The codec to compress with.
+ * \return The resulting payload.
+ */
+Payload compressFile(const std::string &path,
+                     const paper::compression::Codec &codec)
+{
+	Payload payload;
+	std::shared_ptr<FILE> src(paper::util::io::openFile(path, "rb"));
+	paper::util::Memstream compressed;
+	paper::compression::compressPayload(compressed.getFile(), src.get(),
+	                                    codec);
+	payload.data.reset(compressed.detach(), free);
+	payload.size = compressed.getSize();
+	payload.codec = codec.getName();
+	return payload;
+}
+
+/**
+ * This function compresses the contents of the given file with every codec
+ * in parallel, and returns the payload which needs the fewest codes. Ties
+ * are broken by payload size, and then by codec order.
+ *
+ * \param path The path to the file to compress.
+ * \param options The options to configure each codec with.
+ * \param layout The constraints the payload's codes must satisfy.
+ * \return The best resulting payload.
+ */
+Payload compressFileAuto(const std::string &path,
+                         const paper::compression::CompressionOptions &options,
+                         const paper::qr::PlanConstraints &layout)
+{
+	std::vector<paper::compression::CodecId> ids(
+	        paper::compression::getCodecIds());
+	std::vector<Payload> payloads(ids.size());
+
+	// The candidates run at the same time, so LZMA only gets its share of
+	// the threads, rather than competing with the others for every core.
+	paper::compression::CompressionOptions candidateOptions(options);
+	candidateOptions.lzma.threads = std::max(
+	        options.lzma.threads / static_cast<uint32_t>(ids.size()), 1U);
+
+	paper::util::parallelFor(
+	        ids.size(), ids.size(), [&](std::size_t i)
+	        {
+		        payloads[i] = compressFile(
+		                path, *paper::compression::createCodec(
+		                              ids[i], candidateOptions));
+		});
+
+	auto better = [&layout](const Payload &a, const Payload &b) -> bool
+	{
+		std::size_t aCodes = paper::qr::getCodeCount(a.size, layout);
+		std::size_t bCodes = paper::qr::getCodeCount(b.size, layout);
+		return (aCodes < bCodes) || ((aCodes == bCodes) && (a.size < b.size));
+	};
+
+	return *std::min_element(payloads.begin(), payloads.end(), better);
+}
+
+/**
+ * This function returns a copy of the given layout with its symbology chosen,
+ * if it was to be chosen automatically: whichever symbology stores every
+ * buffer in the least total printed area. Choosing once for every buffer
+ * (rather than planning each buffer separately) keeps an export's codes
+ * uniform, so any frame fits in any of its codes.
+ *
+ * \param buffers The buffers which will be encoded.
+ * \param layout The layout to resolve.
+ * \return The layout, with a concrete symbology.
+ */
+paper::qr::PlanConstraints
+resolveSymbology(const std::vector<std::vector<uint8_t>> &buffers,
+                 paper::qr::PlanConstraints layout)
+{
+	if(layout.symbology != paper::symbol::Symbology::Auto)
+		return layout;
+
+	using paper::symbol::Symbology;
+
+	// If neither symbology fits, plan QR codes, so the error is reported
+	// as usual when the codes are encoded.
+	Symbology best = Symbology::QR;
+	std::size_t bestArea = 0;
+	for(Symbology symbology : {Symbology::QR, Symbology::DataMatrix})
+	{
+		layout.symbology = symbology;
+		std::size_t area = 0;
+		try
+		{
+			for(const std::vector<uint8_t> &buffer : buffers)
+			{
+				area += paper::qr::getPlan(buffer.size(), layout)
+				                .area;
+			}
+		}
+		catch(const std::runtime_error &)
+		{
+			continue;
+		}
+
+		if((bestArea == 0) || (area < bestArea))
+		{
+			best = symbology;
+			bestArea = area;
+		}
+	}
+
+	layout.symbology = best;
+	return layout;
+}
+
+/**
+ * This function encodes each of the given buffers into its own codes. If
+ * framing or erasure coding is enabled, each code's chunk is wrapped in a
+ * frame first, with frames numbered across every buffer.
+ *
+ * \param buffers The buffers to encode.
+ * \param options The encoding options to use.
+ * \param report If not null, this is filled in with details about the result.
+ * \return The codes containing every buffer, in order.
+ */
+std::vector<paper::symbol::Symbol>
+encodeBuffers(const std::vector<std::vector<uint8_t>> &buffers,
+              const paper::EncodeOptions &options, paper::EncodeReport *report)
+{
+	bool erasure = options.erasure.parityChunks > 0;
+	if(!options.frame && !erasure)
+	{
+		return paper::qr::encodeSymbols(
+		        buffers, options.qrThreads,
+		        resolveSymbology(buffers, options.layout));
+	}
+
+	// The frame header size depends on the number of frames, which in
+	// turn depends on the header size, so plan until the two agree. The
+	// erasure header can't be larger than it is for the largest chunks.
+
+	paper::qr::PlanConstraints layout(options.layout);
+	layout.overhead = paper::format::getFrameHeaderSize(1);
+	layout = resolveSymbology(buffers, layout);
+	std::vector<paper::qr::Plan> plans;
+	while(true)
+	{
+		plans.clear();
+		uint64_t total = 0;
+		std::size_t erasureHeaderSize = 0;
+		for(const std::vector<uint8_t> &buffer : buffers)
+		{
+			plans.push_back(
+			        paper::qr::getPlan(buffer.size(), layout));
+			if(!erasure)
+			{
+				total += plans.back().codeCount;
+				continue;
+			}
+
+			total += paper::format::getErasureChunkCount(
+			        buffer.size(), plans.back().chunkSize,
+			        options.erasure);
+			erasureHeaderSize = std::max(
+			        erasureHeaderSize,
+			        paper::format::getErasureHeaderSize(
+			                buffer.size(),
+			                paper::qr::getMaximumCapacity(),
+			                options.erasure));
+		}
+
+		std::size_t needed = paper::format::getFrameHeaderSize(total) +
+		                     erasureHeaderSize;
+		if(needed <= layout.overhead)
+			break;
+		layout.overhead = needed;
+	}
+
+	std::vector<std::vector<uint8_t>> chunks;
+	for(std::size_t i = 0; i < buffers.size(); ++i)
+	{
+		const std::vector<uint8_t> &buffer = buffers[i];
+		if(erasure)
+		{
+			std::vector<std::vector<uint8_t>> coded(
+			        paper::format::encodeErasure(
+			                buffer.data(), buffer.size(),
+			                plans[i].chunkSize, options.erasure));
+			for(std::vector<uint8_t> &chunk : coded)
+				chunks.push_back(std::move(chunk));
+			continue;
+		}
+
+		for(std::size_t code = 0; code < plans[i].codeCount; ++code)
+		{
+			std::size_t offset = code * plans[i].chunkSize;
+			std::size_t size = std::min(buffer.size() - offset,
+			                            plans[i].chunkSize);
+			chunks.push_back(std::vector<uint8_t>(
+			        buffer.data() + offset,
+			        buffer.data() + offset + size));
+		}
+	}
+
+	uint32_t exportId = paper::format::generateExportId();
+	if(report != nullptr)
+		report->exportId = exportId;
+
+	// Each frame fits in a single code, by construction. It must not be
+	// split over several smaller codes, even if they'd need less area,
+	// or its code couldn't be verified on its own.
+
+	paper::qr::PlanConstraints frameLayout;
+	frameLayout.symbology = layout.symbology;
+	frameLayout.maximumVersion = options.layout.maximumVersion;
+	frameLayout.errorCorrection = options.layout.errorCorrection;
+	frameLayout.maximumCodes = 1;
+	return paper::qr::encodeSymbols(
+	        paper::format::writeFrames(chunks, exportId), options.qrThreads,
+	        frameLayout);
+}
+
+/**
+ * This function splits the contents of the given file into independently
+ * compressed block groups, and encodes each group into its own codes.
+ *
+ * \param path The path to the file to compress.
+ * \param codec The name of the codec to compress with, or "auto".
+ * \param options The encoding options to use.
+ * \param report If not null, this is filled in with details about the result.
+ * \return The codes containing every group, in order.
+ */
+std::vector<paper::symbol::Symbol>
+encodeGroups(const std::string &path, const std::string &codec,
+             const paper::EncodeOptions &options, paper::EncodeReport *report)
+{
+	// Groups are compressed in parallel, so each codec gets one thread.
+	paper::compression::CompressionOptions compression(options.compression);
+	compression.lzma.threads = 1;
+
+	std::vector<std::shared_ptr<paper::compression::Codec>> codecs;
+	if(codec == "auto")
+	{
+		for(paper::compression::CodecId id :
+		    paper::compression::getCodecIds())
+		{
+			codecs.push_back(
+			        paper::compression::createCodec(id, compression));
+		}
+	}
+	else
+	{
+		codecs.push_back(
+		        paper::compression::createCodec(codec, compression));
+	}
+
+	std::shared_ptr<FILE> src(paper::util::io::openFile(path, "rb"));
+	std::vector<paper::format::Group> groups(paper::format::encodeGroups(
+	        src.get(), options.groupSize, codecs,
+	        paper::util::getOnlineCores()));
+
+	// Every group's codes are encoded together, so that many small groups
+	// parallelize as well as a few large ones.
+
+	std::vector<std::vector<uint8_t>> buffers;
+	std::vector<std::string> names;
+	uint64_t payloadSize = 0;
+	for(paper::format::Group &group : groups)
+	{
+		payloadSize += group.data.size();
+		buffers.push_back(std::move(group.data));
+
+		if(std::find(names.begin(), names.end(), group.codec) ==
+		   names.end())
+		{
+			names.push_back(group.codec);
+		}
+	}
+
+	std::vector<paper::symbol::Symbol> codes(
+	        encodeBuffers(buffers, options, report));
+
+	if(report != nullptr)
+	{
+		report->codec.clear();
+		for(const std::string &name : names)
+			report->codec += (report->codec.empty() ? "" : ", ") + name;
+
+		report->payloadSize = payloadSize;
+		report->groupCount = groups.size();
+	}
+
+	return codes;
+}
+
+/**
+ * This function loads the image at the given path. Netpbm images are read
+ * directly, and any other format is loaded with Qt and converted to RGB.
+ *
+ * \param path The path to the image to load.
+ * \return The loaded image.
+ */
+paper::render::Image loadImage(const std::string &path)
+{
+	std::shared_ptr<uint8_t> data;
+	std::size_t size = paper::util::io::loadFile(data, path);
+	if(paper::render::isPNM(data.get(), size))
+		return paper::render::readPNM(data.get(), size);
+
+	QImage loaded;
+	if((size > static_cast<std::size_t>(INT_MAX)) ||
+	   !loaded.loadFromData(data.get(), static_cast<int>(size)))
+	{
+		throw std::runtime_error("Unsupported image format.");
+	}
+	loaded = loaded.convertToFormat(QImage::Format_RGB888);
+
+	paper::render::Image image(static_cast<std::size_t>(loaded.width()),
+	                           static_cast<std::size_t>(loaded.height()),
+	                           3);
+	std::size_t stride = image.width * image.channels;
+	for(int y = 0; y < loaded.height(); ++y)
+	{
+		const uchar *line = loaded.constScanLine(y);
+		std::size_t offset = static_cast<std::size_t>(y) * stride;
+		std::copy(line, line + stride, image.pixels.data() + offset);
+	}
+	return image;
+}
+
+/**
+ * This function reads the codes from each of the given pages in parallel.
+ * A page which can't be read doesn't stop the others from being read, since
+ * framed codes may be able to do without it; it is listed in the report.
+ *
+ * \param paths The paths to the pages to read, in order.
+ * \param workers The maximum number of threads to use.
+ * \param report If not null, this is filled in with details about the result.
+ * \param read The function which reads the codes from a single page.
+ * \return The contents of each code, in page order.
+ */
+std::vector<std::vector<uint8_t>> readPages(
+        const std::vector<std::string> &paths, std::size_t workers,
+        paper::DecodeReport *report,
+        const std::function<std::vector<std::vector<uint8_t>>(
+                const std::string &)> &read)
+{
+	std::vector<std::vector<std::vector<uint8_t>>> pages(paths.size());
+	std::vector<std::string> errors(paths.size());
+	paper::util::parallelFor(
+	        paths.size(), workers, [&](std::size_t i)
+	        {
+		        try
+		        {
+			        pages[i] = read(paths[i]);
+		        }
+		        catch(const std::runtime_error &e)
+		        {
+			        errors[i] = e.what();
+		        }
+		});
+
+	std::vector<std::vector<uint8_t>> codes;
+	for(std::size_t i = 0; i < paths.size(); ++i)
+	{
+		for(std::vector<uint8_t> &code : pages[i])
+			codes.push_back(std::move(code));
+
+		if(!errors[i].empty() && (report != nullptr))
+		{
+			report->unreadable.push_back(paths[i] + ": " +
+			                             errors[i]);
+		}
+	}
+
+	if(report != nullptr)
+		report->codeCount = codes.size();
+	return codes;
+}
+
+/**
+ * This function scans the given image for codes.
+ *
+ * \param path The path to the image to scan.
+ * \param color Whether the image overlays three codes (see renderSVGs).
+ * \return The contents of each code on the page, in layer order.
+ */
+std::vector<std::vector<uint8_t>> scanPage(const std::string &path,
+                                           bool color)
+{
+	paper::render::Image image(loadImage(path));
+	if(color)
+		return paper::scan::scanColorImage(image);
+	return std::vector<std::vector<uint8_t>>(
+	        1, paper::scan::scanImage(image));
+}
+
+/**
+ * This function returns the smallest part of the given page which contains
+ * every dark module. Symbols smaller than their colour page are centered on
+ * it, and a QR code has dark modules in each of its corners.
+ *
+ * \param page The page's modules.
+ * \param symbol The symbol's modules are written here, if there are any.
+ * \return Whether the page has any dark modules.
+ */
+bool cropSymbol(const paper::qr::ModuleMatrix &page,
+                paper::qr::ModuleMatrix &symbol)
+{
+	std::size_t left = page.getWidth();
+	std::size_t right = 0;
+	std::size_t top = page.getHeight();
+	std::size_t bottom = 0;
+	for(std::size_t y = 0; y < page.getHeight(); ++y)
+	{
+		page.forEachDarkRun(y, [&](std::size_t x, std::size_t length)
+		                    {
+			                    left = std::min(left, x);
+			                    right = std::max(right, x + length);
+			                    top = std::min(top, y);
+			                    bottom = y + 1;
+			            });
+	}
+	if(right <= left)
+		return false;
+
+	symbol = paper::qr::ModuleMatrix(right - left, bottom - top);
+	for(std::size_t y = top; y < bottom; ++y)
+	{
+		for(std::size_t x = left; x < right; ++x)
+			symbol.set(x - left, y - top, page.get(x, y));
+	}
+	return true;
+}
+
+/**
+ * This function reads the codes from an SVG image written by renderSVGs. The
+ * modules are read straight from the SVG's rectangles, so nothing needs to be
+ * rasterized or located.
+ *
+ * \param path The path to the SVG image.
+ * \param color Whether the image overlays three codes (see renderSVGs).
+ * \return The contents of each code on the page, in layer order.
+ */
+std::vector<std::vector<uint8_t>> readSVGPage(const std::string &path,
+                                              bool color)
+{
+	std::shared_ptr<uint8_t> data;
+	std::size_t size = paper::util::io::loadFile(data, path);
+	paper::render::Image image(paper::render::readSVG(data.get(), size));
+
+	std::vector<paper::render::Image> layers;
+	if(color)
+	{
+		for(std::size_t l = 0; l < paper::render::LAYER_COUNT; ++l)
+		{
+			layers.push_back(paper::render::separateLayer(
+			        image, static_cast<paper::render::Layer>(l)));
+		}
+	}
+	else
+	{
+		layers.push_back(paper::render::getGrayscale(image));
+	}
+
+	std::vector<std::vector<uint8_t>> codes;
+	for(const paper::render::Image &layer : layers)
+	{
+		paper::qr::ModuleMatrix symbol;
+		if(cropSymbol(paper::render::sampleModules(layer, image.width,
+		                                           image.height),
+		              symbol))
+		{
+			codes.push_back(paper::qr::decodeSymbol(symbol));
+		}
+	}
+	return codes;
+}
+
+/**
+ * This function returns whether or not the given code holds an intact frame.
+ * The frame marker alone isn't enough to go by: past the first chunk, an
+ * unframed payload starts each code with arbitrary (compressed) data, so one
+ * code in 256 would look like a frame. The frame's checksum rules that out.
+ *
+ * \param code The contents of the code.
+ * \return Whether the code is framed.
+ */
+bool isIntactFrame(const std::vector<uint8_t> &code)
+{
+	try
+	{
+		paper::format::readFrame(code.data(), code.size());
+	}
+	catch(const std::runtime_error &)
+	{
+		return false;
+	}
+	return true;
+}
+
+/**
+ * This function checks that the given codes can be restored even though some
+ * pages were unreadable, which is only possible if they are framed.
+ *
+ * \param codes The contents of each code which was read.
+ * \param report The report listing the unreadable pages.
+ */
+void checkUnreadable(const std::vector<std::vector<uint8_t>> &codes,
+                     const paper::DecodeReport &report)
+{
+	// Unframed codes must all be present, in order.
+	bool framed = !codes.empty() && isIntactFrame(codes[0]);
+	if(!report.unreadable.empty() && !framed)
+	{
+		throw std::runtime_error("Couldn't read a code from " +
+		                         report.unreadable.front());
+	}
+}
+
+/**
+ * This function computes the CRC32C checksum of the rest of the given file,
+ * reading it a chunk at a time so it needn't fit in memory. Whether reading
+ * failed is left to the caller to check (see ferror).
+ *
+ * \param file The file to checksum.
+ * \param size The number of bytes which were read is written here.
+ * \return The checksum of the bytes which were read.
+ */
+uint32_t checksumStream(FILE *file, uint64_t &size)
+{
+	std::vector<uint8_t> chunk(CHECKSUM_CHUNK_SIZE);
+	uint32_t crc = 0;
+	size = 0;
+	std::size_t read;
+	do
+	{
+		read = std::fread(chunk.data(), 1, chunk.size(), file);
+		crc = paper::util::crc32c(chunk.data(), read, crc);
+		size += read;
+	} while(read == chunk.size());
+
+	return crc;
+}
+
+/**
+ * This function computes the CRC32C checksum of the given file.
+ *
+ * \param path The path to the file to checksum.
+ * \param size The size of the file, in bytes, is written here.
+ * \return The file's checksum.
+ */
+uint32_t checksumFile(const std::string &path, uint64_t &size)
+{
+	std::shared_ptr<FILE> file(paper::util::io::openFile(path, "rb"));
+	uint32_t crc = checksumStream(file.get(), size);
+	if(std::ferror(file.get()))
+		throw std::runtime_error("Reading from file failed: " + path);
+	return crc;
+}
+
+/**
+ * \brief This class provides a file which checksums the data written to it on
+ * its own thread, rather than keeping it, so restored data can be checked
+ * against its source without holding all of it in memory.
+ */
+class ChecksumStream
+{
+public:
+	/**
+	 * This constructor starts checksumming the data written to this
+	 * stream's file.
+	 */
+	ChecksumStream() : reader(), writer(), crc(0), size(0), thread()
+	{
+		paper::util::io::openPipe(reader, writer);
+		thread = std::thread(&ChecksumStream::checksum, this);
+	}
+
+	/**
+	 * This destructor ends the data, and waits for the checksum to be
+	 * finished.
+	 */
+	~ChecksumStream()
+	{
+		writer.reset();
+		if(thread.joinable())
+			thread.join();
+	}
+
+	/**
+	 * \return The file to write the data to be checksummed to.
+	 */
+	FILE *getFile()
+	{
+		return writer.get();
+	}
+
+	/**
+	 * This function ends the data, and waits for the rest of it to be
+	 * checksummed.
+	 *
+	 * \param s The number of bytes which were written is stored here.
+	 * \return The checksum of the data.
+	 */
+	uint32_t finish(uint64_t &s)
+	{
+		writer.reset();
+		thread.join();
+		if(std::ferror(reader.get()))
+			throw std::runtime_error("Reading from pipe failed.");
+
+		s = size;
+		return crc;
+	}
+
+private:
+	std::shared_ptr<FILE> reader;
+	std::shared_ptr<FILE> writer;
+	uint32_t crc;
+	uint64_t size;
+	std::thread thread;
+
+	ChecksumStream(const ChecksumStream &);
+	ChecksumStream &operator=(const ChecksumStream &);
+
+	/**
+	 * This function checksums the data until it ends.
+	 */
+	void checksum()
+	{
+		crc = checksumStream(reader.get(), size);
+	}
+};
+
+/**
+ * This function decodes the given symbol's module matrix with the decoder for
+ * its symbology.
+ *
+ * \param code The symbol to decode.
+ * \return The contents of the symbol.
+ */
+std::vector<uint8_t> decodeModules(const paper::symbol::Symbol &code)
+{
+	switch(code.getSymbology())
+	{
+	case paper::symbol::Symbology::QR:
+		return paper::qr::decodeSymbol(code.getModules());
+	case paper::symbol::Symbology::DataMatrix:
+		return paper::datamatrix::decode(code.getModules());
+	default:
+		throw std::runtime_error("Unsupported symbology.");
+	}
+}
+
+/**
+ * This function decodes the given symbols' module matrices in memory, in
+ * parallel, as a scanner would read them.
+ *
+ * \param codes The symbols to decode.
+ * \param workers The maximum number of threads to use.
+ * \param report This is filled in with details about the result.
+ * \return The contents of each symbol, in order.
+ */
+std::vector<std::vector<uint8_t>>
+decodeSymbols(const std::vector<paper::symbol::Symbol> &codes,
+              std::size_t workers, paper::DecodeReport &report)
+{
+	std::vector<std::vector<uint8_t>> contents(codes.size());
+	paper::util::parallelFor(
+	        codes.size(), workers, [&](std::size_t i)
+	        {
+		        contents[i] = decodeModules(codes[i]);
+		});
+
+	report.codeCount = contents.size();
+	return contents;
+}
+
+/**
+ * This function checks that the codes returned by the given function restore
+ * the given file exactly (see verify). The codes are read and decompressed
+ * while the file is checksummed, and the restored data is checksummed as it
+ * is decompressed, rather than kept.
+ *
+ * \param path The path to the source file.
+ * \param read The function which reads the codes, filling in the report.
+ * \param options The options which control how the codes are decoded.
+ * \param report If not null, this is filled in with details about the result.
+ * \return Whether the restored data matches the source file.
+ */
+bool verifyCodes(const std::string &path,
+                 const std::function<std::vector<std::vector<uint8_t>>(
+                         paper::DecodeReport &)> &read,
+                 const paper::DecodeOptions &options,
+                 paper::VerifyReport *report)
+{
+	paper::VerifyReport result;
+	ChecksumStream restored;
+
+	// Checksum the source file while the codes are decoded, since the two
+	// don't depend on each other.
+	paper::util::parallelFor(
+	        2, 2, [&](std::size_t task)
+	        {
+		        if(task == 0)
+		        {
+			        result.inputChecksum =
+			                checksumFile(path, result.inputSize);
+			        return;
+		        }
+
+		        std::vector<std::vector<uint8_t>> codes(
+		                read(result.decode));
+		        checkUnreadable(codes, result.decode);
+		        paper::restore(restored.getFile(), codes, options,
+		                       &result.decode);
+		});
+
+	result.outputChecksum = restored.finish(result.decode.outputSize);
+
+	if(report != nullptr)
+		*report = result;
+	return (result.decode.outputSize == result.inputSize) &&
+	       (result.outputChecksum == result.inputChecksum);
+}
+
+/**
+ * This function decompresses the given payload (see
+ * compression::compressPayload), writing the result to the given file.
+ *
+ * \param dst The file to write the decompressed data to.
+ * \param payload The payload to decompress.
+ * \param options The options to configure the payload's codec with.
+ */
+void decompressBuffer(FILE *dst, const std::vector<uint8_t> &payload,
+                      const paper::compression::CompressionOptions &options)
+{
+	std::shared_ptr<FILE> src(
+	        paper::util::io::openMemory(payload.data(), payload.size()));
+	paper::compression::decompressPayload(dst, src.get(), options);
+}
+
+/**
+ * This function restores the file from whichever of the given chunks' block
+ * groups are intact. Each group is compressed on its own, so a damaged or
+ * missing group only loses its own part of the file: the intact groups are
+ * written in place, with zeros in place of the missing ones, which are
+ * listed in the report.
+ *
+ * \param dst The file to write the restored data to.
+ * \param chunks The chunks of the payload, in order. Missing ones are empty.
+ * \param options The options which control how the data is decoded.
+ * \param report The report to fill in with details about the result.
+ * \return Whether any group was intact. If not, nothing is written.
+ */
+bool restoreBlockGroups(FILE *dst,
+                        const std::vector<std::vector<uint8_t>> &chunks,
+                        const paper::DecodeOptions &options,
+                        paper::DecodeReport &report)
+{
+	std::vector<paper::format::DecodedGroup> groups(
+	        paper::format::decodeGroups(chunks, options.compression,
+	                                    options.threads));
+	if(groups.empty())
+		return false;
+
+	paper::format::restoreIntactGroups(dst, groups);
+	report.groupCount = groups.size();
+	report.missingGroups = paper::format::getGroupGaps(groups);
+	return true;
+}
+
+/**
+ * This function returns whether the frames given to the given reassembler
+ * hold erasure coded chunks. Every erasure coded chunk starts with a header
+ * which identifies it, but only the first chunk of a plain payload has a
+ * known first byte. So the first chunk which was received decides; if that
+ * isn't the first chunk, a plain payload couldn't be restored anyway.
+ *
+ * \param reassembler The reassembler holding the frames.
+ * \return Whether the chunks are erasure coded.
+ */
+bool isErasureCoded(const paper::format::Reassembler &reassembler)
+{
+	for(const std::vector<uint8_t> &chunk :
+	    reassembler.getReceivedChunks())
+	{
+		if(!chunk.empty())
+			return paper::format::isErasure(chunk.data(),
+			                                chunk.size());
+	}
+	return false;
+}
+
+/**
+ * The extensions (in lower case) of the image files findImages() returns.
+ */
+const char *const IMAGE_EXTENSIONS[] = {".bmp", ".gif", ".jpeg", ".jpg",
+                                        ".pbm", ".pgm", ".png", ".pnm",
+                                        ".ppm", ".tif", ".tiff"};
+
+/**
+ * The number of bytes a PayloadStream drains from its pipe at a time, once
+ * its codec has stopped reading.
+ */
+constexpr std::size_t DRAIN_BUFFER_SIZE = 8192;
+
+/**
+ * \brief This class decompresses a payload on its own thread while the
+ * payload is still being written to it, so the output is produced as soon as
+ * each part of the payload is available.
+ */
+class PayloadStream
+{
+public:
+	/**
+	 * This constructor starts decompressing the payload written to this
+	 * stream, writing the result to the given file.
+	 *
+	 * \param dst The file to write the decompressed data to.
+	 * \param options The options to configure the payload's codec with.
+	 */
+	PayloadStream(FILE *dst,
+	              const paper::compression::CompressionOptions &options)
+	        : reader(), writer(), error(), thread()
+	{
+		paper::util::io::openPipe(reader, writer);
+		thread = std::thread(&PayloadStream::decompress, this, dst,
+		                     options);
+	}
+
+	/**
+	 * This destructor ends the payload, and waits for the decompressor to
+	 * stop. Any error it ran into is discarded; see finish().
+	 */
+	~PayloadStream()
+	{
+		writer.reset();
+		if(thread.joinable())
+			thread.join();
+	}
+
+	/**
+	 * This function appends the given data to the payload.
+	 *
+	 * \param data The data to append.
+	 */
+	void write(const std::vector<uint8_t> &data)
+	{
+		if(std::fwrite(data.data(), sizeof(uint8_t), data.size(),
+		               writer.get()) != data.size())
+		{
+			throw std::runtime_error(
+			        "Writing to the decompressor failed.");
+		}
+	}
+
+	/**
+	 * This function ends the payload, and waits for the rest of it to be
+	 * decompressed. If decompression failed, the error is rethrown.
+	 */
+	void finish()
+	{
+		writer.reset();
+		thread.join();
+		if(error)
+			std::rethrow_exception(error);
+	}
+
+private:
+	std::shared_ptr<FILE> reader;
+	std::shared_ptr<FILE> writer;
+	std::exception_ptr error;
+	std::thread thread;
+
+	PayloadStream(const PayloadStream &);
+	PayloadStream &operator=(const PayloadStream &);
+
+	/**
+	 * This function decompresses the payload, and then drains the pipe,
+	 * so the writer never blocks on a codec which has stopped reading
+	 * (e.g. because the payload is corrupt).
+	 *
+	 * \param dst The file to write the decompressed data to.
+	 * \param options The options to configure the payload's codec with.
+	 */
+	void decompress(FILE *dst,
+	                paper::compression::CompressionOptions options)
+	{
+		try
+		{
+			paper::compression::decompressPayload(dst, reader.get(),
+			                                      options);
+		}
+		catch(...)
+		{
+			error = std::current_exception();
+		}
+
+		uint8_t buffer[DRAIN_BUFFER_SIZE];
+		while(std::fread(buffer, sizeof(uint8_t), DRAIN_BUFFER_SIZE,
+		                 reader.get()) > 0)
+		{
+		}
+	}
+};
+
+/**
+ * \brief This class puts the codes read from a set of pages back in order as
+ * each page is read, and restores the file from them.
+ *
+ * Framed codes are reordered by their sequence numbers, so pages may be read
+ * in any order, and duplicates are dropped; otherwise, the codes must be in
+ * page order. Each contiguous run of chunks at the start of the payload is
+ * handed to a PayloadStream as soon as it's complete. Block groups can only be
+ * decoded once every chunk has arrived, so they're collected instead, and
+ * erasure coded chunks are restored from the frames once every page is read.
+ */
+class PageImporter
+{
+public:
+	/**
+	 * \param f The file to write the restored data to.
+	 * \param p The paths to the pages, in order.
+	 * \param o The options which control how the data is decoded.
+	 * \param r The report to fill in with details about the result.
+	 */
+	PageImporter(FILE *f, const std::vector<std::string> &p,
+	             const paper::DecodeOptions &o, paper::DecodeReport &r)
+	        : dst(f),
+	          paths(p),
+	          options(o),
+	          report(r),
+	          mutex(),
+	          pages(p.size()),
+	          errors(p.size()),
+	          read(p.size(), 0),
+	          pending(),
+	          framed(false),
+	          known(false),
+	          nextPage(0),
+	          reassembler(paper::format::getMaximumFrameTotal(
+	                  p.size() * (o.color ? 3 : 1))),
+	          nextFrame(0),
+	          chunkCount(0),
+	          erasure(false),
+	          grouped(false),
+	          groupChunks(),
+	          stream()
+	{
+	}
+
+	/**
+	 * This function accepts the codes read from one page, and passes on
+	 * any chunks which are now in order. This may be called from several
+	 * threads at once, with the pages in any order.
+	 *
+	 * \param page The index of the page.
+	 * \param codes The contents of each code on the page.
+	 * \param error If the page couldn't be read, the reason why.
+	 */
+	void addPage(std::size_t page, std::vector<std::vector<uint8_t>> &codes,
+	             const std::string &error)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		report.codeCount += codes.size();
+		if(!known && !codes.empty())
+		{
+			framed = isIntactFrame(codes[0]);
+			known = true;
+		}
+
+		pages[page] = std::move(codes);
+		errors[page] = error;
+		read[page] = 1;
+		pending.push_back(page);
+
+		if(!known)
+			return;
+		if(framed)
+			flushFrames();
+		else
+			flushPages();
+	}
+
+	/**
+	 * This function restores whatever is left once every page has been
+	 * added. If the file can't be restored, an exception is thrown.
+	 */
+	void finish()
+	{
+		for(std::size_t i = 0; i < paths.size(); ++i)
+		{
+			if(!errors[i].empty())
+			{
+				report.unreadable.push_back(paths[i] + ": " +
+				                            errors[i]);
+			}
+		}
+
+		if(!known)
+		{
+			if(report.unreadable.empty())
+			{
+				throw std::runtime_error(
+				        "No codes were given to restore.");
+			}
+			throw std::runtime_error("Couldn't read a code from " +
+			                         report.unreadable.front());
+		}
+
+		if(framed)
+		{
+			report.exportId = reassembler.getExportId();
+			if(isErasureCoded(reassembler))
+			{
+				decompressBuffer(
+				        dst,
+				        paper::format::decodeErasure(
+				                reassembler.getReceivedChunks(),
+				                reassembler.getMissing()),
+				        options.compression);
+				return;
+			}
+
+			// Block groups are independent, so those whose
+			// frames all arrived can still be restored.
+			if(!reassembler.isComplete() &&
+			   (grouped || (chunkCount == 0)) &&
+			   restoreBlockGroups(dst,
+			                      reassembler.getReceivedChunks(),
+			                      options, report))
+			{
+				return;
+			}
+
+			if(!reassembler.isComplete())
+			{
+				throw std::runtime_error(
+				        std::to_string(reassembler.getMissing()
+				                               .size()) +
+				        " of " +
+				        std::to_string(reassembler.getTotal()) +
+				        " codes are missing.");
+			}
+		}
+
+		if(grouped)
+		{
+			if(!restoreBlockGroups(dst, groupChunks, options,
+			                       report))
+			{
+				throw std::runtime_error(
+				        "No block groups could be decoded.");
+			}
+		}
+		else if(stream)
+		{
+			stream->finish();
+		}
+	}
+
+private:
+	FILE *dst;
+	const std::vector<std::string> &paths;
+	const paper::DecodeOptions &options;
+	paper::DecodeReport &report;
+	std::mutex mutex;
+
+	// The pages read so far, and those whose codes haven't been used yet.
+	std::vector<std::vector<std::vector<uint8_t>>> pages;
+	std::vector<std::string> errors;
+	std::vector<char> read;
+	std::vector<std::size_t> pending;
+
+	// Whether the codes are framed, once the first one has been read.
+	bool framed;
+	bool known;
+
+	// The next page whose (unframed) codes are due.
+	std::size_t nextPage;
+
+	// The frames received so far, and the next one which is due.
+	paper::format::Reassembler reassembler;
+	uint64_t nextFrame;
+
+	// Where the chunks which are in order go.
+	std::size_t chunkCount;
+	bool erasure;
+	bool grouped;
+	std::vector<std::vector<uint8_t>> groupChunks;
+	std::unique_ptr<PayloadStream> stream;
+
+	PageImporter(const PageImporter &);
+	PageImporter &operator=(const PageImporter &);
+
+	/**
+	 * This function adds the frames on every pending page, and passes on
+	 * the frames which are now in order.
+	 */
+	void flushFrames()
+	{
+		for(std::size_t page : pending)
+		{
+			for(const std::vector<uint8_t> &code : pages[page])
+			{
+				if(reassembler.add(code.data(), code.size()) ==
+				   paper::format::FrameStatus::Duplicate)
+				{
+					++report.duplicateCount;
+				}
+			}
+			pages[page].clear();
+		}
+		pending.clear();
+
+		const std::vector<std::vector<uint8_t>> &chunks =
+		        reassembler.getReceivedChunks();
+		for(; nextFrame < reassembler.getContiguousCount(); ++nextFrame)
+			addChunk(chunks[static_cast<std::size_t>(nextFrame)]);
+	}
+
+	/**
+	 * This function passes on the codes of each page which is now in
+	 * order. Since unframed codes must all be present, an unreadable page
+	 * is an error, unless the codes hold block groups, which are found by
+	 * their headers.
+	 */
+	void flushPages()
+	{
+		pending.clear();
+		for(; (nextPage < pages.size()) && (read[nextPage] != 0);
+		    ++nextPage)
+		{
+			const std::string &error = errors[nextPage];
+			if(!error.empty() && !grouped)
+			{
+				throw std::runtime_error(
+				        "Couldn't read a code from " +
+				        paths[nextPage] + ": " + error);
+			}
+
+			for(const std::vector<uint8_t> &code : pages[nextPage])
+				addChunk(code);
+			pages[nextPage].clear();
+		}
+	}
+
+	/**
+	 * This function passes on the next chunk of the payload.
+	 *
+	 * \param chunk The chunk.
+	 */
+	void addChunk(const std::vector<uint8_t> &chunk)
+	{
+		if(chunkCount++ == 0)
+		{
+			erasure = paper::format::isErasure(chunk.data(),
+			                                   chunk.size());
+			grouped = !erasure &&
+			          paper::format::isGroup(chunk.data(),
+			                                 chunk.size());
+			if(!erasure && !grouped)
+			{
+				stream.reset(new PayloadStream(
+				        dst, options.compression));
+			}
+		}
+
+		if(erasure)
+			return;
+		if(grouped)
+			groupChunks.push_back(chunk);
+		else
+			stream->write(chunk);
+	}
+};
+
+/**
+ * This function scans one page for codes, and hands them to the importer.
+ *
+ * \param importer The importer to hand the codes to.
+ * \param paths The paths to the pages, in order.
+ * \param page The index of the page to scan.
+ * \param color Whether the page overlays three codes (see renderSVGs).
+ */
+void readPage(PageImporter &importer, const std::vector<std::string> &paths,
+              std::size_t page, bool color)
+{
+	std::vector<std::vector<uint8_t>> codes;
+	std::string error;
+	try
+	{
+		codes = scanPage(paths[page], color);
+	}
+	catch(const std::runtime_error &e)
+	{
+		error = e.what();
+	}
+	importer.addPage(page, codes, error);
+}
+}
 
 namespace paper
 {
-std::vector<std::shared_ptr<qr::QRCode>> encode(const std::string &path)
+EncodeOptions::EncodeOptions()
+        : codec("lzma"),
+          compression(),
+          probe(true),
+          groupSize(0),
+          qrThreads(util::getOnlineCores()),
+          layout(),
+          frame(false),
+          erasure()
 {
-	// Load the contents of the given file.
+}
+
+EncodeReport::EncodeReport()
+        : codec(),
+          inputSize(0),
+          payloadSize(0),
+          groupCount(0),
+          exportId(0),
+          probed(false),
+          probe()
+{
+}
+
+DecodeOptions::DecodeOptions()
+        : compression(),
+          color(false),
+          threads(util::getOnlineCores())
+{
+}
+
+DecodeReport::DecodeReport()
+        : codeCount(0),
+          unreadable(),
+          exportId(0),
+          duplicateCount(0),
+          groupCount(0),
+          missingGroups(),
+          outputSize(0)
+{
+}
+
+VerifyReport::VerifyReport()
+        : decode(),
+          inputSize(0),
+          inputChecksum(0),
+          outputChecksum(0)
+{
+}
+
+std::vector<symbol::Symbol>
+encode(const std::string &path, const EncodeOptions &options,
+       EncodeReport *report)
+{
+	// Skip compression entirely if the input looks incompressible.
+
+	std::string codec(options.codec);
+	compression::ProbeResult probe;
+	// Pipes can't be sampled without consuming them, so they use the
+	// requested codec as if the probe was disabled.
+	bool probed = options.probe && (codec != "store") &&
+	              util::io::isRegularFile(path);
+	if(probed)
+	{
+		std::shared_ptr<FILE> src(util::io::openFile(path, "rb"));
+		probe = compression::probeCompressibility(src.get());
+		if(!probe.compressible)
+			codec = "store";
+	}
+
+	if(report != nullptr)
+	{
+		report->inputSize = util::io::filesize(path);
+		report->probed = probed;
+		report->probe = probe;
+	}
+
+	if(options.groupSize > 0)
+	{
+		// Each erasure coded buffer must be restored on its own, but
+		// frames are numbered across every group.
+		if(options.erasure.parityChunks > 0)
+		{
+			throw std::runtime_error("Erasure coding can't be "
+			                         "combined with block groups.");
+		}
 
-	std::shared_ptr<uint8_t> buf(nullptr);
-	std::size_t bufSize = util::io::loadFile(buf, path);
+		return encodeGroups(path, codec, options, report);
+	}
 
 	// Compress the given file's contents.
 
+	Payload payload;
+	if(codec == "auto")
+	{
+		payload = compressFileAuto(path, options.compression,
+		                           options.layout);
+	}
+	else
+	{
+		payload = compressFile(path, *compression::createCodec(
+		                                     codec, options.compression));
+	}
+
+	if(report != nullptr)
 	{
-		std::shared_ptr<uint8_t> compressed;
-		std::size_t compressedSize = compression::lzmaCompress(
-		        compressed, buf.get(), bufSize);
-		buf = compressed;
-		bufSize = compressedSize;
+		report->codec = payload.codec;
+		report->payloadSize = payload.size;
 	}
 
-	// Encode some QR codes containing the input data.
+	// Encode some codes containing the input data.
 
-	return qr::encode(buf.get(), bufSize);
+	std::vector<std::vector<uint8_t>> buffers(1);
+	buffers[0].assign(payload.data.get(),
+	                  payload.data.get() + payload.size);
+	return encodeBuffers(buffers, options, report);
 }
 
 void renderSVGs(const std::string &p, const std::string &b,
-                const std::vector<std::shared_ptr<qr::QRCode>> &codes)
+                const std::vector<symbol::Symbol> &codes, bool color)
 {
+	std::size_t perImage = color ? render::LAYER_COUNT : 1;
+	int imageCount = static_cast<int>((codes.size() + perImage - 1) /
+	                                  perImage);
+
 	std::string path(util::fs::dirname(p));
 	QString pathTemplate(
 	        QString::fromStdString(util::fs::appendPath(path, b)) +
 	        ".%1.svg");
 
-	auto getOutputPath = [&pathTemplate, &codes](int i) -> QString
+	// Every image's number is padded to the same number of digits, so
+	// sorting the files by name puts them in order (see findSVGs).
+	int digits = QString::number(imageCount).size();
+	auto getOutputPath = [&pathTemplate, digits](int i) -> QString
 	{
-		return pathTemplate.arg(i + 1, codes.size(), 10, QChar('0'));
+		return pathTemplate.arg(i + 1, digits, 10, QChar('0'));
 	};
 
 	// Check that our output directory and output files are valid.
 
 	util::fs::mkpath(path);
 
-	for(int i = 0; i < static_cast<int>(codes.size()); ++i)
+	for(int i = 0; i < imageCount; ++i)
 	{
 		std::string outPath(getOutputPath(i).toStdString());
 		if(util::fs::exists(outPath))
@@ -84,13 +1439,220 @@ void renderSVGs(const std::string &p, const std::string &b,
 		}
 	}
 
-	// Write each output file.
+	// Write each output file. In colour, the last image may have empty
+	// layers if the codes don't divide evenly.
 
-	for(int i = 0; i < static_cast<int>(codes.size()); ++i)
+	for(int i = 0; i < imageCount; ++i)
 	{
-		render::SVG svg(*codes[static_cast<std::size_t>(i)]);
-		std::string outPath(getOutputPath(i).toStdString());
-		util::io::writeFile(outPath, svg.getData(), svg.getDataSize());
+		std::size_t first = static_cast<std::size_t>(i) * perImage;
+		std::shared_ptr<FILE> file(util::io::openFile(
+		        getOutputPath(i).toStdString(), "wb"));
+
+		if(!color)
+		{
+			render::writeSVG(fileno(file.get()), codes[first]);
+			continue;
+		}
+
+		render::Layers layers;
+		for(std::size_t l = 0; l < render::LAYER_COUNT; ++l)
+		{
+			std::size_t c = first + l;
+			layers[l] = (c < codes.size()) ? &codes[c] : nullptr;
+		}
+
+		render::writeSVG(fileno(file.get()), layers);
+	}
+}
+
+std::vector<std::vector<uint8_t>>
+scanImages(const std::vector<std::string> &paths,
+           const DecodeOptions &options, DecodeReport *report)
+{
+	bool color = options.color;
+	return readPages(paths, options.threads, report,
+	                 [color](const std::string &path)
+	                 {
+		                 return scanPage(path, color);
+		         });
+}
+
+std::vector<std::vector<uint8_t>>
+readSVGs(const std::vector<std::string> &paths, const DecodeOptions &options,
+         DecodeReport *report)
+{
+	bool color = options.color;
+	return readPages(paths, options.threads, report,
+	                 [color](const std::string &path)
+	                 {
+		                 return readSVGPage(path, color);
+		         });
+}
+
+std::vector<std::string> findSVGs(const std::string &p, const std::string &b)
+{
+	// The files are named as renderSVGs names them, and their numbers are
+	// zero padded, so sorting by name puts them in order.
+	std::string prefix(b + ".");
+	std::string suffix(".svg");
+	std::vector<std::string> paths;
+	for(const std::string &name : util::fs::listFiles(p))
+	{
+		if((name.size() <= prefix.size() + suffix.size()) ||
+		   (name.compare(0, prefix.size(), prefix) != 0) ||
+		   (name.compare(name.size() - suffix.size(), suffix.size(),
+		                 suffix) != 0))
+		{
+			continue;
+		}
+
+		std::string number(name.substr(prefix.size(),
+		                               name.size() - prefix.size() -
+		                                       suffix.size()));
+		if(number.find_first_not_of("0123456789") == std::string::npos)
+			paths.push_back(util::fs::appendPath(p, name));
+	}
+	return paths;
+}
+
+void restore(FILE *dst, const std::vector<std::vector<uint8_t>> &codes,
+             const DecodeOptions &options, DecodeReport *report)
+{
+	if(codes.empty())
+		throw std::runtime_error("No codes were given to restore.");
+
+	// Framed codes are put back in order first. With erasure coding, the
+	// payload can be restored even if some of them are missing.
+
+	DecodeReport ignored;
+	DecodeReport &result = report != nullptr ? *report : ignored;
+
+	const std::vector<std::vector<uint8_t>> *chunks = &codes;
+	format::Reassembler reassembler(
+	        format::getMaximumFrameTotal(codes.size()));
+	if(isIntactFrame(codes[0]))
+	{
+		reassembler.addAll(codes, options.threads);
+		result.exportId = reassembler.getExportId();
+
+		if(isErasureCoded(reassembler))
+		{
+			decompressBuffer(
+			        dst,
+			        format::decodeErasure(
+			                reassembler.getReceivedChunks(),
+			                reassembler.getMissing()),
+			        options.compression);
+			return;
+		}
+
+		// Block groups are independent, so those whose frames all
+		// arrived can still be restored.
+		if(!reassembler.isComplete() &&
+		   restoreBlockGroups(dst, reassembler.getReceivedChunks(),
+		                      options, result))
+		{
+			return;
+		}
+
+		chunks = &reassembler.getChunks();
+	}
+
+	if(format::isGroup((*chunks)[0].data(), (*chunks)[0].size()))
+	{
+		if(!restoreBlockGroups(dst, *chunks, options, result))
+		{
+			throw std::runtime_error(
+			        "No block groups could be decoded.");
+		}
+		return;
+	}
+
+	std::vector<uint8_t> payload;
+	for(const std::vector<uint8_t> &chunk : *chunks)
+		payload.insert(payload.end(), chunk.begin(), chunk.end());
+	decompressBuffer(dst, payload, options.compression);
+}
+
+void decode(const std::vector<std::string> &paths, const std::string &path,
+            const DecodeOptions &options, DecodeReport *report)
+{
+	if(util::fs::exists(path))
+		throw std::runtime_error("File already exists: " + path);
+
+	DecodeReport result;
+	try
+	{
+		std::shared_ptr<FILE> dst(util::io::openFile(path, "wb"));
+		PageImporter importer(dst.get(), paths, options, result);
+		util::parallelFor(paths.size(), options.threads,
+		                  [&](std::size_t i)
+		                  {
+			                  readPage(importer, paths, i,
+			                           options.color);
+			          });
+		importer.finish();
 	}
+	catch(...)
+	{
+		std::remove(path.c_str());
+		throw;
+	}
+
+	result.outputSize = util::io::filesize(path);
+	if(report != nullptr)
+		*report = result;
+}
+
+std::vector<std::string> findImages(const std::string &p)
+{
+	std::vector<std::string> paths;
+	for(const std::string &name : util::fs::listFiles(p))
+	{
+		std::string lower(name);
+		std::transform(lower.begin(), lower.end(), lower.begin(),
+		               [](char c)
+		               {
+			               return static_cast<char>(std::tolower(
+			                       static_cast<unsigned char>(c)));
+			       });
+
+		for(const char *extension : IMAGE_EXTENSIONS)
+		{
+			std::string suffix(extension);
+			if((lower.size() > suffix.size()) &&
+			   (lower.compare(lower.size() - suffix.size(),
+			                  suffix.size(), suffix) == 0))
+			{
+				paths.push_back(util::fs::appendPath(p, name));
+				break;
+			}
+		}
+	}
+	return paths;
+}
+
+bool verify(const std::string &path, const std::vector<std::string> &svgPaths,
+            const DecodeOptions &options, VerifyReport *report)
+{
+	return verifyCodes(path,
+	                   [&](DecodeReport &decodeReport)
+	                   {
+		                   return readSVGs(svgPaths, options,
+		                                   &decodeReport);
+		           },
+	                   options, report);
+}
+
+bool verify(const std::string &path, const std::vector<symbol::Symbol> &codes,
+            const DecodeOptions &options, VerifyReport *report)
+{
+	return verifyCodes(path,
+	                   [&](DecodeReport &decodeReport)
+	                   {
+		                   return decodeSymbols(codes, options.threads,
+		                                        decodeReport);
+		           },
+	                   options, report);
 }
 }
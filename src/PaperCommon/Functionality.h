@@ -19,34 +19,404 @@
 #ifndef PAPER_FUNCTIONALITY_H
 #define PAPER_FUNCTIONALITY_H
 
-#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <string>
 #include <vector>
 
-#include "PaperCommon/QR/QRCode.h"
+#include "PaperCommon/Compression/Codec.h"
+#include "PaperCommon/Compression/Probe.h"
+#include "PaperCommon/Format/Erasure.h"
+#include "PaperCommon/Format/Groups.h"
+#include "PaperCommon/QR/Planner.h"
+#include "PaperCommon/Symbol/Symbol.h"
 
 namespace paper
 {
+/**
+ * \brief This structure holds all of the options which control encoding.
+ */
+struct EncodeOptions
+{
+	/**
+	 * The name of the codec used to compress the input file's contents,
+	 * or "auto" to try every codec and keep whichever output needs the
+	 * fewest QR codes.
+	 */
+	std::string codec;
+
+	/**
+	 * The options used to configure the compression codec(s).
+	 */
+	compression::CompressionOptions compression;
+
+	/**
+	 * Whether or not to probe the input's compressibility first. If the
+	 * input appears incompressible (e.g. it is already compressed or
+	 * encrypted), it is stored as-is instead of being run through the
+	 * selected codec.
+	 */
+	bool probe;
+
+	/**
+	 * If nonzero, the input is split into independently compressed block
+	 * groups of this many (uncompressed) bytes, each of which occupies
+	 * whole QR codes of its own (see format::GroupHeader). Otherwise, the
+	 * input is compressed as a single stream.
+	 */
+	uint64_t groupSize;
+
+	/**
+	 * The maximum number of threads used to encode QR codes. The codes are
+	 * independent of one another, so this scales with the number of codes.
+	 */
+	std::size_t qrThreads;
+
+	/**
+	 * The constraints on the codes the payload is split into, such as
+	 * their symbology, maximum version and error correction level (see
+	 * qr::getPlan). With block groups, each group is planned separately,
+	 * but an automatic symbology is chosen once for every group.
+	 */
+	qr::PlanConstraints layout;
+
+	/**
+	 * Whether or not to wrap each QR code's chunk in a frame (see
+	 * format::FrameHeader), so the codes can be scanned in any order and
+	 * verified one at a time.
+	 */
+	bool frame;
+
+	/**
+	 * The parameters of the erasure code added across QR codes. If any
+	 * parity chunks are added, every code is framed, so the lost codes can
+	 * be identified. The layout's maximum code count then only limits the
+	 * number of data codes. This can't be combined with block groups. The
+	 * parameters are recorded in every chunk, so decoding detects them.
+	 */
+	format::ErasureParameters erasure;
+
+	/**
+	 * This constructor initializes all options to their default values.
+	 */
+	EncodeOptions();
+};
+
+/**
+ * \brief This structure describes the result of an encode() operation.
+ */
+struct EncodeReport
+{
+	/**
+	 * The name of the codec which was used to compress the input. With
+	 * block groups, this lists each codec which was used by some group.
+	 */
+	std::string codec;
+
+	/**
+	 * The size of the input file, in bytes.
+	 */
+	uint64_t inputSize;
+
+	/**
+	 * The size of the payload stored in the QR codes, in bytes.
+	 */
+	uint64_t payloadSize;
+
+	/**
+	 * The number of block groups the input was split into, or 0 if it was
+	 * compressed as a single stream.
+	 */
+	uint64_t groupCount;
+
+	/**
+	 * The identifier shared by every frame of the export, or 0 if framing
+	 * was disabled.
+	 */
+	uint32_t exportId;
+
+	/**
+	 * Whether or not the input's compressibility was probed.
+	 */
+	bool probed;
+
+	/**
+	 * The result of the compressibility probe, if it was performed.
+	 */
+	compression::ProbeResult probe;
+
+	/**
+	 * This constructor initializes an empty report.
+	 */
+	EncodeReport();
+};
+
+/**
+ * \brief This structure holds all of the options which control decoding.
+ */
+struct DecodeOptions
+{
+	/**
+	 * The options used to configure the decompression codec, such as the
+	 * preset dictionaries the payload may refer to and the decoder's
+	 * memory limit.
+	 */
+	compression::CompressionOptions compression;
+
+	/**
+	 * Whether or not each image overlays three codes, on cyan, magenta
+	 * and yellow layers (see renderSVGs).
+	 */
+	bool color;
+
+	/**
+	 * The maximum number of threads used to scan images. Each image is
+	 * scanned independently, so this scales with the number of images.
+	 */
+	std::size_t threads;
+
+	/**
+	 * This constructor initializes all options to their default values.
+	 */
+	DecodeOptions();
+};
+
+/**
+ * \brief This structure describes the result of a decode() operation.
+ */
+struct DecodeReport
+{
+	/**
+	 * The number of codes which were read from the images.
+	 */
+	std::size_t codeCount;
+
+	/**
+	 * The paths of the images no code could be read from, each followed
+	 * by the reason. These can only be tolerated if the codes are framed,
+	 * or if the data was split into block groups.
+	 */
+	std::vector<std::string> unreadable;
+
+	/**
+	 * The identifier shared by every frame of the export, or 0 if the
+	 * codes weren't framed.
+	 */
+	uint32_t exportId;
+
+	/**
+	 * The number of framed codes which were dropped because the same
+	 * frame had already been read, e.g. from a page scanned twice.
+	 */
+	std::size_t duplicateCount;
+
+	/**
+	 * The number of block groups the data was restored from, or 0 if it
+	 * was compressed as a single stream.
+	 */
+	uint64_t groupCount;
+
+	/**
+	 * The block groups which were damaged or missing. The ranges of the
+	 * file they held are filled with zeros, so the rest of the file is
+	 * still in place.
+	 */
+	std::vector<format::GroupGap> missingGroups;
+
+	/**
+	 * The size of the restored file, in bytes.
+	 */
+	uint64_t outputSize;
+
+	/**
+	 * This constructor initializes an empty report.
+	 */
+	DecodeReport();
+};
+
+/**
+ * \brief This structure describes the result of a verify() operation.
+ */
+struct VerifyReport
+{
+	/**
+	 * The details of how the data was restored from the images.
+	 */
+	DecodeReport decode;
+
+	/**
+	 * The size of the source file, in bytes.
+	 */
+	uint64_t inputSize;
+
+	/**
+	 * The CRC32C checksum of the source file.
+	 */
+	uint32_t inputChecksum;
+
+	/**
+	 * The CRC32C checksum of the data restored from the images.
+	 */
+	uint32_t outputChecksum;
+
+	/**
+	 * This constructor initializes an empty report.
+	 */
+	VerifyReport();
+};
+
 /**
  * This function will encode the contents of the given file as a minimal set
- * of QR codes. If some error occurs, an appropriate exception will be thrown.
+ * of QR codes (or other symbols, depending on the layout). If some error
+ * occurs, an appropriate exception will be thrown.
  *
  * \param path The path to the file to encode.
- * \return The set of QR codes containing the file's data.
+ * \param options The options which control how the file is encoded.
+ * \param report If not null, this is filled in with details about the result.
+ * \return The set of symbols containing the file's data.
  */
-std::vector<std::shared_ptr<qr::QRCode>> encode(const std::string &path);
+std::vector<symbol::Symbol>
+encode(const std::string &path, const EncodeOptions &options = EncodeOptions(),
+       EncodeReport *report = nullptr);
 
 /**
- * This function will render the given QR codes as SVG images, writing the
+ * This function will render the given symbols as SVG images, writing the
  * resulting file(s) to the given output directory. The files will be named
  * according to the given base file name.
  *
+ * If color is set, the symbols are overlaid three to an image, on cyan,
+ * magenta and yellow layers, so a third as many images are written.
+ *
  * \param p The directory to write output files to.
  * \param b The base name for each file.
- * \param codes The set of QR codes to render.
+ * \param codes The set of symbols to render.
+ * \param color Whether to overlay three symbols per colour image.
  */
 void renderSVGs(const std::string &p, const std::string &b,
-                const std::vector<std::shared_ptr<qr::QRCode>> &codes);
+                const std::vector<symbol::Symbol> &codes, bool color = false);
+
+/**
+ * This function scans each of the given images (PBM, PGM or PPM, or any
+ * other format Qt can load, such as PNG) for codes, in parallel. Images which
+ * can't be read are skipped, and listed in the report.
+ *
+ * \param paths The paths to the images to scan, in order.
+ * \param options The options which control how the images are scanned.
+ * \param report If not null, this is filled in with details about the result.
+ * \return The contents of each code, in image (and layer) order.
+ */
+std::vector<std::vector<uint8_t>>
+scanImages(const std::vector<std::string> &paths,
+           const DecodeOptions &options = DecodeOptions(),
+           DecodeReport *report = nullptr);
+
+/**
+ * This function reads the codes from each of the given SVG images, as
+ * written by renderSVGs, in parallel. Rather than being rasterized and
+ * scanned, each image's rectangles are parsed straight back into modules.
+ * Images which can't be read are skipped, and listed in the report.
+ *
+ * \param paths The paths to the SVG images to read, in order.
+ * \param options The options which control how the images are read.
+ * \param report If not null, this is filled in with details about the result.
+ * \return The contents of each code, in image (and layer) order.
+ */
+std::vector<std::vector<uint8_t>>
+readSVGs(const std::vector<std::string> &paths,
+         const DecodeOptions &options = DecodeOptions(),
+         DecodeReport *report = nullptr);
+
+/**
+ * This function finds the SVG images renderSVGs wrote to the given directory
+ * with the given base file name.
+ *
+ * \param p The directory the images were written to.
+ * \param b The base name of each file.
+ * \return The paths to the images, in order.
+ */
+std::vector<std::string> findSVGs(const std::string &p, const std::string &b);
+
+/**
+ * This function finds the images in the given directory which scanImages can
+ * read, judging by their extensions.
+ *
+ * \param p The directory to search.
+ * \return The paths to the images, in name order.
+ */
+std::vector<std::string> findImages(const std::string &p);
+
+/**
+ * This function restores the original file from the contents of the given
+ * codes, writing it to the given file. Framed codes may be given in any
+ * order, and with erasure coding some may be missing. Otherwise, the codes
+ * must all be given in order. If the data was split into block groups, any
+ * damaged or missing groups are left as zeros (see
+ * DecodeReport::missingGroups). If the file can't be restored, an exception
+ * is thrown.
+ *
+ * \param dst The file to write the restored data to.
+ * \param codes The contents of each code.
+ * \param options The options which control how the data is decoded.
+ * \param report If not null, this is filled in with details about the result.
+ */
+void restore(FILE *dst, const std::vector<std::vector<uint8_t>> &codes,
+             const DecodeOptions &options = DecodeOptions(),
+             DecodeReport *report = nullptr);
+
+/**
+ * This function will restore a file from the codes in the given scanned
+ * images, writing it to the given path (which must not exist yet). If some
+ * error occurs, an appropriate exception will be thrown.
+ *
+ * The images are scanned in parallel, and their codes are put back in order
+ * as they are read. Unless the codes are erasure coded or split into block
+ * groups, the payload is decompressed on another thread as it is reordered,
+ * so the file is written while later images are still being scanned.
+ *
+ * \param paths The paths to the images to scan, in order.
+ * \param path The path to write the restored file to.
+ * \param options The options which control how the images are decoded.
+ * \param report If not null, this is filled in with details about the result.
+ */
+void decode(const std::vector<std::string> &paths, const std::string &path,
+            const DecodeOptions &options = DecodeOptions(),
+            DecodeReport *report = nullptr);
+
+/**
+ * This function checks that the given SVG images, as written by renderSVGs,
+ * restore the given file exactly. The images are read and decompressed while
+ * the file is checksummed, and the restored data is compared against it by
+ * size and CRC32C checksum. If the images can't be restored at all, an
+ * appropriate exception will be thrown.
+ *
+ * \param path The path to the source file.
+ * \param svgPaths The paths to the SVG images, in order.
+ * \param options The options which control how the images are decoded.
+ * \param report If not null, this is filled in with details about the result.
+ * \return Whether the restored data matches the source file.
+ */
+bool verify(const std::string &path, const std::vector<std::string> &svgPaths,
+            const DecodeOptions &options = DecodeOptions(),
+            VerifyReport *report = nullptr);
+
+/**
+ * This function checks that the given symbols, as returned by encode, restore
+ * the given file exactly. Each symbol's modules are decoded in memory, as a
+ * scanner would read them, so this catches anything which went wrong while
+ * encoding before the symbols are printed. QR codes and Data Matrix symbols
+ * are each read by their own decoder. Otherwise, this behaves like the SVG
+ * overload above.
+ *
+ * \param path The path to the source file.
+ * \param codes The symbols to verify.
+ * \param options The options which control how the symbols are decoded.
+ * \param report If not null, this is filled in with details about the result.
+ * \return Whether the restored data matches the source file.
+ */
+bool verify(const std::string &path, const std::vector<symbol::Symbol> &codes,
+            const DecodeOptions &options = DecodeOptions(),
+            VerifyReport *report = nullptr);
 }
 
 #endif
@@ -19,29 +19,160 @@
 #include "Coding.h"
 
 #include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "PaperCommon/Util/Parallel.h"
+
+namespace
+{
+/**
+ * \brief A Chunk is the slice of some input buffer stored in one QR code.
+ */
+struct Chunk
+{
+	const uint8_t *data;
+	std::size_t offset;
+	std::size_t size;
+	paper::symbol::Symbology symbology;
+	paper::qr::QRCode::ErrorCorrection errorCorrection;
+};
+
+/**
+ * This function splits the given buffer into chunks according to the plan
+ * for the given constraints, and appends them to the given list.
+ *
+ * \param chunks The list to append the buffer's chunks to.
+ * \param data The buffer to split.
+ * \param size The size of the given buffer.
+ * \param constraints The constraints the buffer's QR codes must satisfy.
+ */
+void appendChunks(std::vector<Chunk> &chunks, const uint8_t *data,
+                  std::size_t size,
+                  const paper::qr::PlanConstraints &constraints)
+{
+	paper::qr::Plan plan(paper::qr::getPlan(size, constraints));
+
+	for(std::size_t code = 0; code < plan.codeCount; ++code)
+	{
+		std::size_t offset(code * plan.chunkSize);
+		std::size_t singleSize(std::min(size - offset, plan.chunkSize));
+		chunks.push_back({data, offset, singleSize, plan.symbology,
+		                  plan.errorCorrection});
+	}
+}
+
+/**
+ * This function creates a code of the given type containing the given chunk.
+ *
+ * \param chunk The chunk to encode.
+ * \return The new code.
+ */
+template <typename Code> Code *createCode(const Chunk &chunk);
+
+template <> paper::qr::QRCode *createCode(const Chunk &chunk)
+{
+	return new paper::qr::QRCode(chunk.data, chunk.offset, chunk.size,
+	                             chunk.errorCorrection);
+}
+
+template <> paper::symbol::Symbol *createCode(const Chunk &chunk)
+{
+	return new paper::symbol::Symbol(chunk.data, chunk.offset, chunk.size,
+	                                 chunk.symbology,
+	                                 chunk.errorCorrection);
+}
+
+/**
+ * This function encodes each of the given chunks into a code, spreading the
+ * work across (at most) the given number of threads. Each worker writes only
+ * its own chunk's slot, so the result is in order without any locking. The
+ * finished codes are then moved into one contiguous array.
+ *
+ * \param chunks The chunks to encode.
+ * \param workers The maximum number of threads to use.
+ * \return One code per chunk, in the same order.
+ */
+template <typename Code>
+std::vector<Code> encodeChunks(const std::vector<Chunk> &chunks,
+                               std::size_t workers)
+{
+	std::vector<std::unique_ptr<Code>> codes(chunks.size());
+
+	paper::util::parallelFor(
+	        chunks.size(), workers, [&chunks, &codes](std::size_t i)
+	        {
+		        codes[i].reset(createCode<Code>(chunks[i]));
+		});
+
+	std::vector<Code> ret;
+	ret.reserve(codes.size());
+	for(std::unique_ptr<Code> &code : codes)
+		ret.push_back(std::move(*code));
+	return ret;
+}
+
+/**
+ * This function returns a copy of the given constraints which only allows QR
+ * codes, for the functions which return them.
+ *
+ * \param constraints The constraints to copy.
+ * \return The QR code constraints.
+ */
+paper::qr::PlanConstraints
+getQRConstraints(const paper::qr::PlanConstraints &constraints)
+{
+	paper::qr::PlanConstraints ret(constraints);
+	ret.symbology = paper::symbol::Symbology::QR;
+	return ret;
+}
+}
 
 namespace paper
 {
 namespace qr
 {
-std::vector<std::shared_ptr<QRCode>> encode(uint8_t *data, std::size_t size)
+std::size_t getCodeCount(std::size_t size,
+                         const PlanConstraints &constraints)
 {
-	// Determine how many QR codes we'll need, by rounding up division.
-	const std::size_t maxCapacity(getMaximumCapacity());
-	std::size_t codes = 1 + ((size - 1) / maxCapacity);
-	std::vector<std::shared_ptr<QRCode>> ret;
+	return getPlan(size, constraints).codeCount;
+}
 
-	// Encode each block of data.
-	for(std::size_t code = 0; code < codes; ++code)
-	{
-		std::size_t offset(code * maxCapacity);
-		std::size_t singleSize(std::min(size - offset, maxCapacity));
+std::vector<QRCode> encode(const uint8_t *data, std::size_t size)
+{
+	return encode(data, size, 1);
+}
+
+std::vector<QRCode>
+encode(const uint8_t *data, std::size_t size, std::size_t workers,
+       const PlanConstraints &constraints)
+{
+	std::vector<Chunk> chunks;
+	appendChunks(chunks, data, size, getQRConstraints(constraints));
+	return encodeChunks<QRCode>(chunks, workers);
+}
 
-		ret.push_back(std::shared_ptr<QRCode>(
-		        new QRCode(data, offset, singleSize)));
+std::vector<QRCode>
+encode(const std::vector<std::vector<uint8_t>> &buffers, std::size_t workers,
+       const PlanConstraints &constraints)
+{
+	std::vector<Chunk> chunks;
+	for(const std::vector<uint8_t> &buffer : buffers)
+	{
+		appendChunks(chunks, buffer.data(), buffer.size(),
+		             getQRConstraints(constraints));
 	}
+	return encodeChunks<QRCode>(chunks, workers);
+}
 
-	return ret;
+std::vector<symbol::Symbol>
+encodeSymbols(const std::vector<std::vector<uint8_t>> &buffers,
+              std::size_t workers, const PlanConstraints &constraints)
+{
+	std::vector<Chunk> chunks;
+	for(const std::vector<uint8_t> &buffer : buffers)
+		appendChunks(chunks, buffer.data(), buffer.size(), constraints);
+	return encodeChunks<symbol::Symbol>(chunks, workers);
 }
 }
 }
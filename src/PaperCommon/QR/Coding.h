@@ -21,25 +21,85 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <memory>
 #include <vector>
 
+#include "PaperCommon/QR/Planner.h"
 #include "PaperCommon/QR/QRCode.h"
+#include "PaperCommon/Symbol/Symbol.h"
 
 namespace paper
 {
 namespace qr
 {
+/**
+ * This function returns the number of codes encode() (or encodeSymbols()) will
+ * produce for the given amount of data.
+ *
+ * \param size The size of the data to encode.
+ * \param constraints The constraints the QR codes must satisfy.
+ * \return The number of QR codes needed to store the data.
+ */
+std::size_t
+getCodeCount(std::size_t size,
+             const PlanConstraints &constraints = PlanConstraints());
+
 /**
  * This function encodes all of the given data into one or more QR codes. The
- * QR codes produced will be minimal (in number and then in size) in order to
- * store all of the given data.
+ * data is split according to getPlan(), so the QR codes produced will use the
+ * fewest total modules which satisfy the default constraints.
+ *
+ * \param data The data to encode.
+ * \param size The size of the given data buffer.
+ * \return The set of encoded QR codes.
+ */
+std::vector<QRCode> encode(const uint8_t *data, std::size_t size);
+
+/**
+ * This function is identical to encode(data, size), except that the data is
+ * split according to the given constraints, and the QR codes are encoded
+ * concurrently on (at most) the given number of threads. The codes are still
+ * returned in order. The constraints' symbology is ignored.
  *
  * \param data The data to encode.
  * \param size The size of the given data buffer.
+ * \param workers The maximum number of threads to use.
+ * \param constraints The constraints the QR codes must satisfy.
+ * \return The set of encoded QR codes.
+ */
+std::vector<QRCode>
+encode(const uint8_t *data, std::size_t size, std::size_t workers,
+       const PlanConstraints &constraints = PlanConstraints());
+
+/**
+ * This function encodes each of the given buffers into its own QR code(s),
+ * exactly as encode(data, size, workers, constraints) would, and returns
+ * every buffer's codes concatenated in order. Codes from all buffers are
+ * encoded concurrently on (at most) the given number of threads, so many
+ * small buffers parallelize as well as one large one.
+ *
+ * \param buffers The buffers to encode.
+ * \param workers The maximum number of threads to use.
+ * \param constraints The constraints each buffer's QR codes must satisfy.
  * \return The set of encoded QR codes.
  */
-std::vector<std::shared_ptr<QRCode>> encode(uint8_t *data, std::size_t size);
+std::vector<QRCode>
+encode(const std::vector<std::vector<uint8_t>> &buffers, std::size_t workers,
+       const PlanConstraints &constraints = PlanConstraints());
+
+/**
+ * This function is identical to encode(buffers, workers, constraints), except
+ * that it honours the constraints' symbology: each buffer is stored in QR
+ * codes or Data Matrix symbols, according to its plan.
+ *
+ * \param buffers The buffers to encode.
+ * \param workers The maximum number of threads to use.
+ * \param constraints The constraints each buffer's codes must satisfy.
+ * \return The set of encoded symbols.
+ */
+std::vector<symbol::Symbol>
+encodeSymbols(const std::vector<std::vector<uint8_t>> &buffers,
+              std::size_t workers,
+              const PlanConstraints &constraints = PlanConstraints());
 }
 }
 
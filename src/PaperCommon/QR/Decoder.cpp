@@ -0,0 +1,360 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Decoder.h"
+
+#include <stdexcept>
+
+#include "PaperCommon/QR/Layout.h"
+#include "PaperCommon/QR/ReedSolomon.h"
+#include "PaperCommon/Util/Bits.h"
+
+namespace
+{
+/**
+ * \brief The most bit errors we accept in the format or version
+ * information. Both are BCH codes with a minimum distance of 7 or 8, so up
+ * to three errors can be corrected unambiguously.
+ */
+constexpr std::size_t MAX_BIT_ERRORS = 3;
+
+// The four bit mode indicators we understand.
+constexpr unsigned int MODE_TERMINATOR = 0x0;
+constexpr unsigned int MODE_BYTE = 0x4;
+
+/**
+ * This function reads one of the two copies of a QR code's format
+ * information, mirroring the layout it is drawn in.
+ *
+ * \param modules The symbol to read from.
+ * \param second Whether to read the copy split between the top-right and
+ * bottom-left finder patterns, rather than the top-left one.
+ * \return The format information bits.
+ */
+unsigned int readFormatBits(const paper::qr::ModuleMatrix &modules,
+                            bool second)
+{
+	std::size_t w = modules.getWidth();
+	unsigned int bits = 0;
+	auto bit = [&](std::size_t i, std::size_t x, std::size_t y)
+	{
+		if(modules.get(x, y))
+			bits |= 1u << i;
+	};
+
+	if(second)
+	{
+		for(std::size_t i = 0; i < 8; ++i)
+			bit(i, w - 1 - i, 8);
+		for(std::size_t i = 8; i < 15; ++i)
+			bit(i, 8, w - 15 + i);
+		return bits;
+	}
+
+	for(std::size_t i = 0; i < 6; ++i)
+		bit(i, 8, i);
+	bit(6, 8, 7);
+	bit(7, 8, 8);
+	bit(8, 7, 8);
+	for(std::size_t i = 9; i < 15; ++i)
+		bit(i, 14 - i, 8);
+	return bits;
+}
+
+/**
+ * This function reads one of the two copies of a QR code's version
+ * information.
+ *
+ * \param modules The symbol to read from.
+ * \param second Whether to read the copy beside the bottom-left finder
+ * pattern, rather than the top-right one.
+ * \return The version information bits.
+ */
+unsigned int readVersionBits(const paper::qr::ModuleMatrix &modules,
+                             bool second)
+{
+	std::size_t w = modules.getWidth();
+	unsigned int bits = 0;
+	for(std::size_t i = 0; i < 18; ++i)
+	{
+		std::size_t a = w - 11 + i % 3;
+		std::size_t b = i / 3;
+		if(second ? modules.get(b, a) : modules.get(a, b))
+			bits |= 1u << i;
+	}
+	return bits;
+}
+
+/**
+ * This function finds the error correction level and mask recorded by the
+ * given symbol's format information, using whichever copy is closest to a
+ * valid codeword.
+ *
+ * \param modules The symbol to read from.
+ * \param level The error correction level to fill in.
+ * \param mask The mask pattern to fill in.
+ */
+void decodeFormat(const paper::qr::ModuleMatrix &modules,
+                  paper::qr::QRCode::ErrorCorrection &level,
+                  std::size_t &mask)
+{
+	unsigned int copies[2] = {readFormatBits(modules, false),
+	                          readFormatBits(modules, true)};
+
+	using paper::qr::QRCode;
+
+	std::size_t best = MAX_BIT_ERRORS + 1;
+	for(unsigned int l = 0; l < 4; ++l)
+	{
+		auto candidate = static_cast<QRCode::ErrorCorrection>(l);
+		for(std::size_t m = 0; m < 8; ++m)
+		{
+			unsigned int bits =
+			        paper::qr::getFormatBits(candidate, m);
+			for(unsigned int copy : copies)
+			{
+				std::size_t distance =
+				        paper::util::popcount(bits ^ copy);
+				if(distance < best)
+				{
+					best = distance;
+					level = candidate;
+					mask = m;
+				}
+			}
+		}
+	}
+
+	if(best > MAX_BIT_ERRORS)
+	{
+		throw std::runtime_error(
+		        "QR code format information is unreadable.");
+	}
+}
+
+/**
+ * This function reads every codeword from the given symbol, removing the
+ * mask from each module as it goes.
+ *
+ * \param modules The symbol to read from.
+ * \param version The symbol's version.
+ * \param mask The mask pattern to remove.
+ * \return The symbol's codewords, in placement order.
+ */
+std::vector<uint8_t> readCodewords(const paper::qr::ModuleMatrix &modules,
+                                   int version, std::size_t mask)
+{
+	std::vector<uint8_t> codewords(paper::qr::getCodewordCount(version));
+	std::size_t bitCount = codewords.size() * 8;
+	std::size_t bit = 0;
+
+	paper::qr::forEachCodewordModule(
+	        paper::qr::getFunctionModules(version),
+	        [&](std::size_t x, std::size_t y)
+	        {
+		        // Any leftover remainder bits are skipped.
+		        if(bit >= bitCount)
+			        return;
+
+		        if(modules.get(x, y) != paper::qr::isMasked(mask, x, y))
+			        codewords[bit / 8] |= 0x80 >> (bit % 8);
+		        ++bit;
+		});
+
+	return codewords;
+}
+
+/**
+ * This function splits the given codewords back into their blocks (the
+ * reverse of how they are interleaved when encoding), corrects each block,
+ * and returns the data codewords of every block in order.
+ *
+ * \param codewords The symbol's codewords, in placement order.
+ * \param version The symbol's version.
+ * \param level The symbol's error correction level.
+ * \param corrected The number of codewords corrected is added to this.
+ * \return The corrected data codewords.
+ */
+std::vector<uint8_t>
+correctCodewords(const std::vector<uint8_t> &codewords, int version,
+                 paper::qr::QRCode::ErrorCorrection level,
+                 std::size_t &corrected)
+{
+	std::size_t blockCount = paper::qr::getBlockCount(version, level);
+	std::size_t parity = paper::qr::getBlockParityCount(version, level);
+	std::size_t total = codewords.size();
+	std::size_t shortBlocks = blockCount - total % blockCount;
+	std::size_t shortSize = total / blockCount - parity;
+	std::size_t dataCount = total - parity * blockCount;
+
+	std::vector<uint8_t> data;
+	data.reserve(dataCount);
+	uint8_t block[255];
+	for(std::size_t b = 0; b < blockCount; ++b)
+	{
+		std::size_t size = shortSize + (b < shortBlocks ? 0 : 1);
+		for(std::size_t i = 0; i < shortSize; ++i)
+			block[i] = codewords[i * blockCount + b];
+		if(size > shortSize)
+		{
+			std::size_t extra = b - shortBlocks;
+			block[shortSize] =
+			        codewords[shortSize * blockCount + extra];
+		}
+
+		const uint8_t *blockParity = codewords.data() + dataCount;
+		for(std::size_t i = 0; i < parity; ++i)
+			block[size + i] = blockParity[i * blockCount + b];
+
+		corrected +=
+		        paper::qr::correctErrors(block, size + parity, parity);
+		data.insert(data.end(), block, block + size);
+	}
+
+	return data;
+}
+
+/**
+ * This function parses the segments stored in the given data codewords.
+ * Only byte mode segments are supported, since those are all we write.
+ *
+ * \param codewords The data codewords.
+ * \param version The symbol's version.
+ * \return The data stored in the segments.
+ */
+std::vector<uint8_t> parseSegments(const std::vector<uint8_t> &codewords,
+                                   int version)
+{
+	std::size_t bitCount = codewords.size() * 8;
+	std::size_t position = 0;
+	auto read = [&](std::size_t count) -> unsigned int
+	{
+		unsigned int value = 0;
+		for(std::size_t i = 0; i < count; ++i, ++position)
+		{
+			uint8_t codeword = codewords[position / 8];
+			value = (value << 1) |
+			        ((codeword >> (7 - position % 8)) & 1u);
+		}
+		return value;
+	};
+
+	std::size_t countBits = version < 10 ? 8 : 16;
+	std::vector<uint8_t> data;
+
+	// The terminator may be truncated, or left out entirely, if the data
+	// fills the symbol.
+	while(bitCount - position >= 4)
+	{
+		unsigned int mode = read(4);
+		if(mode == MODE_TERMINATOR)
+			break;
+		if(mode != MODE_BYTE)
+		{
+			throw std::runtime_error(
+			        "Unsupported QR code data mode.");
+		}
+
+		if(bitCount - position < countBits)
+			throw std::runtime_error("QR code data is truncated.");
+		std::size_t count = read(countBits);
+		if((bitCount - position) / 8 < count)
+			throw std::runtime_error("QR code data is truncated.");
+
+		for(std::size_t i = 0; i < count; ++i)
+			data.push_back(static_cast<uint8_t>(read(8)));
+	}
+
+	return data;
+}
+}
+
+namespace paper
+{
+namespace qr
+{
+DecodeReport::DecodeReport()
+        : version(0),
+          errorCorrection(QRCode::ErrorCorrection::Low),
+          corrected(0)
+{
+}
+
+int decodeVersionBits(unsigned int bits)
+{
+	int best = 0;
+	std::size_t bestDistance = MAX_BIT_ERRORS + 1;
+	for(int version = 7; version <= 40; ++version)
+	{
+		std::size_t distance =
+		        util::popcount(getVersionBits(version) ^ bits);
+		if(distance < bestDistance)
+		{
+			best = version;
+			bestDistance = distance;
+		}
+	}
+	return best;
+}
+
+std::vector<uint8_t> decodeSymbol(const ModuleMatrix &modules,
+                                  DecodeReport *report)
+{
+	std::size_t w = modules.getWidth();
+	if((modules.getHeight() != w) || (w < 21) || (w > 177) ||
+	   ((w - 17) % 4 != 0))
+	{
+		throw std::runtime_error("Invalid QR code size.");
+	}
+
+	// The size already implies the version, but larger symbols record it
+	// too. If both copies are unreadable, we just trust the size.
+	int version = static_cast<int>((w - 17) / 4);
+	if(version >= 7)
+	{
+		int first = decodeVersionBits(readVersionBits(modules, false));
+		int second = decodeVersionBits(readVersionBits(modules, true));
+		if(((first != 0) && (first != version)) ||
+		   ((first == 0) && (second != 0) && (second != version)))
+		{
+			throw std::runtime_error("QR code version information "
+			                         "doesn't match its size.");
+		}
+	}
+
+	QRCode::ErrorCorrection level = QRCode::ErrorCorrection::Low;
+	std::size_t mask = 0;
+	decodeFormat(modules, level, mask);
+
+	std::size_t corrected = 0;
+	std::vector<uint8_t> data(parseSegments(
+	        correctCodewords(readCodewords(modules, version, mask), version,
+	                         level, corrected),
+	        version));
+
+	if(report != nullptr)
+	{
+		report->version = version;
+		report->errorCorrection = level;
+		report->corrected = corrected;
+	}
+
+	return data;
+}
+}
+}
@@ -0,0 +1,74 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAPER_QR_DECODER_H
+#define PAPER_QR_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PaperCommon/QR/ModuleMatrix.h"
+#include "PaperCommon/QR/QRCode.h"
+
+namespace paper
+{
+namespace qr
+{
+/**
+ * \brief This structure describes a QR code decoded by decodeSymbol().
+ */
+struct DecodeReport
+{
+	int version;
+	QRCode::ErrorCorrection errorCorrection;
+
+	/**
+	 * The number of codewords which Reed-Solomon error correction had to
+	 * repair, across every block.
+	 */
+	std::size_t corrected;
+
+	DecodeReport();
+};
+
+/**
+ * This function returns the version recorded by the given 18-bit version
+ * information, correcting up to three bit errors.
+ *
+ * \param bits The version information bits, as read from a symbol.
+ * \return The version, or 0 if the bits are too badly damaged.
+ */
+int decodeVersionBits(unsigned int bits);
+
+/**
+ * This function decodes the given QR code's modules back into the data
+ * stored in it: it reads the format information, removes the mask, corrects
+ * any errors in each block, and then parses the byte mode segments. If the
+ * symbol can't be decoded, an exception is thrown instead.
+ *
+ * \param modules The symbol's modules, without any quiet zone.
+ * \param report If not null, this is filled in with details about the code.
+ * \return The data stored in the symbol.
+ */
+std::vector<uint8_t> decodeSymbol(const ModuleMatrix &modules,
+                                  DecodeReport *report = nullptr);
+}
+}
+
+#endif
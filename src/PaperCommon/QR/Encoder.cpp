@@ -0,0 +1,650 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Encoder.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "PaperCommon/QR/Layout.h"
+#include "PaperCommon/QR/ReedSolomon.h"
+#include "PaperCommon/Util/Bits.h"
+
+namespace
+{
+// The weights of each of the mask penalty rules.
+constexpr std::size_t PENALTY_RUN = 3;
+constexpr std::size_t PENALTY_BLOCK = 3;
+constexpr std::size_t PENALTY_FINDER = 40;
+constexpr std::size_t PENALTY_BALANCE = 10;
+
+constexpr std::size_t MASK_COUNT = 8;
+
+// Every mask pattern repeats itself every 12 rows.
+constexpr std::size_t MASK_PERIOD = 12;
+
+// The widest QR code (version 40) is 177 modules wide, or 3 words.
+constexpr std::size_t MAX_STRIDE = 3;
+
+/**
+ * \brief A finder-like pattern (dark, light, 3 dark, light, dark) preceded
+ * by four light modules, as a bitmask whose bit k is the k'th module.
+ */
+constexpr unsigned int FINDER_BEFORE = 0x5D0;
+
+/**
+ * \brief A finder-like pattern followed by four light modules, as a bitmask
+ * whose bit k is the k'th module.
+ */
+constexpr unsigned int FINDER_AFTER = 0x05D;
+
+// The number of modules in the finder-like patterns above.
+constexpr unsigned int FINDER_LENGTH = 11;
+
+/**
+ * This function draws the given format information into both of its
+ * locations in the given matrix, along with the module beside it which is
+ * always dark.
+ *
+ * \param modules The matrix to draw into.
+ * \param bits The format information bits to draw.
+ */
+void drawFormatBits(paper::qr::ModuleMatrix &modules, unsigned int bits)
+{
+	std::size_t w = modules.getWidth();
+	auto bit = [bits](std::size_t i)
+	{
+		return ((bits >> i) & 1) != 0;
+	};
+
+	// The first copy wraps around the top-left finder pattern.
+	for(std::size_t i = 0; i < 6; ++i)
+		modules.set(8, i, bit(i));
+	modules.set(8, 7, bit(6));
+	modules.set(8, 8, bit(7));
+	modules.set(7, 8, bit(8));
+	for(std::size_t i = 9; i < 15; ++i)
+		modules.set(14 - i, 8, bit(i));
+
+	// The second copy is split between the other two finder patterns.
+	for(std::size_t i = 0; i < 8; ++i)
+		modules.set(w - 1 - i, 8, bit(i));
+	for(std::size_t i = 8; i < 15; ++i)
+		modules.set(8, w - 15 + i, bit(i));
+
+	modules.set(8, w - 8, true);
+}
+
+/**
+ * \brief This structure holds each mask pattern as rows of bits, so masks
+ * can be applied a word at a time.
+ */
+struct MaskPatterns
+{
+	// For each mask, the pattern of each row modulo MASK_PERIOD.
+	uint64_t rows[MASK_COUNT][MASK_PERIOD][MAX_STRIDE];
+
+	MaskPatterns();
+};
+
+MaskPatterns::MaskPatterns() : rows()
+{
+	for(std::size_t mask = 0; mask < MASK_COUNT; ++mask)
+	{
+		for(std::size_t y = 0; y < MASK_PERIOD; ++y)
+		{
+			for(std::size_t x = 0; x < MAX_STRIDE * 64; ++x)
+			{
+				uint64_t bit = UINT64_C(1) << (x % 64);
+				if(paper::qr::isMasked(mask, x, y))
+					rows[mask][y][x / 64] |= bit;
+			}
+		}
+	}
+}
+
+/**
+ * This function returns the 64 bits of the given line starting at bit k of
+ * word i. The line must have at least one word after word i.
+ *
+ * \param line The line to read from.
+ * \param i The word to start at.
+ * \param k The bit within that word to start at.
+ * \return The bits starting at the given position.
+ */
+inline uint64_t getWindow(const uint64_t *line, std::size_t i, unsigned int k)
+{
+	if(k == 0)
+		return line[i];
+	return (line[i] >> k) | (line[i + 1] << (64 - k));
+}
+
+/**
+ * This function returns a mask of the bits in word i which are for
+ * positions before the given limit.
+ *
+ * \param i The word to return a mask for.
+ * \param limit The first position to exclude.
+ * \return The mask of included bits.
+ */
+inline uint64_t getValidMask(std::size_t i, std::size_t limit)
+{
+	if(limit <= i * 64)
+		return 0;
+	if(limit - i * 64 >= 64)
+		return ~UINT64_C(0);
+	return (UINT64_C(1) << (limit - i * 64)) - 1;
+}
+
+/**
+ * \brief This structure holds a QR code while it is being built.
+ */
+struct Symbol
+{
+	// The modules themselves, before any mask is applied.
+	paper::qr::ModuleMatrix modules;
+
+	// Which modules belong to function patterns or format information.
+	paper::qr::ModuleMatrix function;
+
+	// Which modules hold data, and so are subject to masking.
+	paper::qr::ModuleMatrix data;
+
+	Symbol(std::size_t w);
+
+	/**
+	 * This function sets the color of a module which is part of a
+	 * function pattern.
+	 *
+	 * \param x The column of the module.
+	 * \param y The row of the module.
+	 * \param dark Whether the module should be dark.
+	 */
+	void setFunction(std::size_t x, std::size_t y, bool dark)
+	{
+		modules.set(x, y, dark);
+		function.set(x, y, true);
+	}
+};
+
+Symbol::Symbol(std::size_t w) : modules(w), function(w), data(w)
+{
+}
+
+/**
+ * This function draws a finder pattern (and the separator around it,
+ * where it is inside the symbol) centered on the given module.
+ *
+ * \param symbol The symbol to draw into.
+ * \param cx The column of the pattern's center.
+ * \param cy The row of the pattern's center.
+ */
+void drawFinder(Symbol &symbol, long cx, long cy)
+{
+	long w = static_cast<long>(symbol.modules.getWidth());
+	for(long dy = -4; dy <= 4; ++dy)
+	{
+		for(long dx = -4; dx <= 4; ++dx)
+		{
+			long x = cx + dx;
+			long y = cy + dy;
+			if((x < 0) || (x >= w) || (y < 0) || (y >= w))
+				continue;
+
+			long distance = std::max(std::labs(dx), std::labs(dy));
+			symbol.setFunction(static_cast<std::size_t>(x),
+			                   static_cast<std::size_t>(y),
+			                   (distance != 2) && (distance != 4));
+		}
+	}
+}
+
+/**
+ * This function draws an alignment pattern centered on the given module.
+ *
+ * \param symbol The symbol to draw into.
+ * \param cx The column of the pattern's center.
+ * \param cy The row of the pattern's center.
+ */
+void drawAlignment(Symbol &symbol, std::size_t cx, std::size_t cy)
+{
+	for(long dy = -2; dy <= 2; ++dy)
+	{
+		for(long dx = -2; dx <= 2; ++dx)
+		{
+			symbol.setFunction(
+			        cx + static_cast<std::size_t>(dx),
+			        cy + static_cast<std::size_t>(dy),
+			        std::max(std::labs(dx), std::labs(dy)) != 1);
+		}
+	}
+}
+
+/**
+ * This function draws the version information blocks, for versions which
+ * have them.
+ *
+ * \param symbol The symbol to draw into.
+ * \param version The QR code version.
+ */
+void drawVersion(Symbol &symbol, int version)
+{
+	if(version < 7)
+		return;
+
+	unsigned int bits = paper::qr::getVersionBits(version);
+
+	std::size_t w = symbol.modules.getWidth();
+	for(std::size_t i = 0; i < 18; ++i)
+	{
+		bool dark = ((bits >> i) & 1) != 0;
+		std::size_t a = w - 11 + i % 3;
+		std::size_t b = i / 3;
+		symbol.setFunction(a, b, dark);
+		symbol.setFunction(b, a, dark);
+	}
+}
+
+/**
+ * This function creates a new symbol of the given version, containing all
+ * of its function patterns. The format information areas are reserved, but
+ * not drawn, since they depend on the mask.
+ *
+ * \param version The QR code version.
+ * \return The new symbol.
+ */
+Symbol drawFunctionPatterns(int version)
+{
+	std::size_t w = paper::qr::getSymbolWidth(version);
+	Symbol symbol(w);
+
+	for(std::size_t i = 0; i < w; ++i)
+	{
+		symbol.setFunction(6, i, i % 2 == 0);
+		symbol.setFunction(i, 6, i % 2 == 0);
+	}
+
+	long far = static_cast<long>(w) - 4;
+	drawFinder(symbol, 3, 3);
+	drawFinder(symbol, far, 3);
+	drawFinder(symbol, 3, far);
+
+	// Alignment patterns go on a grid, except where they would overlap
+	// the finder patterns.
+	std::vector<std::size_t> positions(
+	        paper::qr::getAlignmentPositions(version));
+	std::size_t last = positions.size() - 1;
+	for(std::size_t i = 0; i < positions.size(); ++i)
+	{
+		for(std::size_t j = 0; j < positions.size(); ++j)
+		{
+			// Skip the three corners with finder patterns.
+			bool first = (i == 0) || (j == 0);
+			bool corner = ((i == 0) || (i == last)) &&
+			              ((j == 0) || (j == last));
+			if(first && corner)
+				continue;
+			drawAlignment(symbol, positions[i], positions[j]);
+		}
+	}
+
+	drawFormatBits(symbol.function, 0x7FFF);
+	drawVersion(symbol, version);
+
+	for(std::size_t y = 0; y < w; ++y)
+	{
+		const uint64_t *function = symbol.function.getRow(y);
+		uint64_t *data = symbol.data.getRow(y);
+		for(std::size_t i = 0; i < symbol.data.getStride(); ++i)
+			data[i] = getValidMask(i, w) & ~function[i];
+	}
+
+	return symbol;
+}
+
+/**
+ * This function builds the data codewords for the given data: the byte mode
+ * header, the data itself, the terminator, and then padding.
+ *
+ * \param data The data to encode.
+ * \param size The size of the data to encode.
+ * \param version The QR code version.
+ * \param level The error correction level.
+ * \return The data codewords.
+ */
+std::vector<uint8_t> getDataCodewords(const uint8_t *data, std::size_t size,
+                                      int version,
+                                      paper::qr::QRCode::ErrorCorrection level)
+{
+	std::size_t capacity = paper::qr::getDataCodewordCount(version, level);
+	unsigned int countBits = version < 10 ? 8 : 16;
+	if(((size >> countBits) != 0) ||
+	   (4 + countBits + size * 8 > capacity * 8))
+	{
+		throw std::runtime_error("Too much data for one QR code.");
+	}
+
+	std::vector<uint8_t> codewords(capacity);
+	std::size_t position = 0;
+
+	// The header (the byte mode indicator, 0100, and the data length) is
+	// always a whole number of bytes plus one nibble, so every data byte
+	// is split across two codewords.
+	unsigned int headerBits = 4 + countBits;
+	uint32_t header =
+	        (UINT32_C(4) << countBits) | static_cast<uint32_t>(size);
+	for(unsigned int i = headerBits / 8; i > 0; --i)
+	{
+		codewords[position++] =
+		        static_cast<uint8_t>(header >> (i * 8 - 4));
+	}
+
+	uint8_t nibble = header & 0x0F;
+	for(std::size_t i = 0; i < size; ++i)
+	{
+		codewords[position++] =
+		        static_cast<uint8_t>((nibble << 4) | (data[i] >> 4));
+		nibble = data[i] & 0x0F;
+	}
+
+	// The last nibble is followed by the four bit terminator, which fills
+	// the rest of its codeword.
+	codewords[position++] = static_cast<uint8_t>(nibble << 4);
+
+	for(bool odd = false; position < capacity; odd = !odd)
+		codewords[position++] = odd ? 0x11 : 0xEC;
+
+	return codewords;
+}
+
+/**
+ * This function splits the given data codewords into blocks, computes each
+ * block's error correction codewords, and interleaves the blocks in the
+ * order they are placed in the symbol.
+ *
+ * \param data The data codewords.
+ * \param version The QR code version.
+ * \param level The error correction level.
+ * \return All of the symbol's codewords, in placement order.
+ */
+std::vector<uint8_t>
+addErrorCorrection(const std::vector<uint8_t> &data, int version,
+                   paper::qr::QRCode::ErrorCorrection level)
+{
+	std::size_t blockCount = paper::qr::getBlockCount(version, level);
+	std::size_t parity = paper::qr::getBlockParityCount(version, level);
+
+	// When the codewords don't divide evenly, the last few blocks each
+	// have one extra data codeword.
+	std::size_t total = paper::qr::getCodewordCount(version);
+	std::size_t shortBlocks = blockCount - total % blockCount;
+	std::size_t shortSize = total / blockCount - parity;
+
+	// The first data codeword of each block comes first, then the
+	// second, and so on; the long blocks' extra data codewords come
+	// after the rest of the data, and then the parity codewords are
+	// interleaved in the same way.
+	std::vector<uint8_t> codewords(total);
+	uint8_t blockParity[paper::qr::MAX_PARITY_SIZE];
+	std::size_t offset = 0;
+	for(std::size_t block = 0; block < blockCount; ++block)
+	{
+		std::size_t size = shortSize + (block < shortBlocks ? 0 : 1);
+		const uint8_t *blockData = data.data() + offset;
+		paper::qr::computeParity(blockData, size, blockParity, parity);
+
+		for(std::size_t i = 0; i < shortSize; ++i)
+			codewords[i * blockCount + block] = blockData[i];
+		if(size > shortSize)
+		{
+			std::size_t extra = block - shortBlocks;
+			codewords[shortSize * blockCount + extra] =
+			        blockData[shortSize];
+		}
+
+		for(std::size_t i = 0; i < parity; ++i)
+		{
+			codewords[data.size() + i * blockCount + block] =
+			        blockParity[i];
+		}
+
+		offset += size;
+	}
+
+	return codewords;
+}
+
+/**
+ * This function places the given codewords into the symbol's data modules
+ * (see qr::forEachCodewordModule).
+ *
+ * \param symbol The symbol to draw into.
+ * \param codewords The codewords to place.
+ */
+void drawCodewords(Symbol &symbol, const std::vector<uint8_t> &codewords)
+{
+	std::size_t bit = 0;
+	std::size_t bitCount = codewords.size() * 8;
+	paper::qr::forEachCodewordModule(
+	        symbol.function, [&](std::size_t x, std::size_t y)
+	        {
+		        if(bit >= bitCount)
+			        return;
+
+		        uint8_t codeword = codewords[bit / 8];
+		        symbol.modules.set(x, y, (codeword << (bit % 8)) & 0x80);
+		        ++bit;
+		});
+}
+
+/**
+ * This function applies the given mask pattern to the data modules of the
+ * given matrix.
+ *
+ * \param modules The matrix to mask.
+ * \param data Which modules hold data.
+ * \param mask The mask pattern to apply.
+ */
+void applyMask(paper::qr::ModuleMatrix &modules,
+               const paper::qr::ModuleMatrix &data, std::size_t mask)
+{
+	static const MaskPatterns patterns;
+
+	for(std::size_t y = 0; y < modules.getWidth(); ++y)
+	{
+		uint64_t *row = modules.getRow(y);
+		const uint64_t *dataRow = data.getRow(y);
+		const uint64_t *pattern = patterns.rows[mask][y % MASK_PERIOD];
+		for(std::size_t i = 0; i < modules.getStride(); ++i)
+			row[i] ^= pattern[i] & dataRow[i];
+	}
+}
+
+/**
+ * This function computes the penalty for runs of five or more modules of
+ * the same color, and for finder-like patterns, in one row (or column).
+ * Every position is checked at once, 64 at a time, by comparing shifted
+ * copies of the line.
+ *
+ * \param row The line to score.
+ * \param width The length of the line, in modules.
+ * \return The penalty for the line.
+ */
+std::size_t getLinePenalty(const uint64_t *row, std::size_t width)
+{
+	// Copy the line with a spare zero word after it, so windows can run off
+	// its end. The second copy is offset by four light modules, which
+	// stand in for the quiet zone around finder-like patterns at the
+	// edges.
+	std::size_t words = (width + 63) / 64;
+	uint64_t line[MAX_STRIDE + 2] = {0};
+	uint64_t padded[MAX_STRIDE + 2] = {0};
+	for(std::size_t i = 0; i < words; ++i)
+	{
+		line[i] = row[i];
+		padded[i] |= row[i] << 4;
+		padded[i + 1] |= row[i] >> 60;
+	}
+
+	std::size_t penalty = 0;
+
+	// A run of n >= 5 modules scores 3 + (n - 5). Each run contains
+	// n - 4 positions which begin five modules of the same color, and
+	// one position which begins the run itself.
+	uint64_t previous = 0;
+	for(std::size_t i = 0; i < words; ++i)
+	{
+		uint64_t runs = getValidMask(i, width - 4);
+		for(unsigned int k = 0; k < 4; ++k)
+		{
+			runs &= ~(getWindow(line, i, k) ^
+			          getWindow(line, i, k + 1));
+		}
+
+		uint64_t starts = runs & ~((runs << 1) | previous);
+		previous = runs >> 63;
+
+		penalty += paper::util::popcount(runs) +
+		           (PENALTY_RUN - 1) * paper::util::popcount(starts);
+	}
+
+	std::size_t paddedWords = (width + 8 + 63) / 64;
+	for(std::size_t i = 0; i < paddedWords; ++i)
+	{
+		uint64_t before =
+		        getValidMask(i, width + 8 - FINDER_LENGTH + 1);
+		uint64_t after = before;
+		for(unsigned int k = 0; k < FINDER_LENGTH; ++k)
+		{
+			uint64_t bits = getWindow(padded, i, k);
+			before &= ((FINDER_BEFORE >> k) & 1) ? bits : ~bits;
+			after &= ((FINDER_AFTER >> k) & 1) ? bits : ~bits;
+		}
+
+		penalty += PENALTY_FINDER * (paper::util::popcount(before) +
+		                             paper::util::popcount(after));
+	}
+
+	return penalty;
+}
+
+/**
+ * This function computes the penalty score for the given (masked) symbol,
+ * as defined by the QR code specification. Lower scores are better.
+ *
+ * \param modules The symbol to score.
+ * \return The symbol's penalty score.
+ */
+std::size_t getPenalty(const paper::qr::ModuleMatrix &modules)
+{
+	std::size_t w = modules.getWidth();
+	std::size_t words = modules.getStride();
+	std::size_t penalty = 0;
+
+	// Columns are scored the same way as rows, by transposing them.
+	paper::qr::ModuleMatrix columns(modules.getTransposed());
+	for(std::size_t y = 0; y < w; ++y)
+	{
+		penalty += getLinePenalty(modules.getRow(y), w);
+		penalty += getLinePenalty(columns.getRow(y), w);
+	}
+
+	// Each 2x2 block of the same color scores 3.
+	uint64_t top[MAX_STRIDE + 1] = {0};
+	uint64_t bottom[MAX_STRIDE + 1] = {0};
+	for(std::size_t y = 0; y + 1 < w; ++y)
+	{
+		std::copy(modules.getRow(y), modules.getRow(y) + words, top);
+		std::copy(modules.getRow(y + 1), modules.getRow(y + 1) + words,
+		          bottom);
+
+		for(std::size_t i = 0; i < words; ++i)
+		{
+			uint64_t a = getWindow(top, i, 0);
+			uint64_t same = ~(a ^ getWindow(top, i, 1)) &
+			                ~(a ^ getWindow(bottom, i, 0)) &
+			                ~(a ^ getWindow(bottom, i, 1)) &
+			                getValidMask(i, w - 1);
+			penalty += PENALTY_BLOCK * paper::util::popcount(same);
+		}
+	}
+
+	// Every 5% the proportion of dark modules strays from 50% (after the
+	// first) scores 10.
+	std::size_t dark = modules.getDarkCount();
+	std::size_t total = w * w;
+	std::size_t deviation =
+	        dark * 20 > total * 10 ? dark * 20 - total * 10
+	                               : total * 10 - dark * 20;
+	if(deviation > 0)
+	{
+		std::size_t steps = (deviation + total - 1) / total - 1;
+		penalty += PENALTY_BALANCE * steps;
+	}
+
+	return penalty;
+}
+}
+
+namespace paper
+{
+namespace qr
+{
+std::size_t getDataCodewordCount(int version,
+                                 QRCode::ErrorCorrection errorCorrection)
+{
+	return getCodewordCount(version) -
+	       getBlockParityCount(version, errorCorrection) *
+	               getBlockCount(version, errorCorrection);
+}
+
+ModuleMatrix encodeSymbol(const uint8_t *data, std::size_t size, int version,
+                          QRCode::ErrorCorrection errorCorrection)
+{
+	std::vector<uint8_t> codewords(addErrorCorrection(
+	        getDataCodewords(data, size, version, errorCorrection), version,
+	        errorCorrection));
+
+	Symbol symbol(drawFunctionPatterns(version));
+	drawCodewords(symbol, codewords);
+
+	// Try each mask in turn, and keep whichever scores best.
+	ModuleMatrix best;
+	std::size_t bestPenalty = SIZE_MAX;
+	for(std::size_t mask = 0; mask < MASK_COUNT; ++mask)
+	{
+		ModuleMatrix candidate(symbol.modules);
+		applyMask(candidate, symbol.data, mask);
+		drawFormatBits(candidate, getFormatBits(errorCorrection, mask));
+
+		std::size_t penalty = getPenalty(candidate);
+		if(penalty < bestPenalty)
+		{
+			best = std::move(candidate);
+			bestPenalty = penalty;
+		}
+	}
+
+	return best;
+}
+}
+}
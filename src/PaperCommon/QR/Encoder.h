@@ -0,0 +1,63 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_QR_ENCODER_H
+#define PAPER_QR_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "PaperCommon/QR/ModuleMatrix.h"
+#include "PaperCommon/QR/QRCode.h"
+
+namespace paper
+{
+namespace qr
+{
+/**
+ * This function returns the number of data codewords (i.e., bytes available
+ * for the mode header, payload and padding) a QR code of the given version
+ * and error correction level holds.
+ *
+ * \param version The QR code version.
+ * \param errorCorrection The error correction level.
+ * \return The number of data codewords in the specified QR code.
+ */
+std::size_t getDataCodewordCount(int version,
+                                 QRCode::ErrorCorrection errorCorrection);
+
+/**
+ * This function encodes the given data as a single byte mode QR code of the
+ * given version and error correction level. All eight mask patterns are
+ * tried, and the one with the lowest penalty score is used.
+ *
+ * If the data doesn't fit in the requested QR code, an exception is thrown.
+ *
+ * \param data The data to encode.
+ * \param size The size of the data to encode.
+ * \param version The QR code version to produce.
+ * \param errorCorrection The error correction level to use.
+ * \return The QR code's modules.
+ */
+ModuleMatrix encodeSymbol(const uint8_t *data, std::size_t size, int version,
+                          QRCode::ErrorCorrection errorCorrection);
+}
+}
+
+#endif
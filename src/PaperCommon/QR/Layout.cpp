@@ -0,0 +1,255 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Layout.h"
+
+#include <stdexcept>
+
+namespace
+{
+/**
+ * \brief The number of error correction codewords in each block, indexed by
+ * error correction level and then by version.
+ */
+const uint8_t PARITY_PER_BLOCK[4][41] = {
+        {0,  7,  10, 15, 20, 26, 18, 20, 24, 30, 18, 20, 24, 26,
+         30, 22, 24, 28, 30, 28, 28, 28, 28, 30, 30, 26, 28, 30,
+         30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30},
+        {0,  10, 16, 26, 18, 24, 16, 18, 22, 22, 26, 30, 22, 22,
+         24, 24, 28, 28, 26, 26, 26, 26, 28, 28, 28, 28, 28, 28,
+         28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28},
+        {0,  13, 22, 18, 26, 18, 24, 18, 22, 20, 24, 28, 26, 24,
+         20, 30, 24, 28, 28, 26, 30, 28, 30, 30, 30, 30, 28, 30,
+         30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30},
+        {0,  17, 28, 22, 16, 22, 28, 26, 26, 24, 28, 24, 28, 22,
+         24, 24, 30, 28, 28, 26, 28, 30, 24, 30, 30, 30, 30, 30,
+         30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30}};
+
+/**
+ * \brief The number of error correction blocks the codewords are split
+ * into, indexed by error correction level and then by version.
+ */
+const uint8_t BLOCK_COUNT[4][41] = {
+        {0,  1,  1,  1,  1,  1,  2,  2,  2,  2,  4,  4,  4,  4,
+         4,  6,  6,  6,  6,  7,  8,  8,  9,  9,  10, 12, 12, 12,
+         13, 14, 15, 16, 17, 18, 19, 19, 20, 21, 22, 24, 25},
+        {0,  1,  1,  1,  2,  2,  4,  4,  4,  5,  5,  5,  8,  9,
+         9,  10, 10, 11, 13, 14, 16, 17, 17, 18, 20, 21, 23, 25,
+         26, 28, 29, 31, 33, 35, 37, 38, 40, 43, 45, 47, 49},
+        {0,  1,  1,  2,  2,  4,  4,  6,  6,  8,  8,  8,  10, 12,
+         16, 12, 17, 16, 18, 21, 20, 23, 23, 25, 27, 29, 34, 34,
+         35, 38, 40, 43, 45, 48, 51, 53, 56, 59, 62, 65, 68},
+        {0,  1,  1,  2,  4,  4,  4,  5,  6,  8,  8,  11, 11, 16,
+         16, 18, 16, 19, 21, 25, 25, 25, 34, 30, 32, 35, 37, 40,
+         42, 45, 48, 51, 54, 57, 60, 63, 66, 70, 74, 77, 81}};
+
+/**
+ * \brief The two bit value each error correction level is recorded as in a
+ * QR code's format information.
+ */
+const unsigned int FORMAT_LEVEL_BITS[4] = {1, 0, 3, 2};
+
+/**
+ * \param level The error correction level.
+ * \return The index of the given level in our tables.
+ */
+std::size_t getLevelIndex(paper::qr::QRCode::ErrorCorrection level)
+{
+	return static_cast<std::size_t>(level);
+}
+
+/**
+ * This function throws an exception if the given version is invalid.
+ *
+ * \param version The QR code version.
+ */
+void checkVersion(int version)
+{
+	if((version < 1) || (version > 40))
+		throw std::runtime_error("Invalid QR code version.");
+}
+
+/**
+ * This function marks every module in the given rectangle as reserved.
+ *
+ * \param function The matrix of reserved modules.
+ * \param x The first column of the rectangle.
+ * \param y The first row of the rectangle.
+ * \param w The width of the rectangle.
+ * \param h The height of the rectangle.
+ */
+void reserve(paper::qr::ModuleMatrix &function, std::size_t x, std::size_t y,
+             std::size_t w, std::size_t h)
+{
+	for(std::size_t j = y; j < y + h; ++j)
+	{
+		for(std::size_t i = x; i < x + w; ++i)
+			function.set(i, j, true);
+	}
+}
+}
+
+namespace paper
+{
+namespace qr
+{
+std::size_t getSymbolWidth(int version)
+{
+	checkVersion(version);
+	return static_cast<std::size_t>(version) * 4 + 17;
+}
+
+std::size_t getCodewordCount(int version)
+{
+	checkVersion(version);
+	std::size_t v = static_cast<std::size_t>(version);
+
+	// Start with the whole symbol, less the finder patterns, timing
+	// patterns and format information, and then subtract the alignment
+	// patterns (less their overlap with the timing patterns) and the
+	// version information if present.
+	std::size_t count = (16 * v + 128) * v + 64;
+	if(v >= 2)
+	{
+		std::size_t alignCount = v / 7 + 2;
+		count -= (25 * alignCount - 10) * alignCount - 55;
+		if(v >= 7)
+			count -= 36;
+	}
+	return count / 8;
+}
+
+std::size_t getBlockCount(int version, QRCode::ErrorCorrection level)
+{
+	checkVersion(version);
+	return BLOCK_COUNT[getLevelIndex(level)][version];
+}
+
+std::size_t getBlockParityCount(int version, QRCode::ErrorCorrection level)
+{
+	checkVersion(version);
+	return PARITY_PER_BLOCK[getLevelIndex(level)][version];
+}
+
+std::vector<std::size_t> getAlignmentPositions(int version)
+{
+	checkVersion(version);
+	if(version == 1)
+		return std::vector<std::size_t>();
+
+	std::size_t v = static_cast<std::size_t>(version);
+	std::size_t count = v / 7 + 2;
+	std::size_t step = (v * 8 + count * 3 + 5) / (count * 4 - 4) * 2;
+
+	// The first pattern is always at 6, and the rest are evenly spaced
+	// (from the far edge) after it.
+	std::size_t last = getSymbolWidth(version) - 7;
+	std::vector<std::size_t> positions(count, 6);
+	for(std::size_t i = 1; i < count; ++i)
+		positions[i] = last - (count - 1 - i) * step;
+	return positions;
+}
+
+unsigned int getFormatBits(QRCode::ErrorCorrection level, std::size_t mask)
+{
+	unsigned int data = (FORMAT_LEVEL_BITS[getLevelIndex(level)] << 3) |
+	                    static_cast<unsigned int>(mask);
+
+	unsigned int remainder = data;
+	for(int i = 0; i < 10; ++i)
+		remainder = (remainder << 1) ^ ((remainder >> 9) * 0x537);
+
+	return ((data << 10) | remainder) ^ 0x5412;
+}
+
+unsigned int getVersionBits(int version)
+{
+	checkVersion(version);
+	unsigned int remainder = static_cast<unsigned int>(version);
+	for(int i = 0; i < 12; ++i)
+		remainder = (remainder << 1) ^ ((remainder >> 11) * 0x1F25);
+	return (static_cast<unsigned int>(version) << 12) | remainder;
+}
+
+bool isMasked(std::size_t mask, std::size_t x, std::size_t y)
+{
+	switch(mask)
+	{
+	case 0:
+		return (x + y) % 2 == 0;
+	case 1:
+		return y % 2 == 0;
+	case 2:
+		return x % 3 == 0;
+	case 3:
+		return (x + y) % 3 == 0;
+	case 4:
+		return (x / 3 + y / 2) % 2 == 0;
+	case 5:
+		return x * y % 2 + x * y % 3 == 0;
+	case 6:
+		return (x * y % 2 + x * y % 3) % 2 == 0;
+	case 7:
+		return ((x + y) % 2 + x * y % 3) % 2 == 0;
+	default:
+		throw std::runtime_error("Invalid QR code mask pattern.");
+	}
+}
+
+ModuleMatrix getFunctionModules(int version)
+{
+	std::size_t w = getSymbolWidth(version);
+	ModuleMatrix function(w);
+
+	// The finder patterns, their separators and the format information
+	// fill a 9x9 square in the top-left corner, and 8x9 rectangles in the
+	// other two (the bottom-left one including the always dark module).
+	reserve(function, 0, 0, 9, 9);
+	reserve(function, w - 8, 0, 8, 9);
+	reserve(function, 0, w - 8, 9, 8);
+
+	reserve(function, 6, 0, 1, w);
+	reserve(function, 0, 6, w, 1);
+
+	std::vector<std::size_t> positions(getAlignmentPositions(version));
+	std::size_t last = positions.size() - 1;
+	for(std::size_t i = 0; i < positions.size(); ++i)
+	{
+		for(std::size_t j = 0; j < positions.size(); ++j)
+		{
+			// Skip the three corners with finder patterns.
+			bool first = (i == 0) || (j == 0);
+			bool corner = ((i == 0) || (i == last)) &&
+			              ((j == 0) || (j == last));
+			if(first && corner)
+				continue;
+			reserve(function, positions[i] - 2, positions[j] - 2, 5,
+			        5);
+		}
+	}
+
+	if(version >= 7)
+	{
+		reserve(function, w - 11, 0, 3, 6);
+		reserve(function, 0, w - 11, 6, 3);
+	}
+
+	return function;
+}
+}
+}
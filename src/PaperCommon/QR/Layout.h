@@ -0,0 +1,149 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAPER_QR_LAYOUT_H
+#define PAPER_QR_LAYOUT_H
+
+#include <cstddef>
+#include <vector>
+
+#include "PaperCommon/QR/ModuleMatrix.h"
+#include "PaperCommon/QR/QRCode.h"
+
+namespace paper
+{
+namespace qr
+{
+/**
+ * \param version The QR code version.
+ * \return The width (and height) of a QR code of the given version, in
+ * modules.
+ */
+std::size_t getSymbolWidth(int version);
+
+/**
+ * This function returns the total number of codewords (data and error
+ * correction) a QR code of the given version holds. Any leftover remainder
+ * bits are not counted.
+ *
+ * \param version The QR code version.
+ * \return The number of codewords.
+ */
+std::size_t getCodewordCount(int version);
+
+/**
+ * \param version The QR code version.
+ * \param level The error correction level.
+ * \return The number of blocks the codewords are split into.
+ */
+std::size_t getBlockCount(int version, QRCode::ErrorCorrection level);
+
+/**
+ * \param version The QR code version.
+ * \param level The error correction level.
+ * \return The number of error correction codewords in each block.
+ */
+std::size_t getBlockParityCount(int version, QRCode::ErrorCorrection level);
+
+/**
+ * This function returns the row (and column) coordinates of the centers of
+ * the given version's alignment patterns.
+ *
+ * \param version The QR code version.
+ * \return The alignment pattern coordinates, in increasing order.
+ */
+std::vector<std::size_t> getAlignmentPositions(int version);
+
+/**
+ * This function returns the 15-bit format information for the given error
+ * correction level and mask, including its BCH error correction bits.
+ *
+ * \param level The error correction level.
+ * \param mask The mask pattern.
+ * \return The format information bits.
+ */
+unsigned int getFormatBits(QRCode::ErrorCorrection level, std::size_t mask);
+
+/**
+ * This function returns the 18-bit version information for the given
+ * version, including its BCH error correction bits. Only versions 7 and up
+ * record their version information.
+ *
+ * \param version The QR code version.
+ * \return The version information bits.
+ */
+unsigned int getVersionBits(int version);
+
+/**
+ * This function returns whether the given mask pattern inverts the module
+ * at the given position.
+ *
+ * \param mask The mask pattern.
+ * \param x The column of the module.
+ * \param y The row of the module.
+ * \return Whether the module is inverted.
+ */
+bool isMasked(std::size_t mask, std::size_t x, std::size_t y);
+
+/**
+ * This function returns which modules of a QR code of the given version are
+ * reserved for function patterns, format information or version
+ * information, i.e. which modules don't hold codewords.
+ *
+ * \param version The QR code version.
+ * \return The matrix of reserved modules.
+ */
+ModuleMatrix getFunctionModules(int version);
+
+/**
+ * This function calls the given function with the position of each module
+ * which holds codeword bits, in the order the bits are placed: two-module
+ * wide columns, right to left, zigzagging up and down, and skipping over any
+ * function modules. The first bit placed is the most significant bit of the
+ * first codeword.
+ *
+ * \param function Which modules are reserved (see getFunctionModules).
+ * \param fn The function to call with each module's column and row.
+ */
+template <typename F>
+void forEachCodewordModule(const ModuleMatrix &function, F fn)
+{
+	std::size_t w = function.getWidth();
+	for(std::size_t pair = 0; pair < (w - 1) / 2; ++pair)
+	{
+		// Column pairs left of the vertical timing pattern are shifted
+		// one further left, to skip over it.
+		std::size_t right = w - 1 - pair * 2;
+		if(right <= 6)
+			--right;
+
+		bool upward = ((right + 1) & 2) == 0;
+		for(std::size_t vertical = 0; vertical < w; ++vertical)
+		{
+			std::size_t y = upward ? w - 1 - vertical : vertical;
+			if(!function.get(right, y))
+				fn(right, y);
+			if(!function.get(right - 1, y))
+				fn(right - 1, y);
+		}
+	}
+}
+}
+}
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ModuleMatrix.h"
+
+#include "PaperCommon/Util/Bits.h"
+
+namespace
+{
+/**
+ * This function transposes a 64x64 block of bits in place, where bit c of
+ * word r is the bit in row r and column c. Each pass swaps the top-right and
+ * bottom-left quadrants of progressively smaller sub-blocks.
+ *
+ * \param block The 64 words of the block to transpose.
+ */
+void transpose64(uint64_t *block)
+{
+	uint64_t mask = UINT64_C(0x00000000FFFFFFFF);
+	for(unsigned int j = 32; j != 0; j >>= 1, mask ^= mask << j)
+	{
+		for(unsigned int k = 0; k < 64; k = ((k | j) + 1) & ~j)
+		{
+			uint64_t t = ((block[k] >> j) ^ block[k | j]) & mask;
+			block[k | j] ^= t;
+			block[k] ^= t << j;
+		}
+	}
+}
+}
+
+namespace paper
+{
+namespace qr
+{
+ModuleMatrix::ModuleMatrix(std::size_t w)
+        : width(w), height(w), stride((w + 63) / 64), words(w * stride, 0)
+{
+}
+
+ModuleMatrix::ModuleMatrix(std::size_t w, std::size_t h)
+        : width(w), height(h), stride((w + 63) / 64), words(h * stride, 0)
+{
+}
+
+std::size_t ModuleMatrix::getWidth() const
+{
+	return width;
+}
+
+std::size_t ModuleMatrix::getHeight() const
+{
+	return height;
+}
+
+std::size_t ModuleMatrix::getStride() const
+{
+	return stride;
+}
+
+const uint64_t *ModuleMatrix::getRow(std::size_t y) const
+{
+	return words.data() + y * stride;
+}
+
+uint64_t *ModuleMatrix::getRow(std::size_t y)
+{
+	return words.data() + y * stride;
+}
+
+std::size_t ModuleMatrix::find(std::size_t y, std::size_t x, bool dark) const
+{
+	const uint64_t *row = getRow(y);
+	const uint64_t invert = dark ? 0 : ~UINT64_C(0);
+
+	// Mask off the bits before x in the first word, then skip any words
+	// with no modules of the right color. When searching for light
+	// modules, the zero padding past the end of the row stops the search.
+	for(std::size_t i = x / 64; i < stride; ++i)
+	{
+		uint64_t word = row[i] ^ invert;
+		if(i == x / 64)
+			word &= ~UINT64_C(0) << (x % 64);
+		if(word != 0)
+		{
+			std::size_t found =
+			        i * 64 + paper::util::countTrailingZeros(word);
+			return found < width ? found : width;
+		}
+	}
+
+	return width;
+}
+
+ModuleMatrix ModuleMatrix::getTransposed() const
+{
+	ModuleMatrix result(height, width);
+
+	// Transpose one 64x64 block at a time. Rows past the end of the matrix
+	// are treated as being all light.
+	uint64_t block[64];
+	for(std::size_t by = 0; by < result.stride; ++by)
+	{
+		for(std::size_t bx = 0; bx < stride; ++bx)
+		{
+			for(std::size_t r = 0; r < 64; ++r)
+			{
+				std::size_t y = by * 64 + r;
+				block[r] = 0;
+				if(y < height)
+					block[r] = words[y * stride + bx];
+			}
+
+			transpose64(block);
+
+			for(std::size_t r = 0; r < 64; ++r)
+			{
+				std::size_t y = bx * 64 + r;
+				if(y < width)
+					result.getRow(y)[by] = block[r];
+			}
+		}
+	}
+
+	return result;
+}
+
+std::size_t ModuleMatrix::getDarkCount() const
+{
+	std::size_t count = 0;
+	for(uint64_t word : words)
+		count += paper::util::popcount(word);
+	return count;
+}
+
+bool ModuleMatrix::operator==(const ModuleMatrix &o) const
+{
+	return (width == o.width) && (height == o.height) &&
+	       (words == o.words);
+}
+
+bool ModuleMatrix::operator!=(const ModuleMatrix &o) const
+{
+	return !(*this == o);
+}
+}
+}
@@ -0,0 +1,188 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_QR_MODULE_MATRIX_H
+#define PAPER_QR_MODULE_MATRIX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace paper
+{
+namespace qr
+{
+/**
+ * \brief This class denotes a matrix of symbol modules, stored with one bit
+ * per module. QR codes are always square, but Data Matrix symbols may also be
+ * rectangular.
+ *
+ * Each row is stored as a run of 64-bit words, where module x of the row is
+ * bit (x % 64) of word (x / 64). Bits past the end of a row are always zero,
+ * so whole words can be compared, counted or combined directly.
+ */
+class ModuleMatrix
+{
+public:
+	/**
+	 * This constructor creates a new matrix of the given width, with all
+	 * of its modules light.
+	 *
+	 * \param w The width (and height) of the matrix, in modules.
+	 */
+	ModuleMatrix(std::size_t w = 0);
+
+	/**
+	 * This constructor creates a new matrix of the given size, with all
+	 * of its modules light.
+	 *
+	 * \param w The width of the matrix, in modules.
+	 * \param h The height of the matrix, in modules.
+	 */
+	ModuleMatrix(std::size_t w, std::size_t h);
+
+	/**
+	 * \return The width of this matrix, in modules.
+	 */
+	std::size_t getWidth() const;
+
+	/**
+	 * \return The height of this matrix, in modules.
+	 */
+	std::size_t getHeight() const;
+
+	/**
+	 * \return The number of 64-bit words each row is stored in.
+	 */
+	std::size_t getStride() const;
+
+	/**
+	 * This function returns whether the module at the given position is
+	 * dark. No bounds checking is performed.
+	 *
+	 * \param x The column of the module.
+	 * \param y The row of the module.
+	 * \return True if the module is dark, or false if it is light.
+	 */
+	bool get(std::size_t x, std::size_t y) const
+	{
+		return (words[y * stride + x / 64] >> (x % 64)) & 1;
+	}
+
+	/**
+	 * This function sets the color of the module at the given position.
+	 * No bounds checking is performed.
+	 *
+	 * \param x The column of the module.
+	 * \param y The row of the module.
+	 * \param dark Whether the module should be dark.
+	 */
+	void set(std::size_t x, std::size_t y, bool dark)
+	{
+		uint64_t bit = UINT64_C(1) << (x % 64);
+		uint64_t &word = words[y * stride + x / 64];
+		word = dark ? (word | bit) : (word & ~bit);
+	}
+
+	/**
+	 * This function returns the words the given row is stored in. The
+	 * returned array is getStride() words long.
+	 *
+	 * \param y The row to return.
+	 * \return The row's words.
+	 */
+	const uint64_t *getRow(std::size_t y) const;
+
+	/**
+	 * This function returns the words the given row is stored in. The
+	 * caller must leave any bits past the end of the row zero.
+	 *
+	 * \param y The row to return.
+	 * \return The row's words.
+	 */
+	uint64_t *getRow(std::size_t y);
+
+	/**
+	 * This function returns the column of the first module in the given
+	 * row, at or after the given column, which has the given color.
+	 *
+	 * \param y The row to search.
+	 * \param x The column to start searching from.
+	 * \param dark The color to search for.
+	 * \return The module's column, or getWidth() if there is none.
+	 */
+	std::size_t find(std::size_t y, std::size_t x, bool dark) const;
+
+	/**
+	 * This function calls the given function once for each run of
+	 * consecutive dark modules in the given row, from left to right, with
+	 * the run's first column and its length. Light modules are skipped a
+	 * word at a time.
+	 *
+	 * \param y The row to scan.
+	 * \param fn The function to call for each run.
+	 */
+	template <typename F> void forEachDarkRun(std::size_t y, F fn) const
+	{
+		std::size_t x = find(y, 0, true);
+		while(x < width)
+		{
+			std::size_t end = find(y, x, false);
+			fn(x, end - x);
+			x = find(y, end, true);
+		}
+	}
+
+	/**
+	 * This function returns a copy of this matrix with its rows and
+	 * columns swapped, so columns can be processed a word at a time too.
+	 *
+	 * \return The transposed matrix.
+	 */
+	ModuleMatrix getTransposed() const;
+
+	/**
+	 * This function returns the number of dark modules in this matrix.
+	 *
+	 * \return The number of dark modules.
+	 */
+	std::size_t getDarkCount() const;
+
+	/**
+	 * \param o The matrix to compare against.
+	 * \return Whether the two matrices are identical.
+	 */
+	bool operator==(const ModuleMatrix &o) const;
+
+	/**
+	 * \param o The matrix to compare against.
+	 * \return Whether the two matrices differ.
+	 */
+	bool operator!=(const ModuleMatrix &o) const;
+
+private:
+	std::size_t width;
+	std::size_t height;
+	std::size_t stride;
+	std::vector<uint64_t> words;
+};
+}
+}
+
+#endif
@@ -0,0 +1,290 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Planner.h"
+
+#include <stdexcept>
+
+#include "PaperCommon/DataMatrix/DataMatrix.h"
+
+namespace
+{
+/**
+ * This function divides the given nonzero numerator by the given denominator,
+ * rounding up.
+ *
+ * \param n The numerator.
+ * \param d The denominator.
+ * \return The rounded up quotient.
+ */
+std::size_t divideRoundingUp(std::size_t n, std::size_t d)
+{
+	return 1 + ((n - 1) / d);
+}
+
+/**
+ * This function returns the number of bytes a code of the given symbology and
+ * version can store, under the given constraints.
+ *
+ * \param symbology The symbology, which must not be Auto.
+ * \param version The code version.
+ * \param constraints The constraints the plan is made under.
+ * \return The code's capacity.
+ */
+std::size_t getSymbolCapacity(paper::symbol::Symbology symbology, int version,
+                              const paper::qr::PlanConstraints &constraints)
+{
+	if(symbology == paper::symbol::Symbology::DataMatrix)
+		return paper::datamatrix::getCapacity(version);
+	return paper::qr::getCapacity(version, constraints.errorCorrection);
+}
+
+/**
+ * This function returns the smallest version of the given symbology which can
+ * store the given amount of data, under the given constraints.
+ *
+ * \param symbology The symbology, which must not be Auto.
+ * \param bytes The amount of data to store.
+ * \param constraints The constraints the plan is made under.
+ * \return The minimum version.
+ */
+int getSymbolVersion(paper::symbol::Symbology symbology, std::size_t bytes,
+                     const paper::qr::PlanConstraints &constraints)
+{
+	if(symbology == paper::symbol::Symbology::DataMatrix)
+		return paper::datamatrix::getMinimumVersion(bytes);
+	return paper::qr::getMinimumVersion(bytes, constraints.errorCorrection);
+}
+
+/**
+ * This function returns the number of modules a code of the given symbology
+ * and version covers, including the given margin on each side.
+ *
+ * \param symbology The symbology, which must not be Auto.
+ * \param version The code version.
+ * \param margin The width of the margin, in modules.
+ * \return The number of modules the code covers.
+ */
+std::size_t getSymbolArea(paper::symbol::Symbology symbology, int version,
+                          std::size_t margin)
+{
+	std::size_t width = 17 + 4 * static_cast<std::size_t>(version);
+	std::size_t height = width;
+	if(symbology == paper::symbol::Symbology::DataMatrix)
+	{
+		width = paper::datamatrix::getWidth(version);
+		height = paper::datamatrix::getHeight(version);
+	}
+
+	return (width + 2 * margin) * (height + 2 * margin);
+}
+
+/**
+ * This function fills in the details of the plan which splits the given
+ * amount of data into chunks of the given size.
+ *
+ * \param size The amount of data to store. This must be nonzero.
+ * \param chunkSize The number of bytes stored in each code but the last.
+ * \param constraints The constraints the plan is made under.
+ * \param symbology The symbology to plan for, which must not be Auto.
+ * \return The resulting plan.
+ */
+paper::qr::Plan getChunkPlan(std::size_t size, std::size_t chunkSize,
+                             const paper::qr::PlanConstraints &constraints,
+                             paper::symbol::Symbology symbology)
+{
+	paper::qr::Plan plan;
+	plan.symbology = symbology;
+	plan.codeCount = divideRoundingUp(size, chunkSize);
+	plan.chunkSize = chunkSize;
+	plan.version = getSymbolVersion(
+	        symbology, chunkSize + constraints.overhead, constraints);
+	plan.errorCorrection = constraints.errorCorrection;
+
+	std::size_t last = size - (plan.codeCount - 1) * chunkSize;
+	int lastVersion = getSymbolVersion(
+	        symbology, last + constraints.overhead, constraints);
+
+	std::size_t margin = paper::symbol::getQuietZone(symbology);
+	plan.moduleCount =
+	        (plan.codeCount - 1) *
+	                getSymbolArea(symbology, plan.version, 0) +
+	        getSymbolArea(symbology, lastVersion, 0);
+	plan.area = (plan.codeCount - 1) *
+	                    getSymbolArea(symbology, plan.version, margin) +
+	            getSymbolArea(symbology, lastVersion, margin);
+	return plan;
+}
+
+/**
+ * This function returns whether the first plan is better than the second:
+ * it has fewer modules, or as many modules in fewer codes, or as many
+ * modules and codes but smaller (more even) chunks.
+ *
+ * \param a The first plan.
+ * \param b The second plan.
+ * \return Whether the first plan is better.
+ */
+bool isBetter(const paper::qr::Plan &a, const paper::qr::Plan &b)
+{
+	if(a.moduleCount != b.moduleCount)
+		return a.moduleCount < b.moduleCount;
+	if(a.codeCount != b.codeCount)
+		return a.codeCount < b.codeCount;
+	return a.chunkSize < b.chunkSize;
+}
+
+/**
+ * This function returns the plan which stores the given amount of data in
+ * the fewest total modules of the given symbology, or an empty plan if none
+ * satisfies the constraints.
+ *
+ * \param size The amount of data to store.
+ * \param constraints The constraints the plan must satisfy.
+ * \param symbology The symbology to plan for, which must not be Auto.
+ * \return The best plan, or an empty plan.
+ */
+paper::qr::Plan getSymbologyPlan(std::size_t size,
+                                 const paper::qr::PlanConstraints &constraints,
+                                 paper::symbol::Symbology symbology)
+{
+	// Empty data still needs one (empty) code.
+	if(size == 0)
+		return getChunkPlan(1, 1, constraints, symbology);
+
+	// For any given chunk version, filling each chunk to that version's
+	// capacity is optimal: it needs the fewest codes, and leaves the
+	// smallest remainder. So, we only need to compare each version filled
+	// to capacity, and the evenly balanced split over as many codes.
+
+	int maximumVersion = constraints.maximumVersion;
+	if(symbology == paper::symbol::Symbology::DataMatrix)
+		maximumVersion = paper::datamatrix::VERSION_COUNT;
+
+	paper::qr::Plan best;
+	for(int version = 1; version <= maximumVersion; ++version)
+	{
+		std::size_t capacity =
+		        getSymbolCapacity(symbology, version, constraints);
+		if(capacity <= constraints.overhead)
+			continue;
+		capacity -= constraints.overhead;
+
+		std::size_t codes = divideRoundingUp(size, capacity);
+		if((constraints.maximumCodes > 0) &&
+		   (codes > constraints.maximumCodes))
+		{
+			continue;
+		}
+
+		for(std::size_t chunkSize :
+		    {capacity, divideRoundingUp(size, codes)})
+		{
+			paper::qr::Plan plan(getChunkPlan(
+			        size, chunkSize, constraints, symbology));
+			if((best.codeCount == 0) || isBetter(plan, best))
+				best = plan;
+		}
+	}
+
+	return best;
+}
+}
+
+namespace paper
+{
+namespace qr
+{
+PlanConstraints::PlanConstraints()
+        : symbology(symbol::Symbology::QR),
+          maximumVersion(40),
+          errorCorrection(QRCode::ErrorCorrection::Low),
+          maximumCodes(0),
+          overhead(0)
+{
+}
+
+Plan::Plan()
+        : symbology(symbol::Symbology::QR),
+          codeCount(0),
+          chunkSize(0),
+          version(0),
+          errorCorrection(QRCode::ErrorCorrection::Low),
+          moduleCount(0),
+          area(0)
+{
+}
+
+Plan getPlan(std::size_t size, const PlanConstraints &constraints)
+{
+	if((constraints.maximumVersion < 1) ||
+	   (constraints.maximumVersion > 40))
+	{
+		throw std::runtime_error("Invalid maximum QR code version.");
+	}
+
+	Plan best;
+	if(constraints.symbology != symbol::Symbology::Auto)
+	{
+		best = getSymbologyPlan(size, constraints,
+		                        constraints.symbology);
+	}
+	else
+	{
+		for(symbol::Symbology symbology :
+		    {symbol::Symbology::QR, symbol::Symbology::DataMatrix})
+		{
+			Plan plan(getSymbologyPlan(size, constraints,
+			                           symbology));
+			if((plan.codeCount > 0) &&
+			   ((best.codeCount == 0) || (plan.area < best.area)))
+			{
+				best = plan;
+			}
+		}
+	}
+
+	if(best.codeCount == 0)
+	{
+		throw std::runtime_error("Too much data for the maximum number "
+		                         "of codes.");
+	}
+
+	return best;
+}
+
+std::size_t getModuleCount(int version)
+{
+	std::size_t width = 17 + 4 * static_cast<std::size_t>(version);
+	return width * width;
+}
+
+int getMinimumVersion(std::size_t bytes,
+                      QRCode::ErrorCorrection errorCorrection)
+{
+	for(int i = 1; i <= 40; ++i)
+	{
+		if(getCapacity(i, errorCorrection) >= bytes)
+			return i;
+	}
+
+	throw std::runtime_error("Too much data for one QR code.");
+}
+}
+}
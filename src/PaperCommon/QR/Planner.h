@@ -0,0 +1,170 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_QR_PLANNER_H
+#define PAPER_QR_PLANNER_H
+
+#include <cstddef>
+
+#include "PaperCommon/QR/QRCode.h"
+#include "PaperCommon/Symbol/Symbology.h"
+
+namespace paper
+{
+namespace qr
+{
+/**
+ * \brief This structure holds the constraints a Plan must satisfy.
+ */
+struct PlanConstraints
+{
+	/**
+	 * The symbology to store data in. With symbol::Symbology::Auto, the
+	 * plan uses whichever symbology needs the least printed area.
+	 */
+	symbol::Symbology symbology;
+
+	/**
+	 * The largest QR code version which may be used. Smaller versions are
+	 * easier to print and to scan, but store less data per module. This
+	 * doesn't limit Data Matrix symbols.
+	 */
+	int maximumVersion;
+
+	/**
+	 * The error correction level every QR code is encoded with. Data
+	 * Matrix symbols have a fixed amount of error correction instead.
+	 */
+	QRCode::ErrorCorrection errorCorrection;
+
+	/**
+	 * If nonzero, the plan may use at most this many QR codes.
+	 */
+	std::size_t maximumCodes;
+
+	/**
+	 * The number of bytes at the start of each QR code taken up by some
+	 * per-code header (e.g. a frame, see format::FrameHeader), rather
+	 * than by the chunk itself.
+	 */
+	std::size_t overhead;
+
+	/**
+	 * This constructor initializes constraints which allow any QR code
+	 * version, at the lowest error correction level, with no limit on the
+	 * number of QR codes and no per-code overhead.
+	 */
+	PlanConstraints();
+};
+
+/**
+ * \brief This structure describes how some data is split into codes.
+ *
+ * The data is split into chunks of chunkSize bytes, except for the last chunk
+ * which holds whatever remains. Each chunk (plus any per-code overhead) is
+ * stored in the smallest code of the planned symbology (at the planned error
+ * correction level, for QR codes) which can hold it.
+ */
+struct Plan
+{
+	/**
+	 * The symbology every code is encoded in; never Auto.
+	 */
+	symbol::Symbology symbology;
+
+	/**
+	 * The number of codes the data is split into.
+	 */
+	std::size_t codeCount;
+
+	/**
+	 * The number of bytes stored in each code but (possibly) the last.
+	 */
+	std::size_t chunkSize;
+
+	/**
+	 * The largest version used by the plan, numbered as the planned
+	 * symbology numbers them.
+	 */
+	int version;
+
+	/**
+	 * The error correction level every QR code is encoded with.
+	 */
+	QRCode::ErrorCorrection errorCorrection;
+
+	/**
+	 * The total number of modules across every code, which is roughly
+	 * proportional to the printed area.
+	 */
+	std::size_t moduleCount;
+
+	/**
+	 * The total number of modules across every code, including each
+	 * code's quiet zone (see symbol::getQuietZone). This is what the
+	 * planner compares when choosing a symbology automatically.
+	 */
+	std::size_t area;
+
+	/**
+	 * This constructor initializes an empty plan.
+	 */
+	Plan();
+};
+
+/**
+ * This function returns the plan which stores the given amount of data in
+ * the fewest total modules, while satisfying the given constraints. If the
+ * symbology is chosen automatically, the best plan for each symbology is
+ * found, and whichever has the smallest area (including quiet zones) is
+ * returned. If no plan satisfies the constraints, an exception is thrown
+ * instead.
+ *
+ * \param size The amount of data to store, in bytes.
+ * \param constraints The constraints the plan must satisfy.
+ * \return The best plan for the given data.
+ */
+Plan getPlan(std::size_t size,
+             const PlanConstraints &constraints = PlanConstraints());
+
+/**
+ * This function returns the total number of modules in a QR code of the
+ * given version.
+ *
+ * \param version The QR code version.
+ * \return The number of modules in the QR code.
+ */
+std::size_t getModuleCount(int version);
+
+/**
+ * This function returns the minimum QR code version which can store the given
+ * amount of bytes, at the given error correction level. If the given amount
+ * of bytes is larger than the maximum possible capacity, an exception will be
+ * thrown.
+ *
+ * \param bytes The amount of bytes you want to store.
+ * \param errorCorrection The desired level of error correction.
+ * \return The minimum version for the given number of bytes.
+ */
+int getMinimumVersion(std::size_t bytes,
+                      QRCode::ErrorCorrection errorCorrection);
+}
+}
+
+#endif
@@ -18,10 +18,11 @@
 
 #include "QRCode.h"
 
-#include <cerrno>
-#include <cstdlib>
-#include <cstring>
 #include <stdexcept>
+#include <utility>
+
+#include "PaperCommon/QR/Encoder.h"
+#include "PaperCommon/QR/Planner.h"
 
 namespace
 {
@@ -70,90 +71,64 @@ const std::size_t CAPACITY_MAP[41][4] = {{0, 0, 0, 0},
                                          {2699, 2099, 1499, 1139},
                                          {2809, 2213, 1579, 1219},
                                          {2953, 2331, 1663, 1273}};
-
-/**
- * This function returns the minimum QR code version which can store the given
- * amount of bytes. If the given amount of bytes is larger than the maximum
- * possible capacity, an exception will be thrown.
- *
- * \param bytes The amount of bytes you want to store.
- * \param errorCorrection The desired level of error correction.
- * \return The minimum version for the given number of bytes.
- */
-int getMinimumVersion(std::size_t bytes,
-                      paper::qr::QRCode::ErrorCorrection errorCorrection)
-{
-	for(int i = 1; i <= 40; ++i)
-	{
-		if(getCapacity(i, errorCorrection) >= bytes)
-			return i;
-	}
-
-	throw std::runtime_error("Too much data for one QR code.");
-}
 }
 
 namespace paper
 {
 namespace qr
 {
-QRCode::QRCode(const uint8_t *data, std::size_t offset, std::size_t size)
-        : code(nullptr)
+QRCode::QRCode(const uint8_t *data, std::size_t offset, std::size_t size,
+               ErrorCorrection e)
+        : errorCorrection(e),
+          version(getMinimumVersion(size, errorCorrection)),
+          modules(encodeSymbol(data + offset, size, version, errorCorrection))
 {
-	int version = getMinimumVersion(size, ErrorCorrection::Low);
-
-	code = QRcode_encodeData(size, data + offset, version,
-	                         QRecLevel::QR_ECLEVEL_L);
+}
 
-	if(code == nullptr)
-	{
-		std::string error(strerror(errno));
-		switch(errno)
-		{
-		case EINVAL:
-			error = "Invalid input object.";
-			break;
-		case ENOMEM:
-			error = "Unable to allocate memory for input objects.";
-			break;
-		case ERANGE:
-			error = "Input data is too large.";
-			break;
-		default:
-			error = "Unknown error.";
-			break;
-		}
-		throw std::runtime_error(error);
-	}
+QRCode::QRCode(QRCode &&o)
+        : errorCorrection(o.errorCorrection),
+          version(o.version),
+          modules(std::move(o.modules))
+{
+	o.version = 0;
+	o.modules = ModuleMatrix();
 }
 
 QRCode::~QRCode()
 {
-	if(code != nullptr)
+}
+
+QRCode &QRCode::operator=(QRCode &&o)
+{
+	if(this != &o)
 	{
-		QRcode_free(code);
-		code = nullptr;
+		errorCorrection = o.errorCorrection;
+		version = o.version;
+		modules = std::move(o.modules);
+		o.version = 0;
+		o.modules = ModuleMatrix();
 	}
+	return *this;
 }
 
 QRCode::ErrorCorrection QRCode::getErrorCorrection() const
 {
-	return ErrorCorrection::Low;
+	return errorCorrection;
 }
 
 int QRCode::getVersion() const
 {
-	return code->version;
+	return version;
 }
 
 std::size_t QRCode::getWidth() const
 {
-	return static_cast<std::size_t>(std::abs(code->width));
+	return modules.getWidth();
 }
 
-const uint8_t *QRCode::getData() const
+const ModuleMatrix &QRCode::getModules() const
 {
-	return static_cast<const uint8_t *>(code->data);
+	return modules;
 }
 
 bool QRCode::getCellColor(std::size_t x, std::size_t y) const
@@ -163,9 +138,7 @@ bool QRCode::getCellColor(std::size_t x, std::size_t y) const
 	if((x >= width) || (y >= width))
 		throw std::runtime_error("Cell index out of bounds.");
 
-	std::size_t i(y * width + x);
-
-	return (getData()[i] & 1) ? true : false;
+	return modules.get(x, y);
 }
 
 std::size_t getCapacity(int version, QRCode::ErrorCorrection errorCorrection)
@@ -178,6 +151,20 @@ std::size_t getCapacity(int version, QRCode::ErrorCorrection errorCorrection)
 	return CAPACITY_MAP[version][errorCorrectionIdx];
 }
 
+QRCode::ErrorCorrection parseErrorCorrection(const std::string &name)
+{
+	if((name == "L") || (name == "l"))
+		return QRCode::ErrorCorrection::Low;
+	if((name == "M") || (name == "m"))
+		return QRCode::ErrorCorrection::Medium;
+	if((name == "Q") || (name == "q"))
+		return QRCode::ErrorCorrection::Quartile;
+	if((name == "H") || (name == "h"))
+		return QRCode::ErrorCorrection::High;
+
+	throw std::runtime_error("Invalid error correction level: " + name);
+}
+
 std::size_t getMaximumCapacity()
 {
 	return getCapacity(40, QRCode::ErrorCorrection::Low);
@@ -21,8 +21,9 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <string>
 
-#include <qrencode.h>
+#include "PaperCommon/QR/ModuleMatrix.h"
 
 namespace paper
 {
@@ -48,7 +49,7 @@ public:
 	/**
 	 * This constructor creates a new QR code which contains the given
 	 * data. The QR code's size will be minimal in order to store the given
-	 * data.
+	 * data at the given error correction level.
 	 *
 	 * If too much data is given, or some other error occurs, then an
 	 * exception will be thrown indicating that object creation has failed.
@@ -56,8 +57,18 @@ public:
 	 * \param data The data to encode.
 	 * \param offset The offset in the given buffer to read data from.
 	 * \param size The size of the data to encode.
+	 * \param e The error correction level to encode with.
 	 */
-	QRCode(const uint8_t *data, std::size_t offset, std::size_t size);
+	QRCode(const uint8_t *data, std::size_t offset, std::size_t size,
+	       ErrorCorrection e = ErrorCorrection::Low);
+
+	/**
+	 * This constructor takes over the given QR code's modules, leaving it
+	 * empty.
+	 *
+	 * \param o The QR code to move from.
+	 */
+	QRCode(QRCode &&o);
 
 	/**
 	 * This is our object's default destructor, which frees all of this
@@ -65,6 +76,15 @@ public:
 	 */
 	~QRCode();
 
+	/**
+	 * This operator takes over the given QR code's modules, leaving it
+	 * empty.
+	 *
+	 * \param o The QR code to move from.
+	 * \return A reference to this QR code.
+	 */
+	QRCode &operator=(QRCode &&o);
+
 	/**
 	 * This function returns the level of error correction this QR code is
 	 * encoded with.
@@ -89,27 +109,26 @@ public:
 	std::size_t getWidth() const;
 
 	/**
-	 * This function returns the raw QR code data. This is an array of
-	 * bytes, which is getWidth() * getWidth() long. Each byte contains the
-	 * following data:
+	 * This function returns this QR code's modules, packed one bit per
+	 * module, with dark modules set. Renderers should prefer its row and
+	 * run accessors to testing modules one at a time.
 	 *
-	 *     MSB 76543210 LSB
-	 *         |||||||`- 1=black/0=white
-	 *         ||||||`-- data and ecc code area
-	 *         |||||`--- format information
-	 *         ||||`---- version information
-	 *         |||`----- timing pattern
-	 *         ||`------ alignment pattern
-	 *         |`------- finder pattern and separator
-	 *         `-------- non-data modules (format, timing etc.)
-	 *
-	 * In general, the only bit which is particularly useful is
-	 * particularly useful is the least significant bit, which indicates
-	 * whether or not the cell is black or white.
+	 * \return This QR code's modules.
+	 */
+	const ModuleMatrix &getModules() const;
+
+	/**
+	 * This function returns whether the cell at the given position in this
+	 * QR code is black. Unlike getCellColor, no bounds checking is done.
 	 *
-	 * \return This QR code's raw data.
+	 * \param x The x coordinate of the desired cell.
+	 * \param y The y coordinate of the desired cell.
+	 * \return True if the cell is black, or false if it is white.
 	 */
-	const uint8_t *getData() const;
+	bool isDark(std::size_t x, std::size_t y) const
+	{
+		return modules.get(x, y);
+	}
 
 	/**
 	 * This function returns the color of the cell at the given position
@@ -123,7 +142,9 @@ public:
 	bool getCellColor(std::size_t x, std::size_t y) const;
 
 private:
-	QRcode *code;
+	ErrorCorrection errorCorrection;
+	int version;
+	ModuleMatrix modules;
 
 	QRCode(const QRCode &);
 	QRCode &operator=(const QRCode &);
@@ -139,6 +160,16 @@ private:
  */
 std::size_t getCapacity(int version, QRCode::ErrorCorrection errorCorrection);
 
+/**
+ * This function parses an error correction level name: one of "L", "M", "Q"
+ * or "H" (in either case). If the name isn't valid, an exception is thrown
+ * instead.
+ *
+ * \param name The name to parse.
+ * \return The error correction level described by the name.
+ */
+QRCode::ErrorCorrection parseErrorCorrection(const std::string &name);
+
 /**
  * This function returns the absolute maximum amount of data a single QR code
  * can store.
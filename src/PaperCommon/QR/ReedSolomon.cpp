@@ -0,0 +1,258 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ReedSolomon.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "PaperCommon/Util/GF256.h"
+
+namespace
+{
+/**
+ * \brief The size of the buffers we keep generator polynomials and
+ * remainders in. This is a multiple of 16 bytes, so GF(256) arithmetic
+ * never needs to fall back to a scalar loop for the last few bytes; the
+ * padding is always zero, so it doesn't affect the results.
+ */
+constexpr std::size_t PADDED_SIZE = (paper::qr::MAX_PARITY_SIZE + 15) / 16 * 16;
+
+/**
+ * \brief This structure holds the generator polynomial for each supported
+ * number of parity codewords.
+ */
+struct Generators
+{
+	/**
+	 * For each degree, the generator polynomial's coefficients from the
+	 * highest power down to x^0, excluding the leading (monic) 1.
+	 */
+	uint8_t coefficients[paper::qr::MAX_PARITY_SIZE + 1][PADDED_SIZE];
+
+	Generators();
+};
+
+Generators::Generators() : coefficients()
+{
+	using namespace paper::util::gf256;
+
+	for(std::size_t degree = 1; degree <= paper::qr::MAX_PARITY_SIZE;
+	    ++degree)
+	{
+		// Multiply the factors (x - alpha^i), for i in [0, degree),
+		// together one at a time.
+		uint8_t *g = coefficients[degree];
+		g[degree - 1] = 1;
+
+		for(std::size_t i = 0; i < degree; ++i)
+		{
+			uint8_t root = paper::util::gf256::exp(i);
+			for(std::size_t j = 0; j < degree; ++j)
+			{
+				g[j] = multiply(g[j], root);
+				if(j + 1 < degree)
+					g[j] ^= g[j + 1];
+			}
+		}
+	}
+}
+
+/**
+ * This function evaluates the given polynomial, whose coefficients are
+ * stored from x^0 up, at the given point.
+ *
+ * \param polynomial The polynomial's coefficients.
+ * \param count The number of coefficients.
+ * \param x The point to evaluate the polynomial at.
+ * \return The polynomial's value.
+ */
+uint8_t evaluate(const uint8_t *polynomial, std::size_t count, uint8_t x)
+{
+	uint8_t result = 0;
+	for(std::size_t i = count; i > 0; --i)
+	{
+		result = paper::util::gf256::multiply(result, x) ^
+		         polynomial[i - 1];
+	}
+	return result;
+}
+
+/**
+ * This function finds the error locator polynomial for the given syndromes
+ * with the Berlekamp-Massey algorithm: the shortest polynomial whose roots
+ * are the inverses of the error locations.
+ *
+ * \param syndromes The block's syndromes.
+ * \param degree The number of syndromes.
+ * \param locator The buffer to write the polynomial's degree + 1
+ * coefficients to, from x^0 up.
+ * \return The number of errors, i.e. the locator's degree.
+ */
+std::size_t findErrorLocator(const uint8_t *syndromes, std::size_t degree,
+                             uint8_t *locator)
+{
+	using namespace paper::util::gf256;
+
+	uint8_t previous[paper::qr::MAX_PARITY_SIZE + 1] = {1};
+	uint8_t saved[paper::qr::MAX_PARITY_SIZE + 1];
+	std::fill(locator, locator + degree + 1, 0);
+	locator[0] = 1;
+
+	std::size_t errors = 0;
+	std::size_t shift = 1;
+	uint8_t previousDiscrepancy = 1;
+	for(std::size_t n = 0; n < degree; ++n)
+	{
+		uint8_t discrepancy = syndromes[n];
+		for(std::size_t i = 1; i <= errors; ++i)
+			discrepancy ^= multiply(locator[i], syndromes[n - i]);
+
+		if(discrepancy == 0)
+		{
+			++shift;
+			continue;
+		}
+
+		// Subtract the discrepancy's multiple of the previous
+		// locator, shifted into place, from the current one.
+		uint8_t factor = divide(discrepancy, previousDiscrepancy);
+		std::copy(locator, locator + degree + 1, saved);
+		for(std::size_t i = 0; i + shift <= degree; ++i)
+			locator[i + shift] ^= multiply(factor, previous[i]);
+
+		if(errors * 2 <= n)
+		{
+			errors = n + 1 - errors;
+			std::copy(saved, saved + degree + 1, previous);
+			previousDiscrepancy = discrepancy;
+			shift = 1;
+		}
+		else
+		{
+			++shift;
+		}
+	}
+
+	return errors;
+}
+}
+
+namespace paper
+{
+namespace qr
+{
+void computeParity(const uint8_t *data, std::size_t size, uint8_t *parity,
+                   std::size_t degree)
+{
+	static const Generators generators;
+
+	if((degree == 0) || (degree > MAX_PARITY_SIZE))
+		throw std::runtime_error("Unsupported Reed-Solomon degree.");
+
+	const uint8_t *generator = generators.coefficients[degree];
+	std::size_t paddedDegree = (degree + 15) / 16 * 16;
+
+	// This is polynomial long division, keeping only the remainder. For
+	// each data codeword, we shift the remainder along by one, and then
+	// subtract (XOR) the generator times the codeword which fell off.
+	uint8_t remainder[PADDED_SIZE + 1] = {0};
+	for(std::size_t i = 0; i < size; ++i)
+	{
+		uint8_t factor = data[i] ^ remainder[0];
+		memmove(remainder, remainder + 1, paddedDegree);
+		paper::util::gf256::mulAdd(remainder, generator, factor,
+		                           paddedDegree);
+	}
+
+	memcpy(parity, remainder, degree);
+}
+
+std::size_t correctErrors(uint8_t *block, std::size_t size,
+                          std::size_t degree)
+{
+	using namespace paper::util::gf256;
+
+	if((degree == 0) || (degree > MAX_PARITY_SIZE) || (size > 255))
+		throw std::runtime_error("Unsupported Reed-Solomon degree.");
+
+	// Codeword i is the coefficient of x^(size - 1 - i), so the syndromes
+	// are the block's values at each of the generator's roots.
+	uint8_t syndromes[MAX_PARITY_SIZE] = {0};
+	bool intact = true;
+	for(std::size_t j = 0; j < degree; ++j)
+	{
+		uint8_t root = exp(j);
+		for(std::size_t i = 0; i < size; ++i)
+			syndromes[j] = multiply(syndromes[j], root) ^ block[i];
+		intact = intact && (syndromes[j] == 0);
+	}
+	if(intact)
+		return 0;
+
+	uint8_t locator[MAX_PARITY_SIZE + 1];
+	std::size_t errors = findErrorLocator(syndromes, degree, locator);
+
+	// The error evaluator is the product of the syndromes and the
+	// locator, modulo x^degree.
+	uint8_t evaluator[MAX_PARITY_SIZE] = {0};
+	for(std::size_t i = 0; i < degree; ++i)
+	{
+		for(std::size_t j = 0; (j <= i) && (j <= errors); ++j)
+			evaluator[i] ^= multiply(locator[j], syndromes[i - j]);
+	}
+
+	// The locator's formal derivative keeps only its odd terms.
+	uint8_t derivative[MAX_PARITY_SIZE] = {0};
+	for(std::size_t i = 1; i <= errors; i += 2)
+		derivative[i - 1] = locator[i];
+
+	// Find the locator's roots by trying every position (Chien search),
+	// and compute each error's magnitude with Forney's algorithm.
+	std::size_t corrected = 0;
+	for(std::size_t i = 0; (i < size) && (errors * 2 <= degree); ++i)
+	{
+		uint8_t location = exp(size - 1 - i);
+		uint8_t inverseLocation = inverse(location);
+		if(evaluate(locator, errors + 1, inverseLocation) != 0)
+			continue;
+
+		uint8_t denominator =
+		        evaluate(derivative, errors, inverseLocation);
+		if(denominator == 0)
+			break;
+
+		block[i] ^= multiply(
+		        location,
+		        divide(evaluate(evaluator, degree, inverseLocation),
+		               denominator));
+		++corrected;
+	}
+
+	if((errors * 2 > degree) || (corrected != errors))
+	{
+		throw std::runtime_error(
+		        "Too many errors to correct in Reed-Solomon block.");
+	}
+
+	return corrected;
+}
+}
+}
@@ -0,0 +1,66 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_QR_REED_SOLOMON_H
+#define PAPER_QR_REED_SOLOMON_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace paper
+{
+namespace qr
+{
+/**
+ * \brief This constant defines the largest number of error correction
+ * codewords any QR code block uses.
+ */
+constexpr std::size_t MAX_PARITY_SIZE = 30;
+
+/**
+ * This function computes the Reed-Solomon error correction codewords for the
+ * given block of data codewords, as QR codes define them: the remainder of
+ * dividing the data polynomial (times x^degree) by the generator polynomial
+ * whose roots are alpha^0 .. alpha^(degree - 1).
+ *
+ * \param data The data codewords.
+ * \param size The number of data codewords.
+ * \param parity The buffer to write the degree parity codewords to.
+ * \param degree The number of parity codewords, at most MAX_PARITY_SIZE.
+ */
+void computeParity(const uint8_t *data, std::size_t size, uint8_t *parity,
+                   std::size_t degree);
+
+/**
+ * This function corrects any errors in the given block of codewords (its
+ * data codewords followed by its degree parity codewords, as computed by
+ * computeParity) in place. Up to degree / 2 errors can be corrected; if the
+ * block has more errors than that, an exception is thrown instead.
+ *
+ * \param block The block of codewords to correct.
+ * \param size The total number of codewords in the block.
+ * \param degree The number of parity codewords, at most MAX_PARITY_SIZE.
+ * \return The number of codewords which were corrected.
+ */
+std::size_t correctErrors(uint8_t *block, std::size_t size,
+                          std::size_t degree);
+}
+}
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Color.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "PaperCommon/Symbol/Symbol.h"
+
+namespace
+{
+/**
+ * This function returns the pixel at the center of the given module, along
+ * one axis of an image.
+ *
+ * \param module The index of the module.
+ * \param pixels The size of the image along this axis, in pixels.
+ * \param modules The size of the grid along this axis, in modules.
+ * \return The index of the center pixel.
+ */
+std::size_t getCenter(std::size_t module, std::size_t pixels,
+                      std::size_t modules)
+{
+	return (2 * module + 1) * pixels / (2 * modules);
+}
+}
+
+namespace paper
+{
+namespace render
+{
+std::size_t getLayersWidth(const Layers &layers)
+{
+	std::size_t width = 0;
+	for(const symbol::Symbol *code : layers)
+	{
+		if(code != nullptr)
+			width = std::max(width, code->getWidth());
+	}
+	return width;
+}
+
+std::size_t getLayersHeight(const Layers &layers)
+{
+	std::size_t height = 0;
+	for(const symbol::Symbol *code : layers)
+	{
+		if(code != nullptr)
+			height = std::max(height, code->getHeight());
+	}
+	return height;
+}
+
+std::vector<uint8_t> getLayersRow(const Layers &layers, std::size_t y)
+{
+	std::size_t width = getLayersWidth(layers);
+	std::size_t height = getLayersHeight(layers);
+	std::vector<uint8_t> row(width, 0);
+
+	for(std::size_t layer = 0; layer < LAYER_COUNT; ++layer)
+	{
+		if(layers[layer] == nullptr)
+			continue;
+
+		const qr::ModuleMatrix &modules = layers[layer]->getModules();
+		std::size_t offset = (width - modules.getWidth()) / 2;
+		std::size_t top = (height - modules.getHeight()) / 2;
+		if((y < top) || (y - top >= modules.getHeight()))
+			continue;
+
+		uint8_t bit = static_cast<uint8_t>(1 << layer);
+		modules.forEachDarkRun(
+		        y - top, [&row, offset, bit](std::size_t x,
+		                                     std::size_t length)
+		        {
+			        for(std::size_t i = 0; i < length; ++i)
+				        row[offset + x + i] |= bit;
+			});
+	}
+
+	return row;
+}
+
+uint32_t getLayersColor(uint8_t mask)
+{
+	uint32_t red = (mask & 0x1) ? 0 : 0xFF;
+	uint32_t green = (mask & 0x2) ? 0 : 0xFF;
+	uint32_t blue = (mask & 0x4) ? 0 : 0xFF;
+	return (red << 16) | (green << 8) | blue;
+}
+
+Image rasterizeLayers(const Layers &layers, std::size_t cellSize)
+{
+	std::size_t width = getLayersWidth(layers);
+	std::size_t height = getLayersHeight(layers);
+	Image image(width * cellSize, height * cellSize, 3);
+
+	for(std::size_t y = 0; y < height; ++y)
+	{
+		std::vector<uint8_t> row(getLayersRow(layers, y));
+
+		// Render one row of pixels, then copy it down the module.
+		uint8_t *first = image.getPixel(0, y * cellSize);
+		for(std::size_t x = 0; x < width; ++x)
+		{
+			uint32_t color = getLayersColor(row[x]);
+			for(std::size_t p = 0; p < cellSize; ++p)
+			{
+				uint8_t *pixel = first + (x * cellSize + p) * 3;
+				pixel[0] = static_cast<uint8_t>(color >> 16);
+				pixel[1] = static_cast<uint8_t>(color >> 8);
+				pixel[2] = static_cast<uint8_t>(color);
+			}
+		}
+
+		std::size_t rowSize = image.width * 3;
+		for(std::size_t p = 1; p < cellSize; ++p)
+			std::copy(first, first + rowSize, first + p * rowSize);
+	}
+
+	return image;
+}
+
+Image separateLayer(const Image &image, Layer layer)
+{
+	if(image.channels != 3)
+		throw std::runtime_error("Only RGB images can be separated.");
+
+	// Each ink only absorbs its complementary primary, so that channel
+	// alone shows where the layer is inked.
+	std::size_t channel = static_cast<std::size_t>(layer);
+	Image separated(image.width, image.height, 1);
+	for(std::size_t i = 0; i < separated.pixels.size(); ++i)
+		separated.pixels[i] = image.pixels[i * 3 + channel];
+
+	return separated;
+}
+
+qr::ModuleMatrix sampleModules(const Image &image, std::size_t width,
+                               std::size_t height)
+{
+	if((image.channels != 1) || (width == 0) || (height == 0))
+	{
+		throw std::runtime_error(
+		        "Only grayscale images can be sampled.");
+	}
+
+	qr::ModuleMatrix modules(width, height);
+	for(std::size_t y = 0; y < height; ++y)
+	{
+		std::size_t py = getCenter(y, image.height, height);
+		for(std::size_t x = 0; x < width; ++x)
+		{
+			std::size_t px = getCenter(x, image.width, width);
+			const uint8_t *pixel = image.getPixel(px, py);
+			modules.set(x, y, pixel[0] < 128);
+		}
+	}
+
+	return modules;
+}
+}
+}
@@ -0,0 +1,138 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_RENDER_COLOR_H
+#define PAPER_RENDER_COLOR_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PaperCommon/QR/ModuleMatrix.h"
+#include "PaperCommon/Render/Image.h"
+
+namespace paper
+{
+namespace symbol
+{
+class Symbol;
+}
+
+namespace render
+{
+/**
+ * \brief This enumeration defines the ink layers of a colour page.
+ *
+ * Each layer carries its own symbol, printed in one of the subtractive
+ * primaries. Cyan ink absorbs red light, magenta absorbs green, and yellow
+ * absorbs blue, so each layer can be recovered from a scan by looking at a
+ * single RGB channel, no matter what the other layers did.
+ */
+enum class Layer
+{
+	Cyan = 0,
+	Magenta = 1,
+	Yellow = 2
+};
+
+/**
+ * \brief The number of ink layers on a colour page.
+ */
+constexpr std::size_t LAYER_COUNT = 3;
+
+/**
+ * \brief This type holds the symbol on each layer of a colour page, indexed
+ * by Layer. A layer with no symbol (e.g. on the last page) is null.
+ */
+typedef std::array<const symbol::Symbol *, LAYER_COUNT> Layers;
+
+/**
+ * This function returns the width of a colour page, in modules, which is the
+ * width of its widest symbol. Smaller symbols are centered on the page.
+ *
+ * \param layers The symbol on each layer.
+ * \return The width of the page.
+ */
+std::size_t getLayersWidth(const Layers &layers);
+
+/**
+ * This function returns the height of a colour page, in modules, which is the
+ * height of its tallest symbol.
+ *
+ * \param layers The symbol on each layer.
+ * \return The height of the page.
+ */
+std::size_t getLayersHeight(const Layers &layers);
+
+/**
+ * This function returns which layers are inked in each module of the given
+ * row of a colour page. Bit i of each entry is set if layer i is dark there.
+ *
+ * \param layers The symbol on each layer.
+ * \param y The row to return.
+ * \return The layer mask of each module in the row.
+ */
+std::vector<uint8_t> getLayersRow(const Layers &layers, std::size_t y);
+
+/**
+ * This function returns the colour of a module, given which layers are inked
+ * there, as 0xRRGGBB.
+ *
+ * \param mask The layer mask, as returned by getLayersRow.
+ * \return The module's colour.
+ */
+uint32_t getLayersColor(uint8_t mask);
+
+/**
+ * This function renders a colour page as an RGB raster image, with each module
+ * covering a square of the given number of pixels.
+ *
+ * \param layers The symbol on each layer.
+ * \param cellSize The width (and height) of each module, in pixels.
+ * \return The rendered image.
+ */
+Image rasterizeLayers(const Layers &layers, std::size_t cellSize);
+
+/**
+ * This function separates one layer out of an RGB scan of a colour page. The
+ * result is an ordinary grayscale image of that layer's symbol, dark where
+ * its ink is, which can be handed to any barcode reader.
+ *
+ * \param image The RGB image to separate.
+ * \param layer The layer to separate out.
+ * \return The grayscale image of the layer.
+ */
+Image separateLayer(const Image &image, Layer layer);
+
+/**
+ * This function samples the modules of a grayscale image which exactly covers
+ * a grid of the given size, by thresholding the center pixel of each module.
+ *
+ * \param image The grayscale image to sample.
+ * \param width The width of the grid, in modules.
+ * \param height The height of the grid, in modules.
+ * \return The sampled modules.
+ */
+qr::ModuleMatrix sampleModules(const Image &image, std::size_t width,
+                               std::size_t height);
+}
+}
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Image.h"
+
+#include <stdexcept>
+
+namespace paper
+{
+namespace render
+{
+Image::Image(std::size_t w, std::size_t h, std::size_t c)
+        : width(w), height(h), channels(c), pixels(w * h * c, 255)
+{
+}
+
+const uint8_t *Image::getPixel(std::size_t x, std::size_t y) const
+{
+	return pixels.data() + (y * width + x) * channels;
+}
+
+uint8_t *Image::getPixel(std::size_t x, std::size_t y)
+{
+	return pixels.data() + (y * width + x) * channels;
+}
+
+Image getGrayscale(const Image &image)
+{
+	if(image.channels == 1)
+		return image;
+	if(image.channels != 3)
+		throw std::runtime_error("Unsupported number of image channels.");
+
+	// These are the ITU-R BT.601 luma weights, scaled by 1024.
+	Image gray(image.width, image.height, 1);
+	const uint8_t *src = image.pixels.data();
+	for(uint8_t &pixel : gray.pixels)
+	{
+		unsigned int luma = 306u * src[0] + 601u * src[1] + 117u * src[2];
+		pixel = static_cast<uint8_t>((luma + 512) >> 10);
+		src += 3;
+	}
+	return gray;
+}
+}
+}
@@ -0,0 +1,90 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_RENDER_IMAGE_H
+#define PAPER_RENDER_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace paper
+{
+namespace render
+{
+/**
+ * \brief This structure holds an 8-bit raster image, with its pixels stored
+ * row by row and each pixel's channels interleaved.
+ */
+struct Image
+{
+	std::size_t width;
+	std::size_t height;
+
+	/**
+	 * The number of channels per pixel: 1 for grayscale, or 3 for RGB.
+	 */
+	std::size_t channels;
+
+	std::vector<uint8_t> pixels;
+
+	/**
+	 * This constructor creates a new image of the given size, with every
+	 * channel of every pixel set to 255 (white).
+	 *
+	 * \param w The width of the image, in pixels.
+	 * \param h The height of the image, in pixels.
+	 * \param c The number of channels per pixel.
+	 */
+	Image(std::size_t w = 0, std::size_t h = 0, std::size_t c = 1);
+
+	/**
+	 * This function returns the channels of the pixel at the given
+	 * position. No bounds checking is performed.
+	 *
+	 * \param x The column of the pixel.
+	 * \param y The row of the pixel.
+	 * \return The pixel's channels.
+	 */
+	const uint8_t *getPixel(std::size_t x, std::size_t y) const;
+
+	/**
+	 * This function returns the channels of the pixel at the given
+	 * position. No bounds checking is performed.
+	 *
+	 * \param x The column of the pixel.
+	 * \param y The row of the pixel.
+	 * \return The pixel's channels.
+	 */
+	uint8_t *getPixel(std::size_t x, std::size_t y);
+};
+
+/**
+ * This function converts the given image to grayscale, weighting each RGB
+ * channel by its contribution to perceived brightness. Grayscale images are
+ * returned as-is.
+ *
+ * \param image The image to convert.
+ * \return The grayscale image.
+ */
+Image getGrayscale(const Image &image);
+}
+}
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PNM.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+/**
+ * \brief This class reads the whitespace separated header fields (and, for
+ * the plain formats, the samples) of a Netpbm image.
+ */
+class Reader
+{
+public:
+	Reader(const uint8_t *d, std::size_t s) : data(d), size(s), position(0)
+	{
+	}
+
+	/**
+	 * This function skips any whitespace and comments before the next
+	 * field, and then parses that field as an unsigned integer.
+	 *
+	 * \param digits The maximum number of digits to read; plain bitmaps'
+	 * samples need not be separated, so they are read one at a time.
+	 * \return The field's value.
+	 */
+	std::size_t readNumber(std::size_t digits = 9)
+	{
+		skipSeparators();
+
+		std::size_t value = 0;
+		std::size_t count = 0;
+		while((position < size) && (count < digits) &&
+		      (data[position] >= '0') && (data[position] <= '9'))
+		{
+			value = value * 10 + (data[position++] - '0');
+			++count;
+		}
+
+		if(count == 0)
+			throw std::runtime_error("Netpbm image is malformed.");
+		return value;
+	}
+
+	/**
+	 * This function consumes the single whitespace character which
+	 * separates the header from the raster in the binary formats, and
+	 * returns the raster.
+	 *
+	 * \param length The number of raster bytes needed.
+	 * \return The start of the raster.
+	 */
+	const uint8_t *getRaster(std::size_t length)
+	{
+		++position;
+		if((position > size) || (size - position < length))
+			throw std::runtime_error("Netpbm image is truncated.");
+		return data + position;
+	}
+
+private:
+	const uint8_t *data;
+	std::size_t size;
+	std::size_t position;
+
+	void skipSeparators()
+	{
+		while(position < size)
+		{
+			uint8_t c = data[position];
+			if(c == '#')
+			{
+				while((position < size) &&
+				      (data[position] != '\n'))
+				{
+					++position;
+				}
+			}
+			else if((c == ' ') || (c == '\t') || (c == '\n') ||
+			        (c == '\r') || (c == '\v') || (c == '\f'))
+			{
+				++position;
+			}
+			else
+			{
+				break;
+			}
+		}
+	}
+};
+
+/**
+ * This function scales a sample with the given maximum value to 8 bits.
+ *
+ * \param sample The sample to scale.
+ * \param maximum The image's maximum sample value.
+ * \return The scaled sample.
+ */
+uint8_t scaleSample(std::size_t sample, std::size_t maximum)
+{
+	if(sample > maximum)
+	{
+		throw std::runtime_error(
+		        "Netpbm image sample is out of range.");
+	}
+	return static_cast<uint8_t>((sample * 255 + maximum / 2) / maximum);
+}
+}
+
+namespace paper
+{
+namespace render
+{
+bool isPNM(const uint8_t *data, std::size_t size)
+{
+	return (size >= 2) && (data[0] == 'P') && (data[1] >= '1') &&
+	       (data[1] <= '6');
+}
+
+Image readPNM(const uint8_t *data, std::size_t size)
+{
+	if(!isPNM(data, size))
+		throw std::runtime_error("Not a Netpbm image.");
+
+	// P1 and P4 are bitmaps, P2 and P5 graymaps, and P3 and P6 pixmaps;
+	// the first of each pair stores its samples as text.
+	unsigned int type = static_cast<unsigned int>(data[1] - '0');
+	bool plain = type <= 3;
+	bool bitmap = (type == 1) || (type == 4);
+	std::size_t channels = ((type == 3) || (type == 6)) ? 3 : 1;
+
+	Reader reader(data + 2, size - 2);
+	std::size_t width = reader.readNumber();
+	std::size_t height = reader.readNumber();
+	std::size_t maximum = bitmap ? 1 : reader.readNumber();
+	if((width == 0) || (height == 0) || (maximum == 0) ||
+	   (maximum > 65535))
+	{
+		throw std::runtime_error("Netpbm image header is invalid.");
+	}
+
+	// Every sample takes at least one bit (or, in the plain formats, one
+	// character), so the dimensions can be checked before allocating.
+	std::size_t count = width * height * channels;
+	if((count / height / channels != width) || (count / 8 > size))
+		throw std::runtime_error("Netpbm image is truncated.");
+
+	Image image(width, height, channels);
+
+	if(plain)
+	{
+		for(uint8_t &sample : image.pixels)
+		{
+			// In bitmaps, 1 is black.
+			std::size_t value = reader.readNumber(bitmap ? 1 : 9);
+			sample = bitmap ? (value != 0 ? 0 : 255)
+			                : scaleSample(value, maximum);
+		}
+		return image;
+	}
+
+	if(bitmap)
+	{
+		// Each row is packed eight pixels per byte, most significant
+		// bit first, and padded to a whole byte.
+		std::size_t stride = (width + 7) / 8;
+		const uint8_t *raster = reader.getRaster(stride * height);
+		for(std::size_t y = 0; y < height; ++y)
+		{
+			const uint8_t *row = raster + y * stride;
+			uint8_t *pixels = image.getPixel(0, y);
+			for(std::size_t x = 0; x < width; ++x)
+			{
+				bool black = (row[x / 8] >> (7 - x % 8)) & 1;
+				pixels[x] = black ? 0 : 255;
+			}
+		}
+		return image;
+	}
+
+	// Samples above 255 are stored as two bytes, most significant first.
+	std::size_t sampleSize = maximum > 255 ? 2 : 1;
+	const uint8_t *raster = reader.getRaster(count * sampleSize);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		std::size_t value = raster[i * sampleSize];
+		if(sampleSize == 2)
+			value = (value << 8) | raster[i * 2 + 1];
+		image.pixels[i] =
+		        maximum == 255 ? static_cast<uint8_t>(value)
+		                       : scaleSample(value, maximum);
+	}
+	return image;
+}
+
+std::vector<uint8_t> writePNM(const Image &image)
+{
+	if((image.channels != 1) && (image.channels != 3))
+	{
+		throw std::runtime_error(
+		        "Unsupported number of image channels.");
+	}
+
+	std::string header((image.channels == 1 ? "P5\n" : "P6\n") +
+	                   std::to_string(image.width) + " " +
+	                   std::to_string(image.height) + "\n255\n");
+
+	std::vector<uint8_t> encoded(header.begin(), header.end());
+	encoded.insert(encoded.end(), image.pixels.begin(), image.pixels.end());
+	return encoded;
+}
+}
+}
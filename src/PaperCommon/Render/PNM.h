@@ -0,0 +1,65 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAPER_RENDER_PNM_H
+#define PAPER_RENDER_PNM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PaperCommon/Render/Image.h"
+
+namespace paper
+{
+namespace render
+{
+/**
+ * This function returns whether or not the given data starts with the magic
+ * number of one of the Netpbm formats we can read (see readPNM).
+ *
+ * \param data The data to inspect.
+ * \param size The size of the data, in bytes.
+ * \return Whether or not the data looks like a Netpbm image.
+ */
+bool isPNM(const uint8_t *data, std::size_t size);
+
+/**
+ * This function decodes a Netpbm image: a PBM (P1 or P4), PGM (P2 or P5) or
+ * PPM (P3 or P6) file. Bitmaps and graymaps become grayscale images, and
+ * pixmaps become RGB images. Samples wider than 8 bits are scaled down. If
+ * the image is malformed, an exception is thrown instead.
+ *
+ * \param data The encoded image.
+ * \param size The size of the encoded image, in bytes.
+ * \return The decoded image.
+ */
+Image readPNM(const uint8_t *data, std::size_t size);
+
+/**
+ * This function encodes the given image as a binary PGM (P5) or PPM (P6)
+ * file, depending on its number of channels.
+ *
+ * \param image The image to encode.
+ * \return The encoded image.
+ */
+std::vector<uint8_t> writePNM(const Image &image);
+}
+}
+
+#endif
@@ -18,82 +18,250 @@
 
 #include "SVG.h"
 
+#include <cerrno>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
-#include <QSvgGenerator>
-#include <QSize>
-#include <QRect>
-#include <QPainter>
-#include <QPen>
-#include <QBrush>
-#include <QColor>
+#include <unistd.h>
 
-#include "PaperCommon/QR/QRCode.h"
+#include "PaperCommon/Symbol/Symbol.h"
 
 namespace
 {
-const int CELL_SIZE = 100;
-const int IMAGE_SIZE_INCHES = 12;
+/**
+ * \brief The physical width of every image, in thousandths of an inch.
+ */
+constexpr uint64_t IMAGE_WIDTH_MILS = 12000;
 
 /**
- * This function will draw the given QR code cell using the given Qt painter.
- *
- * \param code The QR code being rendered.
- * \param painter The painter to draw with.
- * \param x The x coordinate of the cell to draw.
- * \param y The y coordinate of the cell to draw.
+ * \brief The number of bytes buffered before they are written out.
+ */
+constexpr std::size_t OUTPUT_BUFFER_SIZE = 1 << 16;
+
+/**
+ * \brief This type holds a run of modules in a row, as its first column and
+ * its length.
+ */
+typedef std::pair<std::size_t, std::size_t> Run;
+
+/**
+ * \brief This class buffers text written to a file descriptor.
  */
-void paintQRCodeCell(const paper::qr::QRCode &code, QPainter &painter,
-                     std::size_t x, std::size_t y)
+class Output
 {
-	if(!code.getCellColor(x, y))
-		return;
+public:
+	/**
+	 * \param f The file descriptor to write to.
+	 */
+	explicit Output(int f) : fd(f), buffer()
+	{
+		buffer.reserve(OUTPUT_BUFFER_SIZE);
+	}
 
-	painter.fillRect(x * CELL_SIZE, y * CELL_SIZE, CELL_SIZE, CELL_SIZE,
-	                 Qt::SolidPattern);
-}
+	/**
+	 * This function appends the given text.
+	 *
+	 * \param text The text to append.
+	 * \return This object.
+	 */
+	Output &operator<<(const char *text)
+	{
+		buffer.append(text);
+		if(buffer.size() >= OUTPUT_BUFFER_SIZE)
+			flush();
+		return *this;
+	}
+
+	/**
+	 * This function appends the given number, in decimal. This doesn't go
+	 * through the C library, so the result doesn't depend on the locale.
+	 *
+	 * \param value The number to append.
+	 * \return This object.
+	 */
+	Output &operator<<(uint64_t value)
+	{
+		char digits[20];
+		std::size_t count = 0;
+		do
+		{
+			digits[count++] = static_cast<char>('0' + value % 10);
+			value /= 10;
+		} while(value > 0);
+
+		while(count > 0)
+			buffer.push_back(digits[--count]);
+		return *this;
+	}
+
+	/**
+	 * This function writes out everything appended so far. If writing
+	 * fails, an exception is thrown.
+	 */
+	void flush()
+	{
+		const char *data = buffer.data();
+		std::size_t remaining = buffer.size();
+		while(remaining > 0)
+		{
+			ssize_t written = write(fd, data, remaining);
+			if(written < 0)
+			{
+				if(errno == EINTR)
+					continue;
+				throw std::runtime_error(strerror(errno));
+			}
+
+			data += written;
+			remaining -= static_cast<std::size_t>(written);
+		}
+		buffer.clear();
+	}
+
+private:
+	int fd;
+	std::string buffer;
+};
 
 /**
- * This function draws the entire given QR code using the given Qt painter.
- *
- * \param code The QR code to render.
- * \param painter The painter to draw with.
+ * \brief This class writes a path made of rectangles, given the runs of
+ * modules in each row which it should cover. A rectangle is only ended once a
+ * row doesn't continue it with an identical run, so e.g. the finder patterns'
+ * sides take one rectangle each rather than one per row.
  */
-void paintQRCode(const paper::qr::QRCode &code, QPainter &painter)
+class PathWriter
 {
-	painter.setPen(Qt::NoPen);
-	painter.setBrush(QBrush(QColor(0, 0, 0), Qt::SolidPattern));
+public:
+	/**
+	 * \param o The output to write the path to.
+	 * \param f The path's fill colour, as 0xRRGGBB.
+	 */
+	PathWriter(Output &o, uint32_t f)
+	        : output(o), fill(f), started(false), open(), next()
+	{
+	}
 
-	for(std::size_t x = 0; x < code.getWidth(); ++x)
+	/**
+	 * This function adds the runs in the next row.
+	 *
+	 * \param y The row's index.
+	 * \param runs The row's runs, from left to right.
+	 */
+	void addRow(std::size_t y, const std::vector<Run> &runs)
 	{
-		for(std::size_t y = 0; y < code.getWidth(); ++y)
+		// Both lists are sorted, so they can be matched up in one pass.
+		next.clear();
+		std::size_t o = 0;
+		for(const Run &run : runs)
 		{
-			paintQRCodeCell(code, painter, x, y);
+			while((o < open.size()) && (open[o].run < run))
+				end(open[o++], y);
+
+			if((o < open.size()) && (open[o].run == run))
+			{
+				next.push_back(open[o++]);
+				continue;
+			}
+			next.push_back(Rectangle(run, y));
 		}
+		while(o < open.size())
+			end(open[o++], y);
+		open.swap(next);
 	}
-}
+
+	/**
+	 * This function ends the path. If it was empty, nothing is written.
+	 *
+	 * \param height The number of rows in the image.
+	 */
+	void finish(std::size_t height)
+	{
+		for(const Rectangle &rectangle : open)
+			end(rectangle, height);
+		open.clear();
+
+		if(started)
+			output << "\"/>\n";
+	}
+
+private:
+	struct Rectangle
+	{
+		Run run;
+		std::size_t top;
+
+		Rectangle(const Run &r, std::size_t t) : run(r), top(t)
+		{
+		}
+	};
+
+	Output &output;
+	uint32_t fill;
+	bool started;
+	std::vector<Rectangle> open;
+	std::vector<Rectangle> next;
+
+	/**
+	 * This function writes the given rectangle, which ends above the
+	 * given row, as a closed subpath.
+	 *
+	 * \param rectangle The rectangle to write.
+	 * \param bottom The row below the rectangle.
+	 */
+	void end(const Rectangle &rectangle, std::size_t bottom)
+	{
+		if(!started)
+		{
+			const char *HEX = "0123456789abcdef";
+			char color[8] = "#";
+			for(std::size_t i = 0; i < 6; ++i)
+			{
+				std::size_t shift = 20 - 4 * i;
+				color[i + 1] = HEX[(fill >> shift) & 0xF];
+			}
+
+			output << "<path fill=\"" << color << "\" d=\"";
+			started = true;
+		}
+
+		output << "M" << rectangle.run.first << " " << rectangle.top
+		       << "h" << rectangle.run.second << "v"
+		       << (bottom - rectangle.top) << "H" << rectangle.run.first
+		       << "z";
+	}
+
+	PathWriter(const PathWriter &);
+	PathWriter &operator=(const PathWriter &);
+};
 
 /**
- * This function renders the given QR code as an SVG image, writing the
- * resulting image data to the given QIODevice.
+ * This function writes the start of an SVG document for an image of the given
+ * size, in modules.
  *
- * \param dest The QIODevice to write image data to.
- * \param code The QR code to render.
+ * \param output The output to write to.
+ * \param width The width of the image, in modules.
+ * \param height The height of the image, in modules.
  */
-void renderQRCode(QIODevice &dest, const paper::qr::QRCode &code)
+void writeHeader(Output &output, std::size_t width, std::size_t height)
 {
-	int size = CELL_SIZE * code.getWidth();
-
-	QSvgGenerator generator;
-	generator.setOutputDevice(&dest);
-	generator.setResolution(size / IMAGE_SIZE_INCHES);
-	generator.setSize(QSize(size, size));
-	generator.setViewBox(QRect(0, 0, size, size));
-
-	QPainter painter;
-	painter.begin(&generator);
-	paintQRCode(code, painter);
-	painter.end();
+	// The height is rounded to the nearest thousandth of an inch.
+	uint64_t heightMils = (IMAGE_WIDTH_MILS * height + width / 2) / width;
+	char fraction[4] = {static_cast<char>('0' + heightMils / 100 % 10),
+	                    static_cast<char>('0' + heightMils / 10 % 10),
+	                    static_cast<char>('0' + heightMils % 10), '\0'};
+
+	output << "<?xml version=\"1.0\" encoding=\"UTF-8\" "
+	       << "standalone=\"no\"?>\n"
+	       << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" "
+	       << "width=\"" << IMAGE_WIDTH_MILS / 1000 << "in\" height=\""
+	       << heightMils / 1000 << "." << fraction << "in\" viewBox=\"0 0 "
+	       << width << " " << height << "\" "
+	       << "shape-rendering=\"crispEdges\">\n";
 }
 }
 
@@ -101,19 +269,68 @@ namespace paper
 {
 namespace render
 {
-SVG::SVG(const qr::QRCode &code) : data(), buffer(&data)
+void writeSVG(int fd, const symbol::Symbol &code)
 {
-	renderQRCode(buffer, code);
-}
+	const qr::ModuleMatrix &modules = code.getModules();
+	std::size_t width = modules.getWidth();
+	std::size_t height = modules.getHeight();
 
-const char *SVG::getData() const
-{
-	return data.data();
+	Output output(fd);
+	writeHeader(output, width, height);
+
+	PathWriter path(output, 0x000000);
+	std::vector<Run> runs;
+	for(std::size_t y = 0; y < height; ++y)
+	{
+		runs.clear();
+		modules.forEachDarkRun(
+		        y, [&runs](std::size_t x, std::size_t length)
+		        {
+			        runs.push_back(Run(x, length));
+			});
+		path.addRow(y, runs);
+	}
+	path.finish(height);
+
+	output << "</svg>\n";
+	output.flush();
 }
 
-std::size_t SVG::getDataSize() const
+void writeSVG(int fd, const Layers &layers)
 {
-	return static_cast<std::size_t>(data.size());
+	std::size_t width = getLayersWidth(layers);
+	std::size_t height = getLayersHeight(layers);
+
+	Output output(fd);
+	writeHeader(output, width, height);
+
+	// Each colour's path is written in turn, so only one row's runs are
+	// needed at a time.
+	std::vector<Run> runs;
+	for(uint8_t mask = 1; mask < (1 << LAYER_COUNT); ++mask)
+	{
+		PathWriter path(output, getLayersColor(mask));
+		for(std::size_t y = 0; y < height; ++y)
+		{
+			std::vector<uint8_t> row(getLayersRow(layers, y));
+			runs.clear();
+			for(std::size_t x = 0, end = 0; x < width; x = end)
+			{
+				end = x;
+				while((end < width) && (row[end] == mask))
+					++end;
+				if(end > x)
+					runs.push_back(Run(x, end - x));
+				else
+					++end;
+			}
+			path.addRow(y, runs);
+		}
+		path.finish(height);
+	}
+
+	output << "</svg>\n";
+	output.flush();
 }
 }
 }
@@ -16,51 +16,44 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <QByteArray>
-#include <QBuffer>
+#ifndef PAPER_RENDER_SVG_H
+#define PAPER_RENDER_SVG_H
 
-#include <cstddef>
+#include "PaperCommon/Render/Color.h"
 
 namespace paper
 {
-namespace qr
+namespace symbol
 {
-class QRCode;
+class Symbol;
 }
 
 namespace render
 {
 /**
- * \brief This class encapsulates an SVG version of a given QR code.
+ * This function writes an SVG image of the given symbol to the given file
+ * descriptor, as it is generated. Each module is one user unit, and the image
+ * is scaled to a fixed physical width. The dark modules are drawn as a single
+ * path, made of the rectangles formed by merging runs of dark modules within
+ * each row, and then identical runs in consecutive rows. If writing fails, an
+ * exception is thrown.
+ *
+ * \param fd The file descriptor to write the image to.
+ * \param code The symbol to render.
  */
-class SVG
-{
-public:
-	/**
-	 * Create a new SVG image version of the given raw QR code object.
-	 *
-	 * \param code The QR code to render.
-	 */
-	SVG(const qr::QRCode &code);
-
-	/**
-	 * This function returns a pointer to the resulting SVG image data.
-	 *
-	 * \return The given QR code's SVG image data.
-	 */
-	const char *getData() const;
-
-	/**
-	 * This function returns the length, in bytes, of the resulting SVG
-	 * image data.
-	 *
-	 * \return The length of the given QR code's SVG image data.
-	 */
-	std::size_t getDataSize() const;
+void writeSVG(int fd, const symbol::Symbol &code);
 
-private:
-	QByteArray data;
-	QBuffer buffer;
-};
+/**
+ * This function writes a colour SVG image, overlaying up to three symbols, one
+ * on each ink layer, to the given file descriptor. See Color.h for how the
+ * layers are combined. Each colour is drawn as one path, as above; white is
+ * left as the background.
+ *
+ * \param fd The file descriptor to write the image to.
+ * \param layers The symbol on each layer.
+ */
+void writeSVG(int fd, const Layers &layers);
 }
 }
+
+#endif
@@ -0,0 +1,657 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "SVGReader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+/**
+ * \brief The largest image, in modules, which is accepted. Our largest pages
+ * are a few hundred modules wide, so this only guards against bogus input.
+ */
+constexpr double MAXIMUM_MODULES = 4096.0;
+
+/**
+ * \brief This structure holds the inherited presentation state of an element:
+ * its fill colour, and the (axis-aligned) transform to the root's coordinates.
+ */
+struct Style
+{
+	bool filled;
+	uint32_t fill;
+	double scaleX;
+	double scaleY;
+	double translateX;
+	double translateY;
+
+	// Per the SVG specification, shapes are filled black by default.
+	Style()
+	        : filled(true),
+	          fill(0x000000),
+	          scaleX(1.0),
+	          scaleY(1.0),
+	          translateX(0.0),
+	          translateY(0.0)
+	{
+	}
+};
+
+/**
+ * \brief This type holds a point, as its x and y coordinates.
+ */
+typedef std::pair<double, double> Point;
+
+/**
+ * \brief This structure holds a filled rectangle, in the root's coordinates.
+ */
+struct Rect
+{
+	double left;
+	double top;
+	double right;
+	double bottom;
+	uint32_t fill;
+};
+
+/**
+ * This function finds the value of the given attribute in the given tag.
+ *
+ * \param tag The tag's text, between its angle brackets.
+ * \param name The name of the attribute to find.
+ * \param value The attribute's value is written here, if it was found.
+ * \return Whether the attribute was found.
+ */
+bool getAttribute(const std::string &tag, const std::string &name,
+                  std::string &value)
+{
+	std::string needle(name + "=");
+	for(std::size_t at = tag.find(needle); at != std::string::npos;
+	    at = tag.find(needle, at + 1))
+	{
+		// Make sure this isn't the end of some longer attribute name.
+		if((at == 0) || !std::isspace(static_cast<unsigned char>(
+		                        tag[at - 1])))
+		{
+			continue;
+		}
+
+		std::size_t open = at + needle.size();
+		if(open >= tag.size())
+			break;
+		char quote = tag[open];
+		std::size_t close = tag.find(quote, open + 1);
+		if(((quote != '"') && (quote != '\'')) ||
+		   (close == std::string::npos))
+		{
+			throw std::runtime_error("SVG attribute is malformed.");
+		}
+
+		value = tag.substr(open + 1, close - open - 1);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * This function skips past any whitespace and/or commas, which separate the
+ * numbers in lists and path data.
+ *
+ * \param position The position to advance.
+ */
+void skipSeparators(const char *&position)
+{
+	while((*position != '\0') &&
+	      (std::isspace(static_cast<unsigned char>(*position)) ||
+	       (*position == ',')))
+	{
+		++position;
+	}
+}
+
+/**
+ * This function parses the given list of numbers, separated by whitespace
+ * and/or commas.
+ *
+ * \param text The text to parse.
+ * \return The numbers.
+ */
+std::vector<double> parseNumbers(const std::string &text)
+{
+	std::vector<double> numbers;
+	const char *position = text.c_str();
+	while(true)
+	{
+		skipSeparators(position);
+		if(*position == '\0')
+			return numbers;
+
+		char *end = nullptr;
+		double number = std::strtod(position, &end);
+		if((end == position) || !std::isfinite(number))
+			throw std::runtime_error("SVG number is malformed.");
+		numbers.push_back(number);
+		position = end;
+	}
+}
+
+/**
+ * This function returns the value of the given numeric attribute.
+ *
+ * \param tag The tag's text, between its angle brackets.
+ * \param name The name of the attribute.
+ * \param def The value to return if the attribute isn't present.
+ * \return The attribute's value.
+ */
+double getNumber(const std::string &tag, const std::string &name, double def)
+{
+	std::string value;
+	if(!getAttribute(tag, name, value))
+		return def;
+
+	std::vector<double> numbers(parseNumbers(value));
+	if(numbers.size() != 1)
+		throw std::runtime_error("SVG attribute is malformed.");
+	return numbers[0];
+}
+
+/**
+ * This function parses a fill colour: "none", "black", "white", or a
+ * hexadecimal colour in either the short (#rgb) or long (#rrggbb) form.
+ *
+ * \param value The colour to parse.
+ * \param style The style to update with the colour.
+ */
+void parseFill(const std::string &value, Style &style)
+{
+	style.filled = value != "none";
+	if(!style.filled)
+		return;
+
+	if((value == "black") || (value == "white"))
+	{
+		style.fill = value == "black" ? 0x000000 : 0xFFFFFF;
+		return;
+	}
+
+	bool valid = (value.size() == 4) || (value.size() == 7);
+	valid = valid && (value[0] == '#') &&
+	        (value.find_first_not_of("0123456789abcdefABCDEF", 1) ==
+	         std::string::npos);
+	if(!valid)
+		throw std::runtime_error("Unsupported SVG colour: " + value);
+
+	uint32_t color = static_cast<uint32_t>(
+	        std::strtoul(value.c_str() + 1, nullptr, 16));
+	if(value.size() == 4)
+	{
+		// Each digit of the short form is repeated.
+		uint32_t r = (color >> 8) & 0xF;
+		uint32_t g = (color >> 4) & 0xF;
+		uint32_t b = color & 0xF;
+		color = (r * 0x11) << 16 | (g * 0x11) << 8 | (b * 0x11);
+	}
+	style.fill = color;
+}
+
+/**
+ * This function applies the given transform attribute to the given style.
+ * Only scaling and translation are supported, since our renderer never
+ * rotates or skews anything.
+ *
+ * \param value The transform to apply.
+ * \param style The style to update.
+ */
+void parseTransform(const std::string &value, Style &style)
+{
+	std::size_t open = value.find('(');
+	std::size_t close = value.find(')');
+	if((open == std::string::npos) || (close == std::string::npos) ||
+	   (close < open) ||
+	   (value.find_first_not_of(" \t\r\n", close + 1) != std::string::npos))
+	{
+		throw std::runtime_error("Unsupported SVG transform: " + value);
+	}
+
+	std::size_t first = value.find_first_not_of(" \t\r\n");
+	std::size_t last = value.find_last_not_of(" \t\r\n", open - 1);
+	std::string kind;
+	if((first < open) && (last != std::string::npos))
+		kind = value.substr(first, last - first + 1);
+	std::vector<double> args(
+	        parseNumbers(value.substr(open + 1, close - open - 1)));
+
+	double a = 1.0;
+	double d = 1.0;
+	double e = 0.0;
+	double f = 0.0;
+	if((kind == "matrix") && (args.size() == 6) && (args[1] == 0.0) &&
+	   (args[2] == 0.0))
+	{
+		a = args[0];
+		d = args[3];
+		e = args[4];
+		f = args[5];
+	}
+	else if((kind == "translate") && !args.empty() && (args.size() <= 2))
+	{
+		e = args[0];
+		f = args.size() == 2 ? args[1] : 0.0;
+	}
+	else if((kind == "scale") && !args.empty() && (args.size() <= 2))
+	{
+		a = args[0];
+		d = args.size() == 2 ? args[1] : a;
+	}
+	else
+	{
+		throw std::runtime_error("Unsupported SVG transform: " + value);
+	}
+
+	// The element's own transform applies first, then its parent's.
+	style.translateX += style.scaleX * e;
+	style.translateY += style.scaleY * f;
+	style.scaleX *= a;
+	style.scaleY *= d;
+}
+
+/**
+ * This function applies the presentation attributes of the given tag to the
+ * style it inherited.
+ *
+ * \param tag The tag's text, between its angle brackets.
+ * \param style The inherited style, to update.
+ */
+void applyStyle(const std::string &tag, Style &style)
+{
+	std::string value;
+	if(getAttribute(tag, "fill", value))
+		parseFill(value, style);
+	if(getAttribute(tag, "transform", value))
+		parseTransform(value, style);
+}
+
+/**
+ * This function adds a filled rectangle, given in the coordinates of an
+ * element with the given style.
+ *
+ * \param style The element's style.
+ * \param x The left edge of the rectangle.
+ * \param y The top edge of the rectangle.
+ * \param w The width of the rectangle.
+ * \param h The height of the rectangle.
+ * \param rects The list of rectangles to add to.
+ */
+void addRect(const Style &style, double x, double y, double w, double h,
+             std::vector<Rect> &rects)
+{
+	Rect rect;
+	rect.left = style.translateX + style.scaleX * x;
+	rect.top = style.translateY + style.scaleY * y;
+	rect.right = rect.left + style.scaleX * w;
+	rect.bottom = rect.top + style.scaleY * h;
+	if(rect.right < rect.left)
+		std::swap(rect.left, rect.right);
+	if(rect.bottom < rect.top)
+		std::swap(rect.top, rect.bottom);
+	rect.fill = style.fill;
+	rects.push_back(rect);
+}
+
+/**
+ * This function adds the rectangle outlined by the given subpath. Our renderer
+ * only draws axis-aligned rectangles, so anything else is rejected.
+ *
+ * \param style The path's style.
+ * \param points The subpath's vertices, in order.
+ * \param rects The list of rectangles to add to.
+ */
+void addSubpath(const Style &style, std::vector<Point> &points,
+                std::vector<Rect> &rects)
+{
+	if((points.size() > 1) && (points.back() == points.front()))
+		points.pop_back();
+	if(points.size() <= 1)
+	{
+		points.clear();
+		return;
+	}
+
+	double left = points[0].first;
+	double right = left;
+	double top = points[0].second;
+	double bottom = top;
+	for(const Point &point : points)
+	{
+		left = std::min(left, point.first);
+		right = std::max(right, point.first);
+		top = std::min(top, point.second);
+		bottom = std::max(bottom, point.second);
+	}
+
+	// Every edge must be horizontal or vertical, and every vertex must be
+	// a corner of the bounding box.
+	bool rectangular = points.size() == 4;
+	for(std::size_t i = 0; rectangular && (i < points.size()); ++i)
+	{
+		const Point &a = points[i];
+		const Point &b =
+		        points[(i + 1) % points.size()];
+		rectangular = ((a.first == left) || (a.first == right)) &&
+		              ((a.second == top) || (a.second == bottom)) &&
+		              ((a.first == b.first) != (a.second == b.second));
+	}
+	if(!rectangular)
+		throw std::runtime_error("SVG path isn't a rectangle.");
+
+	addRect(style, left, top, right - left, bottom - top, rects);
+	points.clear();
+}
+
+/**
+ * This function adds the rectangles drawn by the given path data. Only the
+ * moveto, lineto (including horizontal and vertical) and closepath commands
+ * are supported.
+ *
+ * \param style The path's style.
+ * \param d The path data.
+ * \param rects The list of rectangles to add to.
+ */
+void parsePath(const Style &style, const std::string &d,
+               std::vector<Rect> &rects)
+{
+	std::vector<Point> points;
+	double x = 0.0;
+	double y = 0.0;
+	char command = '\0';
+	const char *position = d.c_str();
+	while(true)
+	{
+		skipSeparators(position);
+		if(*position == '\0')
+			break;
+
+		if(std::isalpha(static_cast<unsigned char>(*position)))
+		{
+			command = *(position++);
+			if((command == 'Z') || (command == 'z'))
+			{
+				if(!points.empty())
+				{
+					x = points.front().first;
+					y = points.front().second;
+				}
+				addSubpath(style, points, rects);
+				continue;
+			}
+			if(std::string("MmLlHhVv").find(command) ==
+			   std::string::npos)
+			{
+				throw std::runtime_error(
+				        "Unsupported SVG path command.");
+			}
+			continue;
+		}
+
+		// Each command takes as many arguments as it's given.
+		std::size_t count =
+		        std::string("HhVv").find(command) != std::string::npos
+		                ? 1
+		                : 2;
+		double args[2];
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			skipSeparators(position);
+			char *end = nullptr;
+			args[i] = std::strtod(position, &end);
+			if((command == '\0') || (end == position) ||
+			   !std::isfinite(args[i]))
+			{
+				throw std::runtime_error(
+				        "SVG path is malformed.");
+			}
+			position = end;
+		}
+
+		bool relative =
+		        std::islower(static_cast<unsigned char>(command)) != 0;
+		switch(std::toupper(static_cast<unsigned char>(command)))
+		{
+		case 'M':
+			addSubpath(style, points, rects);
+			x = args[0] + (relative ? x : 0.0);
+			y = args[1] + (relative ? y : 0.0);
+			// Further pairs of arguments are implicit linetos.
+			command = relative ? 'l' : 'L';
+			break;
+		case 'L':
+			x = args[0] + (relative ? x : 0.0);
+			y = args[1] + (relative ? y : 0.0);
+			break;
+		case 'H':
+			x = args[0] + (relative ? x : 0.0);
+			break;
+		case 'V':
+			y = args[0] + (relative ? y : 0.0);
+			break;
+		default:
+			throw std::runtime_error("SVG path is malformed.");
+		}
+		points.push_back(std::make_pair(x, y));
+	}
+	addSubpath(style, points, rects);
+}
+
+/**
+ * This function returns the greatest common divisor of two non-negative
+ * integers.
+ *
+ * \param a The first integer.
+ * \param b The second integer.
+ * \return Their greatest common divisor.
+ */
+long getDivisor(long a, long b)
+{
+	while(b != 0)
+	{
+		long r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+/**
+ * This function rounds the given coordinate to an integer, which it must
+ * (nearly) be already, since our renderer only draws whole modules.
+ *
+ * \param value The coordinate to round.
+ * \return The rounded coordinate.
+ */
+long roundCoordinate(double value)
+{
+	double rounded = std::round(value);
+	if((std::fabs(value - rounded) > 1e-3) ||
+	   (std::fabs(rounded) > 1e12))
+	{
+		throw std::runtime_error("SVG rectangle isn't aligned to the "
+		                         "module grid.");
+	}
+	return static_cast<long>(rounded);
+}
+}
+
+namespace paper
+{
+namespace render
+{
+Image readSVG(const uint8_t *data, std::size_t size)
+{
+	std::string document(reinterpret_cast<const char *>(data), size);
+
+	// Walk through every tag, tracking the style each group passes on to
+	// its children.
+
+	std::vector<Style> styles(1);
+	std::vector<Rect> rects;
+	double viewWidth = 0.0;
+	double viewHeight = 0.0;
+	bool root = false;
+	for(std::size_t open = document.find('<'); open != std::string::npos;
+	    open = document.find('<', open + 1))
+	{
+		if(document.compare(open, 4, "<!--") == 0)
+		{
+			open = document.find("-->", open);
+			if(open == std::string::npos)
+				break;
+			continue;
+		}
+
+		std::size_t close = document.find('>', open);
+		if(close == std::string::npos)
+			throw std::runtime_error("SVG document is truncated.");
+
+		std::string tag(document.substr(open + 1, close - open - 1));
+		bool empty = !tag.empty() && (tag.back() == '/');
+		std::size_t nameEnd = tag.find_first_of(" \t\r\n/");
+		std::string name(tag.substr(0, nameEnd));
+		open = close;
+
+		if(name == "svg")
+		{
+			std::string value;
+			std::vector<double> box;
+			if(getAttribute(tag, "viewBox", value))
+				box = parseNumbers(value);
+			if(box.size() != 4)
+			{
+				throw std::runtime_error(
+				        "SVG document has no view box.");
+			}
+			viewWidth = box[2];
+			viewHeight = box[3];
+			root = true;
+		}
+		else if(name == "g")
+		{
+			Style style(styles.back());
+			applyStyle(tag, style);
+			if(!empty)
+				styles.push_back(style);
+		}
+		else if(name == "/g")
+		{
+			if(styles.size() > 1)
+				styles.pop_back();
+		}
+		else if(name == "rect")
+		{
+			Style style(styles.back());
+			applyStyle(tag, style);
+			if(!style.filled)
+				continue;
+
+			addRect(style, getNumber(tag, "x", 0.0),
+			        getNumber(tag, "y", 0.0),
+			        getNumber(tag, "width", 0.0),
+			        getNumber(tag, "height", 0.0), rects);
+		}
+		else if(name == "path")
+		{
+			Style style(styles.back());
+			applyStyle(tag, style);
+			std::string d;
+			if(style.filled && getAttribute(tag, "d", d))
+				parsePath(style, d, rects);
+		}
+	}
+
+	if(!root)
+		throw std::runtime_error("Not an SVG document.");
+
+	// Every rectangle covers whole modules, so the module size is the
+	// largest size they're all multiples of.
+
+	long cell = 0;
+	for(const Rect &rect : rects)
+	{
+		for(double value : {rect.left, rect.top, rect.right - rect.left,
+		                    rect.bottom - rect.top})
+		{
+			cell = getDivisor(std::labs(roundCoordinate(value)),
+			                  cell);
+		}
+	}
+	if(cell == 0)
+		throw std::runtime_error("SVG document has no modules.");
+
+	double cellSize = static_cast<double>(cell);
+	double width = viewWidth / cellSize;
+	double height = viewHeight / cellSize;
+	if((width < 1.0) || (height < 1.0) || (width > MAXIMUM_MODULES) ||
+	   (height > MAXIMUM_MODULES))
+	{
+		throw std::runtime_error("SVG document has an invalid size.");
+	}
+
+	Image image(static_cast<std::size_t>(roundCoordinate(width)),
+	            static_cast<std::size_t>(roundCoordinate(height)), 3);
+	for(const Rect &rect : rects)
+	{
+		long left = roundCoordinate(rect.left) / cell;
+		long top = roundCoordinate(rect.top) / cell;
+		long right = roundCoordinate(rect.right) / cell;
+		long bottom = roundCoordinate(rect.bottom) / cell;
+		if((left < 0) || (top < 0) ||
+		   (right > static_cast<long>(image.width)) ||
+		   (bottom > static_cast<long>(image.height)))
+		{
+			throw std::runtime_error(
+			        "SVG rectangle is outside the image.");
+		}
+
+		uint8_t r = static_cast<uint8_t>(rect.fill >> 16);
+		uint8_t g = static_cast<uint8_t>(rect.fill >> 8);
+		uint8_t b = static_cast<uint8_t>(rect.fill);
+		for(long y = top; y < bottom; ++y)
+		{
+			uint8_t *pixel =
+			        image.getPixel(static_cast<std::size_t>(left),
+			                       static_cast<std::size_t>(y));
+			for(long x = left; x < right; ++x, pixel += 3)
+			{
+				pixel[0] = r;
+				pixel[1] = g;
+				pixel[2] = b;
+			}
+		}
+	}
+	return image;
+}
+}
+}
@@ -0,0 +1,49 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_RENDER_SVG_READER_H
+#define PAPER_RENDER_SVG_READER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "PaperCommon/Render/Image.h"
+
+namespace paper
+{
+namespace render
+{
+/**
+ * This function reads back an SVG image written by writeSVG, without
+ * rasterizing it: each filled rectangle is drawn into an RGB image with one
+ * pixel per module. The module size is the largest one every rectangle is
+ * aligned to. Only the subset of SVG our own renderer (or Qt's SVG generator)
+ * emits is supported: rectangles, and paths made of axis-aligned rectangles,
+ * filled with solid colours, in groups which may be scaled and translated.
+ * If the image can't be read, an exception is thrown instead.
+ *
+ * \param data The SVG document.
+ * \param size The size of the document, in bytes.
+ * \return The image, with one pixel per module.
+ */
+Image readSVG(const uint8_t *data, std::size_t size);
+}
+}
+
+#endif
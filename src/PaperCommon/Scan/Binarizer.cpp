@@ -0,0 +1,376 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Binarizer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#if(defined(__x86_64__) || defined(__i386__)) && \
+        (defined(__GNUC__) || defined(__clang__))
+#define PAPER_BINARIZER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// The width and height of the blocks statistics are gathered for.
+constexpr std::size_t BLOCK_SIZE = 8;
+
+// Each block's threshold is the mean of the blocks this far around it.
+constexpr std::size_t BLOCK_RADIUS = 2;
+
+/**
+ * \brief Blocks whose brightest and darkest pixels are at most this far
+ * apart are assumed to contain no edges, i.e. to be all one color.
+ */
+constexpr unsigned int MIN_DYNAMIC_RANGE = 24;
+
+/**
+ * \brief This structure holds the statistics of one block of pixels.
+ */
+struct BlockStats
+{
+	unsigned int minimum;
+	unsigned int maximum;
+	unsigned int sum;
+};
+
+/**
+ * \brief This type denotes an implementation of the block statistics
+ * computation. It is given the top-left pixel of the first of a row of
+ * adjacent blocks, the image's stride, and the number of blocks.
+ */
+typedef void (*StatsFunction)(const uint8_t *, std::size_t, std::size_t,
+                              BlockStats *);
+
+/**
+ * \brief This type denotes an implementation of the thresholding of one row
+ * of pixels. It is given the row, the threshold of each block the row
+ * passes through, the row's width, and the (zeroed) words to set the dark
+ * pixels' bits in.
+ */
+typedef void (*ThresholdFunction)(const uint8_t *, const uint8_t *,
+                                  std::size_t, uint64_t *);
+
+/**
+ * This function computes block statistics one pixel at a time.
+ *
+ * \param pixels The top-left pixel of the first block.
+ * \param stride The distance between rows of pixels.
+ * \param count The number of adjacent blocks.
+ * \param stats The array to write each block's statistics to.
+ */
+void getStatsScalar(const uint8_t *pixels, std::size_t stride,
+                    std::size_t count, BlockStats *stats)
+{
+	for(std::size_t b = 0; b < count; ++b)
+	{
+		BlockStats &block = stats[b];
+		block.minimum = 255;
+		block.maximum = 0;
+		block.sum = 0;
+		for(std::size_t y = 0; y < BLOCK_SIZE; ++y)
+		{
+			const uint8_t *row =
+			        pixels + y * stride + b * BLOCK_SIZE;
+			for(std::size_t x = 0; x < BLOCK_SIZE; ++x)
+			{
+				block.minimum = std::min<unsigned int>(
+				        block.minimum, row[x]);
+				block.maximum = std::max<unsigned int>(
+				        block.maximum, row[x]);
+				block.sum += row[x];
+			}
+		}
+	}
+}
+
+/**
+ * This function thresholds a row of pixels one pixel at a time.
+ *
+ * \param pixels The row of pixels.
+ * \param thresholds The threshold of each block along the row.
+ * \param width The number of pixels in the row.
+ * \param bits The words to set each dark pixel's bit in.
+ */
+void thresholdScalar(const uint8_t *pixels, const uint8_t *thresholds,
+                     std::size_t width, uint64_t *bits)
+{
+	for(std::size_t x = 0; x < width; ++x)
+	{
+		if(pixels[x] <= thresholds[x / BLOCK_SIZE])
+			bits[x / 64] |= UINT64_C(1) << (x % 64);
+	}
+}
+
+#ifdef PAPER_BINARIZER_SSE2
+/**
+ * This function computes block statistics with SSE2, two blocks at a time:
+ * each row of the pair is one 16 byte vector, whose halves are summed with
+ * a sum of absolute differences against zero.
+ *
+ * \param pixels The top-left pixel of the first block.
+ * \param stride The distance between rows of pixels.
+ * \param count The number of adjacent blocks.
+ * \param stats The array to write each block's statistics to.
+ */
+__attribute__((target("sse2"))) void
+getStatsSSE2(const uint8_t *pixels, std::size_t stride, std::size_t count,
+             BlockStats *stats)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	std::size_t b = 0;
+	for(; b + 2 <= count; b += 2)
+	{
+		__m128i minimum = _mm_set1_epi8(-1);
+		__m128i maximum = zero;
+		__m128i sum = zero;
+		for(std::size_t y = 0; y < BLOCK_SIZE; ++y)
+		{
+			__m128i row = _mm_loadu_si128(
+			        reinterpret_cast<const __m128i *>(
+			                pixels + y * stride + b * BLOCK_SIZE));
+			minimum = _mm_min_epu8(minimum, row);
+			maximum = _mm_max_epu8(maximum, row);
+			sum = _mm_add_epi64(sum, _mm_sad_epu8(row, zero));
+		}
+
+		alignas(16) uint8_t minimums[16];
+		alignas(16) uint8_t maximums[16];
+		_mm_store_si128(reinterpret_cast<__m128i *>(minimums), minimum);
+		_mm_store_si128(reinterpret_cast<__m128i *>(maximums), maximum);
+
+		for(std::size_t half = 0; half < 2; ++half)
+		{
+			const uint8_t *lo = minimums + half * BLOCK_SIZE;
+			const uint8_t *hi = maximums + half * BLOCK_SIZE;
+			stats[b + half].minimum = *std::min_element(lo, lo + 8);
+			stats[b + half].maximum = *std::max_element(hi, hi + 8);
+		}
+		stats[b].sum =
+		        static_cast<unsigned int>(_mm_cvtsi128_si32(sum));
+		stats[b + 1].sum = static_cast<unsigned int>(
+		        _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+	}
+
+	getStatsScalar(pixels + b * BLOCK_SIZE, stride, count - b, stats + b);
+}
+
+/**
+ * This function thresholds a row of pixels with SSE2, 16 pixels (two
+ * blocks) at a time. A pixel is dark if it is at most its threshold, i.e.
+ * if it is the unsigned minimum of the two; the comparison's byte mask is
+ * then packed down to one bit per pixel.
+ *
+ * \param pixels The row of pixels.
+ * \param thresholds The threshold of each block along the row.
+ * \param width The number of pixels in the row.
+ * \param bits The words to set each dark pixel's bit in.
+ */
+__attribute__((target("sse2"))) void
+thresholdSSE2(const uint8_t *pixels, const uint8_t *thresholds,
+              std::size_t width, uint64_t *bits)
+{
+	const uint64_t spread = UINT64_C(0x0101010101010101);
+
+	std::size_t x = 0;
+	for(; x + 16 <= width; x += 16)
+	{
+		const uint8_t *t = thresholds + x / BLOCK_SIZE;
+		__m128i threshold =
+		        _mm_set_epi64x(static_cast<long long>(t[1] * spread),
+		                       static_cast<long long>(t[0] * spread));
+		__m128i row = _mm_loadu_si128(
+		        reinterpret_cast<const __m128i *>(pixels + x));
+		__m128i dark =
+		        _mm_cmpeq_epi8(_mm_min_epu8(row, threshold), row);
+
+		// Vectors never straddle words, since x is a multiple of 16.
+		uint64_t mask = static_cast<uint16_t>(_mm_movemask_epi8(dark));
+		bits[x / 64] |= mask << (x % 64);
+	}
+
+	for(; x < width; ++x)
+	{
+		if(pixels[x] <= thresholds[x / BLOCK_SIZE])
+			bits[x / 64] |= UINT64_C(1) << (x % 64);
+	}
+}
+#endif
+
+/**
+ * This function returns the fastest block statistics implementation the
+ * processor we're running on supports.
+ *
+ * \return The implementation to use.
+ */
+StatsFunction getStatsFunction()
+{
+#ifdef PAPER_BINARIZER_SSE2
+	if(__builtin_cpu_supports("sse2"))
+		return getStatsSSE2;
+#endif
+	return getStatsScalar;
+}
+
+/**
+ * This function returns the fastest thresholding implementation the
+ * processor we're running on supports.
+ *
+ * \return The implementation to use.
+ */
+ThresholdFunction getThresholdFunction()
+{
+#ifdef PAPER_BINARIZER_SSE2
+	if(__builtin_cpu_supports("sse2"))
+		return thresholdSSE2;
+#endif
+	return thresholdScalar;
+}
+
+/**
+ * This function computes the mean brightness of every block of the given
+ * image. The last row and column of blocks are moved back to fit inside the
+ * image, overlapping their neighbors, if the image's size isn't a multiple
+ * of the block size.
+ *
+ * \param image The grayscale image.
+ * \param columns The number of blocks in each row.
+ * \param rows The number of rows of blocks.
+ * \return The mean of each block, row by row.
+ */
+std::vector<uint8_t> getBlockMeans(const paper::render::Image &image,
+                                   std::size_t columns, std::size_t rows)
+{
+	static const StatsFunction getStats = getStatsFunction();
+
+	std::size_t w = image.width;
+	std::size_t fullColumns = w / BLOCK_SIZE;
+	std::vector<uint8_t> means(columns * rows);
+	std::vector<BlockStats> stats(columns);
+
+	for(std::size_t by = 0; by < rows; ++by)
+	{
+		std::size_t top =
+		        std::min(by * BLOCK_SIZE, image.height - BLOCK_SIZE);
+		const uint8_t *pixels = image.getPixel(0, top);
+		getStats(pixels, w, fullColumns, stats.data());
+		if(columns > fullColumns)
+		{
+			getStats(pixels + w - BLOCK_SIZE, w, 1,
+			         stats.data() + fullColumns);
+		}
+
+		uint8_t *mean = means.data() + by * columns;
+		for(std::size_t bx = 0; bx < columns; ++bx)
+		{
+			const BlockStats &block = stats[bx];
+			unsigned int value =
+			        block.sum / (BLOCK_SIZE * BLOCK_SIZE);
+
+			// A flat block is most likely light background, so we
+			// put its threshold below its darkest pixel. But if
+			// its neighbors (which have already been computed)
+			// are brighter still, it is probably inside a dark
+			// area instead, so we use their mean.
+			if(block.maximum - block.minimum <= MIN_DYNAMIC_RANGE)
+			{
+				value = block.minimum / 2;
+				if((by > 0) && (bx > 0))
+				{
+					const uint8_t *above = mean - columns;
+					unsigned int neighbors =
+					        (above[bx] + 2u * mean[bx - 1] +
+					         above[bx - 1]) /
+					        4;
+					if(block.minimum < neighbors)
+						value = neighbors;
+				}
+			}
+
+			mean[bx] = static_cast<uint8_t>(value);
+		}
+	}
+
+	return means;
+}
+}
+
+namespace paper
+{
+namespace scan
+{
+qr::ModuleMatrix binarize(const render::Image &image)
+{
+	static const ThresholdFunction threshold = getThresholdFunction();
+
+	if(image.channels != 1)
+	{
+		throw std::runtime_error(
+		        "Only grayscale images can be binarized.");
+	}
+	if((image.width < BLOCK_SIZE) || (image.height < BLOCK_SIZE))
+		throw std::runtime_error("Image is too small to scan.");
+
+	std::size_t columns = (image.width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	std::size_t rows = (image.height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	std::vector<uint8_t> means(getBlockMeans(image, columns, rows));
+
+	// Each block's threshold is the mean of the blocks around it, so a
+	// symbol's modules are compared against both light and dark areas.
+	std::vector<uint8_t> thresholds(columns * rows);
+	for(std::size_t by = 0; by < rows; ++by)
+	{
+		std::size_t top = by - std::min(by, BLOCK_RADIUS);
+		std::size_t bottom = std::min(by + BLOCK_RADIUS + 1, rows);
+		for(std::size_t bx = 0; bx < columns; ++bx)
+		{
+			std::size_t left = bx - std::min(bx, BLOCK_RADIUS);
+			std::size_t right =
+			        std::min(bx + BLOCK_RADIUS + 1, columns);
+
+			unsigned int sum = 0;
+			for(std::size_t y = top; y < bottom; ++y)
+			{
+				for(std::size_t x = left; x < right; ++x)
+					sum += means[y * columns + x];
+			}
+
+			std::size_t count = (bottom - top) * (right - left);
+			thresholds[by * columns + bx] =
+			        static_cast<uint8_t>(sum / count);
+		}
+	}
+
+	qr::ModuleMatrix bits(image.width, image.height);
+	for(std::size_t y = 0; y < image.height; ++y)
+	{
+		const uint8_t *rowThresholds =
+		        thresholds.data() + y / BLOCK_SIZE * columns;
+		threshold(image.getPixel(0, y), rowThresholds, image.width,
+		          bits.getRow(y));
+	}
+	return bits;
+}
+}
+}
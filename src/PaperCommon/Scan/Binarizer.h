@@ -0,0 +1,48 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAPER_SCAN_BINARIZER_H
+#define PAPER_SCAN_BINARIZER_H
+
+#include "PaperCommon/QR/ModuleMatrix.h"
+#include "PaperCommon/Render/Image.h"
+
+namespace paper
+{
+namespace scan
+{
+/**
+ * This function converts the given grayscale image to black and white with
+ * an adaptive threshold, so uneven lighting or toner across a scan doesn't
+ * matter. The image is divided into 8x8 pixel blocks, and each pixel is
+ * compared against the mean brightness of the 5x5 blocks around its own.
+ * Blocks with too little contrast to contain any edges are assumed to be
+ * background. Both the block statistics and the comparisons are computed 16
+ * pixels at a time with SSE2, where available.
+ *
+ * The result has one bit per pixel, which is set for dark pixels. If the
+ * image is too small to contain a symbol, an exception is thrown.
+ *
+ * \param image The grayscale image to convert.
+ * \return The black and white image.
+ */
+qr::ModuleMatrix binarize(const render::Image &image);
+}
+}
+
+#endif
@@ -0,0 +1,847 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Detector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <utility>
+
+#include "PaperCommon/QR/Decoder.h"
+#include "PaperCommon/QR/Layout.h"
+
+namespace
+{
+/**
+ * \brief Finder patterns must be seen on at least this many rows, to weed
+ * out patterns which only happen to look right on a single line.
+ */
+constexpr std::size_t FINDER_QUORUM = 2;
+
+// How far each run across a finder pattern's diagonal may be off, in modules.
+constexpr double DIAGONAL_TOLERANCE = 0.75;
+
+/**
+ * \brief Only this many of the most often seen finder pattern candidates
+ * are considered when choosing the code's three patterns.
+ */
+constexpr std::size_t MAX_FINDER_CANDIDATES = 12;
+
+// How many versions either side of the estimate are tried when reading the
+// version information.
+constexpr int VERSION_SEARCH_DISTANCE = 2;
+
+/**
+ * \brief How far from its expected position the alignment pattern is first
+ * searched for, in modules. The search area is doubled until it reaches a
+ * quarter of the code's width, since perspective pushes the pattern further
+ * from where the affine transform expects it in larger codes.
+ */
+constexpr double ALIGNMENT_SEARCH_MODULES = 4.0;
+
+// How many of an alignment pattern's 25 modules must be right to accept it.
+constexpr std::size_t ALIGNMENT_QUORUM = 24;
+
+/**
+ * \brief This structure holds a point in an image, in pixels. Pixel (x, y)
+ * covers [x, x + 1) horizontally and [y, y + 1) vertically.
+ */
+struct Point
+{
+	double x;
+	double y;
+
+	Point(double px = 0.0, double py = 0.0) : x(px), y(py)
+	{
+	}
+
+	Point operator+(const Point &o) const
+	{
+		return Point(x + o.x, y + o.y);
+	}
+
+	Point operator-(const Point &o) const
+	{
+		return Point(x - o.x, y - o.y);
+	}
+
+	Point operator*(double s) const
+	{
+		return Point(x * s, y * s);
+	}
+};
+
+/**
+ * \param a The first point.
+ * \param b The second point.
+ * \return The distance between the two points.
+ */
+double getDistance(const Point &a, const Point &b)
+{
+	return std::hypot(a.x - b.x, a.y - b.y);
+}
+
+/**
+ * \brief This structure holds a (candidate) finder pattern.
+ */
+struct FinderPattern
+{
+	Point center;
+
+	// The pattern's estimated module size, in pixels.
+	double moduleSize;
+
+	// The number of rows the pattern has been seen on.
+	std::size_t count;
+};
+
+/**
+ * This function returns whether the given bit of the image is set, treating
+ * everything outside the image as light.
+ *
+ * \param bits The black and white image.
+ * \param x The column of the pixel.
+ * \param y The row of the pixel.
+ * \return Whether the pixel is dark.
+ */
+bool isDark(const paper::qr::ModuleMatrix &bits, long x, long y)
+{
+	if((x < 0) || (y < 0))
+		return false;
+
+	std::size_t column = static_cast<std::size_t>(x);
+	std::size_t row = static_cast<std::size_t>(y);
+	return (column < bits.getWidth()) && (row < bits.getHeight()) &&
+	       bits.get(column, row);
+}
+
+/**
+ * This function returns whether the given pixel is dark, treating anything
+ * outside the image as light.
+ *
+ * \param bits The black and white image.
+ * \param p The point to sample.
+ * \return Whether the pixel containing the point is dark.
+ */
+bool isDark(const paper::qr::ModuleMatrix &bits, const Point &p)
+{
+	return isDark(bits, static_cast<long>(std::floor(p.x)),
+	              static_cast<long>(std::floor(p.y)));
+}
+
+/**
+ * This function returns whether the given run lengths (dark, light, dark,
+ * light, dark) are in the ratio 1:1:3:1:1 of a line through the center of a
+ * finder pattern.
+ *
+ * \param counts The five run lengths.
+ * \param tolerance How far each run may be off, in modules.
+ * \return Whether the runs look like a finder pattern.
+ */
+bool isFinderRatio(const long *counts, double tolerance = 0.5)
+{
+	long total = 0;
+	for(std::size_t i = 0; i < 5; ++i)
+	{
+		if(counts[i] == 0)
+			return false;
+		total += counts[i];
+	}
+	if(total < 7)
+		return false;
+
+	double moduleSize = static_cast<double>(total) / 7.0;
+	double variance = moduleSize * tolerance;
+	for(std::size_t i = 0; i < 5; ++i)
+	{
+		double expected = (i == 2) ? 3.0 : 1.0;
+		double error = std::fabs(expected * moduleSize -
+		                         static_cast<double>(counts[i]));
+		if(error >= expected * variance)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * This function measures the runs of a finder pattern along the line
+ * through the given (dark) pixel in the given direction, and checks that
+ * they are in the right ratio.
+ *
+ * \param bits The black and white image.
+ * \param x The column of the pixel, inside the pattern's center.
+ * \param y The row of the pixel, inside the pattern's center.
+ * \param dx The horizontal step along the line.
+ * \param dy The vertical step along the line.
+ * \param offset The number of steps from the pixel to the center of the
+ * pattern is written here.
+ * \param total The total length of the runs, in steps, is written here.
+ * \param tolerance How far each run may be off, in modules.
+ * \return Whether the line looks like it passes through a finder pattern.
+ */
+bool measureCross(const paper::qr::ModuleMatrix &bits, long x, long y, long dx,
+                  long dy, double &offset, double &total,
+                  double tolerance = 0.5)
+{
+	long w = static_cast<long>(bits.getWidth());
+	long h = static_cast<long>(bits.getHeight());
+	auto dark = [&](long i)
+	{
+		return isDark(bits, x + i * dx, y + i * dy);
+	};
+	auto inside = [&](long i)
+	{
+		long px = x + i * dx;
+		long py = y + i * dy;
+		return (px >= 0) && (py >= 0) && (px < w) && (py < h);
+	};
+
+	if(!dark(0))
+		return false;
+
+	long counts[5] = {0};
+	long i = 0;
+	for(; dark(i); --i)
+		++counts[2];
+	for(; inside(i) && !dark(i); --i)
+		++counts[1];
+	for(; dark(i); --i)
+		++counts[0];
+
+	long j = 1;
+	for(; dark(j); ++j)
+		++counts[2];
+	long centerEnd = j;
+	for(; inside(j) && !dark(j); ++j)
+		++counts[3];
+	for(; dark(j); ++j)
+		++counts[4];
+
+	if(!isFinderRatio(counts, tolerance))
+		return false;
+
+	offset = static_cast<double>(centerEnd) -
+	         static_cast<double>(counts[2]) / 2.0;
+	total = static_cast<double>(j - i - 1);
+	return true;
+}
+
+/**
+ * This function checks a finder pattern candidate found on a row, by
+ * measuring it vertically, horizontally (again, through its refined center)
+ * and diagonally. If it passes, it is merged into the list of patterns
+ * found so far.
+ *
+ * \param bits The black and white image.
+ * \param x The horizontal center of the candidate.
+ * \param y The row the candidate was found on.
+ * \param rowTotal The candidate's width along the row.
+ * \param patterns The patterns found so far.
+ */
+void checkCandidate(const paper::qr::ModuleMatrix &bits, double x, long y,
+                    double rowTotal, std::vector<FinderPattern> &patterns)
+{
+	long column = static_cast<long>(x);
+	double offset;
+	double verticalTotal;
+	if(!measureCross(bits, column, y, 0, 1, offset, verticalTotal))
+		return;
+
+	// The pattern must be about as tall as it is wide.
+	if(5.0 * std::fabs(verticalTotal - rowTotal) >= 2.0 * rowTotal)
+		return;
+
+	Point center(0.0, static_cast<double>(y) + offset);
+	long row = static_cast<long>(center.y);
+	double horizontalTotal;
+	if(!measureCross(bits, column, row, 1, 0, offset, horizontalTotal))
+		return;
+	center.x = static_cast<double>(column) + offset;
+
+	// The diagonal crosses the corners of the pattern's rings, where a
+	// single stray pixel changes the runs, so it's checked more loosely.
+	double diagonalTotal;
+	if(!measureCross(bits, static_cast<long>(center.x), row, 1, 1, offset,
+	                 diagonalTotal, DIAGONAL_TOLERANCE))
+	{
+		return;
+	}
+
+	double moduleSize = (verticalTotal + horizontalTotal) / 14.0;
+	for(FinderPattern &pattern : patterns)
+	{
+		if((std::fabs(pattern.center.x - center.x) > moduleSize) ||
+		   (std::fabs(pattern.center.y - center.y) > moduleSize))
+		{
+			continue;
+		}
+
+		// This is another sighting of a known pattern, so refine its
+		// position and size.
+		double weight = static_cast<double>(pattern.count);
+		pattern.center = (pattern.center * weight + center) *
+		                 (1.0 / (weight + 1.0));
+		pattern.moduleSize =
+		        (pattern.moduleSize * weight + moduleSize) /
+		        (weight + 1.0);
+		++pattern.count;
+		return;
+	}
+
+	patterns.push_back(FinderPattern{center, moduleSize, 1});
+}
+
+/**
+ * This function finds every finder pattern candidate in the given image,
+ * by scanning each row's runs for the right ratio.
+ *
+ * \param bits The black and white image.
+ * \return The candidates which were seen on enough rows, most often seen
+ * first.
+ */
+std::vector<FinderPattern>
+findFinderPatterns(const paper::qr::ModuleMatrix &bits)
+{
+	std::vector<FinderPattern> patterns;
+
+	// Each row's dark runs are collected as [start, end) pairs, so each
+	// three consecutive runs (and the gaps between them) are a candidate.
+	std::vector<long> runs;
+	auto addRun = [&runs](std::size_t x, std::size_t length)
+	{
+		runs.push_back(static_cast<long>(x));
+		runs.push_back(static_cast<long>(x + length));
+	};
+
+	for(std::size_t y = 0; y < bits.getHeight(); ++y)
+	{
+		runs.clear();
+		bits.forEachDarkRun(y, addRun);
+
+		for(std::size_t i = 0; i + 6 <= runs.size(); i += 2)
+		{
+			const long *edges = runs.data() + i;
+			long counts[5];
+			for(std::size_t k = 0; k < 5; ++k)
+				counts[k] = edges[k + 1] - edges[k];
+			if(!isFinderRatio(counts))
+				continue;
+
+			double center =
+			        static_cast<double>(edges[2] + edges[3]) / 2.0;
+			double total = static_cast<double>(edges[5] - edges[0]);
+			long row = static_cast<long>(y);
+			checkCandidate(bits, center, row, total, patterns);
+		}
+	}
+
+	patterns.erase(std::remove_if(patterns.begin(), patterns.end(),
+	                              [](const FinderPattern &p)
+	                              {
+		                              return p.count < FINDER_QUORUM;
+		                      }),
+	               patterns.end());
+	std::stable_sort(patterns.begin(), patterns.end(),
+	                 [](const FinderPattern &a, const FinderPattern &b)
+	                 {
+		                 return a.count > b.count;
+		         });
+	return patterns;
+}
+
+/**
+ * This function scores how much the given three finder patterns look like
+ * the corners of one QR code: they should form an isosceles right triangle,
+ * and have similar module sizes. The patterns are reordered so the one at
+ * the right angle comes first.
+ *
+ * \param triple The three finder patterns.
+ * \return The score, where lower is better, or HUGE_VAL if the patterns
+ * can't belong to the same code.
+ */
+double scorePatterns(FinderPattern *triple)
+{
+	double smallest = std::min({triple[0].moduleSize, triple[1].moduleSize,
+	                            triple[2].moduleSize});
+	double largest = std::max({triple[0].moduleSize, triple[1].moduleSize,
+	                           triple[2].moduleSize});
+
+	// The right angle is opposite the longest side.
+	double sides[3];
+	for(std::size_t s = 0; s < 3; ++s)
+	{
+		sides[s] = getDistance(triple[(s + 1) % 3].center,
+		                       triple[(s + 2) % 3].center);
+	}
+	std::size_t corner = static_cast<std::size_t>(
+	        std::max_element(sides, sides + 3) - sides);
+	std::swap(triple[0], triple[corner]);
+	std::swap(sides[0], sides[corner]);
+
+	// The smallest code is 21 modules wide, so its finder patterns are
+	// 14 modules apart (less some leeway for the module size estimates).
+	if(std::min(sides[1], sides[2]) < 12.0 * smallest)
+		return HUGE_VAL;
+
+	double squares = sides[1] * sides[1] + sides[2] * sides[2];
+	return (largest - smallest) / largest +
+	       std::fabs(sides[1] - sides[2]) / std::max(sides[1], sides[2]) +
+	       std::fabs(sides[0] * sides[0] - squares) / squares;
+}
+
+/**
+ * This function chooses the three finder patterns which are most likely to
+ * be the corners of one QR code (see scorePatterns). They are returned in
+ * the order top-left, top-right, bottom-left.
+ *
+ * \param candidates The finder pattern candidates.
+ * \return The code's three finder patterns.
+ */
+std::vector<FinderPattern>
+choosePatterns(const std::vector<FinderPattern> &candidates)
+{
+	std::size_t count = std::min(candidates.size(), MAX_FINDER_CANDIDATES);
+	std::vector<FinderPattern> best;
+	double bestScore = HUGE_VAL;
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		for(std::size_t j = i + 1; j < count; ++j)
+		{
+			for(std::size_t k = j + 1; k < count; ++k)
+			{
+				FinderPattern triple[3] = {candidates[i],
+				                           candidates[j],
+				                           candidates[k]};
+				double score = scorePatterns(triple);
+				if(score < bestScore)
+				{
+					best.assign(triple, triple + 3);
+					bestScore = score;
+				}
+			}
+		}
+	}
+
+	if(best.empty())
+		throw paper::scan::NotFoundError();
+
+	// In image coordinates (y down), the top-right pattern is clockwise
+	// from the bottom-left one, as seen from the top-left one.
+	Point right = best[1].center - best[0].center;
+	Point down = best[2].center - best[0].center;
+	if(right.x * down.y - right.y * down.x < 0.0)
+		std::swap(best[1], best[2]);
+	return best;
+}
+
+/**
+ * \brief This class maps module coordinates (module (i, j) covers [i, i + 1)
+ * and [j, j + 1)) to image coordinates with a perspective transform.
+ */
+class Transform
+{
+public:
+	/**
+	 * This constructor creates an affine transform from the centers of
+	 * the three finder patterns.
+	 *
+	 * \param patterns The top-left, top-right and bottom-left patterns.
+	 * \param width The width of the code, in modules.
+	 */
+	Transform(const std::vector<FinderPattern> &patterns, std::size_t width)
+	        : coefficients()
+	{
+		double span = static_cast<double>(width) - 7.0;
+		Point origin(patterns[0].center);
+		Point across((patterns[1].center - origin) * (1.0 / span));
+		Point down((patterns[2].center - origin) * (1.0 / span));
+		Point start(origin - (across + down) * 3.5);
+
+		double c[9] = {across.x, down.x, start.x, across.y, down.y,
+		               start.y, 0.0, 0.0, 1.0};
+		std::copy(c, c + 9, coefficients);
+	}
+
+	/**
+	 * This function creates a perspective transform which maps each of
+	 * the given four module positions to the corresponding image points.
+	 *
+	 * \param from The module positions.
+	 * \param to The image points.
+	 * \param transform The transform to fill in.
+	 * \return Whether the points determine a transform.
+	 */
+	static bool fromPoints(const Point *from, const Point *to,
+	                       Transform &transform)
+	{
+		// Each correspondence gives two linear equations in the eight
+		// unknown coefficients (the last one is fixed at 1), which we
+		// solve by Gaussian elimination.
+		double system[8][9];
+		for(std::size_t p = 0; p < 4; ++p)
+		{
+			double u = from[p].x;
+			double v = from[p].y;
+			double x = to[p].x;
+			double y = to[p].y;
+			double rowX[9] = {u, v, 1.0, 0.0, 0.0, 0.0,
+			                  -u * x, -v * x, x};
+			double rowY[9] = {0.0, 0.0, 0.0, u, v, 1.0,
+			                  -u * y, -v * y, y};
+			std::copy(rowX, rowX + 9, system[p * 2]);
+			std::copy(rowY, rowY + 9, system[p * 2 + 1]);
+		}
+
+		for(std::size_t col = 0; col < 8; ++col)
+		{
+			std::size_t pivot = col;
+			for(std::size_t r = col + 1; r < 8; ++r)
+			{
+				if(std::fabs(system[r][col]) >
+				   std::fabs(system[pivot][col]))
+				{
+					pivot = r;
+				}
+			}
+			if(std::fabs(system[pivot][col]) < 1e-9)
+				return false;
+			std::swap(system[col], system[pivot]);
+
+			for(std::size_t r = 0; r < 8; ++r)
+			{
+				if(r == col)
+					continue;
+				double factor =
+				        system[r][col] / system[col][col];
+				for(std::size_t c = col; c < 9; ++c)
+					system[r][c] -= factor * system[col][c];
+			}
+		}
+
+		for(std::size_t i = 0; i < 8; ++i)
+			transform.coefficients[i] = system[i][8] / system[i][i];
+		transform.coefficients[8] = 1.0;
+		return true;
+	}
+
+	/**
+	 * \param u The horizontal module coordinate.
+	 * \param v The vertical module coordinate.
+	 * \return The corresponding image point.
+	 */
+	Point map(double u, double v) const
+	{
+		const double *c = coefficients;
+		double z = c[6] * u + c[7] * v + c[8];
+		return Point((c[0] * u + c[1] * v + c[2]) / z,
+		             (c[3] * u + c[4] * v + c[5]) / z);
+	}
+
+private:
+	double coefficients[9];
+};
+
+/**
+ * This function reads one copy of the version information of a code, by
+ * sampling it relative to the finder pattern it sits beside. The module
+ * size is derived from the distance between the finder patterns, assuming
+ * the given version, since the patterns' own module size estimates are too
+ * coarse to reach 7 modules away.
+ *
+ * \param bits The black and white image.
+ * \param patterns The top-left, top-right and bottom-left patterns.
+ * \param version The version that is assumed.
+ * \param second Whether to read the copy beside the bottom-left pattern,
+ * rather than the top-right one.
+ * \return The version, or 0 if it is unreadable.
+ */
+int readVersion(const paper::qr::ModuleMatrix &bits,
+                const std::vector<FinderPattern> &patterns, int version,
+                bool second)
+{
+	const FinderPattern &anchor = patterns[second ? 2 : 1];
+	double spacing =
+	        static_cast<double>(paper::qr::getSymbolWidth(version) - 7);
+	Point across((patterns[1].center - patterns[0].center) *
+	             (1.0 / spacing));
+	Point down((patterns[2].center - patterns[0].center) * (1.0 / spacing));
+
+	// The block is 3 modules by 6, starting 7 modules before the
+	// pattern's center along one axis and 3 along the other.
+	unsigned int versionBits = 0;
+	for(unsigned int i = 0; i < 18; ++i)
+	{
+		double a = static_cast<double>(i % 3) - 7.0;
+		double b = static_cast<double>(i / 3) - 3.0;
+		Point p = second ? anchor.center + across * b + down * a
+		                 : anchor.center + across * a + down * b;
+		if(isDark(bits, p))
+			versionBits |= 1u << i;
+	}
+	return paper::qr::decodeVersionBits(versionBits);
+}
+
+/**
+ * This function reads the version of a code from its version information,
+ * trying the versions closest to the estimated one in turn, and accepting
+ * the first one whose version information agrees with it.
+ *
+ * \param bits The black and white image.
+ * \param patterns The top-left, top-right and bottom-left patterns.
+ * \param estimate The version estimated from the finder patterns.
+ * \return The version, or 0 if it is unreadable.
+ */
+int findVersion(const paper::qr::ModuleMatrix &bits,
+                const std::vector<FinderPattern> &patterns, int estimate)
+{
+	for(int distance = 0; distance <= VERSION_SEARCH_DISTANCE; ++distance)
+	{
+		for(int version : {estimate - distance, estimate + distance})
+		{
+			if((version < 7) || (version > 40))
+				continue;
+			int first = readVersion(bits, patterns, version, false);
+			int second = readVersion(bits, patterns, version, true);
+			if((first == version) || (second == version))
+				return version;
+		}
+	}
+	return 0;
+}
+
+/**
+ * This function matches the alignment pattern's 5x5 modules at every pixel
+ * within a square around the predicted position.
+ *
+ * \param bits The black and white image.
+ * \param predicted The predicted center of the pattern.
+ * \param across The offset of one module to the right.
+ * \param down The offset of one module down.
+ * \param radius Half the width of the search area, in pixels.
+ * \param center The center of the pattern is written here, if found.
+ * \return Whether the pattern was found.
+ */
+bool matchAlignment(const paper::qr::ModuleMatrix &bits,
+                    const Point &predicted, const Point &across,
+                    const Point &down, long radius, Point &center)
+{
+	long px = static_cast<long>(std::floor(predicted.x));
+	long py = static_cast<long>(std::floor(predicted.y));
+
+	// Every position with the best score is averaged, since at higher
+	// resolutions a whole module's worth of positions match.
+	std::size_t bestScore = ALIGNMENT_QUORUM;
+	Point sum;
+	double matches = 0.0;
+	for(long y = py - radius; y <= py + radius; ++y)
+	{
+		for(long x = px - radius; x <= px + radius; ++x)
+		{
+			Point candidate(static_cast<double>(x) + 0.5,
+			                static_cast<double>(y) + 0.5);
+			std::size_t score = 0;
+			for(long j = -2; j <= 2; ++j)
+			{
+				for(long i = -2; i <= 2; ++i)
+				{
+					bool dark = std::max(std::labs(i),
+					                     std::labs(j)) != 1;
+					double u = static_cast<double>(i);
+					double v = static_cast<double>(j);
+					Point p = candidate + across * u +
+					          down * v;
+					if(isDark(bits, p) == dark)
+						++score;
+				}
+			}
+
+			if(score > bestScore)
+			{
+				bestScore = score;
+				sum = Point();
+				matches = 0.0;
+			}
+			if(score == bestScore)
+			{
+				sum = sum + candidate;
+				matches += 1.0;
+			}
+		}
+	}
+
+	if(matches == 0.0)
+		return false;
+	center = sum * (1.0 / matches);
+	return true;
+}
+
+/**
+ * This function searches for the code's bottom-right alignment pattern near
+ * where the affine transform predicts it, widening the search until it's
+ * found.
+ *
+ * \param bits The black and white image.
+ * \param affine The affine transform from the finder patterns.
+ * \param width The width of the code, in modules.
+ * \param moduleSize The code's estimated module size, in pixels.
+ * \param center The center of the pattern is written here, if found.
+ * \return Whether the pattern was found.
+ */
+bool findAlignment(const paper::qr::ModuleMatrix &bits,
+                   const Transform &affine, std::size_t width,
+                   double moduleSize, Point &center)
+{
+	double expected = static_cast<double>(width) - 6.5;
+	Point predicted(affine.map(expected, expected));
+	Point across(affine.map(expected + 1.0, expected) - predicted);
+	Point down(affine.map(expected, expected + 1.0) - predicted);
+
+	double limit = std::max(ALIGNMENT_SEARCH_MODULES,
+	                        static_cast<double>(width) / 4.0);
+	for(double modules = ALIGNMENT_SEARCH_MODULES;; modules *= 2.0)
+	{
+		modules = std::min(modules, limit);
+		long radius =
+		        static_cast<long>(std::ceil(modules * moduleSize));
+		if(matchAlignment(bits, predicted, across, down, radius,
+		                  center))
+			return true;
+		if(modules >= limit)
+			return false;
+	}
+}
+
+/**
+ * This function samples the center of each module of a code through the
+ * given transform.
+ *
+ * \param bits The black and white image.
+ * \param transform The transform from module to image coordinates.
+ * \param width The width of the code, in modules.
+ * \param modules The sampled modules are written here.
+ * \return Whether every module was inside the image.
+ */
+bool sampleGrid(const paper::qr::ModuleMatrix &bits,
+                const Transform &transform, std::size_t width,
+                paper::qr::ModuleMatrix &modules)
+{
+	modules = paper::qr::ModuleMatrix(width);
+	double w = static_cast<double>(bits.getWidth());
+	double h = static_cast<double>(bits.getHeight());
+	for(std::size_t y = 0; y < width; ++y)
+	{
+		for(std::size_t x = 0; x < width; ++x)
+		{
+			Point p = transform.map(static_cast<double>(x) + 0.5,
+			                        static_cast<double>(y) + 0.5);
+			if(!(p.x >= 0.0) || !(p.y >= 0.0) || (p.x >= w) ||
+			   (p.y >= h))
+			{
+				return false;
+			}
+			modules.set(x, y, isDark(bits, p));
+		}
+	}
+	return true;
+}
+}
+
+namespace paper
+{
+namespace scan
+{
+NotFoundError::NotFoundError()
+        : std::runtime_error("Couldn't find a QR code in the image.")
+{
+}
+
+std::vector<qr::ModuleMatrix> detectQRCode(const qr::ModuleMatrix &bits)
+{
+	std::vector<FinderPattern> patterns(
+	        choosePatterns(findFinderPatterns(bits)));
+
+	// Estimate the code's width from the distance between the finder
+	// patterns, rounded to the nearest valid width (4k + 1).
+	double moduleSize = (patterns[0].moduleSize + patterns[1].moduleSize +
+	                     patterns[2].moduleSize) /
+	                    3.0;
+	double span = (getDistance(patterns[0].center, patterns[1].center) +
+	               getDistance(patterns[0].center, patterns[2].center)) /
+	              (2.0 * moduleSize);
+	// The width stays unsigned, and is range checked before the version
+	// is derived from it.
+	std::size_t estimate =
+	        static_cast<std::size_t>(std::lround(std::max(span, 0.0))) + 7;
+	estimate = (estimate + 1) / 4 * 4 + 1;
+	int version = 1;
+	if(estimate > qr::getSymbolWidth(1))
+	{
+		version = static_cast<int>(
+		        std::min<std::size_t>((estimate - 17) / 4, 40));
+	}
+
+	if(version >= 7 - VERSION_SEARCH_DISTANCE)
+	{
+		int recorded = findVersion(bits, patterns, version);
+		if(recorded != 0)
+			version = recorded;
+	}
+
+	std::size_t width = qr::getSymbolWidth(version);
+	Transform affine(patterns, width);
+	std::vector<Transform> transforms;
+
+	// Codes from version 2 up have an alignment pattern 3 modules in from
+	// their bottom-right corner, which gives us a fourth point.
+	Point alignment;
+	if((version >= 2) &&
+	   findAlignment(bits, affine, width, moduleSize, alignment))
+	{
+		double near = 3.5;
+		double far = static_cast<double>(width) - 3.5;
+		double corner = static_cast<double>(width) - 6.5;
+		Point from[4] = {Point(near, near), Point(far, near),
+		                 Point(near, far), Point(corner, corner)};
+		Point to[4] = {patterns[0].center, patterns[1].center,
+		               patterns[2].center, alignment};
+
+		Transform perspective(affine);
+		if(Transform::fromPoints(from, to, perspective))
+			transforms.push_back(perspective);
+	}
+	transforms.push_back(affine);
+
+	std::vector<qr::ModuleMatrix> samplings;
+	for(const Transform &transform : transforms)
+	{
+		qr::ModuleMatrix modules;
+		if(sampleGrid(bits, transform, width, modules))
+			samplings.push_back(std::move(modules));
+	}
+
+	if(samplings.empty())
+	{
+		throw std::runtime_error(
+		        "The QR code extends past the edge of the image.");
+	}
+	return samplings;
+}
+}
+}
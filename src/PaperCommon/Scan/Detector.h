@@ -0,0 +1,63 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAPER_SCAN_DETECTOR_H
+#define PAPER_SCAN_DETECTOR_H
+
+#include <stdexcept>
+#include <vector>
+
+#include "PaperCommon/QR/ModuleMatrix.h"
+
+namespace paper
+{
+namespace scan
+{
+/**
+ * \brief This exception is thrown when an image doesn't appear to contain a
+ * symbol at all, as opposed to containing one which can't be read.
+ */
+class NotFoundError : public std::runtime_error
+{
+public:
+	NotFoundError();
+};
+
+/**
+ * This function locates a QR code in the given black and white image (see
+ * binarize), and samples its module grid.
+ *
+ * The code's three finder patterns are found by scanning each row for runs
+ * in the ratio 1:1:3:1:1, and then checking the same ratio vertically and
+ * diagonally through each candidate's center. The version is estimated from
+ * the distance between the patterns, or read from the version information
+ * beside them for larger codes. Where the code has a bottom-right alignment
+ * pattern, it is used to correct for perspective.
+ *
+ * Since the alignment pattern may be misidentified, several samplings may be
+ * returned, most likely first. If no QR code is found, an exception is
+ * thrown instead.
+ *
+ * \param bits The black and white image, with dark pixels set.
+ * \return The candidate samplings of the code's modules.
+ */
+std::vector<qr::ModuleMatrix> detectQRCode(const qr::ModuleMatrix &bits);
+}
+}
+
+#endif
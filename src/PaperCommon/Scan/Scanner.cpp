@@ -0,0 +1,79 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Scanner.h"
+
+#include <stdexcept>
+#include <string>
+
+#include "PaperCommon/Render/Color.h"
+#include "PaperCommon/Scan/Binarizer.h"
+#include "PaperCommon/Scan/Detector.h"
+
+namespace paper
+{
+namespace scan
+{
+std::vector<uint8_t> scanImage(const render::Image &image,
+                               qr::DecodeReport *report)
+{
+	std::vector<qr::ModuleMatrix> samplings(
+	        detectQRCode(binarize(render::getGrayscale(image))));
+
+	// Try each sampling in turn, reporting the first one's error if
+	// none of them decode.
+	std::string error;
+	for(const qr::ModuleMatrix &modules : samplings)
+	{
+		try
+		{
+			return qr::decodeSymbol(modules, report);
+		}
+		catch(const std::runtime_error &e)
+		{
+			if(error.empty())
+				error = e.what();
+		}
+	}
+
+	throw std::runtime_error(error);
+}
+
+std::vector<std::vector<uint8_t>>
+scanColorImage(const render::Image &image)
+{
+	std::vector<std::vector<uint8_t>> codes;
+	for(std::size_t l = 0; l < render::LAYER_COUNT; ++l)
+	{
+		render::Layer layer = static_cast<render::Layer>(l);
+		try
+		{
+			codes.push_back(
+			        scanImage(render::separateLayer(image, layer)));
+		}
+		catch(const NotFoundError &)
+		{
+		}
+	}
+
+	if(codes.empty())
+		throw NotFoundError();
+	return codes;
+}
+}
+}
@@ -0,0 +1,60 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAPER_SCAN_SCANNER_H
+#define PAPER_SCAN_SCANNER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "PaperCommon/QR/Decoder.h"
+#include "PaperCommon/Render/Image.h"
+
+namespace paper
+{
+namespace scan
+{
+/**
+ * This function reads the QR code in the given scanned image: it binarizes
+ * the image, locates the code and samples its modules, and decodes them
+ * (see binarize, detectQRCode and qr::decodeSymbol). RGB images are
+ * converted to grayscale first. If the image doesn't contain a readable
+ * code, an exception is thrown instead.
+ *
+ * \param image The scanned image.
+ * \param report If not null, this is filled in with details about the code.
+ * \return The data stored in the code.
+ */
+std::vector<uint8_t> scanImage(const render::Image &image,
+                               qr::DecodeReport *report = nullptr);
+
+/**
+ * This function reads the QR codes on each layer of a scanned colour page
+ * (see render::separateLayer). Layers without any code, as on the last page
+ * of an export whose codes don't divide evenly, are skipped. If a layer's
+ * code can't be read, an exception is thrown instead.
+ *
+ * \param image The scanned RGB image.
+ * \return The data stored in each layer's code, in layer order.
+ */
+std::vector<std::vector<uint8_t>>
+scanColorImage(const render::Image &image);
+}
+}
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Symbol.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+/**
+ * This function encodes the given data in the given symbology, and returns
+ * the resulting symbol's version and modules.
+ *
+ * \param data The data to encode.
+ * \param size The size of the data to encode.
+ * \param symbology The symbology to encode with.
+ * \param errorCorrection The error correction level, for QR codes.
+ * \param version Set to the resulting symbol's version.
+ * \return The resulting symbol's modules.
+ */
+paper::qr::ModuleMatrix
+encodeModules(const uint8_t *data, std::size_t size,
+              paper::symbol::Symbology symbology,
+              paper::qr::QRCode::ErrorCorrection errorCorrection,
+              int &version)
+{
+	switch(symbology)
+	{
+	case paper::symbol::Symbology::QR:
+	{
+		paper::qr::QRCode code(data, 0, size, errorCorrection);
+		version = code.getVersion();
+		return code.getModules();
+	}
+	case paper::symbol::Symbology::DataMatrix:
+	{
+		paper::datamatrix::DataMatrix code(data, 0, size);
+		version = code.getVersion();
+		return code.getModules();
+	}
+	default:
+		throw std::runtime_error("A symbology must be chosen before "
+		                         "encoding.");
+	}
+}
+}
+
+namespace paper
+{
+namespace symbol
+{
+Symbol::Symbol(const uint8_t *data, std::size_t offset, std::size_t size,
+               Symbology s, qr::QRCode::ErrorCorrection e)
+        : symbology(s), version(0), modules()
+{
+	modules = encodeModules(data + offset, size, symbology, e, version);
+}
+
+Symbol::Symbol(const qr::QRCode &code)
+        : symbology(Symbology::QR),
+          version(code.getVersion()),
+          modules(code.getModules())
+{
+}
+
+Symbol::Symbol(const datamatrix::DataMatrix &code)
+        : symbology(Symbology::DataMatrix),
+          version(code.getVersion()),
+          modules(code.getModules())
+{
+}
+
+Symbol::Symbol(Symbology s, int v, const qr::ModuleMatrix &m)
+        : symbology(s), version(v), modules(m)
+{
+}
+
+Symbol::Symbol(Symbol &&o)
+        : symbology(o.symbology),
+          version(o.version),
+          modules(std::move(o.modules))
+{
+	o.version = 0;
+	o.modules = qr::ModuleMatrix();
+}
+
+Symbol::~Symbol()
+{
+}
+
+Symbol &Symbol::operator=(Symbol &&o)
+{
+	if(this != &o)
+	{
+		symbology = o.symbology;
+		version = o.version;
+		modules = std::move(o.modules);
+		o.version = 0;
+		o.modules = qr::ModuleMatrix();
+	}
+	return *this;
+}
+
+Symbology Symbol::getSymbology() const
+{
+	return symbology;
+}
+
+int Symbol::getVersion() const
+{
+	return version;
+}
+
+std::size_t Symbol::getWidth() const
+{
+	return modules.getWidth();
+}
+
+std::size_t Symbol::getHeight() const
+{
+	return modules.getHeight();
+}
+
+const qr::ModuleMatrix &Symbol::getModules() const
+{
+	return modules;
+}
+}
+}
@@ -0,0 +1,163 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_SYMBOL_SYMBOL_H
+#define PAPER_SYMBOL_SYMBOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "PaperCommon/DataMatrix/DataMatrix.h"
+#include "PaperCommon/QR/ModuleMatrix.h"
+#include "PaperCommon/QR/QRCode.h"
+#include "PaperCommon/Symbol/Symbology.h"
+
+namespace paper
+{
+namespace symbol
+{
+/**
+ * \brief This class denotes a single encoded 2D barcode of any symbology.
+ *
+ * Renderers only need a symbol's modules, so they work with this class
+ * rather than with QR codes or Data Matrix symbols directly.
+ */
+class Symbol
+{
+public:
+	/**
+	 * This constructor creates a new symbol which contains the given
+	 * data, encoded in the smallest code of the given symbology which can
+	 * hold it. If too much data is given, or some other error occurs,
+	 * then an exception will be thrown.
+	 *
+	 * \param data The data to encode.
+	 * \param offset The offset in the given buffer to read data from.
+	 * \param size The size of the data to encode.
+	 * \param s The symbology to encode with, which must not be Auto.
+	 * \param e The error correction level, for QR codes.
+	 */
+	Symbol(const uint8_t *data, std::size_t offset, std::size_t size,
+	       Symbology s, qr::QRCode::ErrorCorrection e =
+	                            qr::QRCode::ErrorCorrection::Low);
+
+	/**
+	 * This constructor creates a new symbol with the given QR code's
+	 * modules.
+	 *
+	 * \param code The QR code to wrap.
+	 */
+	explicit Symbol(const qr::QRCode &code);
+
+	/**
+	 * This constructor creates a new symbol with the given Data Matrix
+	 * symbol's modules.
+	 *
+	 * \param code The Data Matrix symbol to wrap.
+	 */
+	explicit Symbol(const datamatrix::DataMatrix &code);
+
+	/**
+	 * This constructor creates a new symbol with the given modules, taken
+	 * as they are, e.g. as they were read back from an image.
+	 *
+	 * \param s The symbology the modules are encoded in.
+	 * \param v The symbol's version, numbered as its symbology numbers
+	 * them.
+	 * \param m The symbol's modules.
+	 */
+	Symbol(Symbology s, int v, const qr::ModuleMatrix &m);
+
+	/**
+	 * This constructor takes over the given symbol's modules, leaving it
+	 * empty.
+	 *
+	 * \param o The symbol to move from.
+	 */
+	Symbol(Symbol &&o);
+
+	/**
+	 * This is our object's default destructor, which frees all of this
+	 * object's internal resources.
+	 */
+	~Symbol();
+
+	/**
+	 * This operator takes over the given symbol's modules, leaving it
+	 * empty.
+	 *
+	 * \param o The symbol to move from.
+	 * \return A reference to this symbol.
+	 */
+	Symbol &operator=(Symbol &&o);
+
+	/**
+	 * \return The symbology this symbol is encoded in.
+	 */
+	Symbology getSymbology() const;
+
+	/**
+	 * \return This symbol's version, numbered as its symbology numbers
+	 * them.
+	 */
+	int getVersion() const;
+
+	/**
+	 * \return The width of this symbol, in modules.
+	 */
+	std::size_t getWidth() const;
+
+	/**
+	 * \return The height of this symbol, in modules.
+	 */
+	std::size_t getHeight() const;
+
+	/**
+	 * This function returns this symbol's modules, packed one bit per
+	 * module, with dark modules set.
+	 *
+	 * \return This symbol's modules.
+	 */
+	const qr::ModuleMatrix &getModules() const;
+
+	/**
+	 * This function returns whether the module at the given position in
+	 * this symbol is dark. No bounds checking is done.
+	 *
+	 * \param x The column of the desired module.
+	 * \param y The row of the desired module.
+	 * \return True if the module is dark, or false if it is light.
+	 */
+	bool isDark(std::size_t x, std::size_t y) const
+	{
+		return modules.get(x, y);
+	}
+
+private:
+	Symbology symbology;
+	int version;
+	qr::ModuleMatrix modules;
+
+	Symbol(const Symbol &);
+	Symbol &operator=(const Symbol &);
+};
+}
+}
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Symbology.h"
+
+#include <stdexcept>
+
+namespace paper
+{
+namespace symbol
+{
+Symbology parseSymbology(const std::string &name)
+{
+	if(name == "qr")
+		return Symbology::QR;
+	if(name == "datamatrix")
+		return Symbology::DataMatrix;
+	if(name == "auto")
+		return Symbology::Auto;
+
+	throw std::runtime_error("Invalid symbology: " + name);
+}
+
+std::string getSymbologyName(Symbology symbology)
+{
+	switch(symbology)
+	{
+	case Symbology::QR:
+		return "QR code";
+	case Symbology::DataMatrix:
+		return "Data Matrix";
+	default:
+		return "automatic";
+	}
+}
+
+std::size_t getQuietZone(Symbology symbology)
+{
+	// QR codes need four modules of margin, while Data Matrix symbols
+	// only need one, which is what makes them denser at small sizes.
+	return symbology == Symbology::DataMatrix ? 1 : 4;
+}
+}
+}
@@ -0,0 +1,75 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_SYMBOL_SYMBOLOGY_H
+#define PAPER_SYMBOL_SYMBOLOGY_H
+
+#include <cstddef>
+#include <string>
+
+namespace paper
+{
+namespace symbol
+{
+/**
+ * \brief This enumeration defines the 2D barcode symbologies we can encode
+ * data with.
+ */
+enum class Symbology
+{
+	QR = 0,
+	DataMatrix = 1,
+
+	/**
+	 * This isn't a symbology itself: it asks the planner to choose
+	 * whichever of the others needs the least printed area.
+	 */
+	Auto = 2
+};
+
+/**
+ * This function parses a symbology name: one of "qr", "datamatrix" or "auto".
+ * If the name isn't valid, an exception is thrown instead.
+ *
+ * \param name The name to parse.
+ * \return The symbology described by the name.
+ */
+Symbology parseSymbology(const std::string &name);
+
+/**
+ * This function returns a human readable name for the given symbology.
+ *
+ * \param symbology The symbology to name.
+ * \return The symbology's name.
+ */
+std::string getSymbologyName(Symbology symbology);
+
+/**
+ * This function returns the width of the light margin, in modules, which must
+ * be left around each symbol of the given symbology for it to scan reliably.
+ * This counts towards the symbol's printed area.
+ *
+ * \param symbology The symbology.
+ * \return The width of the quiet zone on each side, in modules.
+ */
+std::size_t getQuietZone(Symbology symbology);
+}
+}
+
+#endif
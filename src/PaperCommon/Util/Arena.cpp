@@ -0,0 +1,185 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+
+namespace
+{
+/**
+ * \brief This structure precedes each block handed out by an arena, and
+ * records the block's usable size.
+ *
+ * Its size is a multiple of the strictest fundamental alignment, so the
+ * block which follows it is suitably aligned for any type.
+ */
+struct alignas(alignof(std::max_align_t)) BlockHeader
+{
+	std::size_t capacity;
+};
+
+// Block sizes are rounded up to a multiple of this, to keep them aligned.
+constexpr std::size_t GRANULARITY = sizeof(BlockHeader);
+
+// A free block is only reused for requests of at least this fraction of its
+// size, so small requests don't tie up much larger blocks.
+constexpr std::size_t MAX_WASTE_FACTOR = 2;
+
+/**
+ * This function returns the header which precedes the given block.
+ *
+ * \param block The block to inspect.
+ * \return The block's header.
+ */
+BlockHeader *getHeader(void *block)
+{
+	return static_cast<BlockHeader *>(block) - 1;
+}
+}
+
+namespace paper
+{
+namespace util
+{
+Arena::Arena(std::size_t c)
+        : mutex(),
+          chunkSize(c),
+          systemBlocks(),
+          cursor(nullptr),
+          remaining(0),
+          freeBlocks(),
+          reservedSize(0),
+          reuseCount(0)
+{
+}
+
+Arena::~Arena()
+{
+	for(void *block : systemBlocks)
+		free(block);
+}
+
+void *Arena::allocate(std::size_t size)
+{
+	if(size > SIZE_MAX - 2 * GRANULARITY)
+		return nullptr;
+	size = (size + GRANULARITY - 1) / GRANULARITY * GRANULARITY;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Reuse the smallest free block which is big enough, if any.
+
+	auto it = freeBlocks.lower_bound(size);
+	if((it != freeBlocks.end()) && (it->first / MAX_WASTE_FACTOR <= size))
+	{
+		void *block = it->second;
+		freeBlocks.erase(it);
+		++reuseCount;
+		return block;
+	}
+
+	// Large blocks get their own system allocation.
+
+	std::size_t total = size + sizeof(BlockHeader);
+	if(total > chunkSize / 4)
+	{
+		void *memory = allocateFromSystem(total);
+		if(memory == nullptr)
+			return nullptr;
+
+		BlockHeader *header = static_cast<BlockHeader *>(memory);
+		header->capacity = size;
+		return header + 1;
+	}
+
+	// Small blocks are carved out of the current chunk.
+
+	if(remaining < total)
+	{
+		void *chunk = allocateFromSystem(chunkSize);
+		if(chunk == nullptr)
+			return nullptr;
+
+		cursor = static_cast<uint8_t *>(chunk);
+		remaining = chunkSize;
+	}
+
+	BlockHeader *header = reinterpret_cast<BlockHeader *>(cursor);
+	header->capacity = size;
+	cursor += total;
+	remaining -= total;
+	return header + 1;
+}
+
+void Arena::release(void *block)
+{
+	if(block == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// If the free list can't grow, the block is simply never reused.
+	try
+	{
+		freeBlocks.insert(
+		        std::make_pair(getHeader(block)->capacity, block));
+	}
+	catch(...)
+	{
+	}
+}
+
+std::size_t Arena::getReservedSize() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return reservedSize;
+}
+
+uint64_t Arena::getReuseCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return reuseCount;
+}
+
+void *Arena::allocateFromSystem(std::size_t size)
+{
+	void *memory = malloc(size);
+	if(memory == nullptr)
+		return nullptr;
+
+	// Our callers may be C code, so report failure instead of throwing.
+	try
+	{
+		systemBlocks.push_back(memory);
+	}
+	catch(...)
+	{
+		free(memory);
+		return nullptr;
+	}
+
+	reservedSize += size;
+	return memory;
+}
+}
+}
@@ -0,0 +1,109 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_UTIL_ARENA_H
+#define PAPER_UTIL_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace paper
+{
+namespace util
+{
+/**
+ * \brief This class implements a memory arena for workloads which repeatedly
+ * allocate and free blocks of similar sizes.
+ *
+ * Small blocks are carved out of large chunks, and large blocks are
+ * allocated individually. Freed blocks are never returned to the system;
+ * instead, they are kept on a free list and handed out again for later
+ * requests of a similar size. All memory is released when the arena is
+ * destroyed, so any blocks still in use at that point become invalid.
+ *
+ * All functions are thread-safe.
+ */
+class Arena
+{
+public:
+	/**
+	 * This constructor creates a new, empty arena.
+	 *
+	 * \param c The size of each chunk small blocks are carved out of.
+	 */
+	Arena(std::size_t c = 65536);
+
+	/**
+	 * This destructor releases all of the memory this arena holds.
+	 */
+	~Arena();
+
+	/**
+	 * This function allocates a block of at least the given size, which
+	 * is suitably aligned for any type. If the allocation fails, nullptr
+	 * is returned.
+	 *
+	 * \param size The minimum size of the block, in bytes.
+	 * \return The allocated block.
+	 */
+	void *allocate(std::size_t size);
+
+	/**
+	 * This function returns the given block to this arena, so it can be
+	 * reused by a later allocation. The block must have been allocated
+	 * by this arena. Releasing nullptr has no effect.
+	 *
+	 * \param block The block to release.
+	 */
+	void release(void *block);
+
+	/**
+	 * \return The total number of bytes this arena has obtained from the
+	 * system.
+	 */
+	std::size_t getReservedSize() const;
+
+	/**
+	 * \return The number of allocations which were satisfied by reusing
+	 * a previously released block.
+	 */
+	uint64_t getReuseCount() const;
+
+private:
+	mutable std::mutex mutex;
+	std::size_t chunkSize;
+	std::vector<void *> systemBlocks;
+	uint8_t *cursor;
+	std::size_t remaining;
+	std::multimap<std::size_t, void *> freeBlocks;
+	std::size_t reservedSize;
+	uint64_t reuseCount;
+
+	Arena(const Arena &);
+	Arena &operator=(const Arena &);
+
+	void *allocateFromSystem(std::size_t size);
+};
+}
+}
+
+#endif
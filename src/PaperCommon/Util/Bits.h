@@ -0,0 +1,69 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_UTIL_BITS_H
+#define PAPER_UTIL_BITS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace paper
+{
+namespace util
+{
+/**
+ * This function returns the number of set bits in the given word.
+ *
+ * \param word The word to inspect.
+ * \return The number of bits set in the word.
+ */
+inline std::size_t popcount(uint64_t word)
+{
+#ifdef _MSC_VER
+	return static_cast<std::size_t>(__popcnt64(word));
+#else
+	return static_cast<std::size_t>(__builtin_popcountll(word));
+#endif
+}
+
+/**
+ * This function returns the index of the lowest set bit in the given word.
+ * The word must not be zero.
+ *
+ * \param word The word to inspect.
+ * \return The number of trailing zero bits in the word.
+ */
+inline std::size_t countTrailingZeros(uint64_t word)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return static_cast<std::size_t>(index);
+#else
+	return static_cast<std::size_t>(__builtin_ctzll(word));
+#endif
+}
+}
+}
+
+#endif
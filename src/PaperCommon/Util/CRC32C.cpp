@@ -0,0 +1,137 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "CRC32C.h"
+
+#include <cstring>
+
+#if(defined(__x86_64__) || defined(__i386__)) && \
+        (defined(__GNUC__) || defined(__clang__))
+#define PAPER_CRC32C_SSE42 1
+#include <nmmintrin.h>
+#endif
+
+namespace
+{
+/**
+ * The CRC32C polynomial, in reversed (least significant bit first) form.
+ */
+constexpr uint32_t POLYNOMIAL = 0x82F63B78;
+
+/**
+ * \brief This structure holds the CRC of every possible byte value.
+ */
+struct Table
+{
+	uint32_t entries[256];
+
+	Table();
+};
+
+Table::Table() : entries()
+{
+	for(uint32_t i = 0; i < 256; ++i)
+	{
+		uint32_t crc = i;
+		for(unsigned int bit = 0; bit < 8; ++bit)
+			crc = (crc >> 1) ^ ((crc & 1) ? POLYNOMIAL : 0);
+		entries[i] = crc;
+	}
+}
+
+/**
+ * \brief This type denotes an implementation of the CRC32C update, which
+ * operates on the raw (non-inverted) CRC register.
+ */
+typedef uint32_t (*UpdateFunction)(uint32_t, const uint8_t *, std::size_t);
+
+/**
+ * This function updates the given CRC register with a table lookup per byte.
+ *
+ * \param crc The CRC register.
+ * \param data The data to checksum.
+ * \param size The size of the data, in bytes.
+ * \return The updated CRC register.
+ */
+uint32_t updateTable(uint32_t crc, const uint8_t *data, std::size_t size)
+{
+	static const Table table;
+	for(std::size_t i = 0; i < size; ++i)
+		crc = (crc >> 8) ^ table.entries[(crc ^ data[i]) & 0xFF];
+	return crc;
+}
+
+#ifdef PAPER_CRC32C_SSE42
+/**
+ * This function updates the given CRC register with the SSE 4.2 CRC32
+ * instruction, eight bytes at a time where possible.
+ *
+ * \param crc The CRC register.
+ * \param data The data to checksum.
+ * \param size The size of the data, in bytes.
+ * \return The updated CRC register.
+ */
+__attribute__((target("sse4.2"))) uint32_t
+updateSSE42(uint32_t crc, const uint8_t *data, std::size_t size)
+{
+	std::size_t i = 0;
+#ifdef __x86_64__
+	uint64_t wide = crc;
+	for(; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		wide = _mm_crc32_u64(wide, word);
+	}
+	crc = static_cast<uint32_t>(wide);
+#endif
+
+	for(; i < size; ++i)
+		crc = _mm_crc32_u8(crc, data[i]);
+	return crc;
+}
+#endif
+
+/**
+ * This function returns the fastest CRC32C implementation the processor
+ * we're running on supports.
+ *
+ * \return The CRC32C implementation to use.
+ */
+UpdateFunction getUpdateFunction()
+{
+#ifdef PAPER_CRC32C_SSE42
+	if(__builtin_cpu_supports("sse4.2"))
+		return updateSSE42;
+#endif
+	return updateTable;
+}
+}
+
+namespace paper
+{
+namespace util
+{
+uint32_t crc32c(const uint8_t *data, std::size_t size, uint32_t crc)
+{
+	static const UpdateFunction update = getUpdateFunction();
+	return ~update(~crc, data, size);
+}
+}
+}
@@ -0,0 +1,47 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_UTIL_CRC32C_H
+#define PAPER_UTIL_CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace paper
+{
+namespace util
+{
+/**
+ * This function computes the CRC32C (Castagnoli) checksum of the given data.
+ * On processors which support SSE 4.2, the dedicated CRC32 instruction is
+ * used; otherwise, a lookup table is used instead.
+ *
+ * To checksum data in pieces, pass the result for the previous pieces as the
+ * initial value for the next one.
+ *
+ * \param data The data to checksum.
+ * \param size The size of the data, in bytes.
+ * \param crc The checksum of any data which came before this data.
+ * \return The checksum of all of the data so far.
+ */
+uint32_t crc32c(const uint8_t *data, std::size_t size, uint32_t crc = 0);
+}
+}
+
+#endif
@@ -112,6 +112,14 @@ bool exists(const std::string &p)
 	return info.exists();
 }
 
+bool isDirectory(const std::string &p)
+{
+	std::string path(p);
+	normalize(path);
+	QFileInfo info(QString::fromStdString(path));
+	return info.isDir();
+}
+
 void mkpath(const std::string &p)
 {
 	std::string path(p);
@@ -132,6 +140,21 @@ void mkpath(const std::string &p)
 	if(!info.dir().mkpath(QString::fromStdString(path)))
 		throw std::runtime_error("Creating path failed.");
 }
+
+std::vector<std::string> listFiles(const std::string &p)
+{
+	std::string path(p);
+	normalize(path);
+
+	QDir dir(QString::fromStdString(path));
+	if(!dir.exists())
+		throw std::runtime_error("Directory doesn't exist: " + p);
+
+	std::vector<std::string> names;
+	for(const QString &name : dir.entryList(QDir::Files, QDir::Name))
+		names.push_back(name.toStdString());
+	return names;
+}
 }
 }
 }
@@ -20,6 +20,7 @@
 #define PAPER_UTIL_FS_H
 
 #include <string>
+#include <vector>
 
 namespace paper
 {
@@ -72,6 +73,14 @@ std::string appendPath(const std::string &base, const std::string &a);
  */
 bool exists(const std::string &p);
 
+/**
+ * This function returns whether or not the given path is a directory.
+ *
+ * \param p The path to test.
+ * \return True if the path is an existing directory, or false otherwise.
+ */
+bool isDirectory(const std::string &p);
+
 /**
  * This is a utility to create all of the directories necessary to ensure that
  * the given directory exists. If an error occurs, an exception will be thrown
@@ -80,6 +89,16 @@ bool exists(const std::string &p);
  * \param p The path to create.
  */
 void mkpath(const std::string &p);
+
+/**
+ * This function returns the names of the regular files in the given
+ * directory, sorted by name. If the directory can't be read, an exception
+ * will be thrown instead.
+ *
+ * \param p The directory to list.
+ * \return The names of the files in the directory.
+ */
+std::vector<std::string> listFiles(const std::string &p);
 }
 }
 }
@@ -0,0 +1,241 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "GF256.h"
+
+#include <stdexcept>
+
+#if(defined(__x86_64__) || defined(__i386__)) && \
+        (defined(__GNUC__) || defined(__clang__))
+#define PAPER_GF256_SSSE3 1
+#include <tmmintrin.h>
+#endif
+
+namespace
+{
+/**
+ * \brief This structure holds the lookup tables used for GF(2^8) arithmetic.
+ */
+struct Tables
+{
+	/**
+	 * Powers of alpha. This is twice as long as it needs to be, so the
+	 * sum of two logarithms can be used as an index without reducing it.
+	 */
+	uint8_t exp[510];
+
+	// Discrete logarithms; log[0] is unused.
+	uint8_t log[256];
+
+	/**
+	 * For each coefficient c, the products of c and every possible low
+	 * nibble (lowProducts[c][n] = c * n), and every possible high nibble
+	 * (highProducts[c][n] = c * (n << 4)). Since multiplication
+	 * distributes over addition, c * x is the XOR of the products for x's
+	 * two nibbles.
+	 */
+	alignas(16) uint8_t lowProducts[256][16];
+	alignas(16) uint8_t highProducts[256][16];
+
+	Tables();
+};
+
+Tables::Tables() : exp(), log(), lowProducts(), highProducts()
+{
+	unsigned int x = 1;
+	for(std::size_t i = 0; i < 255; ++i)
+	{
+		exp[i] = static_cast<uint8_t>(x);
+		exp[i + 255] = static_cast<uint8_t>(x);
+		log[x] = static_cast<uint8_t>(i);
+
+		x <<= 1;
+		if(x & 0x100)
+			x ^= 0x11D;
+	}
+
+	for(unsigned int c = 0; c < 256; ++c)
+	{
+		for(unsigned int n = 0; n < 16; ++n)
+		{
+			uint8_t coefficient = static_cast<uint8_t>(c);
+			lowProducts[c][n] = paper::util::gf256::multiply(
+			        coefficient, static_cast<uint8_t>(n));
+			highProducts[c][n] = paper::util::gf256::multiply(
+			        coefficient, static_cast<uint8_t>(n << 4));
+		}
+	}
+}
+
+/**
+ * This function returns our lookup tables, building them the first time it
+ * is called.
+ *
+ * \return The GF(2^8) lookup tables.
+ */
+const Tables &getTables()
+{
+	static const Tables tables;
+	return tables;
+}
+
+/**
+ * \brief This type denotes an implementation of mulAdd, which is given the
+ * nibble product tables for the coefficient.
+ */
+typedef void (*MulAddFunction)(uint8_t *, const uint8_t *, const uint8_t *,
+                               const uint8_t *, std::size_t);
+
+/**
+ * This function implements mulAdd using a pair of table lookups per byte.
+ *
+ * \param dst The buffer to add the products into.
+ * \param src The buffer to multiply.
+ * \param low The products of the coefficient and each low nibble.
+ * \param high The products of the coefficient and each high nibble.
+ * \param size The length of both buffers.
+ */
+void mulAddScalar(uint8_t *dst, const uint8_t *src, const uint8_t *low,
+                  const uint8_t *high, std::size_t size)
+{
+	for(std::size_t i = 0; i < size; ++i)
+		dst[i] ^= low[src[i] & 0x0F] ^ high[src[i] >> 4];
+}
+
+#ifdef PAPER_GF256_SSSE3
+/**
+ * This function implements mulAdd with SSSE3, multiplying 16 bytes at a time
+ * by using each nibble to shuffle the product tables.
+ *
+ * \param dst The buffer to add the products into.
+ * \param src The buffer to multiply.
+ * \param low The products of the coefficient and each low nibble.
+ * \param high The products of the coefficient and each high nibble.
+ * \param size The length of both buffers.
+ */
+__attribute__((target("ssse3"))) void
+mulAddSSSE3(uint8_t *dst, const uint8_t *src, const uint8_t *low,
+            const uint8_t *high, std::size_t size)
+{
+	const __m128i lowTable =
+	        _mm_load_si128(reinterpret_cast<const __m128i *>(low));
+	const __m128i highTable =
+	        _mm_load_si128(reinterpret_cast<const __m128i *>(high));
+	const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+
+	std::size_t i = 0;
+	for(; i + 16 <= size; i += 16)
+	{
+		__m128i *d = reinterpret_cast<__m128i *>(dst + i);
+		__m128i s = _mm_loadu_si128(
+		        reinterpret_cast<const __m128i *>(src + i));
+
+		__m128i lo = _mm_and_si128(s, nibbleMask);
+		__m128i hi = _mm_and_si128(_mm_srli_epi64(s, 4), nibbleMask);
+		__m128i product =
+		        _mm_xor_si128(_mm_shuffle_epi8(lowTable, lo),
+		                      _mm_shuffle_epi8(highTable, hi));
+
+		_mm_storeu_si128(d, _mm_xor_si128(_mm_loadu_si128(d), product));
+	}
+
+	mulAddScalar(dst + i, src + i, low, high, size - i);
+}
+#endif
+
+/**
+ * This function returns the fastest mulAdd implementation the processor
+ * we're running on supports.
+ *
+ * \return The mulAdd implementation to use.
+ */
+MulAddFunction getMulAddFunction()
+{
+#ifdef PAPER_GF256_SSSE3
+	if(__builtin_cpu_supports("ssse3"))
+		return mulAddSSSE3;
+#endif
+	return mulAddScalar;
+}
+}
+
+namespace paper
+{
+namespace util
+{
+namespace gf256
+{
+uint8_t multiply(uint8_t a, uint8_t b)
+{
+	// This is Russian peasant multiplication, rather than a table lookup,
+	// since it is used to build the tables in the first place.
+	unsigned int result = 0;
+	unsigned int x = a;
+	for(unsigned int y = b; y != 0; y >>= 1)
+	{
+		if(y & 1)
+			result ^= x;
+		x <<= 1;
+		if(x & 0x100)
+			x ^= 0x11D;
+	}
+	return static_cast<uint8_t>(result);
+}
+
+uint8_t divide(uint8_t a, uint8_t b)
+{
+	if(b == 0)
+		throw std::runtime_error("Division by zero in GF(256).");
+	if(a == 0)
+		return 0;
+
+	const Tables &tables = getTables();
+	return tables.exp[tables.log[a] + 255 - tables.log[b]];
+}
+
+uint8_t inverse(uint8_t a)
+{
+	return divide(1, a);
+}
+
+uint8_t exp(std::size_t exponent)
+{
+	return getTables().exp[exponent % 255];
+}
+
+uint8_t log(uint8_t a)
+{
+	if(a == 0)
+		throw std::runtime_error("Logarithm of zero in GF(256).");
+	return getTables().log[a];
+}
+
+void mulAdd(uint8_t *dst, const uint8_t *src, uint8_t c, std::size_t size)
+{
+	static const MulAddFunction function = getMulAddFunction();
+
+	if(c == 0)
+		return;
+
+	const Tables &tables = getTables();
+	function(dst, src, tables.lowProducts[c], tables.highProducts[c], size);
+}
+}
+}
+}
@@ -0,0 +1,99 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_UTIL_GF256_H
+#define PAPER_UTIL_GF256_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace paper
+{
+namespace util
+{
+namespace gf256
+{
+/**
+ * This function multiplies two elements of GF(2^8), using the field generated
+ * by the primitive polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11D). This is the
+ * field QR codes use for their Reed-Solomon error correction.
+ *
+ * \param a The first factor.
+ * \param b The second factor.
+ * \return The product of the two factors.
+ */
+uint8_t multiply(uint8_t a, uint8_t b);
+
+/**
+ * This function divides one element of GF(2^8) by another. An exception is
+ * thrown if the divisor is zero.
+ *
+ * \param a The dividend.
+ * \param b The divisor.
+ * \return The quotient a / b.
+ */
+uint8_t divide(uint8_t a, uint8_t b);
+
+/**
+ * This function returns the multiplicative inverse of the given element. An
+ * exception is thrown if the element is zero.
+ *
+ * \param a The element to invert.
+ * \return The inverse of the given element.
+ */
+uint8_t inverse(uint8_t a);
+
+/**
+ * This function returns the given power of the field's generator, alpha (2).
+ *
+ * \param exponent The power to raise alpha to.
+ * \return alpha ^ exponent.
+ */
+uint8_t exp(std::size_t exponent);
+
+/**
+ * This function returns the discrete logarithm of the given element, base
+ * alpha (2). An exception is thrown if the element is zero.
+ *
+ * \param a The element whose logarithm should be returned.
+ * \return The exponent e such that alpha ^ e == a, in the range [0, 254].
+ */
+uint8_t log(uint8_t a);
+
+/**
+ * This function multiplies each byte of the source buffer by the given
+ * coefficient, and adds (XORs) the products into the destination buffer:
+ * dst[i] ^= c * src[i]. This is the inner loop of Reed-Solomon encoding and
+ * erasure decoding.
+ *
+ * Where the processor supports it, this is done 16 bytes at a time, by
+ * splitting each source byte into nibbles and looking up each nibble's
+ * product with a byte shuffle.
+ *
+ * \param dst The buffer to add the products into.
+ * \param src The buffer to multiply.
+ * \param c The coefficient to multiply by.
+ * \param size The length of both buffers.
+ */
+void mulAdd(uint8_t *dst, const uint8_t *src, uint8_t c, std::size_t size);
+}
+}
+}
+
+#endif
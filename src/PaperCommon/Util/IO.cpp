@@ -52,6 +52,146 @@ std::size_t filesize(const std::string &path)
 	return static_cast<size_t>(s.st_size);
 }
 
+bool isRegularFile(const std::string &path)
+{
+	struct stat s;
+	return (stat(path.c_str(), &s) == 0) && S_ISREG(s.st_mode);
+}
+
+std::shared_ptr<FILE> openFile(const std::string &path, const char *mode)
+{
+	FILE *file = fopen(path.c_str(), mode);
+	if(file == nullptr)
+		throw std::runtime_error(strerror(errno));
+
+	return std::shared_ptr<FILE>(file, fclose);
+}
+
+std::shared_ptr<FILE> openMemory(const uint8_t *data, std::size_t size)
+{
+	FILE *file = fmemopen(const_cast<uint8_t *>(data),
+	                      sizeof(uint8_t) * size, "rb");
+	if(file == nullptr)
+		throw std::runtime_error(strerror(errno));
+
+	return std::shared_ptr<FILE>(file, fclose);
+}
+
+void openPipe(std::shared_ptr<FILE> &reader, std::shared_ptr<FILE> &writer)
+{
+	int fds[2];
+	if(pipe(fds) != 0)
+		throw std::runtime_error(strerror(errno));
+
+	FILE *readFile = fdopen(fds[0], "rb");
+	if(readFile == nullptr)
+	{
+		int error = errno;
+		close(fds[0]);
+		close(fds[1]);
+		throw std::runtime_error(strerror(error));
+	}
+	reader.reset(readFile, fclose);
+
+	FILE *writeFile = fdopen(fds[1], "wb");
+	if(writeFile == nullptr)
+	{
+		int error = errno;
+		close(fds[1]);
+		reader.reset();
+		throw std::runtime_error(strerror(error));
+	}
+	writer.reset(writeFile, fclose);
+}
+
+uint64_t copyFile(FILE *dst, FILE *src)
+{
+	constexpr std::size_t BUFFER_SIZE = 8192;
+	uint8_t buffer[BUFFER_SIZE];
+	uint64_t copied = 0;
+
+	while(true)
+	{
+		std::size_t read = fread(buffer, sizeof(uint8_t), BUFFER_SIZE, src);
+		if(ferror(src) != 0)
+			throw std::runtime_error(strerror(errno));
+
+		if(read == 0)
+			break;
+
+		if(fwrite(buffer, sizeof(uint8_t), read, dst) != read)
+			throw std::runtime_error(strerror(errno));
+
+		copied += read;
+	}
+
+	return copied;
+}
+
+std::size_t encodeVarint(uint8_t *dst, uint64_t value)
+{
+	std::size_t written = 0;
+
+	do
+	{
+		uint8_t byte = static_cast<uint8_t>(value & 0x7F);
+		value >>= 7;
+		if(value != 0)
+			byte |= 0x80;
+
+		dst[written++] = byte;
+	} while(value != 0);
+
+	return written;
+}
+
+std::size_t decodeVarint(uint64_t &value, const uint8_t *src, std::size_t size)
+{
+	value = 0;
+
+	for(std::size_t i = 0; i < MAX_VARINT_SIZE; ++i)
+	{
+		if(i >= size)
+			return 0;
+
+		value |= static_cast<uint64_t>(src[i] & 0x7F) << (7 * i);
+		if((src[i] & 0x80) == 0)
+			return i + 1;
+	}
+
+	throw std::runtime_error("Variable-length integer is too long.");
+}
+
+std::size_t writeVarint(FILE *dst, uint64_t value)
+{
+	uint8_t buffer[MAX_VARINT_SIZE];
+	std::size_t size = encodeVarint(buffer, value);
+
+	if(fwrite(buffer, sizeof(uint8_t), size, dst) != size)
+		throw std::runtime_error(strerror(errno));
+
+	return size;
+}
+
+uint64_t readVarint(FILE *src)
+{
+	uint64_t value = 0;
+
+	for(unsigned int shift = 0; shift < 64; shift += 7)
+	{
+		int byte = fgetc(src);
+		if(byte == EOF)
+			throw std::runtime_error("Unexpected end of variable-length "
+			                         "integer.");
+
+		value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+		if((byte & 0x80) == 0)
+			return value;
+	}
+
+	throw std::runtime_error("Variable-length integer is too long.");
+}
+
 std::size_t loadFile(std::shared_ptr<uint8_t> &buf, const std::string &path)
 {
 	FILE *in = fopen(path.c_str(), "rb");
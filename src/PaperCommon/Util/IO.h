@@ -21,6 +21,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <memory>
 #include <string>
 
@@ -40,6 +41,110 @@ namespace io
  */
 std::size_t filesize(const std::string &path);
 
+/**
+ * This function returns whether the given path denotes a regular file, as
+ * opposed to e.g. a pipe or a device, which can only be read once.
+ *
+ * \param path The path to inspect.
+ * \return Whether the path is a regular file.
+ */
+bool isRegularFile(const std::string &path);
+
+/**
+ * This function opens the file denoted by the given path with the given
+ * fopen()-style mode. The returned shared_ptr closes the file when the last
+ * reference to it is released. If the file can't be opened, an exception is
+ * thrown instead.
+ *
+ * \param path The path to the file to open.
+ * \param mode The fopen() mode string to open the file with.
+ * \return A shared_ptr containing the opened file.
+ */
+std::shared_ptr<FILE> openFile(const std::string &path, const char *mode);
+
+/**
+ * This function opens the given in-memory buffer as a read-only FILE, so it
+ * can be passed to FILE-based APIs. The buffer is not copied, so it must
+ * outlive the returned file.
+ *
+ * \param data The buffer to read from.
+ * \param size The size of the given buffer.
+ * \return A shared_ptr containing the opened file.
+ */
+std::shared_ptr<FILE> openMemory(const uint8_t *data, std::size_t size);
+
+/**
+ * This function creates an anonymous pipe, and opens its ends as FILEs, so
+ * data written on one thread can be streamed into FILE-based APIs running on
+ * another. Releasing the writing end signals the end of the data. Note that
+ * the reader must keep reading until then, or the writer will block.
+ *
+ * \param reader The pipe's reading end is stored here.
+ * \param writer The pipe's writing end is stored here.
+ */
+void openPipe(std::shared_ptr<FILE> &reader, std::shared_ptr<FILE> &writer);
+
+/**
+ * This function copies all of the remaining data from the given source file
+ * to the given destination file, in small fixed-size blocks. If reading or
+ * writing fails, an exception is thrown instead.
+ *
+ * \param dst The file to write data to.
+ * \param src The file to read data from.
+ * \return The number of bytes copied.
+ */
+uint64_t copyFile(FILE *dst, FILE *src);
+
+/**
+ * This is the maximum number of bytes a 64-bit value occupies when encoded as
+ * a variable-length integer.
+ */
+constexpr std::size_t MAX_VARINT_SIZE = 10;
+
+/**
+ * This function encodes the given value into the given buffer as an unsigned
+ * LEB128 variable-length integer (see writeVarint). The buffer must have room
+ * for at least MAX_VARINT_SIZE bytes.
+ *
+ * \param dst The buffer to encode the value into.
+ * \param value The value to encode.
+ * \return The number of bytes written.
+ */
+std::size_t encodeVarint(uint8_t *dst, uint64_t value);
+
+/**
+ * This function decodes an unsigned LEB128 variable-length integer from the
+ * start of the given buffer. If the value is malformed, an exception is thrown
+ * instead.
+ *
+ * \param value The decoded value.
+ * \param src The buffer to decode the value from.
+ * \param size The size of the buffer, in bytes.
+ * \return The number of bytes consumed, or 0 if the buffer ends early.
+ */
+std::size_t decodeVarint(uint64_t &value, const uint8_t *src, std::size_t size);
+
+/**
+ * This function writes the given value to the given file as an unsigned
+ * LEB128 variable-length integer: seven bits per byte, least significant group
+ * first, with the high bit set on every byte except the last.
+ *
+ * \param dst The file to write the value to.
+ * \param value The value to write.
+ * \return The number of bytes written.
+ */
+std::size_t writeVarint(FILE *dst, uint64_t value);
+
+/**
+ * This function reads an unsigned LEB128 variable-length integer (as written
+ * by writeVarint) from the given file. If the file ends early or the value is
+ * malformed, an exception is thrown instead.
+ *
+ * \param src The file to read the value from.
+ * \return The value which was read.
+ */
+uint64_t readVarint(FILE *src);
+
 /**
  * This function loads all of the contents of the file denoted by the given
  * path into memory. The contents will be stored in an array of uint8_t's,
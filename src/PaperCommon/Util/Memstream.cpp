@@ -72,3 +72,17 @@ FILE *paper::util::Memstream::getFile()
 {
 	return stream;
 }
+
+uint8_t *paper::util::Memstream::detach()
+{
+	if(stream != nullptr)
+	{
+		int r = fclose(stream);
+		stream = nullptr;
+
+		if(r != 0)
+			throw std::runtime_error(strerror(errno));
+	}
+
+	return buffer;
+}
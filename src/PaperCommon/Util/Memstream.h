@@ -100,6 +100,20 @@ public:
 	 */
 	FILE *getFile();
 
+	/**
+	 * This function closes this memory stream, and returns its final
+	 * buffer. The buffer contains getSize() bytes of data (getSize()
+	 * remains valid after this call), and it must be released with free()
+	 * by the caller.
+	 *
+	 * This should be used instead of getBuffer() whenever the buffer
+	 * needs to outlive this object, since closing the stream may move
+	 * the buffer.
+	 *
+	 * \return This memory stream's final buffer.
+	 */
+	uint8_t *detach();
+
 private:
 	uint8_t *buffer;
 	FILE *stream;
@@ -0,0 +1,88 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace paper
+{
+namespace util
+{
+std::size_t getOnlineCores()
+{
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return cores < 1 ? 1 : static_cast<std::size_t>(cores);
+}
+
+void parallelFor(std::size_t count, std::size_t workers,
+                 const std::function<void(std::size_t)> &fn)
+{
+	std::atomic<std::size_t> next(0);
+	std::atomic<bool> failed(false);
+	std::exception_ptr error;
+	std::mutex errorMutex;
+
+	auto work = [&]()
+	{
+		while(!failed)
+		{
+			std::size_t i = next++;
+			if(i >= count)
+				break;
+
+			try
+			{
+				fn(i);
+			}
+			catch(...)
+			{
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if(!failed)
+					error = std::current_exception();
+				failed = true;
+			}
+		}
+	};
+
+	// The calling thread acts as one of the workers.
+
+	std::vector<std::thread> threads;
+	std::size_t threadCount = std::min(std::max<std::size_t>(workers, 1),
+	                                   std::max<std::size_t>(count, 1));
+	for(std::size_t i = 1; i < threadCount; ++i)
+		threads.push_back(std::thread(work));
+
+	work();
+
+	for(auto &thread : threads)
+		thread.join();
+
+	if(error)
+		std::rethrow_exception(error);
+}
+}
+}
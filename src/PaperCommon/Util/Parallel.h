@@ -0,0 +1,54 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_UTIL_PARALLEL_H
+#define PAPER_UTIL_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+namespace paper
+{
+namespace util
+{
+/**
+ * This function returns the number of processor cores which are currently
+ * online. If this can't be determined, 1 is returned instead.
+ *
+ * \return The number of online processor cores.
+ */
+std::size_t getOnlineCores();
+
+/**
+ * This function calls the given function once for each index in the range
+ * [0, count), spreading the calls across (at most) the given number of worker
+ * threads. Indices are handed out in increasing order, but calls may complete
+ * in any order. If any call throws an exception, no further indices are
+ * started, and the first exception is rethrown once all workers are done.
+ *
+ * \param count The number of indices to process.
+ * \param workers The maximum number of threads to use.
+ * \param fn The function to call for each index.
+ */
+void parallelFor(std::size_t count, std::size_t workers,
+                 const std::function<void(std::size_t)> &fn);
+}
+}
+
+#endif
@@ -19,11 +19,22 @@
 #include <Vrfy/Vrfy.h>
 
 #include "PaperTests/Tests/CompressionTest.h"
+#include "PaperTests/Tests/FormatTest.h"
+#include "PaperTests/Tests/FunctionalityTest.h"
+#include "PaperTests/Tests/QRTest.h"
+#include "PaperTests/Tests/ScanTest.h"
+#include "PaperTests/Tests/SymbolTest.h"
 
 int main(int, char **)
 {
 	using namespace paper::tests;
 
 	vrfy::Tests tests;
-	tests.add<CompressionTest>().execute();
+	tests.add<CompressionTest>()
+	        .add<FormatTest>()
+	        .add<FunctionalityTest>()
+	        .add<QRTest>()
+	        .add<ScanTest>()
+	        .add<SymbolTest>()
+	        .execute();
 }
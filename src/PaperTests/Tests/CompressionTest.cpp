@@ -18,13 +18,26 @@
 
 #include "CompressionTest.h"
 
+#include "PaperCommon/Compression/Codec.h"
+#include "PaperCommon/Compression/Dictionary.h"
+#include "PaperCommon/Compression/Filters.h"
 #include "PaperCommon/Compression/LZMA.h"
+#include "PaperCommon/Compression/Probe.h"
+#include "PaperCommon/Util/IO.h"
+#include "PaperCommon/Util/Memstream.h"
 
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
 
 namespace
 {
@@ -85,6 +98,45 @@ const uint8_t TEST_DATA[] = {
  * \brief This constant defines the length of our test data.
  */
 const std::size_t TEST_DATA_SIZE = sizeof(TEST_DATA) / sizeof(TEST_DATA[0]);
+
+/**
+ * This function creates a temporary file holding the given data, with its
+ * file position at the start.
+ *
+ * \param data The data to write to the file.
+ * \param size The size of the data, in bytes.
+ * \return The temporary file.
+ */
+std::shared_ptr<FILE> createTemporaryFile(const uint8_t *data,
+                                          std::size_t size)
+{
+	std::shared_ptr<FILE> file(std::tmpfile(), fclose);
+	if(!file)
+		throw std::runtime_error("Creating temporary file failed.");
+
+	if(((size > 0) && (fwrite(data, 1, size, file.get()) != size)) ||
+	   (fflush(file.get()) != 0))
+	{
+		throw std::runtime_error("Writing temporary file failed.");
+	}
+	rewind(file.get());
+	return file;
+}
+
+/**
+ * This function reads the entire contents of the given file descriptor.
+ *
+ * \param fd The file descriptor to read.
+ * \return The file's contents.
+ */
+std::vector<uint8_t> readDescriptor(int fd)
+{
+	off_t size = lseek(fd, 0, SEEK_END);
+	std::vector<uint8_t> data(static_cast<std::size_t>(size));
+	if(pread(fd, data.data(), data.size(), 0) != size)
+		throw std::runtime_error("Reading temporary file failed.");
+	return data;
+}
 }
 
 namespace paper
@@ -104,6 +156,142 @@ void CompressionTest::test()
 	using namespace compression;
 	using namespace vrfy::assert;
 
+	LZMAOptions singleThreaded;
+	singleThreaded.threads = 1;
+	testRoundTrip(singleThreaded);
+
+	LZMAOptions fast;
+	fast.threads = 1;
+	fast.level = 0;
+	testRoundTrip(fast);
+
+	LZMAOptions extreme;
+	extreme.threads = 1;
+	extreme.extreme = true;
+	testRoundTrip(extreme);
+
+	LZMAOptions multiThreaded;
+	multiThreaded.threads = 4;
+	multiThreaded.blockSize = TEST_DATA_SIZE / 3;
+	testRoundTrip(multiThreaded);
+
+	// By default, the thread count is reduced so the encoder's memory
+	// usage stays within the default memory limit.
+	LZMAOptions manyThreads;
+	manyThreads.threads = 256;
+	assertEquals(true, lzmaEncoderMemoryUsage(manyThreads, 0) <=
+	                           manyThreads.memoryLimit);
+
+	LZMAOptions raw;
+	raw.format = LZMAFormat::Raw;
+	testRoundTrip(raw);
+
+	LZMAOptions rawUnchecked;
+	rawUnchecked.format = LZMAFormat::Raw;
+	rawUnchecked.checksum = false;
+	testRoundTrip(rawUnchecked);
+
+	LZMAOptions x86;
+	x86.threads = 1;
+	x86.filter = Filter(FilterType::X86);
+	testRoundTrip(x86);
+
+	LZMAOptions rawDelta;
+	rawDelta.format = LZMAFormat::Raw;
+	rawDelta.filter = Filter(FilterType::Delta, 3);
+	testRoundTrip(rawDelta);
+
+	for(LZMAOptions options : {multiThreaded, raw})
+	{
+		testFileRoundTrip(options);
+		testDescriptorRoundTrip(options);
+	}
+
+	testFilterDetection();
+	testContext();
+
+	testDictionaryRoundTrip();
+	testProbe();
+	testDecoderLimits();
+	testIncompressibleBlocks();
+
+	CompressionOptions codecOptions;
+	codecOptions.zstd.longRange = true;
+	for(CodecId id : getCodecIds())
+		testCodecRoundTrip(*createCodec(id, codecOptions));
+
+	codecOptions.lzma.format = LZMAFormat::Raw;
+	testCodecRoundTrip(*createCodec(CodecId::LZMA, codecOptions));
+
+	testPayloadFormat();
+}
+
+void CompressionTest::testCodecRoundTrip(const compression::Codec &codec)
+{
+	using namespace compression;
+	using namespace vrfy::assert;
+
+	std::shared_ptr<FILE> src(util::io::openMemory(TEST_DATA, TEST_DATA_SIZE));
+	util::Memstream payload;
+	compressPayload(payload.getFile(), src.get(), codec);
+
+	std::shared_ptr<uint8_t> payloadData(payload.detach(), free);
+	if(codec.isSelfDescribing())
+		assertEquals(0xFD, payloadData.get()[0]);
+	else
+		assertEquals(static_cast<uint8_t>(codec.getId()),
+		             payloadData.get()[0]);
+
+	std::shared_ptr<uint8_t> decompressed;
+	std::size_t decompressedSize =
+	        decompressPayload(decompressed, payloadData.get(),
+	                          payload.getSize(), CompressionOptions());
+
+	assertEquals(TEST_DATA_SIZE, decompressedSize);
+
+	for(std::size_t i = 0; i < TEST_DATA_SIZE; ++i)
+		assertEquals(TEST_DATA[i], decompressed.get()[i]);
+}
+
+void CompressionTest::testPayloadFormat()
+{
+	using namespace compression;
+	using namespace vrfy::assert;
+
+	// Plain .xz data, as exported before codec identifiers were added,
+	// is still a valid payload.
+
+	std::shared_ptr<uint8_t> xz;
+	std::size_t xzSize = lzmaCompress(xz, TEST_DATA, TEST_DATA_SIZE);
+
+	std::shared_ptr<uint8_t> decompressed;
+	assertEquals(TEST_DATA_SIZE,
+	             decompressPayload(decompressed, xz.get(), xzSize,
+	                               CompressionOptions()));
+	assertEquals(0, memcmp(decompressed.get(), TEST_DATA, TEST_DATA_SIZE));
+
+	// Unknown codec identifiers are rejected.
+
+	const uint8_t UNKNOWN[] = {0x7F, 0x00, 0x01};
+	std::string message;
+	try
+	{
+		decompressPayload(decompressed, UNKNOWN, sizeof(UNKNOWN),
+		                  CompressionOptions());
+	}
+	catch(const std::runtime_error &e)
+	{
+		message = e.what();
+	}
+	assertEquals(std::string("Unknown payload codec identifier: 127."),
+	             message);
+}
+
+void CompressionTest::testRoundTrip(const compression::LZMAOptions &options)
+{
+	using namespace compression;
+	using namespace vrfy::assert;
+
 	std::shared_ptr<uint8_t> original(new uint8_t[TEST_DATA_SIZE],
 	                                  [](uint8_t *p)
 	                                  {
@@ -112,8 +300,8 @@ void CompressionTest::test()
 	memcpy(original.get(), TEST_DATA, TEST_DATA_SIZE);
 
 	std::shared_ptr<uint8_t> compressed;
-	std::size_t compressedSize =
-	        lzmaCompress(compressed, original.get(), TEST_DATA_SIZE);
+	std::size_t compressedSize = lzmaCompress(compressed, original.get(),
+	                                          TEST_DATA_SIZE, options);
 
 	std::shared_ptr<uint8_t> decompressed;
 	std::size_t decompressedSize =
@@ -125,6 +313,394 @@ void CompressionTest::test()
 	{
 		assertEquals(original.get()[i], decompressed.get()[i]);
 	}
+
+	// The single-shot output must also be readable by the streaming
+	// decoder, and decodable directly into a caller-provided buffer.
+
+	std::shared_ptr<FILE> src(
+	        util::io::openMemory(compressed.get(), compressedSize));
+	util::Memstream streamed;
+	lzmaDecompress(streamed.getFile(), src.get());
+	std::shared_ptr<uint8_t> streamedData(streamed.detach(), free);
+	assertEquals(TEST_DATA_SIZE, streamed.getSize());
+
+	assertEquals(static_cast<uint64_t>(TEST_DATA_SIZE),
+	             lzmaDecompressedSize(compressed.get(), compressedSize));
+
+	std::vector<uint8_t> buffer(TEST_DATA_SIZE);
+	assertEquals(TEST_DATA_SIZE,
+	             lzmaDecompress(buffer.data(), buffer.size(),
+	                            compressed.get(), compressedSize));
+	assertEquals(0, memcmp(buffer.data(), TEST_DATA, TEST_DATA_SIZE));
+
+	bool threw = false;
+	try
+	{
+		lzmaDecompress(buffer.data(), buffer.size() - 1,
+		               compressed.get(), compressedSize);
+	}
+	catch(const std::runtime_error &)
+	{
+		threw = true;
+	}
+	assertEquals(true, threw);
+}
+
+void CompressionTest::testFileRoundTrip(
+        const compression::LZMAOptions &options)
+{
+	using namespace compression;
+	using namespace vrfy::assert;
+
+	std::shared_ptr<FILE> src(
+	        util::io::openMemory(TEST_DATA, TEST_DATA_SIZE));
+	util::Memstream compressed;
+	lzmaCompress(compressed.getFile(), src.get(), options);
+	std::shared_ptr<uint8_t> compressedData(compressed.detach(), free);
+
+	std::shared_ptr<FILE> compressedFile(util::io::openMemory(
+	        compressedData.get(), compressed.getSize()));
+	util::Memstream decompressed;
+	lzmaDecompress(decompressed.getFile(), compressedFile.get());
+	std::shared_ptr<uint8_t> decompressedData(decompressed.detach(), free);
+
+	assertEquals(TEST_DATA_SIZE, decompressed.getSize());
+	assertEquals(0, memcmp(decompressedData.get(), TEST_DATA,
+	                       TEST_DATA_SIZE));
+}
+
+void CompressionTest::testDescriptorRoundTrip(
+        const compression::LZMAOptions &options)
+{
+	using namespace compression;
+	using namespace vrfy::assert;
+
+	std::shared_ptr<FILE> src(
+	        createTemporaryFile(TEST_DATA, TEST_DATA_SIZE));
+	std::shared_ptr<FILE> compressed(createTemporaryFile(nullptr, 0));
+	std::shared_ptr<FILE> decompressed(createTemporaryFile(nullptr, 0));
+
+	lzmaCompress(fileno(compressed.get()), fileno(src.get()), options);
+	lseek(fileno(compressed.get()), 0, SEEK_SET);
+	lzmaDecompress(fileno(decompressed.get()), fileno(compressed.get()));
+
+	// The descriptors are left open, with everything written out.
+	std::vector<uint8_t> expected(TEST_DATA, TEST_DATA + TEST_DATA_SIZE);
+	assertEquals(true,
+	             readDescriptor(fileno(decompressed.get())) == expected);
+}
+
+void CompressionTest::testDictionaryRoundTrip()
+{
+	using namespace compression;
+	using namespace vrfy::assert;
+
+	// Train with samples which share most of their content with our data.
+
+	std::vector<std::vector<uint8_t>> samples;
+	for(std::size_t i = 0; i < 8; ++i)
+	{
+		std::vector<uint8_t> sample(TEST_DATA, TEST_DATA + TEST_DATA_SIZE);
+		sample[i * (TEST_DATA_SIZE / 8)] ^= 0xFF;
+		samples.push_back(sample);
+	}
+
+	std::shared_ptr<DictionaryStore> store(new DictionaryStore());
+	std::shared_ptr<const Dictionary> dictionary(
+	        trainDictionary(samples, 4096));
+	store->add(dictionary);
+
+	LZMAOptions options;
+	options.format = LZMAFormat::Raw;
+
+	std::shared_ptr<uint8_t> plain;
+	std::size_t plainSize =
+	        lzmaCompress(plain, TEST_DATA, TEST_DATA_SIZE, options);
+
+	options.dictionary = dictionary;
+	std::shared_ptr<uint8_t> compressed;
+	std::size_t compressedSize =
+	        lzmaCompress(compressed, TEST_DATA, TEST_DATA_SIZE, options);
+
+	assertEquals(true, compressedSize < plainSize);
+
+	LZMADecoderOptions decoderOptions;
+	decoderOptions.dictionaries = store;
+
+	std::shared_ptr<uint8_t> decompressed;
+	std::size_t decompressedSize = lzmaDecompress(
+	        decompressed, compressed.get(), compressedSize, decoderOptions);
+
+	assertEquals(TEST_DATA_SIZE, decompressedSize);
+
+	for(std::size_t i = 0; i < TEST_DATA_SIZE; ++i)
+		assertEquals(TEST_DATA[i], decompressed.get()[i]);
+}
+
+void CompressionTest::testFilterDetection()
+{
+	using namespace compression;
+	using namespace vrfy::assert;
+
+	assertEquals(FilterType::None,
+	             detectFilter(TEST_DATA, TEST_DATA_SIZE).type);
+
+	// A slowly increasing series of 16-bit samples suits the delta filter.
+
+	std::vector<uint8_t> samples;
+	for(uint32_t i = 0; i < 8192; ++i)
+	{
+		uint16_t sample = static_cast<uint16_t>(i * 7 + (i % 5));
+		samples.push_back(static_cast<uint8_t>(sample & 0xFF));
+		samples.push_back(static_cast<uint8_t>(sample >> 8));
+	}
+
+	Filter filter(detectFilter(samples.data(), samples.size()));
+	assertEquals(FilterType::Delta, filter.type);
+	assertEquals(2U, filter.distance);
+
+	// ELF headers are identified by their machine type.
+
+	std::vector<uint8_t> elf(64, 0);
+	memcpy(elf.data(), "\177ELF", 4);
+	elf[5] = 1;
+	elf[18] = 183;
+	assertEquals(FilterType::ARM64,
+	             detectFilter(elf.data(), elf.size()).type);
+
+	assertEquals(std::string("delta:2"), getFilterName(filter));
+	assertEquals(FilterType::Delta, parseFilter("delta:2").type);
+	assertEquals(2U, parseFilter("delta:2").distance);
+}
+
+void CompressionTest::testContext()
+{
+	using namespace compression;
+	using namespace vrfy::assert;
+
+	// A context should produce the same output as the free functions, as
+	// it switches between formats, levels and coding directions.
+
+	LZMAContext context;
+	for(std::size_t i = 0; i < 8; ++i)
+	{
+		LZMAOptions options;
+		options.threads = 1;
+		options.level = static_cast<uint32_t>(i % 3) * 3;
+		options.format = (i % 2 == 0) ? LZMAFormat::Raw : LZMAFormat::XZ;
+		std::size_t size = TEST_DATA_SIZE - i * 16;
+
+		std::shared_ptr<uint8_t> expected;
+		std::size_t expectedSize =
+		        lzmaCompress(expected, TEST_DATA, size, options);
+
+		std::shared_ptr<uint8_t> compressed;
+		std::size_t compressedSize =
+		        context.compress(compressed, TEST_DATA, size, options);
+
+		assertEquals(expectedSize, compressedSize);
+		assertEquals(0, memcmp(expected.get(), compressed.get(),
+		                       compressedSize));
+
+		std::shared_ptr<uint8_t> decompressed;
+		assertEquals(size, context.decompress(decompressed,
+		                                      compressed.get(),
+		                                      compressedSize));
+		assertEquals(0, memcmp(decompressed.get(), TEST_DATA, size));
+	}
+
+	assertEquals(true, context.getReservedMemory() > 0);
+}
+
+void CompressionTest::testProbe()
+{
+	using namespace compression;
+	using namespace vrfy::assert;
+
+	assertEquals(true, probeCompressibility(TEST_DATA, TEST_DATA_SIZE)
+	                           .compressible);
+
+	// Pseudo-random data should be detected as incompressible.
+
+	std::vector<uint8_t> noise(1 << 17);
+	uint32_t state = 1;
+	for(uint8_t &b : noise)
+	{
+		state = state * 1103515245 + 12345;
+		b = static_cast<uint8_t>(state >> 24);
+	}
+
+	ProbeResult result = probeCompressibility(noise.data(), noise.size());
+	assertEquals(false, result.compressible);
+	assertEquals(true, result.entropy > 7.9);
+
+	// A pipe can't be sampled without consuming it, so it is left alone,
+	// and assumed to be compressible.
+
+	std::shared_ptr<FILE> reader;
+	std::shared_ptr<FILE> writer;
+	util::io::openPipe(reader, writer);
+	std::vector<uint8_t> piped(4096);
+	assertEquals(piped.size(), fwrite(noise.data(), 1, piped.size(),
+	                                  writer.get()));
+	writer.reset();
+
+	result = probeCompressibility(reader.get());
+	assertEquals(true, result.compressible);
+	assertEquals(static_cast<uint64_t>(0), result.sampledSize);
+
+	assertEquals(piped.size(),
+	             fread(piped.data(), 1, piped.size(), reader.get()));
+	assertEquals(0, memcmp(piped.data(), noise.data(), piped.size()));
+}
+
+void CompressionTest::testDecoderLimits()
+{
+	using namespace compression;
+	using namespace vrfy::assert;
+
+	// By default, the decoder's memory use is limited, to the same
+	// amount as the encoder's.
+
+	assertEquals(LZMAOptions().memoryLimit,
+	             LZMADecoderOptions().memoryLimit);
+	assertEquals(true, LZMADecoderOptions().memoryLimit > 0);
+
+	for(LZMAFormat format : {LZMAFormat::XZ, LZMAFormat::Raw})
+	{
+		LZMAOptions options;
+		options.threads = 1;
+		options.format = format;
+
+		std::shared_ptr<uint8_t> compressed;
+		std::size_t compressedSize = lzmaCompress(
+		        compressed, TEST_DATA, TEST_DATA_SIZE, options);
+
+		// Streaming into a sink should produce all of the data.
+
+		std::vector<uint8_t> output;
+		std::shared_ptr<FILE> src(
+		        util::io::openMemory(compressed.get(), compressedSize));
+		lzmaDecompress([&output](const uint8_t *data, std::size_t size)
+		               {
+			output.insert(output.end(), data, data + size);
+		}, src.get());
+
+		assertEquals(true, std::vector<uint8_t>(TEST_DATA,
+		                                        TEST_DATA +
+		                                                TEST_DATA_SIZE) ==
+		                           output);
+
+		// A tiny memory limit should report the limit required.
+
+		LZMADecoderOptions limited;
+		limited.memoryLimit = 1024;
+		uint64_t required = 0;
+		try
+		{
+			std::shared_ptr<uint8_t> decompressed;
+			lzmaDecompress(decompressed, compressed.get(),
+			               compressedSize, limited);
+		}
+		catch(const MemoryLimitError &e)
+		{
+			required = e.getRequiredLimit();
+		}
+		assertEquals(true, required > limited.memoryLimit);
+
+		limited.memoryLimit = required;
+		std::shared_ptr<uint8_t> decompressed;
+		assertEquals(TEST_DATA_SIZE,
+		             lzmaDecompress(decompressed, compressed.get(),
+		                            compressedSize, limited));
+
+		// Output beyond the output limit should be rejected.
+
+		limited.outputLimit = TEST_DATA_SIZE - 1;
+		bool threw = false;
+		try
+		{
+			lzmaDecompress(decompressed, compressed.get(),
+			               compressedSize, limited);
+		}
+		catch(const std::runtime_error &)
+		{
+			threw = true;
+		}
+		assertEquals(true, threw);
+	}
+
+	// A raw header may declare any size. An implausibly large one (here,
+	// 1 TiB) must be treated as corrupt, not allocated up front.
+
+	LZMAOptions options;
+	options.format = LZMAFormat::Raw;
+	options.checksum = false;
+	options.filter = Filter(FilterType::None);
+
+	std::shared_ptr<uint8_t> compressed;
+	std::size_t compressedSize =
+	        lzmaCompress(compressed, TEST_DATA, TEST_DATA_SIZE, options);
+
+	uint64_t size = 0;
+	std::size_t headerSize =
+	        1 + util::io::decodeVarint(size, compressed.get() + 1,
+	                                   compressedSize - 1);
+	assertEquals(static_cast<uint64_t>(TEST_DATA_SIZE), size);
+
+	std::vector<uint8_t> forged(1, compressed.get()[0]);
+	forged.resize(1 + util::io::MAX_VARINT_SIZE);
+	forged.resize(1 + util::io::encodeVarint(forged.data() + 1, 1ULL << 40));
+	forged.insert(forged.end(), compressed.get() + headerSize,
+	              compressed.get() + compressedSize);
+
+	std::string message;
+	try
+	{
+		std::shared_ptr<uint8_t> decompressed;
+		lzmaDecompress(decompressed, forged.data(), forged.size());
+	}
+	catch(const std::runtime_error &e)
+	{
+		message = e.what();
+	}
+	assertEquals(std::string("Raw LZMA2 data has the wrong size."), message);
+}
+void CompressionTest::testIncompressibleBlocks()
+{
+	using namespace compression;
+	using namespace vrfy::assert;
+
+	// Every block adds its own header, padding and check to the output,
+	// which incompressible data gains nothing to make up for.
+
+	std::vector<uint8_t> noise(1 << 20);
+	uint32_t state = 1;
+	for(uint8_t &b : noise)
+	{
+		state = state * 1103515245 + 12345;
+		b = static_cast<uint8_t>(state >> 24);
+	}
+
+	for(uint64_t blockSize : {4096u, 65536u})
+	{
+		LZMAOptions options;
+		options.threads = 4;
+		options.blockSize = blockSize;
+		options.level = 1;
+
+		std::shared_ptr<uint8_t> compressed;
+		std::size_t compressedSize = lzmaCompress(
+		        compressed, noise.data(), noise.size(), options);
+		assertEquals(true, compressedSize > noise.size());
+
+		std::shared_ptr<uint8_t> decompressed;
+		assertEquals(noise.size(),
+		             lzmaDecompress(decompressed, compressed.get(),
+		                            compressedSize));
+		assertEquals(0, memcmp(decompressed.get(), noise.data(),
+		                       noise.size()));
+	}
 }
 }
 }
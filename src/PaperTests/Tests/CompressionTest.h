@@ -21,6 +21,9 @@
 
 #include <Vrfy/Vrfy.h>
 
+#include "PaperCommon/Compression/Codec.h"
+#include "PaperCommon/Compression/LZMA.h"
+
 namespace paper
 {
 namespace tests
@@ -48,6 +51,85 @@ public:
 	 * tests.
 	 */
 	virtual void test();
+
+private:
+	/**
+	 * This function compresses and then decompresses our test data using
+	 * the given options, verifying that the original data is recovered.
+	 *
+	 * \param options The compression options to test with.
+	 */
+	void testRoundTrip(const compression::LZMAOptions &options);
+
+	/**
+	 * This function compresses our test data from one FILE to another, and
+	 * then decompresses it again, verifying that the original data is
+	 * recovered.
+	 *
+	 * \param options The compression options to test with.
+	 */
+	void testFileRoundTrip(const compression::LZMAOptions &options);
+
+	/**
+	 * This function does the same as testFileRoundTrip, but using the
+	 * file descriptor based functions on temporary files.
+	 *
+	 * \param options The compression options to test with.
+	 */
+	void testDescriptorRoundTrip(const compression::LZMAOptions &options);
+
+	/**
+	 * This function compresses our test data into a tagged payload with
+	 * the given codec, and verifies that decompressing the payload
+	 * recovers the original data.
+	 *
+	 * \param codec The codec to test.
+	 */
+	void testCodecRoundTrip(const compression::Codec &codec);
+
+	/**
+	 * This function verifies that plain .xz payloads are still read, and
+	 * that payloads with unknown codec identifiers are rejected.
+	 */
+	void testPayloadFormat();
+
+	/**
+	 * This function trains a preset dictionary from samples similar to our
+	 * test data, and verifies that compressing with it produces smaller
+	 * output which still decompresses to the original data.
+	 */
+	void testDictionaryRoundTrip();
+
+	/**
+	 * This function verifies that filters are chosen sensibly for
+	 * executables, numeric samples and text.
+	 */
+	void testFilterDetection();
+
+	/**
+	 * This function verifies that a reused LZMAContext produces the same
+	 * output as the free compression functions.
+	 */
+	void testContext();
+
+	/**
+	 * This function verifies that the compressibility probe accepts our
+	 * (text) test data, and rejects pseudo-random data.
+	 */
+	void testProbe();
+
+	/**
+	 * This function verifies that streaming decompression produces all of
+	 * our test data, and that the decoder's memory and output limits are
+	 * enforced.
+	 */
+	void testDecoderLimits();
+
+	/**
+	 * This function verifies that incompressible data split into many
+	 * small blocks still fits in the single-shot compressor's output.
+	 */
+	void testIncompressibleBlocks();
 };
 }
 }
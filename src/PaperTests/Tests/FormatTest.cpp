@@ -0,0 +1,369 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "FormatTest.h"
+
+#include "PaperCommon/Compression/Codec.h"
+#include "PaperCommon/Format/Erasure.h"
+#include "PaperCommon/Format/Framing.h"
+#include "PaperCommon/Format/Groups.h"
+#include "PaperCommon/Util/CRC32C.h"
+#include "PaperCommon/Util/IO.h"
+#include "PaperCommon/Util/Memstream.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+/**
+ * \brief The size of each simulated QR code, in bytes.
+ */
+const std::size_t CODE_SIZE = 1000;
+
+/**
+ * This function returns some compressible test data of the given size.
+ *
+ * \param size The size of the data to generate.
+ * \return The generated data.
+ */
+std::vector<uint8_t> getTestData(std::size_t size)
+{
+	std::string text;
+	for(std::size_t i = 0; text.size() < size; ++i)
+		text += "Line " + std::to_string(i * 7919 % 1000) + " of data.\n";
+
+	text.resize(size);
+	return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+/**
+ * This function splits each of the given groups into simulated QR codes.
+ *
+ * \param groups The groups to split.
+ * \return The contents of each QR code, in order.
+ */
+std::vector<std::vector<uint8_t>>
+splitCodes(const std::vector<paper::format::Group> &groups)
+{
+	std::vector<std::vector<uint8_t>> codes;
+	for(const paper::format::Group &group : groups)
+	{
+		for(std::size_t offset = 0; offset < group.data.size();
+		    offset += CODE_SIZE)
+		{
+			auto begin = group.data.begin() +
+			             static_cast<std::ptrdiff_t>(offset);
+			auto end = group.data.begin() +
+			           static_cast<std::ptrdiff_t>(std::min(
+			                   offset + CODE_SIZE, group.data.size()));
+			codes.push_back(std::vector<uint8_t>(begin, end));
+		}
+	}
+
+	return codes;
+}
+
+/**
+ * This function restores the given range from the given groups into memory.
+ *
+ * \param groups The decoded groups.
+ * \param begin The offset of the first byte to restore.
+ * \param end The offset just past the last byte to restore.
+ * \return The restored data.
+ */
+std::vector<uint8_t>
+restore(const std::vector<paper::format::DecodedGroup> &groups,
+        uint64_t begin = 0, uint64_t end = UINT64_MAX)
+{
+	paper::util::Memstream stream;
+	paper::format::restoreGroups(stream.getFile(), groups, begin, end);
+
+	std::shared_ptr<uint8_t> data(stream.detach(), free);
+	return std::vector<uint8_t>(data.get(), data.get() + stream.getSize());
+}
+
+/**
+ * This function restores whatever it can from the given groups into memory,
+ * with zeros in place of any missing groups.
+ *
+ * \param groups The decoded groups.
+ * \return The restored data.
+ */
+std::vector<uint8_t>
+restoreIntact(const std::vector<paper::format::DecodedGroup> &groups)
+{
+	paper::util::Memstream stream;
+	uint64_t size =
+	        paper::format::restoreIntactGroups(stream.getFile(), groups);
+	stream.flush();
+	if(size != stream.getSize())
+		throw std::runtime_error("Restored size is wrong.");
+
+	std::shared_ptr<uint8_t> data(stream.detach(), free);
+	return std::vector<uint8_t>(data.get(), data.get() + stream.getSize());
+}
+}
+
+namespace paper
+{
+namespace tests
+{
+FormatTest::FormatTest()
+{
+}
+
+FormatTest::~FormatTest()
+{
+}
+
+void FormatTest::test()
+{
+	testGroups();
+	testFraming();
+	testErasure();
+}
+
+void FormatTest::testGroups()
+{
+	using namespace vrfy::assert;
+
+	const std::size_t GROUP_SIZE = 16384;
+	std::vector<uint8_t> data(getTestData(5 * GROUP_SIZE + 123));
+
+	compression::CompressionOptions options;
+	options.lzma.threads = 1;
+	std::vector<std::shared_ptr<compression::Codec>> codecs;
+	codecs.push_back(compression::createCodec("lzma", options));
+	codecs.push_back(compression::createCodec("store", options));
+
+	std::shared_ptr<FILE> src(
+	        util::io::openMemory(data.data(), data.size()));
+	std::vector<format::Group> groups(
+	        format::encodeGroups(src.get(), GROUP_SIZE, codecs, 4));
+	assertEquals(static_cast<std::size_t>(6), groups.size());
+
+	// All of the data should be recovered from an intact set of codes.
+
+	std::vector<std::vector<uint8_t>> codes(splitCodes(groups));
+	std::vector<format::DecodedGroup> decoded(
+	        format::decodeGroups(codes, options, 4));
+	assertEquals(groups.size(), decoded.size());
+	assertEquals(true, restore(decoded) == data);
+
+	// Losing the first code of the third group only loses that group.
+
+	std::size_t lost = 0;
+	for(std::size_t i = 0; i < 2; ++i)
+		lost += (groups[i].data.size() + CODE_SIZE - 1) / CODE_SIZE;
+	codes.erase(codes.begin() + static_cast<std::ptrdiff_t>(lost));
+
+	decoded = format::decodeGroups(codes, options, 4);
+	std::vector<uint64_t> missing(format::getMissingGroups(decoded));
+	assertEquals(static_cast<std::size_t>(1), missing.size());
+	assertEquals(static_cast<uint64_t>(2), missing[0]);
+
+	std::vector<uint8_t> prefix(restore(decoded, 100, 2 * GROUP_SIZE));
+	assertEquals(true, std::vector<uint8_t>(data.begin() + 100,
+	                                        data.begin() + 2 * GROUP_SIZE) ==
+	                           prefix);
+
+	std::vector<uint8_t> suffix(restore(decoded, 3 * GROUP_SIZE));
+	assertEquals(true, std::vector<uint8_t>(data.begin() + 3 * GROUP_SIZE,
+	                                        data.end()) == suffix);
+
+	bool threw = false;
+	try
+	{
+		restore(decoded);
+	}
+	catch(const std::runtime_error &)
+	{
+		threw = true;
+	}
+	assertEquals(true, threw);
+
+	// Otherwise, the intact groups are restored in place, with zeros in
+	// place of the lost group.
+
+	std::vector<format::GroupGap> gaps(format::getGroupGaps(decoded));
+	assertEquals(static_cast<std::size_t>(1), gaps.size());
+	assertEquals(static_cast<uint64_t>(2), gaps[0].first);
+	assertEquals(static_cast<uint64_t>(3), gaps[0].last);
+	assertEquals(static_cast<uint64_t>(2 * GROUP_SIZE), gaps[0].begin);
+	assertEquals(static_cast<uint64_t>(3 * GROUP_SIZE), gaps[0].end);
+
+	std::vector<uint8_t> expected(data);
+	std::fill(expected.begin() + 2 * GROUP_SIZE,
+	          expected.begin() + 3 * GROUP_SIZE, 0);
+	assertEquals(true, restoreIntact(decoded) == expected);
+
+	// Without the final group, the input's size is unknown, so the
+	// output ends with the last intact group.
+
+	decoded.pop_back();
+	gaps = format::getGroupGaps(decoded);
+	assertEquals(static_cast<std::size_t>(2), gaps.size());
+	assertEquals(static_cast<uint64_t>(5), gaps[1].first);
+	assertEquals(static_cast<uint64_t>(5 * GROUP_SIZE), gaps[1].begin);
+	assertEquals(UINT64_MAX, gaps[1].end);
+
+	expected.resize(5 * GROUP_SIZE);
+	assertEquals(true, restoreIntact(decoded) == expected);
+}
+
+void FormatTest::testFraming()
+{
+	using namespace vrfy::assert;
+
+	// This is the standard CRC32C check value.
+	const uint8_t CHECK[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+	assertEquals(UINT32_C(0xE3069283), util::crc32c(CHECK, sizeof(CHECK)));
+	assertEquals(UINT32_C(0xE3069283),
+	             util::crc32c(CHECK + 4, 5, util::crc32c(CHECK, 4)));
+
+	std::vector<uint8_t> data(getTestData(20 * CODE_SIZE + 10));
+	std::vector<std::vector<uint8_t>> chunks;
+	for(std::size_t offset = 0; offset < data.size(); offset += CODE_SIZE)
+	{
+		std::size_t end = std::min(offset + CODE_SIZE, data.size());
+		chunks.push_back(std::vector<uint8_t>(data.data() + offset,
+		                                      data.data() + end));
+	}
+
+	std::vector<std::vector<uint8_t>> frames(
+	        format::writeFrames(chunks, 1234));
+	assertEquals(chunks.size(), frames.size());
+	assertEquals(format::getFrameHeaderSize(frames.size()) + CODE_SIZE,
+	             frames[0].size());
+
+	// Scan the frames backwards, with one damaged and one left out, plus a
+	// duplicate and a frame from some other export.
+
+	std::vector<std::vector<uint8_t>> scans(frames.rbegin(),
+	                                        frames.rend() - 1);
+	scans[3][scans[3].size() / 2] ^= 0x01;
+	scans.push_back(frames[5]);
+	scans.push_back(format::writeFrames(chunks, 5678)[0]);
+
+	format::Reassembler reassembler(
+	        format::getMaximumFrameTotal(scans.size()));
+	std::vector<format::FrameStatus> statuses(
+	        reassembler.addAll(scans, 4));
+	assertEquals(true, statuses[0] == format::FrameStatus::Accepted);
+	assertEquals(true, statuses[3] == format::FrameStatus::Damaged);
+	assertEquals(true, statuses[statuses.size() - 2] ==
+	                           format::FrameStatus::Duplicate);
+	assertEquals(true, statuses.back() == format::FrameStatus::Foreign);
+
+	assertEquals(UINT32_C(1234), reassembler.getExportId());
+	assertEquals(false, reassembler.isComplete());
+	assertEquals(static_cast<uint64_t>(0),
+	             reassembler.getContiguousCount());
+	std::vector<uint64_t> missing(reassembler.getMissing());
+	assertEquals(static_cast<std::size_t>(2), missing.size());
+	assertEquals(static_cast<uint64_t>(0), missing[0]);
+	assertEquals(static_cast<uint64_t>(frames.size() - 4), missing[1]);
+
+	assertEquals(true, reassembler.add(frames[0].data(),
+	                                   frames[0].size()) ==
+	                           format::FrameStatus::Accepted);
+	assertEquals(static_cast<uint64_t>(frames.size() - 4),
+	             reassembler.getContiguousCount());
+	std::vector<uint8_t> &damaged = frames[frames.size() - 4];
+	assertEquals(true, reassembler.add(damaged.data(), damaged.size()) ==
+	                           format::FrameStatus::Accepted);
+	assertEquals(true, reassembler.isComplete());
+	assertEquals(true, reassembler.assemble() == data);
+
+	// A frame's checksum doesn't stop it from declaring any total, so one
+	// which is implausible for the number of codes read is rejected.
+
+	std::vector<std::vector<uint8_t>> forged(format::writeFrames(
+	        std::vector<std::vector<uint8_t>>(1000), 1234));
+	format::Reassembler single(format::getMaximumFrameTotal(1));
+	assertEquals(true, single.add(forged[0].data(), forged[0].size()) ==
+	                           format::FrameStatus::Damaged);
+	assertEquals(static_cast<uint64_t>(0), single.getTotal());
+	assertEquals(UINT64_MAX, format::getMaximumFrameTotal(UINT64_MAX));
+}
+
+void FormatTest::testErasure()
+{
+	using namespace vrfy::assert;
+
+	// Use a short final stripe, with a short final chunk.
+	std::vector<uint8_t> data(getTestData(8 * CODE_SIZE + 123));
+	format::ErasureParameters parameters;
+	parameters.dataChunks = 5;
+	parameters.parityChunks = 2;
+
+	std::vector<std::vector<uint8_t>> chunks(format::encodeErasure(
+	        data.data(), data.size(), CODE_SIZE, parameters));
+	assertEquals(static_cast<std::size_t>(13), chunks.size());
+	assertEquals(chunks.size(),
+	             format::getErasureChunkCount(data.size(), CODE_SIZE,
+	                                          parameters));
+	for(const std::vector<uint8_t> &chunk : chunks)
+	{
+		assertEquals(true,
+		             format::isErasure(chunk.data(), chunk.size()));
+	}
+	assertEquals(false, format::isErasure(data.data(), data.size()));
+
+	// Lose every possible pair of chunks from the first stripe, along
+	// with one data and one parity chunk from the last.
+
+	bool restored = true;
+	for(uint64_t a = 0; a < 7; ++a)
+	{
+		for(uint64_t b = a + 1; b < 7; ++b)
+		{
+			std::vector<uint64_t> missing = {a, b, 8, 11};
+			std::vector<std::vector<uint8_t>> lost(chunks);
+			for(uint64_t i : missing)
+				lost[static_cast<std::size_t>(i)].clear();
+
+			std::vector<uint8_t> decoded(
+			        format::decodeErasure(lost, missing));
+			restored = restored && (decoded == data);
+		}
+	}
+	assertEquals(true, restored);
+
+	bool threw = false;
+	try
+	{
+		format::decodeErasure(chunks, {0, 1, 2});
+	}
+	catch(const std::runtime_error &)
+	{
+		threw = true;
+	}
+	assertEquals(true, threw);
+}
+}
+}
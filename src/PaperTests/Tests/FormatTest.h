@@ -0,0 +1,78 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_TESTS_FORMAT_TEST_H
+#define PAPER_TESTS_FORMAT_TEST_H
+
+#include <Vrfy/Vrfy.h>
+
+namespace paper
+{
+namespace tests
+{
+/**
+ * \brief This class implements unit tests for our payload formats.
+ */
+class FormatTest : public vrfy::Test
+{
+public:
+	/**
+	 * This is our default constructor, which creates a new instance of our
+	 * format tests.
+	 */
+	FormatTest();
+
+	/**
+	 * This is our default destructor, which cleans up & destroys this
+	 * object.
+	 */
+	virtual ~FormatTest();
+
+	/**
+	 * This function provides the main entrypoint for this class's unit
+	 * tests.
+	 */
+	virtual void test();
+
+private:
+	/**
+	 * This function splits some data into block groups, and verifies that
+	 * it can be restored in full, and that losing one QR code only loses
+	 * the group it belongs to.
+	 */
+	void testGroups();
+
+	/**
+	 * This function verifies our CRC32C implementation, and that framed
+	 * chunks can be reassembled in any order, with damaged, duplicate and
+	 * foreign frames rejected and missing frames reported.
+	 */
+	void testFraming();
+
+	/**
+	 * This function verifies that erasure coded data can be restored with
+	 * any combination of chunks lost, up to the number of parity chunks in
+	 * each stripe.
+	 */
+	void testErasure();
+};
+}
+}
+
+#endif
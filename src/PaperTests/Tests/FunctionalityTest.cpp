@@ -0,0 +1,542 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "FunctionalityTest.h"
+
+#include "PaperCommon/Format/Framing.h"
+#include "PaperCommon/Functionality.h"
+#include "PaperCommon/QR/Decoder.h"
+#include "PaperCommon/QR/ModuleMatrix.h"
+#include "PaperCommon/Render/Image.h"
+#include "PaperCommon/Render/PNM.h"
+#include "PaperCommon/Symbol/Symbol.h"
+#include "PaperCommon/Symbol/Symbology.h"
+#include "PaperCommon/Util/FS.h"
+#include "PaperCommon/Util/IO.h"
+#include "PaperCommon/Util/Memstream.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace
+{
+/**
+ * \brief This class creates a temporary directory, and removes it along with
+ * the files in it when it is destroyed.
+ */
+class TemporaryDirectory
+{
+public:
+	/**
+	 * This constructor creates a new, empty directory.
+	 */
+	TemporaryDirectory() : path()
+	{
+		char name[] = "/tmp/PaperTests.XXXXXX";
+		if(mkdtemp(name) == nullptr)
+		{
+			throw std::runtime_error(
+			        "Creating temporary directory failed.");
+		}
+		path = name;
+	}
+
+	/**
+	 * This destructor removes the directory, and the files in it.
+	 */
+	~TemporaryDirectory()
+	{
+		for(const std::string &name : paper::util::fs::listFiles(path))
+			std::remove(getPath(name).c_str());
+		rmdir(path.c_str());
+	}
+
+	/**
+	 * \param name The name of a file in this directory.
+	 * \return The path to the file.
+	 */
+	std::string getPath(const std::string &name) const
+	{
+		return paper::util::fs::appendPath(path, name);
+	}
+
+	/**
+	 * This function writes the given data to a new file in this
+	 * directory.
+	 *
+	 * \param name The name of the file.
+	 * \param data The file's contents.
+	 * \return The path to the file.
+	 */
+	std::string write(const std::string &name,
+	                  const std::vector<uint8_t> &data) const
+	{
+		std::string file(getPath(name));
+		paper::util::io::writeFile(
+		        file, reinterpret_cast<const char *>(data.data()),
+		        data.size());
+		return file;
+	}
+
+private:
+	std::string path;
+
+	TemporaryDirectory(const TemporaryDirectory &);
+	TemporaryDirectory &operator=(const TemporaryDirectory &);
+};
+
+/**
+ * This function returns some pseudo-random test data of the given size,
+ * which is incompressible, so it is stored as-is.
+ *
+ * \param size The size of the data to generate.
+ * \param seed The seed to generate the data from.
+ * \return The generated data.
+ */
+std::vector<uint8_t> getTestData(std::size_t size, uint32_t seed)
+{
+	std::vector<uint8_t> data(size);
+	for(uint8_t &byte : data)
+	{
+		seed = seed * 1103515245 + 12345;
+		byte = static_cast<uint8_t>(seed >> 16);
+	}
+	return data;
+}
+
+/**
+ * This function returns some compressible test data of the given size.
+ *
+ * \param size The size of the data to generate.
+ * \return The generated data.
+ */
+std::vector<uint8_t> getTextData(std::size_t size)
+{
+	std::string text;
+	for(std::size_t i = 0; text.size() < size; ++i)
+	{
+		text += "Line " + std::to_string(i * 7919 % 1000) +
+		        " of data.\n";
+	}
+
+	text.resize(size);
+	return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+/**
+ * This function writes each of the given symbols to its own PGM image in the
+ * given directory, as a page would look once scanned: four pixels per module,
+ * with a four module quiet zone.
+ *
+ * \param directory The directory to write the images to.
+ * \param name The prefix of each image's file name.
+ * \param codes The symbols to write.
+ * \return The paths to the images, in order.
+ */
+std::vector<std::string> writePages(
+        const TemporaryDirectory &directory, const std::string &name,
+        const std::vector<paper::symbol::Symbol> &codes)
+{
+	const std::size_t SCALE = 4;
+	const std::size_t QUIET = 4;
+
+	std::vector<std::string> paths;
+	for(const paper::symbol::Symbol &code : codes)
+	{
+		std::size_t width = code.getWidth() + 2 * QUIET;
+		std::size_t height = code.getHeight() + 2 * QUIET;
+		paper::render::Image image(width * SCALE, height * SCALE, 1);
+		for(std::size_t y = 0; y < image.height; ++y)
+		{
+			for(std::size_t x = 0; x < image.width; ++x)
+			{
+				std::size_t u = x / SCALE;
+				std::size_t v = y / SCALE;
+				bool dark = (u >= QUIET) && (v >= QUIET) &&
+				            (u < width - QUIET) &&
+				            (v < height - QUIET) &&
+				            code.isDark(u - QUIET, v - QUIET);
+				*image.getPixel(x, y) = dark ? 40 : 210;
+			}
+		}
+
+		paths.push_back(directory.write(
+		        name + std::to_string(paths.size()) + ".pgm",
+		        paper::render::writePNM(image)));
+	}
+	return paths;
+}
+
+/**
+ * This function restores a file from the given pages, and returns the error
+ * this fails with. If it fails, the output file must have been removed.
+ *
+ * \param paths The paths to the pages.
+ * \param path The path to write the restored file to.
+ * \return The error message, or an empty string if the file was restored.
+ */
+std::string getDecodeError(const std::vector<std::string> &paths,
+                           const std::string &path)
+{
+	try
+	{
+		paper::DecodeOptions options;
+		options.threads = 4;
+		paper::decode(paths, path, options);
+	}
+	catch(const std::runtime_error &e)
+	{
+		if(paper::util::fs::exists(path))
+			return "Output file was left behind.";
+		return e.what();
+	}
+	return std::string();
+}
+
+/**
+ * This function returns a copy of the given symbol, with the modules in its
+ * bottom right quadrant inverted, which is more damage than any symbol can
+ * correct.
+ *
+ * \param code The symbol to copy.
+ * \return The corrupted copy.
+ */
+paper::symbol::Symbol corrupt(const paper::symbol::Symbol &code)
+{
+	paper::qr::ModuleMatrix modules(code.getModules());
+	for(std::size_t y = modules.getHeight() / 2; y < modules.getHeight();
+	    ++y)
+	{
+		for(std::size_t x = modules.getWidth() / 2;
+		    x < modules.getWidth(); ++x)
+		{
+			modules.set(x, y, !modules.get(x, y));
+		}
+	}
+
+	return paper::symbol::Symbol(code.getSymbology(), code.getVersion(),
+	                             modules);
+}
+
+/**
+ * This function restores a file from the given codes' contents into memory.
+ *
+ * \param codes The contents of each code.
+ * \param options The options which control how the data is decoded.
+ * \return The restored data.
+ */
+std::vector<uint8_t>
+restoreCodes(const std::vector<std::vector<uint8_t>> &codes,
+             const paper::DecodeOptions &options = paper::DecodeOptions())
+{
+	paper::util::Memstream stream;
+	paper::restore(stream.getFile(), codes, options);
+	stream.flush();
+
+	std::shared_ptr<uint8_t> data(stream.detach(), free);
+	return std::vector<uint8_t>(data.get(), data.get() + stream.getSize());
+}
+}
+
+namespace paper
+{
+namespace tests
+{
+FunctionalityTest::FunctionalityTest()
+{
+}
+
+FunctionalityTest::~FunctionalityTest()
+{
+}
+
+void FunctionalityTest::test()
+{
+	testFramedEncode();
+	testErasure();
+	testVerify();
+	testDecode();
+}
+
+void FunctionalityTest::testFramedEncode()
+{
+	using namespace vrfy::assert;
+
+	TemporaryDirectory directory;
+	std::vector<uint8_t> data(getTestData(3000, 17));
+	std::string path(directory.write("input.bin", data));
+
+	// The payload needs several frames at this size, and the last frame
+	// is short enough that two smaller codes would hold it in less area.
+	EncodeOptions options;
+	options.frame = true;
+	options.layout.maximumVersion = 20;
+	EncodeReport report;
+	std::vector<symbol::Symbol> codes(encode(path, options, &report));
+	assertEquals(true, codes.size() > 1);
+	assertEquals(true, report.exportId != 0);
+
+	// Every code must hold one whole frame, so it can be checked on its
+	// own, rather than part of a frame split over several codes.
+
+	std::vector<std::vector<uint8_t>> contents;
+	format::Reassembler reassembler(codes.size());
+	for(const symbol::Symbol &code : codes)
+	{
+		contents.push_back(qr::decodeSymbol(code.getModules()));
+		assertEquals(true, reassembler.add(contents.back().data(),
+		                                   contents.back().size()) ==
+		                           format::FrameStatus::Accepted);
+	}
+	assertEquals(true, reassembler.isComplete());
+	assertEquals(report.exportId, reassembler.getExportId());
+	assertEquals(codes.size(), reassembler.getTotal());
+
+	std::vector<std::vector<uint8_t>> reversed(contents.rbegin(),
+	                                           contents.rend());
+	assertEquals(true, restoreCodes(reversed) == data);
+}
+
+void FunctionalityTest::testErasure()
+{
+	using namespace vrfy::assert;
+
+	TemporaryDirectory directory;
+	std::vector<uint8_t> data(getTestData(3000, 18));
+	std::string path(directory.write("input.bin", data));
+
+	EncodeOptions options;
+	options.layout.maximumVersion = 10;
+	options.erasure.dataChunks = 4;
+	options.erasure.parityChunks = 2;
+	std::vector<symbol::Symbol> codes(encode(path, options));
+
+	// Lose the first code, which would otherwise start the payload, and
+	// one code from the last stripe.
+
+	std::vector<std::vector<uint8_t>> contents;
+	for(std::size_t i = 1; i < codes.size(); ++i)
+	{
+		if(i != codes.size() - 2)
+		{
+			contents.push_back(
+			        qr::decodeSymbol(codes[i].getModules()));
+		}
+	}
+	assertEquals(true, restoreCodes(contents) == data);
+}
+
+void FunctionalityTest::testVerify()
+{
+	using namespace vrfy::assert;
+
+	TemporaryDirectory directory;
+	std::vector<uint8_t> data(getTestData(2000, 19));
+	std::string path(directory.write("input.bin", data));
+
+	for(symbol::Symbology symbology :
+	    {symbol::Symbology::QR, symbol::Symbology::DataMatrix})
+	{
+		EncodeOptions options;
+		options.layout.symbology = symbology;
+		std::vector<symbol::Symbol> codes(encode(path, options));
+		assertEquals(true, codes[0].getSymbology() == symbology);
+
+		VerifyReport report;
+		assertEquals(true,
+		             verify(path, codes, DecodeOptions(), &report));
+		assertEquals(codes.size(), report.decode.codeCount);
+		assertEquals(data.size(), report.decode.outputSize);
+
+		// Damage the first symbol's modules.
+
+		std::vector<symbol::Symbol> corrupted;
+		corrupted.push_back(corrupt(codes[0]));
+		for(std::size_t i = 1; i < codes.size(); ++i)
+			corrupted.push_back(std::move(codes[i]));
+
+		bool threw = false;
+		try
+		{
+			verify(path, corrupted);
+		}
+		catch(const std::runtime_error &)
+		{
+			threw = true;
+		}
+		assertEquals(true, threw);
+	}
+}
+
+void FunctionalityTest::testDecode()
+{
+	using namespace vrfy::assert;
+
+	TemporaryDirectory directory;
+	std::vector<uint8_t> data(getTextData(6000));
+	std::string path(directory.write("input.bin", data));
+
+	EncodeOptions options;
+	options.layout.maximumVersion = 5;
+	std::vector<std::string> pages(
+	        writePages(directory, "plain", encode(path, options)));
+	options.frame = true;
+	std::vector<std::string> framed(
+	        writePages(directory, "framed", encode(path, options)));
+	assertEquals(true, pages.size() > 3);
+
+	// Unframed pages are scanned in parallel, and their payload is
+	// decompressed as the pages before it arrive.
+
+	DecodeOptions decodeOptions;
+	decodeOptions.threads = 4;
+	DecodeReport report;
+	std::string output(directory.getPath("output.bin"));
+	decode(pages, output, decodeOptions, &report);
+	assertEquals(pages.size(), report.codeCount);
+	assertEquals(data.size(), report.outputSize);
+
+	std::shared_ptr<uint8_t> restored;
+	assertEquals(data.size(), util::io::loadFile(restored, output));
+	assertEquals(true, std::equal(data.begin(), data.end(),
+	                              restored.get()));
+
+	// Framed pages may be read in any order, and pages read twice are
+	// dropped.
+
+	std::vector<std::string> shuffled(framed.rbegin(), framed.rend());
+	shuffled.insert(shuffled.begin() + 2, framed[1]);
+	report = DecodeReport();
+	output = directory.getPath("shuffled.bin");
+	decode(shuffled, output, decodeOptions, &report);
+	assertEquals(framed.size() + 1, report.codeCount);
+	assertEquals(1, report.duplicateCount);
+	assertEquals(data.size(), report.outputSize);
+
+	assertEquals(data.size(), util::io::loadFile(restored, output));
+	assertEquals(true, std::equal(data.begin(), data.end(),
+	                              restored.get()));
+
+	// An unreadable page is named if the codes aren't framed, since they
+	// must all be present. Otherwise, its frame is missing.
+
+	std::string missing(directory.getPath("missing.pgm"));
+	std::vector<std::string> unreadable(pages);
+	unreadable[1] = missing;
+	std::string error(getDecodeError(unreadable, output + ".1"));
+	assertEquals(0, error.find("Couldn't read a code from " + missing));
+
+	unreadable = framed;
+	unreadable[1] = missing;
+	assertEquals("1 of " + std::to_string(framed.size()) +
+	                     " codes are missing.",
+	             getDecodeError(unreadable, output + ".2"));
+
+	// Unframed pages out of order are put together into a corrupt
+	// payload, which the decompressor rejects.
+
+	std::vector<std::string> swapped(pages);
+	std::swap(swapped[1], swapped[2]);
+	assertEquals("Data is corrupt.",
+	             getDecodeError(swapped, output + ".3"));
+
+	// With block groups, an unreadable page only loses the groups it
+	// held, which are left as zeros, framed or not.
+
+	options = EncodeOptions();
+	options.layout.maximumVersion = 5;
+	options.groupSize = 1000;
+	for(bool frame : {false, true})
+	{
+		options.frame = frame;
+		std::vector<std::string> grouped(writePages(
+		        directory, frame ? "framedgroup" : "group",
+		        encode(path, options)));
+		assertEquals(true, grouped.size() > 6);
+		grouped[3] = missing;
+
+		report = DecodeReport();
+		output = directory.getPath(frame ? "framedgroup.bin"
+		                                 : "group.bin");
+		decode(grouped, output, decodeOptions, &report);
+		assertEquals(static_cast<std::size_t>(1),
+		             report.missingGroups.size());
+		assertEquals(static_cast<std::size_t>(1),
+		             report.unreadable.size());
+		assertEquals(data.size(), report.outputSize);
+
+		const format::GroupGap &gap = report.missingGroups[0];
+		assertEquals(true, gap.end < data.size());
+		std::vector<uint8_t> expected(data);
+		std::fill(expected.begin() +
+		                  static_cast<std::ptrdiff_t>(gap.begin),
+		          expected.begin() +
+		                  static_cast<std::ptrdiff_t>(gap.end),
+		          0);
+		assertEquals(data.size(), util::io::loadFile(restored, output));
+		assertEquals(true, std::equal(expected.begin(), expected.end(),
+		                              restored.get()));
+	}
+
+	// Past the first page, an unframed code may happen to start with the
+	// frame marker. Even if that page is read first, it mustn't be taken
+	// for a frame. The data is stored as-is, so the marker can be placed
+	// at the start of the second code.
+
+	data = getTestData(150, 20);
+	options = EncodeOptions();
+	options.layout.maximumVersion = 5;
+	std::vector<symbol::Symbol> codes(
+	        encode(directory.write("marked.bin", data), options));
+	assertEquals(2, codes.size());
+	std::vector<uint8_t> second(qr::decodeSymbol(codes[1].getModules()));
+	std::size_t offset = static_cast<std::size_t>(
+	        std::search(data.begin(), data.end(), second.begin(),
+	                    second.begin() + 16) -
+	        data.begin());
+	assertEquals(true, offset < data.size());
+
+	data[offset] = 0xF5;
+	codes = encode(directory.write("marked.bin", data), options);
+	second = qr::decodeSymbol(codes[1].getModules());
+	assertEquals(true, format::isFrame(second.data(), second.size()));
+
+	std::vector<std::string> marked(
+	        writePages(directory, "marked", codes));
+	output = directory.getPath("marked.out");
+	decode(marked, output, decodeOptions);
+	assertEquals(data.size(), util::io::loadFile(restored, output));
+	assertEquals(true, std::equal(data.begin(), data.end(),
+	                              restored.get()));
+
+	marked[0] = missing;
+	error = getDecodeError(marked, output + ".1");
+	assertEquals(0, error.find("Couldn't read a code from " + missing));
+}
+}
+}
@@ -0,0 +1,85 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_TESTS_FUNCTIONALITY_TEST_H
+#define PAPER_TESTS_FUNCTIONALITY_TEST_H
+
+#include <Vrfy/Vrfy.h>
+
+namespace paper
+{
+namespace tests
+{
+/**
+ * \brief This class implements end to end tests of exporting and importing
+ * whole files.
+ */
+class FunctionalityTest : public vrfy::Test
+{
+public:
+	/**
+	 * This is our default constructor, which creates a new instance of our
+	 * end to end tests.
+	 */
+	FunctionalityTest();
+
+	/**
+	 * This is our default destructor, which cleans up & destroys this
+	 * object.
+	 */
+	virtual ~FunctionalityTest();
+
+	/**
+	 * This function provides the main entrypoint for this class's unit
+	 * tests.
+	 */
+	virtual void test();
+
+private:
+	/**
+	 * This function encodes a file which needs several framed codes, and
+	 * verifies that each code holds exactly one whole frame, and that the
+	 * file is restored from the codes in any order.
+	 */
+	void testFramedEncode();
+
+	/**
+	 * This function verifies that erasure coded codes are detected and
+	 * restored with some of them missing, without being told the erasure
+	 * code's parameters.
+	 */
+	void testErasure();
+
+	/**
+	 * This function verifies that QR codes and Data Matrix symbols are each
+	 * decoded by verify(), and that corrupted symbols are rejected.
+	 */
+	void testVerify();
+
+	/**
+	 * This function verifies that decode() restores a file from scanned
+	 * pages in any order, and reports the right error for pages which are
+	 * unreadable or which leave the payload corrupt.
+	 */
+	void testDecode();
+};
+}
+}
+
+#endif
@@ -0,0 +1,461 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "QRTest.h"
+
+#include "PaperCommon/QR/Coding.h"
+#include "PaperCommon/QR/Encoder.h"
+#include "PaperCommon/QR/ModuleMatrix.h"
+#include "PaperCommon/QR/Planner.h"
+#include "PaperCommon/QR/QRCode.h"
+#include "PaperCommon/QR/ReedSolomon.h"
+#include "PaperCommon/Render/Color.h"
+#include "PaperCommon/Render/Image.h"
+#include "PaperCommon/Symbol/Symbol.h"
+#include "PaperCommon/Util/GF256.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <qrencode.h>
+
+namespace
+{
+/**
+ * This function returns some pseudo-random test data of the given size.
+ *
+ * \param size The size of the data to generate.
+ * \param seed The seed to generate the data from.
+ * \return The generated data.
+ */
+std::vector<uint8_t> getTestData(std::size_t size, uint32_t seed)
+{
+	std::vector<uint8_t> data(size);
+	for(uint8_t &byte : data)
+	{
+		seed = seed * 1103515245 + 12345;
+		byte = static_cast<uint8_t>(seed >> 16);
+	}
+	return data;
+}
+
+/**
+ * This function reads the mask pattern out of the (first copy of the)
+ * format information of a QR code.
+ *
+ * \param isDark A function which returns whether a module is dark.
+ * \return The mask pattern the QR code uses.
+ */
+template <typename F> unsigned int getMask(F isDark)
+{
+	unsigned int bits = 0;
+	for(std::size_t i = 0; i < 6; ++i)
+		bits |= static_cast<unsigned int>(isDark(8, i)) << i;
+	bits |= static_cast<unsigned int>(isDark(8, 7)) << 6;
+	bits |= static_cast<unsigned int>(isDark(8, 8)) << 7;
+	bits |= static_cast<unsigned int>(isDark(7, 8)) << 8;
+	for(std::size_t i = 9; i < 15; ++i)
+		bits |= static_cast<unsigned int>(isDark(14 - i, 8)) << i;
+
+	return ((bits ^ 0x5412) >> 10) & 0x7;
+}
+
+/**
+ * This function returns whether the given mask pattern inverts the module
+ * at the given position.
+ *
+ * \param mask The mask pattern.
+ * \param x The column of the module.
+ * \param y The row of the module.
+ * \return Whether the module is inverted.
+ */
+bool isMasked(unsigned int mask, std::size_t x, std::size_t y)
+{
+	switch(mask)
+	{
+	case 0:
+		return (x + y) % 2 == 0;
+	case 1:
+		return y % 2 == 0;
+	case 2:
+		return x % 3 == 0;
+	case 3:
+		return (x + y) % 3 == 0;
+	case 4:
+		return (x / 3 + y / 2) % 2 == 0;
+	case 5:
+		return x * y % 2 + x * y % 3 == 0;
+	case 6:
+		return (x * y % 2 + x * y % 3) % 2 == 0;
+	default:
+		return ((x + y) % 2 + x * y % 3) % 2 == 0;
+	}
+}
+}
+
+namespace paper
+{
+namespace tests
+{
+QRTest::QRTest()
+{
+}
+
+QRTest::~QRTest()
+{
+}
+
+void QRTest::test()
+{
+	testReedSolomon();
+	testLayout();
+	testAgainstQREncode();
+	testParallel();
+	testPlanner();
+	testColor();
+}
+
+void QRTest::testReedSolomon()
+{
+	using namespace vrfy::assert;
+
+	// Make sure the vectorized multiply handles every coefficient, and
+	// lengths which aren't a multiple of the vector size.
+	using namespace util::gf256;
+
+	std::vector<uint8_t> src(getTestData(53, 1));
+	for(unsigned int c = 0; c < 256; ++c)
+	{
+		uint8_t coefficient = static_cast<uint8_t>(c);
+		std::vector<uint8_t> expected(getTestData(src.size(), c));
+		std::vector<uint8_t> actual(expected);
+
+		for(std::size_t i = 0; i < src.size(); ++i)
+			expected[i] ^= multiply(coefficient, src[i]);
+		mulAdd(actual.data(), src.data(), coefficient, src.size());
+		assertEquals(true, expected == actual);
+
+		if(c != 0)
+		{
+			uint8_t product = multiply(coefficient, 0x53);
+			assertEquals(0x53, divide(product, coefficient));
+		}
+	}
+
+	// This is the widely used "HELLO WORLD" version 1-M example.
+	const uint8_t DATA[] = {32,  91,  11, 120, 209, 114, 220,
+	                        77,  67,  64, 236, 17,  236, 17,
+	                        236, 17};
+	const uint8_t PARITY[] = {196, 35, 39, 119, 235, 215, 231, 226, 93, 23};
+
+	std::vector<uint8_t> parity(sizeof(PARITY));
+	qr::computeParity(DATA, sizeof(DATA), parity.data(), parity.size());
+	std::vector<uint8_t> expected(PARITY, PARITY + sizeof(PARITY));
+	assertEquals(true, expected == parity);
+}
+
+void QRTest::testLayout()
+{
+	using namespace vrfy::assert;
+
+	for(int version = 1; version <= 40; ++version)
+	{
+		for(int level = 0; level < 4; ++level)
+		{
+			qr::QRCode::ErrorCorrection errorCorrection =
+			        static_cast<qr::QRCode::ErrorCorrection>(level);
+
+			// Byte mode spends four bits on the mode indicator, and
+			// 8 or 16 bits on the length.
+			std::size_t headerBits = version < 10 ? 12 : 20;
+			std::size_t bits = qr::getDataCodewordCount(
+			                           version, errorCorrection) *
+			                   8;
+			assertEquals((bits - headerBits) / 8,
+			             qr::getCapacity(version, errorCorrection));
+		}
+	}
+
+	qr::ModuleMatrix matrix(qr::QRCode(getTestData(700, 2).data(), 0, 700)
+	                                .getModules());
+	qr::ModuleMatrix transposed(matrix.getTransposed());
+	bool same = true;
+	for(std::size_t y = 0; y < matrix.getWidth(); ++y)
+	{
+		for(std::size_t x = 0; x < matrix.getWidth(); ++x)
+			same = same && matrix.get(x, y) == transposed.get(y, x);
+	}
+	assertEquals(true, same);
+	assertEquals(true, matrix == transposed.getTransposed());
+
+	// Rebuilding the matrix from its dark runs should give it back.
+	qr::ModuleMatrix rebuilt(matrix.getWidth());
+	for(std::size_t y = 0; y < matrix.getWidth(); ++y)
+	{
+		matrix.forEachDarkRun(
+		        y, [&rebuilt, y](std::size_t x, std::size_t length)
+		        {
+			        for(std::size_t i = 0; i < length; ++i)
+				        rebuilt.set(x + i, y, true);
+			});
+	}
+	assertEquals(true, matrix == rebuilt);
+}
+
+void QRTest::testAgainstQREncode()
+{
+	using namespace vrfy::assert;
+
+	const std::size_t SIZES[] = {1, 17, 18, 100, 271, 272, 1000, 2953};
+	for(std::size_t size : SIZES)
+	{
+		std::vector<uint8_t> data(getTestData(size, size));
+		qr::QRCode code(data.data(), 0, data.size());
+
+		std::shared_ptr<QRcode> reference(
+		        QRcode_encodeData(static_cast<int>(size), data.data(),
+		                          code.getVersion(), QR_ECLEVEL_L),
+		        QRcode_free);
+		assertEquals(true, reference.get() != nullptr);
+		assertEquals(code.getVersion(), reference->version);
+		assertEquals(code.getWidth(),
+		             static_cast<std::size_t>(reference->width));
+
+		std::size_t width = code.getWidth();
+		auto referenceDark = [&](std::size_t x, std::size_t y)
+		{
+			return (reference->data[y * width + x] & 0x01) != 0;
+		};
+		auto ourDark = [&](std::size_t x, std::size_t y)
+		{
+			return code.getModules().get(x, y);
+		};
+
+		// The two encoders may pick different masks, since the penalty
+		// rules are open to interpretation. So, compare the data
+		// modules with their masks removed, and everything else except
+		// the format information (which includes the mask) directly.
+		unsigned int referenceMask = getMask(referenceDark);
+		unsigned int ourMask = getMask(ourDark);
+
+		bool same = true;
+		for(std::size_t y = 0; y < width; ++y)
+		{
+			for(std::size_t x = 0; x < width; ++x)
+			{
+				bool ours = ourDark(x, y);
+				bool theirs = referenceDark(x, y);
+
+				// Skip the format information, and unmask data.
+				uint8_t flags = reference->data[y * width + x];
+				if(flags & 0x04)
+					continue;
+				if(!(flags & 0x80))
+				{
+					ours ^= isMasked(ourMask, x, y);
+					theirs ^= isMasked(referenceMask, x, y);
+				}
+
+				same = same && (ours == theirs);
+			}
+		}
+		assertEquals(true, same);
+	}
+}
+
+void QRTest::testParallel()
+{
+	using namespace vrfy::assert;
+
+	const std::size_t capacity = qr::getMaximumCapacity();
+	std::vector<std::vector<uint8_t>> buffers;
+	buffers.push_back(getTestData(capacity * 5 + 100, 1));
+	buffers.push_back(getTestData(1, 2));
+	buffers.push_back(getTestData(capacity, 3));
+
+	std::vector<qr::QRCode> expected;
+	for(const std::vector<uint8_t> &buffer : buffers)
+	{
+		std::vector<qr::QRCode> codes(
+		        qr::encode(buffer.data(), buffer.size()));
+		for(qr::QRCode &code : codes)
+			expected.push_back(std::move(code));
+	}
+	assertEquals(static_cast<std::size_t>(8), expected.size());
+
+	std::vector<qr::QRCode> single(qr::encode(
+	        buffers[0].data(), buffers[0].size(), 4));
+	std::vector<qr::QRCode> all(qr::encode(buffers, 4));
+	assertEquals(static_cast<std::size_t>(6), single.size());
+	assertEquals(expected.size(), all.size());
+
+	bool same = true;
+	for(std::size_t i = 0; i < expected.size(); ++i)
+	{
+		const qr::ModuleMatrix &modules = expected[i].getModules();
+		same = same && (all[i].getModules() == modules);
+		if(i < single.size())
+			same = same && (single[i].getModules() == modules);
+	}
+	assertEquals(true, same);
+}
+
+void QRTest::testPlanner()
+{
+	using namespace vrfy::assert;
+
+	const std::size_t SIZES[] = {1, 300, 2953, 2954, 5000, 20000};
+	const int VERSIONS[] = {5, 10, 25, 40};
+	bool optimal = true;
+	for(std::size_t size : SIZES)
+	{
+		for(int version : VERSIONS)
+		{
+			qr::PlanConstraints constraints;
+			constraints.maximumVersion = version;
+			constraints.errorCorrection =
+			        qr::QRCode::ErrorCorrection::Medium;
+			qr::Plan plan(qr::getPlan(size, constraints));
+
+			// Try every possible chunk size by brute force.
+			auto getModules = [&constraints](std::size_t bytes)
+			{
+				return qr::getModuleCount(qr::getMinimumVersion(
+				        bytes, constraints.errorCorrection));
+			};
+
+			std::size_t best = 0;
+			std::size_t capacity = qr::getCapacity(
+			        version, constraints.errorCorrection);
+			for(std::size_t chunk = 1; chunk <= capacity; ++chunk)
+			{
+				std::size_t codes = (size + chunk - 1) / chunk;
+				std::size_t last = size - (codes - 1) * chunk;
+				std::size_t modules =
+				        (codes - 1) * getModules(chunk) +
+				        getModules(last);
+				if((best == 0) || (modules < best))
+					best = modules;
+			}
+
+			optimal = optimal && (plan.moduleCount == best) &&
+			          (plan.version <= version) &&
+			          (plan.chunkSize * plan.codeCount >= size);
+		}
+	}
+	assertEquals(true, optimal);
+
+	// The planned codes should be encoded as planned.
+	std::vector<uint8_t> data(getTestData(5000, 4));
+	qr::PlanConstraints constraints;
+	constraints.maximumVersion = 10;
+	constraints.errorCorrection = qr::QRCode::ErrorCorrection::Quartile;
+	qr::Plan plan(qr::getPlan(data.size(), constraints));
+	std::vector<qr::QRCode> codes(
+	        qr::encode(data.data(), data.size(), 2, constraints));
+	assertEquals(plan.codeCount, codes.size());
+	std::size_t modules = 0;
+	for(const qr::QRCode &code : codes)
+	{
+		assertEquals(true, code.getVersion() <= plan.version);
+		assertEquals(true, code.getErrorCorrection() ==
+		                           constraints.errorCorrection);
+		modules += code.getWidth() * code.getWidth();
+	}
+	assertEquals(plan.moduleCount, modules);
+
+	// A code count limit which can't be met should be rejected.
+	constraints.maximumCodes = plan.codeCount - 1;
+	bool threw = false;
+	try
+	{
+		qr::getPlan(data.size(), constraints);
+	}
+	catch(const std::runtime_error &)
+	{
+		threw = true;
+	}
+	assertEquals(true, threw);
+}
+
+void QRTest::testColor()
+{
+	using namespace vrfy::assert;
+
+	// Overlay two QR codes of one size and a smaller, rectangular Data
+	// Matrix symbol, which is centered.
+	std::vector<symbol::Symbol> codes;
+	for(uint32_t seed = 1; seed <= 3; ++seed)
+	{
+		std::size_t size = seed == 3 ? 12 : 100;
+		std::vector<uint8_t> data(getTestData(size, seed));
+		codes.push_back(symbol::Symbol(
+		        data.data(), 0, data.size(),
+		        seed == 3 ? symbol::Symbology::DataMatrix
+		                  : symbol::Symbology::QR));
+	}
+	assertEquals(true, codes[2].getWidth() != codes[2].getHeight());
+
+	render::Layers layers = {{&codes[0], &codes[1], &codes[2]}};
+	std::size_t width = render::getLayersWidth(layers);
+	std::size_t height = render::getLayersHeight(layers);
+	assertEquals(codes[0].getWidth(), width);
+	assertEquals(codes[0].getHeight(), height);
+	assertEquals(0xFFFFFFu, render::getLayersColor(0));
+	assertEquals(0x000000u, render::getLayersColor(7));
+	assertEquals(0x00FFFFu, render::getLayersColor(1));
+
+	render::Image image(render::rasterizeLayers(layers, 3));
+	assertEquals(width * 3, image.width);
+
+	// Each separated layer should sample back to exactly its own code.
+	bool same = true;
+	for(std::size_t l = 0; l < render::LAYER_COUNT; ++l)
+	{
+		render::Image gray(render::separateLayer(
+		        image, static_cast<render::Layer>(l)));
+		qr::ModuleMatrix page(
+		        render::sampleModules(gray, width, height));
+
+		const qr::ModuleMatrix &modules = codes[l].getModules();
+		std::size_t w = modules.getWidth();
+		std::size_t h = modules.getHeight();
+		std::size_t left = (width - w) / 2;
+		std::size_t top = (height - h) / 2;
+		for(std::size_t y = 0; y < height; ++y)
+		{
+			for(std::size_t x = 0; x < width; ++x)
+			{
+				std::size_t mx = x - left;
+				std::size_t my = y - top;
+				bool inside = (x >= left) && (mx < w) &&
+				              (y >= top) && (my < h);
+				bool dark = inside && modules.get(mx, my);
+				same = same && (page.get(x, y) == dark);
+			}
+		}
+	}
+	assertEquals(true, same);
+}
+}
+}
@@ -0,0 +1,96 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_TESTS_QR_TEST_H
+#define PAPER_TESTS_QR_TEST_H
+
+#include <Vrfy/Vrfy.h>
+
+namespace paper
+{
+namespace tests
+{
+/**
+ * \brief This class implements unit tests for our QR code encoder.
+ */
+class QRTest : public vrfy::Test
+{
+public:
+	/**
+	 * This is our default constructor, which creates a new instance of our
+	 * QR code tests.
+	 */
+	QRTest();
+
+	/**
+	 * This is our default destructor, which cleans up & destroys this
+	 * object.
+	 */
+	virtual ~QRTest();
+
+	/**
+	 * This function provides the main entrypoint for this class's unit
+	 * tests.
+	 */
+	virtual void test();
+
+private:
+	/**
+	 * This function verifies that our vectorized GF(256) arithmetic
+	 * matches plain multiplication, and that Reed-Solomon parity matches a
+	 * known QR code.
+	 */
+	void testReedSolomon();
+
+	/**
+	 * This function verifies that our capacity table matches the capacity
+	 * the encoder derives from the QR code specification, and that module
+	 * matrices transpose and scan correctly.
+	 */
+	void testLayout();
+
+	/**
+	 * This function verifies that our encoder produces the same QR codes
+	 * as libqrencode, apart from (possibly) the choice of mask.
+	 */
+	void testAgainstQREncode();
+
+	/**
+	 * This function verifies that encoding on several threads produces
+	 * the same QR codes, in the same order, as encoding on one.
+	 */
+	void testParallel();
+
+	/**
+	 * This function verifies that the chunk planner honours its
+	 * constraints, and finds the fewest total modules of any uniform chunk
+	 * size.
+	 */
+	void testPlanner();
+
+	/**
+	 * This function verifies that each layer of a colour image of
+	 * overlaid QR codes can be separated back out of its RGB pixels.
+	 */
+	void testColor();
+};
+}
+}
+
+#endif
@@ -0,0 +1,484 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ScanTest.h"
+
+#include "PaperCommon/QR/Decoder.h"
+#include "PaperCommon/QR/Encoder.h"
+#include "PaperCommon/QR/Layout.h"
+#include "PaperCommon/QR/ModuleMatrix.h"
+#include "PaperCommon/QR/QRCode.h"
+#include "PaperCommon/QR/ReedSolomon.h"
+#include "PaperCommon/Render/Color.h"
+#include "PaperCommon/Render/Image.h"
+#include "PaperCommon/Render/PNM.h"
+#include "PaperCommon/Render/SVG.h"
+#include "PaperCommon/Render/SVGReader.h"
+#include "PaperCommon/Scan/Detector.h"
+#include "PaperCommon/Scan/Scanner.h"
+#include "PaperCommon/Symbol/Symbol.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace
+{
+/**
+ * This function returns some pseudo-random test data of the given size.
+ *
+ * \param size The size of the data to generate.
+ * \param seed The seed to generate the data from.
+ * \return The generated data.
+ */
+std::vector<uint8_t> getTestData(std::size_t size, uint32_t seed)
+{
+	std::vector<uint8_t> data(size);
+	for(uint8_t &byte : data)
+	{
+		seed = seed * 1103515245 + 12345;
+		byte = static_cast<uint8_t>(seed >> 16);
+	}
+	return data;
+}
+
+/**
+ * This function renders the given symbols as an SVG image, the way they would
+ * be exported, and reads the image straight back.
+ *
+ * \param layers The symbol on each layer.
+ * \return The image read back, with one pixel per module.
+ */
+paper::render::Image writeAndReadSVG(const paper::render::Layers &layers)
+{
+	std::FILE *file = std::tmpfile();
+	if(file == nullptr)
+		throw std::runtime_error("Creating temporary file failed.");
+
+	std::string document;
+	try
+	{
+		int fd = fileno(file);
+		if((layers[1] == nullptr) && (layers[2] == nullptr))
+			paper::render::writeSVG(fd, *layers[0]);
+		else
+			paper::render::writeSVG(fd, layers);
+
+		off_t size = lseek(fd, 0, SEEK_END);
+		document.resize(static_cast<std::size_t>(size));
+		if(pread(fd, &document[0], document.size(), 0) != size)
+		{
+			throw std::runtime_error(
+			        "Reading temporary file failed.");
+		}
+	}
+	catch(...)
+	{
+		std::fclose(file);
+		throw;
+	}
+	std::fclose(file);
+
+	return paper::render::readSVG(
+	        reinterpret_cast<const uint8_t *>(document.data()),
+	        document.size());
+}
+
+/**
+ * This function renders the given symbol as a grayscale scan would see it,
+ * with a four module quiet zone, rotated about the image's center.
+ *
+ * \param modules The symbol to render.
+ * \param scale The width of each module, in pixels.
+ * \param angle The angle to rotate the symbol by, in radians.
+ * \return The rendered image.
+ */
+paper::render::Image renderScan(const paper::qr::ModuleMatrix &modules,
+                                double scale, double angle)
+{
+	double width = static_cast<double>(modules.getWidth());
+	std::size_t size = static_cast<std::size_t>(
+	        std::ceil((width + 8.0) * scale * 1.5));
+	paper::render::Image image(size, size, 1);
+
+	double center = static_cast<double>(size) / 2.0;
+	double cos = std::cos(angle);
+	double sin = std::sin(angle);
+	for(std::size_t y = 0; y < size; ++y)
+	{
+		for(std::size_t x = 0; x < size; ++x)
+		{
+			double dx = static_cast<double>(x) + 0.5 - center;
+			double dy = static_cast<double>(y) + 0.5 - center;
+			double u = (cos * dx + sin * dy) / scale + width / 2.0;
+			double v = (cos * dy - sin * dx) / scale + width / 2.0;
+			bool dark = (u >= 0.0) && (v >= 0.0) && (u < width) &&
+			            (v < width) &&
+			            modules.get(static_cast<std::size_t>(u),
+			                        static_cast<std::size_t>(v));
+			*image.getPixel(x, y) = dark ? 40 : 210;
+		}
+	}
+	return image;
+}
+}
+
+namespace paper
+{
+namespace tests
+{
+ScanTest::ScanTest()
+{
+}
+
+ScanTest::~ScanTest()
+{
+}
+
+void ScanTest::test()
+{
+	testReedSolomon();
+	testDecoder();
+	testPNM();
+	testScan();
+	testSVG();
+}
+
+void ScanTest::testReedSolomon()
+{
+	using namespace vrfy::assert;
+
+	const std::size_t DATA_SIZE = 100;
+	const std::size_t DEGREE = 20;
+	std::vector<uint8_t> block(getTestData(DATA_SIZE, 1));
+	block.resize(DATA_SIZE + DEGREE);
+	qr::computeParity(block.data(), DATA_SIZE, block.data() + DATA_SIZE,
+	                  DEGREE);
+
+	std::vector<uint8_t> intact(block);
+	assertEquals(0, qr::correctErrors(block.data(), block.size(), DEGREE));
+
+	// Damage the block more each time, until it can't be corrected.
+	std::vector<uint8_t> noise(getTestData(block.size(), 2));
+	for(std::size_t errors = 1; errors <= DEGREE / 2 + 1; ++errors)
+	{
+		std::vector<uint8_t> damaged(intact);
+		for(std::size_t i = 0; i < errors; ++i)
+			damaged[i * 11] ^= noise[i] | 1;
+
+		bool threw = false;
+		std::size_t corrected = 0;
+		try
+		{
+			corrected = qr::correctErrors(damaged.data(),
+			                              damaged.size(), DEGREE);
+		}
+		catch(const std::runtime_error &)
+		{
+			threw = true;
+		}
+
+		bool correctable = errors <= DEGREE / 2;
+		assertEquals(!correctable, threw);
+		if(correctable)
+		{
+			assertEquals(errors, corrected);
+			assertEquals(true, damaged == intact);
+		}
+	}
+}
+
+void ScanTest::testDecoder()
+{
+	using namespace vrfy::assert;
+
+	for(int version = 1; version <= 40; ++version)
+	{
+		qr::QRCode::ErrorCorrection level =
+		        static_cast<qr::QRCode::ErrorCorrection>(version % 4);
+		std::vector<uint8_t> data(getTestData(
+		        qr::getDataCodewordCount(version, level) / 2,
+		        static_cast<uint32_t>(version)));
+		qr::ModuleMatrix modules(qr::encodeSymbol(
+		        data.data(), data.size(), version, level));
+
+		// Flip a few data modules, which damages at most as many
+		// codewords as the smallest block can correct.
+		qr::ModuleMatrix function(qr::getFunctionModules(version));
+		std::size_t width = modules.getWidth();
+		std::size_t flipped = 0;
+		for(std::size_t i = 0; (i < width) && (flipped < 3); i += 7)
+		{
+			if(function.get(i, width - 1 - i))
+				continue;
+			modules.set(i, width - 1 - i,
+			            !modules.get(i, width - 1 - i));
+			++flipped;
+		}
+
+		qr::DecodeReport report;
+		std::vector<uint8_t> decoded(
+		        qr::decodeSymbol(modules, &report));
+		assertEquals(true, decoded == data);
+		assertEquals(version, report.version);
+		assertEquals(static_cast<int>(level),
+		             static_cast<int>(report.errorCorrection));
+		assertEquals(true, report.corrected <= flipped);
+	}
+
+	bool threw = false;
+	try
+	{
+		qr::decodeSymbol(qr::ModuleMatrix(21));
+	}
+	catch(const std::runtime_error &)
+	{
+		threw = true;
+	}
+	assertEquals(true, threw);
+}
+
+void ScanTest::testPNM()
+{
+	using namespace vrfy::assert;
+
+	render::Image image(3, 2, 3);
+	std::vector<uint8_t> pixels(getTestData(image.pixels.size(), 3));
+	image.pixels = pixels;
+	std::vector<uint8_t> encoded(render::writePNM(image));
+	assertEquals(true, render::isPNM(encoded.data(), encoded.size()));
+
+	render::Image decoded(render::readPNM(encoded.data(), encoded.size()));
+	assertEquals(image.width, decoded.width);
+	assertEquals(image.height, decoded.height);
+	assertEquals(image.channels, decoded.channels);
+	assertEquals(true, decoded.pixels == image.pixels);
+
+	// In a bitmap, 1 is black.
+	const char *BITMAP = "P1\n# A comment.\n3 2\n1 0 1\n0 1 0\n";
+	render::Image bitmap(
+	        render::readPNM(reinterpret_cast<const uint8_t *>(BITMAP),
+	                        std::strlen(BITMAP)));
+	const uint8_t BITMAP_PIXELS[] = {0, 255, 0, 255, 0, 255};
+	assertEquals(1, bitmap.channels);
+	assertEquals(true, bitmap.pixels ==
+	                           std::vector<uint8_t>(BITMAP_PIXELS,
+	                                                BITMAP_PIXELS + 6));
+
+	// Samples are scaled to 8 bits.
+	const char *GRAYMAP = "P2 2 1 1023 0 1023";
+	render::Image graymap(render::readPNM(
+	        reinterpret_cast<const uint8_t *>(GRAYMAP),
+	        std::strlen(GRAYMAP)));
+	assertEquals(0, graymap.pixels[0]);
+	assertEquals(255, graymap.pixels[1]);
+
+	bool threw = false;
+	try
+	{
+		render::readPNM(encoded.data(), encoded.size() - 1);
+	}
+	catch(const std::runtime_error &)
+	{
+		threw = true;
+	}
+	assertEquals(true, threw);
+}
+
+void ScanTest::testScan()
+{
+	using namespace vrfy::assert;
+
+	const double PI = 3.14159265358979323846;
+	const int VERSIONS[] = {1, 2, 7, 15, 40};
+	const double SCALES[] = {3.0, 2.5, 4.0, 2.2};
+	const double ANGLES[] = {0.0, 0.1, PI / 2.0 + 0.05, PI - 0.05};
+	for(std::size_t i = 0; i < sizeof(VERSIONS) / sizeof(int); ++i)
+	{
+		int version = VERSIONS[i];
+		std::vector<uint8_t> data(getTestData(
+		        qr::getDataCodewordCount(
+		                version, qr::QRCode::ErrorCorrection::Low) /
+		                2,
+		        static_cast<uint32_t>(version)));
+		qr::ModuleMatrix modules(qr::encodeSymbol(
+		        data.data(), data.size(), version,
+		        qr::QRCode::ErrorCorrection::Low));
+
+		for(std::size_t c = 0; c < 4; ++c)
+		{
+			render::Image image(
+			        renderScan(modules, SCALES[c], ANGLES[c]));
+			qr::DecodeReport report;
+			std::vector<uint8_t> scanned(
+			        scan::scanImage(image, &report));
+			assertEquals(true, scanned == data);
+			assertEquals(version, report.version);
+		}
+	}
+
+	// A blank page has no code on it.
+	bool notFound = false;
+	try
+	{
+		scan::scanImage(render::Image(200, 200, 1));
+	}
+	catch(const scan::NotFoundError &)
+	{
+		notFound = true;
+	}
+	assertEquals(true, notFound);
+
+	// Each layer of a colour page is read separately, skipping empty
+	// layers. The page is drawn inset, so it has a quiet zone.
+	std::vector<symbol::Symbol> codes;
+	for(uint32_t seed = 1; seed <= 2; ++seed)
+	{
+		std::vector<uint8_t> code(getTestData(100, seed));
+		codes.push_back(symbol::Symbol(code.data(), 0, code.size(),
+		                               symbol::Symbology::QR));
+	}
+	render::Layers layers = {{&codes[0], &codes[1], nullptr}};
+	render::Image page(render::rasterizeLayers(layers, 3));
+	const std::size_t MARGIN = 12;
+	render::Image color(page.width + 2 * MARGIN, page.height + 2 * MARGIN,
+	                    3);
+	for(std::size_t y = 0; y < page.height; ++y)
+	{
+		std::memcpy(color.getPixel(MARGIN, y + MARGIN),
+		            page.getPixel(0, y), page.width * 3);
+	}
+
+	std::vector<std::vector<uint8_t>> scanned(scan::scanColorImage(color));
+	assertEquals(2, scanned.size());
+	assertEquals(true, scanned[0] == getTestData(100, 1));
+	assertEquals(true, scanned[1] == getTestData(100, 2));
+}
+
+void ScanTest::testSVG()
+{
+	using namespace vrfy::assert;
+
+	std::vector<uint8_t> data(getTestData(50, 22));
+	qr::ModuleMatrix modules(qr::encodeSymbol(
+	        data.data(), data.size(), 4, qr::QRCode::ErrorCorrection::Low));
+
+	// Draw the symbol the way Qt's SVG generator does: a white background,
+	// and each dark run as a rectangle, inside a transformed group.
+	const std::size_t CELL_SIZE = 5;
+	std::size_t size = modules.getWidth() * CELL_SIZE;
+	std::ostringstream svg;
+	svg << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	    << "<!-- Drawn <by> hand. -->\n"
+	    << "<svg width=\"10mm\" height=\"10mm\" viewBox=\"0 0 " << size
+	    << " " << size << "\" version=\"1.2\">\n"
+	    << "<g fill=\"none\" stroke=\"black\">\n"
+	    << "<g fill=\"#ffffff\" transform=\"matrix(1,0,0,1,0,0)\">\n"
+	    << "<rect x=\"0\" y=\"0\" width=\"" << size << "\" height=\""
+	    << size << "\"/>\n</g>\n"
+	    << "<g fill=\"#000000\" transform=\"matrix(1,0,0,1,0,0)\">\n";
+	for(std::size_t y = 0; y < modules.getHeight(); ++y)
+	{
+		modules.forEachDarkRun(
+		        y, [&](std::size_t x, std::size_t length)
+		        {
+			        svg << "<rect x=\"" << x * CELL_SIZE
+			            << "\" y=\"" << y * CELL_SIZE
+			            << "\" width=\"" << length * CELL_SIZE
+			            << "\" height=\"" << CELL_SIZE << "\"/>\n";
+			});
+	}
+	svg << "</g>\n</g>\n</svg>\n";
+
+	std::string document(svg.str());
+	render::Image image(render::readSVG(
+	        reinterpret_cast<const uint8_t *>(document.data()),
+	        document.size()));
+	assertEquals(modules.getWidth(), image.width);
+	assertEquals(modules.getHeight(), image.height);
+
+	qr::ModuleMatrix read(render::sampleModules(
+	        render::getGrayscale(image), image.width, image.height));
+	assertEquals(true, read == modules);
+	assertEquals(true, qr::decodeSymbol(read) == data);
+
+	// Our own renderer's output reads back to the same modules, in mono
+	// and in colour.
+	std::vector<symbol::Symbol> codes;
+	for(uint32_t seed = 1; seed <= 3; ++seed)
+	{
+		std::vector<uint8_t> code(getTestData(100, 20 + seed));
+		codes.push_back(symbol::Symbol(code.data(), 0, code.size(),
+		                               symbol::Symbology::QR));
+	}
+	render::Layers mono = {{&codes[0], nullptr, nullptr}};
+	render::Image written(writeAndReadSVG(mono));
+	assertEquals(true, render::sampleModules(render::getGrayscale(written),
+	                                         written.width,
+	                                         written.height) ==
+	                           codes[0].getModules());
+
+	render::Layers layers = {{&codes[0], &codes[1], &codes[2]}};
+	written = writeAndReadSVG(layers);
+	render::Image expected(render::rasterizeLayers(layers, 1));
+	assertEquals(expected.width, written.width);
+	assertEquals(expected.height, written.height);
+	assertEquals(true, written.pixels == expected.pixels);
+
+	// Rectangles off the module grid can't have come from our renderer.
+	const char *UNALIGNED = "<svg viewBox=\"0 0 10 10\">"
+	                        "<rect x=\"0.5\" y=\"0\" width=\"4\" "
+	                        "height=\"4\"/></svg>";
+	bool threw = false;
+	try
+	{
+		render::readSVG(reinterpret_cast<const uint8_t *>(UNALIGNED),
+		                std::strlen(UNALIGNED));
+	}
+	catch(const std::runtime_error &)
+	{
+		threw = true;
+	}
+	assertEquals(true, threw);
+
+	// Paths are only read if they're made of rectangles.
+	const char *TRIANGLE = "<svg viewBox=\"0 0 10 10\">"
+	                       "<path d=\"M0 0h4v4z\"/></svg>";
+	threw = false;
+	try
+	{
+		render::readSVG(reinterpret_cast<const uint8_t *>(TRIANGLE),
+		                std::strlen(TRIANGLE));
+	}
+	catch(const std::runtime_error &)
+	{
+		threw = true;
+	}
+	assertEquals(true, threw);
+}
+}
+}
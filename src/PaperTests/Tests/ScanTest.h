@@ -0,0 +1,89 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_TESTS_SCAN_TEST_H
+#define PAPER_TESTS_SCAN_TEST_H
+
+#include <Vrfy/Vrfy.h>
+
+namespace paper
+{
+namespace tests
+{
+/**
+ * \brief This class implements unit tests for reading QR codes back out of
+ * scanned images.
+ */
+class ScanTest : public vrfy::Test
+{
+public:
+	/**
+	 * This is our default constructor, which creates a new instance of our
+	 * scanning tests.
+	 */
+	ScanTest();
+
+	/**
+	 * This is our default destructor, which cleans up & destroys this
+	 * object.
+	 */
+	virtual ~ScanTest();
+
+	/**
+	 * This function provides the main entrypoint for this class's unit
+	 * tests.
+	 */
+	virtual void test();
+
+private:
+	/**
+	 * This function verifies that Reed-Solomon blocks with up to half as
+	 * many errors as parity codewords are corrected, and that blocks with
+	 * more are rejected.
+	 */
+	void testReedSolomon();
+
+	/**
+	 * This function verifies that damaged symbols of every version decode
+	 * back to the data they were encoded from.
+	 */
+	void testDecoder();
+
+	/**
+	 * This function verifies that Netpbm images round trip, and that the
+	 * plain text formats are parsed.
+	 */
+	void testPNM();
+
+	/**
+	 * This function verifies that rendered symbols are found and read at
+	 * various scales and orientations.
+	 */
+	void testScan();
+
+	/**
+	 * This function verifies that symbols drawn as SVG rectangles, by Qt or
+	 * by our own renderer, are read straight back into their modules.
+	 */
+	void testSVG();
+};
+}
+}
+
+#endif
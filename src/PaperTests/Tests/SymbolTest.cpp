@@ -0,0 +1,175 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "SymbolTest.h"
+
+#include "PaperCommon/DataMatrix/DataMatrix.h"
+#include "PaperCommon/DataMatrix/ReedSolomon.h"
+#include "PaperCommon/QR/Coding.h"
+#include "PaperCommon/QR/Planner.h"
+#include "PaperCommon/Symbol/Symbol.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+/**
+ * This function returns some pseudo-random test data of the given size.
+ *
+ * \param size The size of the data to generate.
+ * \param seed The seed to generate the data from.
+ * \return The generated data.
+ */
+std::vector<uint8_t> getTestData(std::size_t size, uint32_t seed)
+{
+	std::vector<uint8_t> data(size);
+	for(uint8_t &byte : data)
+	{
+		seed = seed * 1103515245 + 12345;
+		byte = static_cast<uint8_t>(seed >> 16);
+	}
+	return data;
+}
+}
+
+namespace paper
+{
+namespace tests
+{
+SymbolTest::SymbolTest()
+{
+}
+
+SymbolTest::~SymbolTest()
+{
+}
+
+void SymbolTest::test()
+{
+	testDataMatrix();
+	testAuto();
+}
+
+void SymbolTest::testDataMatrix()
+{
+	using namespace vrfy::assert;
+
+	// This is the ISO/IEC 16022 "123456" example, in a 10x10 symbol.
+	const uint8_t DATA[] = {142, 164, 186};
+	const uint8_t PARITY[] = {114, 25, 5, 88, 102};
+	std::vector<uint8_t> parity(sizeof(PARITY));
+	datamatrix::computeParity(DATA, sizeof(DATA), parity.data(),
+	                          parity.size());
+	assertEquals(true, std::equal(parity.begin(), parity.end(), PARITY));
+
+	bool same = true;
+	for(int version = 1; version <= datamatrix::VERSION_COUNT; ++version)
+	{
+		std::size_t capacity = datamatrix::getCapacity(version);
+		for(std::size_t size : {std::size_t(0), capacity / 2, capacity})
+		{
+			std::vector<uint8_t> data(getTestData(size, 1));
+			datamatrix::DataMatrix code(data.data(), 0, size);
+			same = same && (datamatrix::decode(code.getModules()) ==
+			                data);
+		}
+
+		// Every symbol has a solid "L" on its left and bottom edges.
+		std::vector<uint8_t> data(getTestData(capacity, 2));
+		datamatrix::DataMatrix code(data.data(), 0, capacity);
+		const qr::ModuleMatrix &modules = code.getModules();
+		assertEquals(datamatrix::getWidth(code.getVersion()),
+		             modules.getWidth());
+		std::size_t bottom = modules.getHeight() - 1;
+		for(std::size_t x = 0; x < modules.getWidth(); ++x)
+			same = same && modules.get(x, bottom);
+		for(std::size_t y = 0; y < modules.getHeight(); ++y)
+			same = same && modules.get(0, y);
+	}
+	assertEquals(true, same);
+
+	// Damaging any data module should be detected.
+	std::vector<uint8_t> data(getTestData(100, 3));
+	datamatrix::DataMatrix code(data.data(), 0, data.size());
+	qr::ModuleMatrix damaged(code.getModules());
+	damaged.set(5, 5, !damaged.get(5, 5));
+
+	bool threw = false;
+	try
+	{
+		datamatrix::decode(damaged);
+	}
+	catch(const std::runtime_error &)
+	{
+		threw = true;
+	}
+	assertEquals(true, threw);
+}
+
+void SymbolTest::testAuto()
+{
+	using namespace vrfy::assert;
+
+	// Data Matrix needs a much smaller quiet zone, so it wins for small
+	// payloads, while QR codes store more per module at large sizes.
+	for(std::size_t size : {10u, 100u, 1000u, 100000u})
+	{
+		qr::PlanConstraints constraints;
+		qr::Plan qr(qr::getPlan(size, constraints));
+		constraints.symbology = symbol::Symbology::DataMatrix;
+		qr::Plan dm(qr::getPlan(size, constraints));
+		constraints.symbology = symbol::Symbology::Auto;
+		qr::Plan best(qr::getPlan(size, constraints));
+
+		assertEquals(std::min(qr.area, dm.area), best.area);
+		assertEquals(true, best.symbology != symbol::Symbology::Auto);
+	}
+
+	qr::PlanConstraints constraints;
+	constraints.symbology = symbol::Symbology::Auto;
+	assertEquals(true, qr::getPlan(10, constraints).symbology ==
+	                           symbol::Symbology::DataMatrix);
+	assertEquals(true, qr::getPlan(100000, constraints).symbology ==
+	                           symbol::Symbology::QR);
+
+	// Data Matrix symbols should hold their chunks of the buffer, in
+	// order.
+	constraints.symbology = symbol::Symbology::DataMatrix;
+	std::vector<std::vector<uint8_t>> buffers(1, getTestData(5000, 4));
+	std::vector<symbol::Symbol> codes(
+	        qr::encodeSymbols(buffers, 2, constraints));
+	assertEquals(qr::getCodeCount(5000, constraints), codes.size());
+
+	std::vector<uint8_t> decoded;
+	for(const symbol::Symbol &code : codes)
+	{
+		assertEquals(true, code.getSymbology() ==
+		                           symbol::Symbology::DataMatrix);
+		std::vector<uint8_t> chunk(
+		        datamatrix::decode(code.getModules()));
+		decoded.insert(decoded.end(), chunk.begin(), chunk.end());
+	}
+	assertEquals(true, decoded == buffers[0]);
+}
+}
+}
@@ -0,0 +1,71 @@
+/*
+ * Paper - An application for storing & loading data using QR codes.
+ * Copyright (C) 2014  Axel Rasmussen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAPER_TESTS_SYMBOL_TEST_H
+#define PAPER_TESTS_SYMBOL_TEST_H
+
+#include <Vrfy/Vrfy.h>
+
+namespace paper
+{
+namespace tests
+{
+/**
+ * \brief This class implements unit tests for our Data Matrix encoder, and
+ * for choosing between symbologies.
+ */
+class SymbolTest : public vrfy::Test
+{
+public:
+	/**
+	 * This is our default constructor, which creates a new instance of our
+	 * symbol tests.
+	 */
+	SymbolTest();
+
+	/**
+	 * This is our default destructor, which cleans up & destroys this
+	 * object.
+	 */
+	virtual ~SymbolTest();
+
+	/**
+	 * This function provides the main entrypoint for this class's unit
+	 * tests.
+	 */
+	virtual void test();
+
+private:
+	/**
+	 * This function verifies that Data Matrix parity matches a known
+	 * symbol, and that every symbol size round trips through decode().
+	 */
+	void testDataMatrix();
+
+	/**
+	 * This function verifies that the automatic symbology picks whichever
+	 * plan needs the least printed area, and that the planned symbols
+	 * store the data they were given.
+	 */
+	void testAuto();
+};
+}
+}
+
+#endif